@@ -0,0 +1,582 @@
+#include "arm64_encoder.h"
+
+static const int IP0 = 16, IP1 = 17, FP = 29, LR = 30, SP = 31;
+static const uint32_t ALWAYS = 0xff;
+
+static void emit(std::vector<uint8_t>& out, uint32_t word) {
+    for (int i = 0; i < 4; ++i) out.push_back((word >> (8 * i)) & 0xff);
+}
+
+// movz (or movn when most 16-bit chunks are all ones) for the first chunk
+// that differs from the fill, then movk for each remaining one; 0 and -1
+// take a single movz or movn of chunk 0
+static void movImmediate(std::vector<uint8_t>& out, int dest, int64_t value) {
+    uint64_t bits = static_cast<uint64_t>(value);
+    int zeros = 0, ones = 0;
+    for (int hw = 0; hw < 4; ++hw) {
+        uint64_t chunk = (bits >> (16 * hw)) & 0xffff;
+        if (chunk == 0) zeros++;
+        if (chunk == 0xffff) ones++;
+    }
+    bool inverted = ones > zeros;
+    uint64_t fill = inverted ? 0xffff : 0;
+
+    bool first = true;
+    for (uint32_t hw = 0; hw < 4; ++hw) {
+        uint32_t chunk = static_cast<uint32_t>((bits >> (16 * hw)) & 0xffff);
+        if (chunk == fill && !(first && hw == 0 && (bits >> 16) == (inverted ? 0xffffffffffffull : 0))) continue;
+        if (first) {
+            uint32_t opcode = inverted ? 0x92800000 : 0xd2800000;
+            emit(out, opcode | hw << 21 | (inverted ? ~chunk & 0xffff : chunk) << 5 | dest);
+            first = false;
+        } else {
+            emit(out, 0xf2800000 | hw << 21 | chunk << 5 | dest);
+        }
+    }
+}
+
+// mov d, s; orr reads register 31 as xzr, so sp goes through add #0
+static void movRR(std::vector<uint8_t>& out, int dest, int src) {
+    if (dest == src) return;
+    if (dest == SP || src == SP) {
+        emit(out, 0x91000000 | src << 5 | dest);
+    } else {
+        emit(out, 0xaa0003e0 | src << 16 | dest);
+    }
+}
+
+// add or sub d, n, m, in the extended-register form when sp is involved
+static void addRR(std::vector<uint8_t>& out, bool subtract, int dest, int left, int right) {
+    uint32_t opcode = subtract ? 0xcb000000 : 0x8b000000;
+    if (dest == SP || left == SP) opcode |= 0x00206000;     // uxtx
+    emit(out, opcode | right << 16 | left << 5 | dest);
+}
+
+// add or sub d, n, #value using the 12-bit immediate and its lsl #12 form;
+// false when the magnitude needs more than 24 bits
+static bool addImmediate(std::vector<uint8_t>& out, bool subtract, int dest, int left, int64_t value) {
+    if (value < 0) {
+        subtract = !subtract;
+        value = -value;
+    }
+    if (value >= (1 << 24)) return false;
+    uint32_t opcode = subtract ? 0xd1000000 : 0x91000000;
+    uint32_t high = static_cast<uint32_t>(value >> 12);
+    uint32_t low = static_cast<uint32_t>(value & 0xfff);
+    if (high) {
+        emit(out, opcode | 1 << 22 | high << 10 | left << 5 | dest);
+        left = dest;
+    }
+    if (low || !high) emit(out, opcode | low << 10 | left << 5 | dest);
+    return true;
+}
+
+// The N:immr:imms fields of and/orr/eor with an immediate: value must be a
+// repeated element of 2 to 64 bits holding one rotated run of ones
+static bool logicalImmediate(uint64_t value, uint32_t& fields) {
+    if (value == 0 || value == ~0ull) return false;
+    int size = 64;
+    while (size > 2) {
+        int half = size / 2;
+        uint64_t mask = (1ull << half) - 1;
+        if ((value & mask) != ((value >> half) & mask)) break;
+        size = half;
+    }
+    uint64_t mask = size == 64 ? ~0ull : (1ull << size) - 1;
+    uint64_t element = value & mask;
+    int ones = 0;
+    for (int i = 0; i < size; ++i) ones += (element >> i) & 1;
+    uint64_t run = (1ull << ones) - 1;
+
+    for (int r = 0; r < size; ++r) {
+        uint64_t rotated = r == 0 ? element : ((element >> r) | (element << (size - r))) & mask;
+        if (rotated == run) {
+            uint32_t immr = static_cast<uint32_t>((size - r) % size);
+            uint32_t imms = static_cast<uint32_t>(((~(size - 1) << 1) | (ones - 1)) & 0x3f);
+            fields = (size == 64 ? 1u << 22 : 0) | immr << 16 | imms << 10;
+            return true;
+        }
+    }
+    return false;
+}
+
+// One load or store instruction pair: the unsigned offset form scaled by
+// the access size, and the unscaled ldur/stur form
+struct MemoryForm {
+    uint32_t scaled;
+    uint32_t unscaled;
+    int size;
+};
+
+static const MemoryForm LOAD_X = {0xf9400000, 0xf8400000, 8};
+static const MemoryForm STORE_X = {0xf9000000, 0xf8000000, 8};
+static const MemoryForm LOAD_D = {0xfd400000, 0xfc400000, 8};
+static const MemoryForm STORE_D = {0xfd000000, 0xfc000000, 8};
+
+// adrp dest, target; add dest, dest, :lo12:target, both left to fixups
+static void address(std::vector<uint8_t>& out, int dest, Fixup::Target target, uint32_t symbol,
+                    std::vector<Fixup>& fixups) {
+    fixups.emplace_back(target, Fixup::PAGE21, out.size(), out.size(), symbol);
+    emit(out, 0x90000000 | dest);
+    fixups.emplace_back(target, Fixup::LO12, out.size(), out.size(), symbol);
+    emit(out, 0x91000000 | dest << 5 | dest);
+}
+
+// str x, [sp, #-16]! and ldr x, [sp], #16: sp has to stay 16-byte aligned
+static void push(std::vector<uint8_t>& out, int reg) {
+    emit(out, 0xf81f0fe0 | reg);
+}
+
+static void pop(std::vector<uint8_t>& out, int reg) {
+    emit(out, 0xf84107e0 | reg);
+}
+
+// Registers an instruction needs beyond its operands: the scratch
+// registers when no operand is held in them, otherwise x9-x15 saved on the
+// stack until release()
+class Temporaries {
+public:
+    Temporaries(std::vector<uint8_t>& out, std::initializer_list<int> busy) : out(out), busy(busy) {}
+
+    int take() {
+        for (int reg = IP0; reg <= IP1; ++reg) {
+            if (!isBusy(reg)) {
+                busy.push_back(reg);
+                return reg;
+            }
+        }
+        for (int reg = 9; reg <= 15; ++reg) {
+            if (!isBusy(reg)) {
+                busy.push_back(reg);
+                borrowed.push_back(reg);
+                push(out, reg);
+                return reg;
+            }
+        }
+        return IP0;
+    }
+
+    void release() {
+        for (auto it = borrowed.rbegin(); it != borrowed.rend(); ++it) pop(out, *it);
+        borrowed.clear();
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    std::vector<int> busy;
+    std::vector<int> borrowed;
+
+    bool isBusy(int reg) const {
+        for (int used : busy) {
+            if (used == reg) return true;
+        }
+        return false;
+    }
+};
+
+// Accesses [base + offset]. An offset neither form reaches is added to
+// the base in a temporary register; moving the base itself could leave sp
+// misaligned for the access.
+static void memory(std::vector<uint8_t>& out, const MemoryForm& form, int reg, int base, int32_t offset) {
+    if (offset >= 0 && offset % form.size == 0 && offset / form.size < 4096) {
+        emit(out, form.scaled | (offset / form.size) << 10 | base << 5 | reg);
+    } else if (offset >= -256 && offset < 256) {
+        emit(out, form.unscaled | (offset & 0x1ff) << 12 | base << 5 | reg);
+    } else {
+        Temporaries temps(out, {reg, base});
+        int address = temps.take();
+        if (!addImmediate(out, false, address, base, offset)) {
+            movImmediate(out, address, offset);
+            addRR(out, false, address, base, address);
+        }
+        emit(out, form.scaled | address << 5 | reg);
+        temps.release();
+    }
+}
+
+// Condition field of b.cond: signed after CMP; after FCMP mi and ls keep
+// unordered operands out of "less"
+static uint32_t conditionCode(Instruction::OpCode opcode, bool float_flags) {
+    switch (opcode) {
+        case Instruction::JE: return 0x0;
+        case Instruction::JNE: return 0x1;
+        case Instruction::JL: return float_flags ? 0x4 : 0xb;
+        case Instruction::JLE: return float_flags ? 0x9 : 0xd;
+        case Instruction::JG: return 0xc;
+        case Instruction::JGE: return 0xa;
+        default: return 0x0;
+    }
+}
+
+ARM64Encoder::ARM64Encoder(const RegisterFile& file)
+    : file(file), func(nullptr), frame_bytes(0), float_flags(false) {}
+
+int ARM64Encoder::encoding(VReg reg) const {
+    const Register& info = func->getRegister(reg);
+    return info.physical >= 0 ? file.get(info.type == Register::FLOAT, info.physical).encoding : 0;
+}
+
+bool ARM64Encoder::isFloat(VReg reg) const {
+    return func->getRegister(reg).type == Register::FLOAT;
+}
+
+// stp fp, lr, [sp, #-16]!; mov fp, sp; room for the spill slots and the
+// saved registers, which are stored from sp upwards
+void ARM64Encoder::beginFunction(const Function& function, std::vector<uint8_t>& out) {
+    func = &function;
+    float_flags = false;
+    saved_general.clear();
+    saved_floating.clear();
+    for (int physical : func->saved_general) {
+        int reg = file.general[physical].encoding;
+        if (reg != FP && reg != LR && reg != SP) saved_general.push_back(reg);
+    }
+    for (int physical : func->saved_floating) {
+        saved_floating.push_back(file.floating[physical].encoding);
+    }
+    int saved = static_cast<int>(saved_general.size() + saved_floating.size());
+    frame_bytes = (func->stack_size + 8 * saved + 15) & ~15;
+
+    emit(out, 0xa9bf7bfd);
+    movRR(out, FP, SP);
+    if (frame_bytes > 0) addImmediate(out, true, SP, SP, frame_bytes);
+    int offset = 0;
+    for (int reg : saved_general) {
+        memory(out, STORE_X, reg, SP, offset);
+        offset += 8;
+    }
+    for (int reg : saved_floating) {
+        memory(out, STORE_D, reg, SP, offset);
+        offset += 8;
+    }
+}
+
+void ARM64Encoder::epilogue(std::vector<uint8_t>& out) const {
+    // sp is recomputed from fp so the restores do not depend on the body
+    if (!saved_general.empty() || !saved_floating.empty()) {
+        addImmediate(out, true, SP, FP, frame_bytes);
+        int offset = 0;
+        for (int reg : saved_general) {
+            memory(out, LOAD_X, reg, SP, offset);
+            offset += 8;
+        }
+        for (int reg : saved_floating) {
+            memory(out, LOAD_D, reg, SP, offset);
+            offset += 8;
+        }
+    }
+    movRR(out, SP, FP);
+    emit(out, 0xa8c17bfd);      // ldp fp, lr, [sp], #16
+}
+
+// ADD, SUB, AND, OR and XOR d, a, b or d, a, #imm
+void ARM64Encoder::binary(const Instruction& instr, std::vector<uint8_t>& out) const {
+    bool arithmetic = instr.opcode == Instruction::ADD || instr.opcode == Instruction::SUB;
+    bool subtract = instr.opcode == Instruction::SUB;
+    uint32_t shifted, immediate;
+    switch (instr.opcode) {
+        case Instruction::AND: shifted = 0x8a000000; immediate = 0x92000000; break;
+        case Instruction::OR:  shifted = 0xaa000000; immediate = 0xb2000000; break;
+        default:               shifted = 0xca000000; immediate = 0xd2000000; break;
+    }
+
+    int dest = encoding(instr.operands[0]);
+    int left = encoding(instr.operands[1]);
+    int right;
+    Temporaries temps(out, {dest, left});
+    if (instr.num_operands == 3) {
+        right = encoding(instr.operands[2]);
+    } else {
+        int64_t value = instr.has_immediate ? instr.immediate : 0;
+        uint32_t fields;
+        if (arithmetic && addImmediate(out, subtract, dest, left, value)) return;
+        if (!arithmetic && logicalImmediate(static_cast<uint64_t>(value), fields)) {
+            emit(out, immediate | fields | left << 5 | dest);
+            return;
+        }
+        right = temps.take();
+        movImmediate(out, right, value);
+    }
+
+    if (arithmetic) {
+        addRR(out, subtract, dest, left, right);
+    } else {
+        emit(out, shifted | right << 16 | left << 5 | dest);
+    }
+    temps.release();
+}
+
+// MUL as madd with xzr, DIV as sdiv, MOD as sdiv and msub
+void ARM64Encoder::multiply(const Instruction& instr, std::vector<uint8_t>& out) const {
+    int dest = encoding(instr.operands[0]);
+    int left = encoding(instr.operands[1]);
+    int right = instr.num_operands == 3 ? encoding(instr.operands[2]) : -1;
+    Temporaries temps(out, {dest, left, right});
+    if (right < 0) {
+        right = temps.take();
+        movImmediate(out, right, instr.has_immediate ? instr.immediate : 1);
+    }
+
+    switch (instr.opcode) {
+        case Instruction::MUL:
+            emit(out, 0x9b007c00 | right << 16 | left << 5 | dest);
+            break;
+        case Instruction::DIV:
+            emit(out, 0x9ac00c00 | right << 16 | left << 5 | dest);
+            break;
+        default: {
+            // d = a - (a / b) * b
+            int quotient = temps.take();
+            emit(out, 0x9ac00c00 | right << 16 | left << 5 | quotient);
+            emit(out, 0x9b008000 | right << 16 | left << 10 | quotient << 5 | dest);
+            break;
+        }
+    }
+    temps.release();
+}
+
+// CMP a, b or CMP a, #imm as subs xzr (cmn for negative immediates)
+void ARM64Encoder::compare(const Instruction& instr, std::vector<uint8_t>& out) const {
+    int left = encoding(instr.operands[0]);
+    if (instr.num_operands == 2) {
+        emit(out, 0xeb00001f | encoding(instr.operands[1]) << 16 | left << 5);
+        return;
+    }
+
+    int64_t value = instr.has_immediate ? instr.immediate : 0;
+    uint32_t opcode = value < 0 ? 0xb100001f : 0xf100001f;
+    uint32_t magnitude = static_cast<uint32_t>(value < 0 ? -value : value);
+    if (magnitude < 4096) {
+        emit(out, opcode | magnitude << 10 | left << 5);
+    } else if ((magnitude & 0xfff) == 0 && magnitude < (1 << 24)) {
+        emit(out, opcode | 1 << 22 | (magnitude >> 12) << 10 | left << 5);
+    } else {
+        Temporaries temps(out, {left});
+        int right = temps.take();
+        movImmediate(out, right, value);
+        emit(out, 0xeb00001f | right << 16 | left << 5);
+        temps.release();
+    }
+}
+
+// b.cond, or b when condition is ALWAYS, to a label of this function. The
+// long form of b.cond, for targets beyond its 1 MB reach, is the inverted
+// condition skipping a b.
+void ARM64Encoder::branch(uint32_t condition, bool short_branch, uint32_t label, std::vector<uint8_t>& out,
+                          std::vector<Fixup>& fixups) const {
+    if (condition != ALWAYS && !short_branch) {
+        emit(out, 0x54000000 | 2 << 5 | (condition ^ 1));
+        condition = ALWAYS;
+    }
+    if (condition == ALWAYS) {
+        fixups.emplace_back(Fixup::LABEL, Fixup::BRANCH26, out.size(), out.size(), label);
+        emit(out, 0x14000000);
+    } else {
+        fixups.emplace_back(Fixup::LABEL, Fixup::BRANCH19, out.size(), out.size(), label);
+        emit(out, 0x54000000 | condition);
+    }
+}
+
+void ARM64Encoder::encode(const Instruction& instr, bool short_branch, std::vector<uint8_t>& out,
+                          std::vector<Fixup>& fixups) {
+    const VReg* ops = instr.operands;
+    switch (instr.opcode) {
+        case Instruction::MOV:
+            if (instr.num_operands == 1) {
+                if (!isFloat(ops[0])) {
+                    movImmediate(out, encoding(ops[0]), instr.immediate);
+                } else {
+                    // Float constants are the bits of a double, sign-extended
+                    // from the immediate: through the scratch register, then
+                    // fmov d, x
+                    int scratch = file.general[file.scratch_general[0]].encoding;
+                    movImmediate(out, scratch, instr.immediate);
+                    emit(out, 0x9e670000 | scratch << 5 | encoding(ops[0]));
+                }
+            } else if (isFloat(ops[0]) && isFloat(ops[1])) {
+                if (encoding(ops[0]) != encoding(ops[1])) {
+                    emit(out, 0x1e604000 | encoding(ops[1]) << 5 | encoding(ops[0]));
+                }
+            } else if (isFloat(ops[0])) {
+                emit(out, 0x9e670000 | encoding(ops[1]) << 5 | encoding(ops[0]));
+            } else if (isFloat(ops[1])) {
+                emit(out, 0x9e660000 | encoding(ops[1]) << 5 | encoding(ops[0]));
+            } else {
+                movRR(out, encoding(ops[0]), encoding(ops[1]));
+            }
+            break;
+
+        case Instruction::ADDR:
+            address(out, encoding(ops[0]), Fixup::DATA, instr.label, fixups);
+            break;
+
+        case Instruction::LOAD:
+            if (isFloat(ops[0])) {
+                memory(out, LOAD_D, encoding(ops[0]), encoding(ops[1]), instr.immediate);
+            } else {
+                memory(out, LOAD_X, encoding(ops[0]), encoding(ops[1]), instr.immediate);
+            }
+            break;
+
+        case Instruction::STORE:
+            memory(out, isFloat(ops[0]) ? STORE_D : STORE_X, encoding(ops[0]), encoding(ops[1]),
+                   instr.immediate);
+            break;
+
+        case Instruction::ADD: case Instruction::SUB:
+        case Instruction::AND: case Instruction::OR: case Instruction::XOR:
+            binary(instr, out);
+            break;
+
+        case Instruction::MUL: case Instruction::DIV: case Instruction::MOD:
+            multiply(instr, out);
+            break;
+
+        case Instruction::FADD: case Instruction::FSUB: case Instruction::FMUL: case Instruction::FDIV: {
+            uint32_t opcode;
+            switch (instr.opcode) {
+                case Instruction::FADD: opcode = 0x1e602800; break;
+                case Instruction::FSUB: opcode = 0x1e603800; break;
+                case Instruction::FMUL: opcode = 0x1e600800; break;
+                default:                opcode = 0x1e601800; break;
+            }
+            emit(out, opcode | encoding(ops[2]) << 16 | encoding(ops[1]) << 5 | encoding(ops[0]));
+            break;
+        }
+
+        case Instruction::CVTI2F:
+            // scvtf d, x
+            emit(out, 0x9e620000 | encoding(ops[1]) << 5 | encoding(ops[0]));
+            break;
+
+        case Instruction::CVTF2I:
+            // fcvtzs x, d
+            emit(out, 0x9e780000 | encoding(ops[1]) << 5 | encoding(ops[0]));
+            break;
+
+        case Instruction::CVTS2D:
+            // fcvt d, s
+            emit(out, 0x1e22c000 | encoding(ops[1]) << 5 | encoding(ops[0]));
+            break;
+
+        case Instruction::NOT:
+            // orn d, xzr, s
+            emit(out, 0xaa2003e0 | encoding(ops[1]) << 16 | encoding(ops[0]));
+            break;
+
+        case Instruction::SHL: case Instruction::SHR: {
+            int dest = encoding(ops[0]);
+            int left = encoding(ops[1]);
+            bool left_shift = instr.opcode == Instruction::SHL;
+            if (instr.num_operands == 3) {
+                // lslv or asrv
+                emit(out, (left_shift ? 0x9ac02000 : 0x9ac02800) | encoding(ops[2]) << 16 | left << 5 | dest);
+            } else {
+                uint32_t count = static_cast<uint32_t>(instr.has_immediate ? instr.immediate & 63 : 0);
+                if (left_shift) {
+                    // ubfm d, s, #(-count mod 64), #(63 - count)
+                    emit(out, 0xd3400000 | ((64 - count) & 63) << 16 | (63 - count) << 10 | left << 5 | dest);
+                } else {
+                    // sbfm d, s, #count, #63
+                    emit(out, 0x9340fc00 | count << 16 | left << 5 | dest);
+                }
+            }
+            break;
+        }
+
+        case Instruction::CMP:
+            compare(instr, out);
+            float_flags = false;
+            break;
+
+        case Instruction::FCMP:
+            emit(out, 0x1e602000 | encoding(ops[1]) << 16 | encoding(ops[0]) << 5);
+            float_flags = true;
+            break;
+
+        case Instruction::JMP:
+            branch(ALWAYS, short_branch, instr.label, out, fixups);
+            break;
+
+        case Instruction::JE: case Instruction::JNE: case Instruction::JL:
+        case Instruction::JLE: case Instruction::JG: case Instruction::JGE:
+            branch(conditionCode(instr.opcode, float_flags), short_branch, instr.label, out, fixups);
+            break;
+
+        case Instruction::JZ: case Instruction::JNZ: {
+            // cbz and cbnz leave the flags alone; the long form is the
+            // opposite one skipping a b
+            uint32_t opcode = (instr.opcode == Instruction::JZ ? 0xb4000000 : 0xb5000000) | encoding(ops[0]);
+            if (short_branch) {
+                fixups.emplace_back(Fixup::LABEL, Fixup::BRANCH19, out.size(), out.size(), instr.label);
+                emit(out, opcode);
+            } else {
+                emit(out, (opcode ^ 0x01000000) | 2 << 5);
+                branch(ALWAYS, true, instr.label, out, fixups);
+            }
+            break;
+        }
+
+        case Instruction::JMPT: {
+            // adrp base, table; add base, base, :lo12:table;
+            // ldrsw offset, [base, index, lsl #2]; add base, base, offset;
+            // br base. An index held in a scratch register is a spill
+            // reload that dies here, so it may take the offset.
+            int index = encoding(ops[0]);
+            int base = index == IP0 ? IP1 : IP0;
+            int offset = base == IP0 ? IP1 : IP0;
+            address(out, base, Fixup::TABLE, instr.label, fixups);
+            emit(out, 0xb8a07800 | index << 16 | base << 5 | offset);
+            addRR(out, false, base, base, offset);
+            emit(out, 0xd61f0000 | base << 5);
+            break;
+        }
+
+        case Instruction::CALL:
+            if (instr.label) {
+                fixups.emplace_back(Fixup::SYMBOL, Fixup::BRANCH26, out.size(), out.size(), instr.label);
+                emit(out, 0x94000000);
+            } else {
+                emit(out, 0xd63f0000 | encoding(ops[instr.num_operands - 1]) << 5);
+            }
+            break;
+
+        case Instruction::RET:
+            epilogue(out);
+            emit(out, 0xd65f03c0);
+            break;
+
+        case Instruction::TAILCALL:
+            epilogue(out);
+            fixups.emplace_back(Fixup::SYMBOL, Fixup::BRANCH26, out.size(), out.size(), instr.label);
+            emit(out, 0x14000000);
+            break;
+
+        case Instruction::PUSH:
+            if (instr.num_operands == 0) {
+                int scratch = file.general[file.scratch_general[0]].encoding;
+                movImmediate(out, scratch, instr.immediate);
+                push(out, scratch);
+            } else if (isFloat(ops[0])) {
+                emit(out, 0xfc1f0fe0 | encoding(ops[0]));     // str d, [sp, #-16]!
+            } else {
+                push(out, encoding(ops[0]));
+            }
+            break;
+
+        case Instruction::POP:
+            if (isFloat(ops[0])) {
+                emit(out, 0xfc4107e0 | encoding(ops[0]));     // ldr d, [sp], #16
+            } else {
+                pop(out, encoding(ops[0]));
+            }
+            break;
+
+        case Instruction::NOP:
+            emit(out, 0xd503201f);
+            break;
+
+        case Instruction::LABEL:
+            break;
+    }
+}
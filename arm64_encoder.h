@@ -0,0 +1,35 @@
+#pragma once
+
+#include "encoder.h"
+
+// AArch64 encoder for allocated code. The three-address IR maps onto the
+// instruction set almost one to one; constants that do not fit an
+// instruction's immediate field are built with movz/movn/movk in a
+// temporary register, and floats are doubles in the d registers.
+// Every function gets a frame record (fp, lr) with its spill slots and the
+// callee-saved registers it uses below fp.
+class ARM64Encoder : public MachineEncoder {
+public:
+    explicit ARM64Encoder(const RegisterFile& file);
+
+    void beginFunction(const Function& func, std::vector<uint8_t>& out) override;
+    void encode(const Instruction& instr, bool short_branch, std::vector<uint8_t>& out,
+                std::vector<Fixup>& fixups) override;
+
+private:
+    const RegisterFile& file;
+    const Function* func;
+    std::vector<int> saved_general;     // Stored from sp upwards by the prologue
+    std::vector<int> saved_floating;    // Stored after the general registers, as d registers
+    int frame_bytes;                    // Spill slots and saved registers below fp
+    bool float_flags;                   // The last compare was FCMP, so conditions read the FP results
+
+    int encoding(VReg reg) const;
+    bool isFloat(VReg reg) const;
+    void epilogue(std::vector<uint8_t>& out) const;
+    void binary(const Instruction& instr, std::vector<uint8_t>& out) const;
+    void multiply(const Instruction& instr, std::vector<uint8_t>& out) const;
+    void compare(const Instruction& instr, std::vector<uint8_t>& out) const;
+    void branch(uint32_t condition, bool short_branch, uint32_t label, std::vector<uint8_t>& out,
+                std::vector<Fixup>& fixups) const;
+};
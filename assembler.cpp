@@ -0,0 +1,215 @@
+#include "assembler.h"
+#include <unordered_map>
+
+// Whether a displacement in bytes fits the field
+static bool fits(Fixup::Field field, int64_t displacement) {
+    switch (field) {
+        case Fixup::REL8: return displacement >= -128 && displacement <= 127;
+        case Fixup::REL32: return displacement >= INT32_MIN && displacement <= INT32_MAX;
+        case Fixup::REL64: return true;
+        case Fixup::BRANCH19: return displacement >= -(1 << 20) && displacement < (1 << 20);
+        case Fixup::BRANCH26: return displacement >= -(1 << 27) && displacement < (1 << 27);
+        case Fixup::PAGE21: return displacement >= -(1ll << 32) && displacement < (1ll << 32);
+        case Fixup::LO12: return true;
+    }
+    return false;
+}
+
+static void write32(std::vector<uint8_t>& code, size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; ++i) code[offset + i] = (value >> (8 * i)) & 0xff;
+}
+
+static uint32_t read32(const std::vector<uint8_t>& code, size_t offset) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) value |= static_cast<uint32_t>(code[offset + i]) << (8 * i);
+    return value;
+}
+
+// Writes a displacement into the field; AArch64 fields are merged into the
+// instruction word, whose displacement bits the encoder left zero. Page
+// fields only ever refer to data, whose address is the linker's to fill.
+static void patch(std::vector<uint8_t>& code, Fixup::Field field, size_t offset, int64_t displacement) {
+    uint32_t words = static_cast<uint32_t>(displacement >> 2);
+    switch (field) {
+        case Fixup::REL8:
+            code[offset] = static_cast<uint8_t>(displacement);
+            break;
+        case Fixup::REL32:
+            write32(code, offset, static_cast<uint32_t>(displacement));
+            break;
+        case Fixup::BRANCH19:
+            write32(code, offset, read32(code, offset) | (words & 0x7ffff) << 5);
+            break;
+        case Fixup::BRANCH26:
+            write32(code, offset, read32(code, offset) | (words & 0x3ffffff));
+            break;
+        case Fixup::REL64: case Fixup::PAGE21: case Fixup::LO12:
+            break;
+    }
+}
+
+// Label fixups of branches that have a long form to fall back to
+static bool isRelaxable(const Fixup& fixup) {
+    return fixup.target == Fixup::LABEL && (fixup.field == Fixup::REL8 || fixup.field == Fixup::BRANCH19);
+}
+
+static Section sectionOf(DataObject::Section section) {
+    switch (section) {
+        case DataObject::RODATA: return Section::RODATA;
+        case DataObject::DATA: return Section::DATA;
+        case DataObject::BSS: return Section::BSS;
+    }
+    return Section::RODATA;
+}
+
+// Places each object at the next multiple of its alignment in its section
+static void layoutData(const std::vector<DataObject>& objects, AssembledCode& result,
+                       std::unordered_map<std::string, const AssembledData*>& placed) {
+    for (const auto& object : objects) {
+        Section section = sectionOf(object.section);
+        size_t alignment = object.alignment ? object.alignment : 1;
+        size_t offset;
+        if (section == Section::BSS) {
+            result.bss_size = (result.bss_size + alignment - 1) / alignment * alignment;
+            offset = result.bss_size;
+            result.bss_size += object.bytes.size();
+        } else {
+            std::vector<uint8_t>& bytes = section == Section::RODATA ? result.rodata : result.data;
+            while (bytes.size() % alignment != 0) bytes.push_back(0);
+            offset = bytes.size();
+            bytes.insert(bytes.end(), object.bytes.begin(), object.bytes.end());
+        }
+        result.objects.push_back({object.name, section, offset, object.bytes.size()});
+    }
+    for (const auto& object : result.objects) placed[object.name] = &object;
+}
+
+AssembledCode assemble(const std::vector<std::unique_ptr<Function>>& functions,
+                       const std::vector<DataObject>& objects, MachineEncoder& encoder, AssemblerStats& stats) {
+    // Instructions encoded in their long form, per function in block order
+    std::vector<std::vector<bool>> long_form(functions.size());
+    for (size_t f = 0; f < functions.size(); ++f) {
+        size_t count = 0;
+        for (const auto& block : functions[f]->blocks) count += block->instructions.size();
+        long_form[f].assign(count, false);
+    }
+
+    stats = AssemblerStats();
+    AssembledCode result;
+    bool grew = true;
+    while (grew) {
+        grew = false;
+        stats.passes++;
+        stats.short_branches = 0;
+        result = AssembledCode();
+        std::unordered_map<std::string, const AssembledData*> placed;
+        layoutData(objects, result, placed);
+        std::unordered_map<std::string, size_t> entry_points;
+        std::vector<ExternalReference> calls;   // Resolved once every function has its place
+
+        for (size_t f = 0; f < functions.size(); ++f) {
+            const Function& func = *functions[f];
+            size_t start = result.code.size();
+            std::unordered_map<uint32_t, size_t> labels;
+            std::vector<Fixup> fixups;
+            std::vector<size_t> owners;         // Instruction index of each fixup
+
+            encoder.beginFunction(func, result.code);
+            size_t index = 0;
+            for (const auto& block : func.blocks) {
+                for (const auto& instr : block->instructions) {
+                    if (instr.opcode == Instruction::LABEL) labels[instr.label] = result.code.size();
+                    encoder.encode(instr, !long_form[f][index], result.code, fixups);
+                    owners.resize(fixups.size(), index);
+                    index++;
+                }
+            }
+
+            // Jump tables follow the data, 4-byte aligned, each entry the
+            // distance of its target from the table
+            std::unordered_map<uint32_t, size_t> tables;
+            for (const auto& table : func.jump_tables) {
+                while (result.rodata.size() % 4 != 0) result.rodata.push_back(0);
+                size_t start = result.rodata.size();
+                tables[table.symbol] = start;
+                for (uint32_t target : table.targets) {
+                    size_t entry = result.rodata.size();
+                    result.rodata.resize(entry + 4, 0);
+                    auto it = labels.find(target);
+                    size_t code_offset = it != labels.end() ? it->second : 0;
+                    result.references.push_back({Section::RODATA, Fixup::REL32, entry, start, Section::TEXT,
+                                                 code_offset});
+                }
+            }
+
+            for (size_t i = 0; i < fixups.size(); ++i) {
+                const Fixup& fixup = fixups[i];
+                if (fixup.target == Fixup::SYMBOL) {
+                    calls.push_back({func.symbolName(fixup.symbol), fixup.field, fixup.offset, fixup.base});
+                    continue;
+                }
+                if (fixup.target == Fixup::TABLE) {
+                    auto it = tables.find(fixup.symbol);
+                    if (it != tables.end()) {
+                        result.references.push_back({Section::TEXT, fixup.field, fixup.offset, fixup.base,
+                                                     Section::RODATA, it->second});
+                    }
+                    continue;
+                }
+                if (fixup.target == Fixup::DATA) {
+                    auto it = placed.find(func.symbolName(fixup.symbol));
+                    if (it != placed.end()) {
+                        result.references.push_back({Section::TEXT, fixup.field, fixup.offset, fixup.base,
+                                                     it->second->section, it->second->offset});
+                    } else {
+                        result.externals.push_back({func.symbolName(fixup.symbol), fixup.field, fixup.offset,
+                                                    fixup.base});
+                    }
+                    continue;
+                }
+                auto it = labels.find(fixup.symbol);
+                if (it == labels.end()) continue;
+                int64_t displacement = static_cast<int64_t>(it->second) - static_cast<int64_t>(fixup.base);
+                if (!fits(fixup.field, displacement)) {
+                    if (isRelaxable(fixup) && !long_form[f][owners[i]]) {
+                        long_form[f][owners[i]] = true;
+                        grew = true;
+                    }
+                    continue;
+                }
+                patch(result.code, fixup.field, fixup.offset, displacement);
+                if (isRelaxable(fixup)) stats.short_branches++;
+            }
+
+            result.functions.push_back({func.name, start, result.code.size() - start});
+            entry_points[func.name] = start;
+        }
+
+        for (const auto& call : calls) {
+            auto it = entry_points.find(call.symbol);
+            int64_t displacement = it != entry_points.end()
+                ? static_cast<int64_t>(it->second) - static_cast<int64_t>(call.base) : 0;
+            if (it != entry_points.end() && fits(call.field, displacement)) {
+                patch(result.code, call.field, call.offset, displacement);
+            } else {
+                result.externals.push_back(call);
+            }
+        }
+
+        // Function entries of data objects are distances the linker fills
+        for (size_t i = 0; i < objects.size(); ++i) {
+            const AssembledData& placed_object = result.objects[i];
+            for (const auto& entry : objects[i].entries) {
+                auto it = entry_points.find(entry.function);
+                if (it == entry_points.end()) continue;
+                result.references.push_back({placed_object.section, Fixup::REL64, placed_object.offset + entry.offset,
+                                             placed_object.offset, Section::TEXT, it->second});
+            }
+        }
+    }
+
+    for (const auto& flags : long_form) {
+        for (bool is_long : flags) stats.long_branches += is_long ? 1 : 0;
+    }
+    return result;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "encoder.h"
+#include <memory>
+#include <string>
+
+// A function's place in the assembled code
+struct AssembledFunction {
+    std::string name;
+    size_t offset;
+    size_t size;
+};
+
+// A call the assembler could not resolve because its target is not part
+// of the program, such as a runtime helper
+struct ExternalReference {
+    std::string symbol;
+    Fixup::Field field;
+    size_t offset;      // Position of the field, as in Fixup
+    size_t base;
+};
+
+// Sections of the assembled program
+enum class Section {
+    TEXT,
+    RODATA,     // Constants and jump tables
+    DATA,
+    BSS
+};
+
+// A data object's place in its section
+struct AssembledData {
+    std::string name;
+    Section section;
+    size_t offset;
+    size_t size;
+};
+
+// A field holding the distance from one section to another, which only
+// the linker knows. The field holds target - base, as for a Fixup.
+struct SectionReference {
+    Section section;        // Section holding the field
+    Fixup::Field field;
+    size_t offset;          // Position of the field in its section
+    size_t base;            // Position the distance is measured from, in the same section
+    Section target;
+    size_t target_offset;
+};
+
+// Machine code and data of the whole program with what an object writer
+// still needs
+struct AssembledCode {
+    std::vector<uint8_t> code;
+    std::vector<uint8_t> rodata;
+    std::vector<uint8_t> data;
+    size_t bss_size;
+    std::vector<AssembledFunction> functions;
+    std::vector<AssembledData> objects;
+    std::vector<ExternalReference> externals;
+    std::vector<SectionReference> references;
+
+    AssembledCode() : bss_size(0) {}
+};
+
+// Counters reported by the assembler
+struct AssemblerStats {
+    size_t short_branches;      // Branches whose short form reaches their target
+    size_t long_branches;       // Branches relaxed to the long form
+    size_t passes;              // Layout passes until no branch had to grow
+
+    AssemblerStats() : short_branches(0), long_branches(0), passes(0) {}
+};
+
+// Lays out the functions one after the other and the data objects in
+// their sections, and resolves every label and call fixup the encoder
+// left. Jump tables go to .rodata after the data, one 4-byte entry per
+// target holding its distance from the table; those entries, the function
+// entries of data objects and every reference from code to data become
+// section references. Branches start
+// out in their short form; a pass that finds one out of range makes it
+// long and lays everything out again, until a pass changes nothing.
+// Branches only ever grow, so this terminates.
+AssembledCode assemble(const std::vector<std::unique_ptr<Function>>& functions,
+                       const std::vector<DataObject>& objects, MachineEncoder& encoder, AssemblerStats& stats);
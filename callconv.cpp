@@ -0,0 +1,258 @@
+#include "callconv.h"
+#include <unordered_set>
+
+// Where one argument or parameter travels
+struct ArgumentLocation {
+    int physical;       // Argument register, -1 when passed on the stack
+    int mask_bit;       // Bit of that register in a CALL's argument mask
+    int stack_slot;     // 8-byte slot counted up from the first stack argument
+};
+
+static std::vector<ArgumentLocation> assignArguments(const Function& func, const RegisterFile& file,
+                                                     const std::vector<VReg>& values) {
+    std::vector<ArgumentLocation> locations;
+    size_t next[2] = {0, 0};
+    int next_slot = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        int cls = func.getRegister(values[i]).type == Register::FLOAT ? 1 : 0;
+        const std::vector<int>& registers = cls ? file.argument_floating : file.argument_general;
+        size_t index = file.positional_arguments ? i : next[cls];
+
+        ArgumentLocation location = {-1, -1, -1};
+        if (index < registers.size()) {
+            location.physical = registers[index];
+            location.mask_bit = cls * 16 + static_cast<int>(index);
+            next[cls]++;
+        } else {
+            location.stack_slot = next_slot++;
+        }
+        locations.push_back(location);
+    }
+    return locations;
+}
+
+static Instruction move(VReg dest, VReg src) {
+    Instruction instr(Instruction::MOV);
+    instr.addOperand(dest);
+    instr.addOperand(src);
+    return instr;
+}
+
+static Instruction adjustStack(Instruction::OpCode opcode, VReg stack_pointer, int bytes) {
+    Instruction instr(opcode);
+    instr.addOperand(stack_pointer);
+    instr.addOperand(stack_pointer);
+    instr.setImmediate(bytes);
+    return instr;
+}
+
+static void lowerCall(Function& func, const RegisterFile& file, std::vector<Instruction>& lowered,
+                      const Instruction& call, const std::vector<Instruction>& pushes, CallStats& stats) {
+    // The last PUSH carries the first argument
+    std::vector<VReg> args;
+    for (auto it = pushes.rbegin(); it != pushes.rend(); ++it) {
+        args.push_back(it->operands[0]);
+    }
+    std::vector<ArgumentLocation> locations = assignArguments(func, file, args);
+
+    int stack_arguments = 0;
+    for (const auto& location : locations) {
+        if (location.physical < 0) stack_arguments++;
+    }
+
+    // The outgoing area is reserved in one adjustment that keeps the stack
+    // 16-byte aligned throughout, which AArch64 requires of every access
+    // through sp
+    VReg stack_pointer = func.fixedRegister(Register::GENERAL, file.stack_pointer);
+    int outgoing = stack_arguments * 8 + (stack_arguments % 2) * 8;
+    int released = outgoing + file.shadow_space;
+    if (outgoing > 0) {
+        lowered.push_back(adjustStack(Instruction::SUB, stack_pointer, outgoing));
+    }
+
+    // Stack arguments are stored into their slots; register arguments become
+    // moves into the registers the call reads
+    int32_t mask = 0;
+    for (size_t i = args.size(); i-- > 0;) {
+        const ArgumentLocation& location = locations[i];
+        if (location.physical < 0) {
+            Instruction store(Instruction::STORE);
+            store.addOperand(args[i]);
+            store.addOperand(stack_pointer);
+            store.setImmediate(8 * location.stack_slot);
+            lowered.push_back(store);
+            stats.stack_arguments++;
+        } else {
+            Register::Type type = func.getRegister(args[i]).type;
+            lowered.push_back(move(func.fixedRegister(type, location.physical), args[i]));
+            mask |= 1 << location.mask_bit;
+            stats.register_arguments++;
+        }
+    }
+    if (file.shadow_space > 0) {
+        lowered.push_back(adjustStack(Instruction::SUB, stack_pointer, file.shadow_space));
+    }
+
+    Instruction lowered_call = call;
+    if (mask != 0) lowered_call.setImmediate(mask);
+    VReg result = call.num_operands > 0 ? call.operands[0] : VReg();
+    if (result) {
+        Register::Type type = func.getRegister(result).type;
+        lowered_call.operands[0] = func.fixedRegister(type, type == Register::FLOAT ? file.return_floating
+                                                                                   : file.return_general);
+    }
+    lowered.push_back(lowered_call);
+    if (result) {
+        lowered.push_back(move(result, lowered_call.operands[0]));
+    }
+    if (released > 0) {
+        lowered.push_back(adjustStack(Instruction::ADD, stack_pointer, released));
+    }
+    stats.calls++;
+}
+
+// Number of instructions, starting at the CALL, that a tail call replaces:
+// the call, the copy of its result into the return register and the RET.
+// Zero when the function does anything else after the call.
+static size_t tailCallLength(const Function& func, const std::vector<Instruction>& instructions, size_t i) {
+    const Instruction& call = instructions[i];
+    if (!call.label || call.num_operands > 1) return 0;
+
+    VReg result = call.num_operands > 0 ? call.operands[0] : VReg();
+    size_t next = i + 1;
+    if (func.return_register && result != func.return_register) {
+        if (!result || next >= instructions.size()) return 0;
+        const Instruction& copy = instructions[next];
+        if (copy.opcode != Instruction::MOV || copy.num_operands != 2 || copy.has_immediate ||
+            copy.operands[0] != func.return_register || copy.operands[1] != result ||
+            func.getRegister(result).type != func.getRegister(func.return_register).type) {
+            return 0;
+        }
+        next++;
+    }
+    if (next >= instructions.size() || instructions[next].opcode != Instruction::RET) return 0;
+    return next - i + 1;
+}
+
+// The callee takes over the frame and returns to our caller, so it may only
+// read arguments from registers: the incoming stack area is not ours to
+// rewrite. Returns false, emitting nothing, when an argument needs the stack.
+static bool lowerTailCall(Function& func, const RegisterFile& file, std::vector<Instruction>& lowered,
+                          const Instruction& call, const std::vector<Instruction>& pushes, CallStats& stats) {
+    std::vector<VReg> args;
+    for (auto it = pushes.rbegin(); it != pushes.rend(); ++it) {
+        args.push_back(it->operands[0]);
+    }
+    std::vector<ArgumentLocation> locations = assignArguments(func, file, args);
+    for (const auto& location : locations) {
+        if (location.physical < 0) return false;
+    }
+
+    int32_t mask = 0;
+    for (size_t i = 0; i < args.size(); ++i) {
+        Register::Type type = func.getRegister(args[i]).type;
+        lowered.push_back(move(func.fixedRegister(type, locations[i].physical), args[i]));
+        mask |= 1 << locations[i].mask_bit;
+        stats.register_arguments++;
+    }
+
+    Instruction jump(Instruction::TAILCALL);
+    jump.label = call.label;
+    if (mask != 0) jump.setImmediate(mask);
+    lowered.push_back(jump);
+    stats.calls++;
+    stats.tail_calls++;
+    return true;
+}
+
+static void lowerParameters(Function& func, const RegisterFile& file, CallStats& stats) {
+    if (func.parameters.empty() || func.blocks.empty()) return;
+
+    std::unordered_set<uint32_t> read;
+    for (auto& block : func.blocks) {
+        for (const auto& instr : block->instructions) {
+            for (int i = instr.firstUse(); i < instr.num_operands; ++i) {
+                if (instr.operands[i]) read.insert(instr.operands[i].id);
+            }
+        }
+    }
+
+    // Stack parameters sit above the saved frame pointer, the return address
+    // and the caller's shadow space
+    std::vector<ArgumentLocation> locations = assignArguments(func, file, func.parameters);
+    std::vector<Instruction> entry;
+    for (size_t i = 0; i < func.parameters.size(); ++i) {
+        VReg param = func.parameters[i];
+        if (!read.count(param.id)) continue;
+
+        const ArgumentLocation& location = locations[i];
+        Register::Type type = func.getRegister(param).type;
+        if (location.physical >= 0) {
+            entry.push_back(move(param, func.fixedRegister(type, location.physical)));
+        } else {
+            Instruction load(Instruction::LOAD);
+            load.addOperand(param);
+            load.addOperand(func.fixedRegister(Register::GENERAL, file.frame_pointer));
+            load.setImmediate(16 + file.shadow_space + 8 * location.stack_slot);
+            entry.push_back(load);
+        }
+        stats.parameters++;
+    }
+
+    auto& instructions = func.blocks.front()->instructions;
+    size_t position = func.blocks.front()->labelSymbol() ? 1 : 0;
+    instructions.insert(instructions.begin() + position, entry.begin(), entry.end());
+}
+
+static void lowerReturn(Function& func, const RegisterFile& file) {
+    VReg value = func.return_register;
+    if (!value) return;
+
+    Register::Type type = func.getRegister(value).type;
+    VReg fixed = func.fixedRegister(type, type == Register::FLOAT ? file.return_floating : file.return_general);
+    for (auto& block : func.blocks) {
+        auto& instructions = block->instructions;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            if (instructions[i].opcode != Instruction::RET) continue;
+            instructions.insert(instructions.begin() + i, move(fixed, value));
+            i++;
+        }
+    }
+    func.return_register = fixed;
+}
+
+void lowerCallingConvention(Function& func, const RegisterFile& file, CallStats& stats) {
+    // Liveness decodes the argument masks through the register file
+    func.register_file = &file;
+
+    for (auto& block : func.blocks) {
+        std::vector<Instruction> lowered;
+        lowered.reserve(block->instructions.size());
+        std::vector<Instruction> pushes;
+        const auto& instructions = block->instructions;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            const Instruction& instr = instructions[i];
+            if (instr.opcode == Instruction::PUSH) {
+                pushes.push_back(instr);
+                continue;
+            }
+            if (instr.opcode == Instruction::CALL) {
+                size_t length = tailCallLength(func, instructions, i);
+                if (length > 0 && lowerTailCall(func, file, lowered, instr, pushes, stats)) {
+                    i += length - 1;
+                } else {
+                    lowerCall(func, file, lowered, instr, pushes, stats);
+                }
+            } else {
+                lowered.insert(lowered.end(), pushes.begin(), pushes.end());
+                lowered.push_back(instr);
+            }
+            pushes.clear();
+        }
+        lowered.insert(lowered.end(), pushes.begin(), pushes.end());
+        block->instructions = std::move(lowered);
+    }
+
+    lowerParameters(func, file, stats);
+    lowerReturn(func, file);
+}
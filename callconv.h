@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ir.h"
+#include "target.h"
+
+// Counters reported by calling-convention lowering
+struct CallStats {
+    size_t calls;               // Call sites lowered
+    size_t register_arguments;  // Arguments moved into argument registers
+    size_t stack_arguments;     // Arguments still passed on the stack
+    size_t parameters;          // Incoming parameters read from registers or the caller's frame
+    size_t tail_calls;          // Calls in tail position turned into jumps
+    size_t tail_recursion;      // Self tail calls turned into loops by the code generator
+
+    CallStats() : calls(0), register_arguments(0), stack_arguments(0), parameters(0),
+                  tail_calls(0), tail_recursion(0) {}
+};
+
+// Rewrites the abstract PUSH/CALL argument passing of a function out of SSA
+// form into the System V, Microsoft x64 or AAPCS64 convention of the
+// register file: leading arguments are moved into argument registers that
+// the CALL reads, the rest are stored into an outgoing area that is
+// reserved and released with a single stack adjustment each, and results come back in the return register. Incoming
+// parameters and the function's own return value are pinned the same way.
+// A direct call whose result is returned unchanged, and whose arguments all
+// fit in registers, becomes a TAILCALL that reuses the caller's frame.
+// Pinned values use Function::fixedRegister, which both allocators treat
+// as precolored.
+void lowerCallingConvention(Function& func, const RegisterFile& file, CallStats& stats);
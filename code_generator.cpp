@@ -3,172 +3,97 @@
 #include <sstream>
 #include <algorithm>
 #include <iomanip>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <set>
 
-// Instruction implementation
-std::string Instruction::toString() const {
-    std::stringstream ss;
-    
-    switch (opcode) {
-        case MOV: ss << "mov"; break;
-        case LOAD: ss << "load"; break;
-        case STORE: ss << "store"; break;
-        case ADD: ss << "add"; break;
-        case SUB: ss << "sub"; break;
-        case MUL: ss << "mul"; break;
-        case DIV: ss << "div"; break;
-        case MOD: ss << "mod"; break;
-        case FADD: ss << "fadd"; break;
-        case FSUB: ss << "fsub"; break;
-        case FMUL: ss << "fmul"; break;
-        case FDIV: ss << "fdiv"; break;
-        case AND: ss << "and"; break;
-        case OR: ss << "or"; break;
-        case XOR: ss << "xor"; break;
-        case NOT: ss << "not"; break;
-        case CMP: ss << "cmp"; break;
-        case FCMP: ss << "fcmp"; break;
-        case JMP: ss << "jmp"; break;
-        case JE: ss << "je"; break;
-        case JNE: ss << "jne"; break;
-        case JL: ss << "jl"; break;
-        case JLE: ss << "jle"; break;
-        case JG: ss << "jg"; break;
-        case JGE: ss << "jge"; break;
-        case CALL: ss << "call"; break;
-        case RET: ss << "ret"; break;
-        case PUSH: ss << "push"; break;
-        case POP: ss << "pop"; break;
-        case NOP: ss << "nop"; break;
-        case LABEL: ss << label << ":"; return ss.str();
-        default: ss << "unknown"; break;
-    }
-    
-    if (!label.empty()) {
-        ss << " " << label;
-    } else {
-        for (size_t i = 0; i < operands.size(); ++i) {
-            if (i > 0) ss << ", ";
-            else ss << " ";
-            
-            if (operands[i]) {
-                ss << operands[i]->name;
-            } else {
-                ss << "null";
-            }
-        }
-        
-        if (has_immediate) {
-            if (!operands.empty()) ss << ", ";
-            else ss << " ";
-            ss << "#" << immediate;
-        }
-    }
-    
-    return ss.str();
+// Static type helpers shared by the typed arithmetic and assignment paths
+static bool isIntegral(GDType type) {
+    return type == GDType::INT || type == GDType::BOOL;
 }
 
-// BasicBlock implementation
-void BasicBlock::addInstruction(std::unique_ptr<Instruction> instr) {
-    instructions.push_back(std::move(instr));
+static bool isNumericType(GDType type) {
+    return isIntegral(type) || type == GDType::FLOAT;
 }
 
-void BasicBlock::addSuccessor(BasicBlock* block) {
-    successors.push_back(block);
-    block->predecessors.push_back(this);
+static bool isVectorType(GDType type) {
+    return type == GDType::VECTOR2 || type == GDType::VECTOR3;
 }
 
-// Function implementation
-BasicBlock* Function::createBlock(const std::string& label) {
-    auto block = std::make_unique<BasicBlock>(label);
-    BasicBlock* ptr = block.get();
-    blocks.push_back(std::move(block));
-    return ptr;
+static GDType storageType(GDType type) {
+    return type == GDType::UNKNOWN ? GDType::VARIANT : type;
 }
 
-BasicBlock* Function::getBlock(const std::string& label) {
-    for (auto& block : blocks) {
-        if (block->label == label) {
-            return block.get();
-        }
+static GDType typeFromName(const std::string& name) {
+    if (name == "int") return GDType::INT;
+    if (name == "float") return GDType::FLOAT;
+    if (name == "bool") return GDType::BOOL;
+    if (name == "String") return GDType::STRING;
+    if (name == "Vector2") return GDType::VECTOR2;
+    if (name == "Vector3") return GDType::VECTOR3;
+    return GDType::VARIANT;
+}
+
+// Runtime array header: reference count, element count, then a pointer to
+// the contiguous element storage. Array elements are inline Variants used by
+// address; packed arrays store raw values, padded to a whole word at the end.
+static const int ARRAY_SIZE_OFFSET = 8;
+static const int ARRAY_DATA_OFFSET = 16;
+static const int VARIANT_SIZE = 24;
+
+// Result type of generateArithmetic for the same operands
+static GDType arithmeticResultType(TokenType op, GDType left_type, GDType right_type) {
+    if (isIntegral(left_type) && isIntegral(right_type)) return GDType::INT;
+    if (isNumericType(left_type) && isNumericType(right_type)) return GDType::FLOAT;
+    if (isVectorType(left_type) && (left_type == right_type || isNumericType(right_type)) && op != TokenType::MODULO) return left_type;
+    if (isNumericType(left_type) && isVectorType(right_type) && op == TokenType::MULTIPLY) return right_type;
+    if (left_type == GDType::STRING && (op == TokenType::MODULO || (op == TokenType::PLUS && right_type == GDType::STRING))) return GDType::STRING;
+    return GDType::VARIANT;
+}
+
+static const char* operatorSuffix(TokenType op) {
+    switch (op) {
+        case TokenType::PLUS: return "add";
+        case TokenType::MINUS: return "sub";
+        case TokenType::MULTIPLY: return "mul";
+        case TokenType::DIVIDE: return "div";
+        case TokenType::MODULO: return "mod";
+        default: return "op";
     }
-    return nullptr;
 }
 
 // CodeGenerator implementation
 CodeGenerator::CodeGenerator() 
-    : current_class_name(""), target_platform(TargetPlatform::MACOS_X64), output_format(OutputFormat::ASSEMBLY),
-      current_function(nullptr), current_block(nullptr), 
-      next_register_id(0), next_label_id(0), stack_offset(0), semantic_analyzer(nullptr) {
+    : current_class_name(""), current_class_entry(nullptr), target_platform(TargetPlatform::MACOS_X64), output_format(OutputFormat::ASSEMBLY),
+      current_function(nullptr), current_block(nullptr), current_return_type(GDType::VARIANT),
+      next_label_id(0), stack_offset(0), allocator_kind(AllocatorKind::LINEAR_SCAN), profile_generate(false), semantic_analyzer(nullptr) {
     initializeBuiltinFunctions();
-    
-    // Initialize available registers (simplified x86-64 subset)
-    for (int i = 0; i < 8; ++i) {
-        std::string name = "r" + std::to_string(i);
-        available_registers.push_back(std::make_shared<Register>(i, Register::GENERAL, name));
-    }
-    
-    // Initialize floating point registers
-    for (int i = 0; i < 8; ++i) {
-        std::string name = "xmm" + std::to_string(i);
-        available_registers.push_back(std::make_shared<Register>(i + 100, Register::FLOAT, name));
-    }
+
 }
 
 CodeGenerator::CodeGenerator(SemanticAnalyzer* analyzer) 
-    : current_class_name(""), target_platform(TargetPlatform::MACOS_X64), output_format(OutputFormat::ASSEMBLY),
-      current_function(nullptr), current_block(nullptr), 
-      next_register_id(0), next_label_id(0), stack_offset(0), semantic_analyzer(analyzer) {
+    : current_class_name(""), current_class_entry(nullptr), target_platform(TargetPlatform::MACOS_X64), output_format(OutputFormat::ASSEMBLY),
+      current_function(nullptr), current_block(nullptr), current_return_type(GDType::VARIANT),
+      next_label_id(0), stack_offset(0), allocator_kind(AllocatorKind::LINEAR_SCAN), profile_generate(false), semantic_analyzer(analyzer) {
     initializeBuiltinFunctions();
-    
-    // Initialize available registers (simplified x86-64 subset)
-    for (int i = 0; i < 8; ++i) {
-        std::string name = "r" + std::to_string(i);
-        available_registers.push_back(std::make_shared<Register>(i, Register::GENERAL, name));
-    }
-    
-    // Initialize floating point registers
-    for (int i = 0; i < 8; ++i) {
-        std::string name = "xmm" + std::to_string(i);
-        available_registers.push_back(std::make_shared<Register>(i + 100, Register::FLOAT, name));
-    }
+
 }
 
 CodeGenerator::CodeGenerator(TargetPlatform platform, OutputFormat format)
-    : current_class_name(""), target_platform(platform), output_format(format),
-      current_function(nullptr), current_block(nullptr),
-      next_register_id(0), next_label_id(0), stack_offset(0), semantic_analyzer(nullptr) {
+    : current_class_name(""), current_class_entry(nullptr), target_platform(platform), output_format(format),
+      current_function(nullptr), current_block(nullptr), current_return_type(GDType::VARIANT),
+      next_label_id(0), stack_offset(0), allocator_kind(AllocatorKind::LINEAR_SCAN), profile_generate(false), semantic_analyzer(nullptr) {
     initializeBuiltinFunctions();
-    
-    // Initialize available registers (simplified x86-64 subset)
-    for (int i = 0; i < 8; ++i) {
-        std::string name = "r" + std::to_string(i);
-        available_registers.push_back(std::make_shared<Register>(i, Register::GENERAL, name));
-    }
-    
-    // Initialize floating point registers
-    for (int i = 0; i < 8; ++i) {
-        std::string name = "xmm" + std::to_string(i);
-        available_registers.push_back(std::make_shared<Register>(i + 100, Register::FLOAT, name));
-    }
+
 }
 
 CodeGenerator::CodeGenerator(SemanticAnalyzer* analyzer, TargetPlatform platform, OutputFormat format)
-    : current_class_name(""), target_platform(platform), output_format(format),
-      current_function(nullptr), current_block(nullptr),
-      next_register_id(0), next_label_id(0), stack_offset(0), semantic_analyzer(analyzer) {
+    : current_class_name(""), current_class_entry(nullptr), target_platform(platform), output_format(format),
+      current_function(nullptr), current_block(nullptr), current_return_type(GDType::VARIANT),
+      next_label_id(0), stack_offset(0), allocator_kind(AllocatorKind::LINEAR_SCAN), profile_generate(false), semantic_analyzer(analyzer) {
     initializeBuiltinFunctions();
-    
-    // Initialize available registers (simplified x86-64 subset)
-    for (int i = 0; i < 8; ++i) {
-        std::string name = "r" + std::to_string(i);
-        available_registers.push_back(std::make_shared<Register>(i, Register::GENERAL, name));
-    }
-    
-    // Initialize floating point registers
-    for (int i = 0; i < 8; ++i) {
-        std::string name = "xmm" + std::to_string(i);
-        available_registers.push_back(std::make_shared<Register>(i + 100, Register::FLOAT, name));
-    }
+
 }
 
 bool CodeGenerator::generate(ASTNode* root, const std::string& output_file) {
@@ -191,6 +116,12 @@ bool CodeGenerator::generate(ASTNode* root, const std::string& output_file) {
         return false;
     }
     
+    // Profile points are fixed before any optimization, so that the
+    // instrumented and the optimized build agree on them
+    if (profile_generate || !profile.empty()) {
+        applyProfile();
+    }
+    
     // Perform optimizations
     optimizeCode();
     
@@ -267,6 +198,13 @@ void CodeGenerator::generateProgram(Program* program) {
     // Generate runtime support first
     generateRuntimeSupport();
     
+    // Calls may come before the function they reach
+    for (auto& stmt : program->statements) {
+        if (stmt->type != ASTNodeType::FUNC_DECL) continue;
+        FuncDecl* decl = static_cast<FuncDecl*>(stmt.get());
+        if (hasInferredParameters(decl)) specialized_functions.insert(decl->name);
+    }
+    
     // Generate all functions and classes
     for (auto& stmt : program->statements) {
         generateStatement(stmt.get());
@@ -275,7 +213,7 @@ void CodeGenerator::generateProgram(Program* program) {
     // Generate main entry point if no main function exists
     if (function_map.find("main") == function_map.end()) {
         setupFunction("main");
-        emit(Instruction::MOV, allocateRegister(), 0); // Return 0
+        emit(Instruction::MOV, returnRegister(Register::GENERAL), 0); // Return 0
         emit(Instruction::RET);
         finalizeFunction();
     }
@@ -340,14 +278,22 @@ void CodeGenerator::generateStatement(Statement* stmt) {
 }
 
 void CodeGenerator::generateVarDecl(VarDecl* decl) {
-    auto var_reg = allocateRegister();
-    var_reg->name = decl->name;
+    GDType init_type = decl->initializer ? getStaticType(decl->initializer.get()) : GDType::VARIANT;
+    GDType var_type = typeFromName(decl->type);
+    if (decl->type.empty()) {
+        // ':=' takes the initializer's type; untyped locals use the inferred storage type
+        var_type = decl->is_inferred || !semantic_analyzer ? init_type :
+                   storageType(semantic_analyzer->getDeclarationType(decl).base_type);
+    }
+    
+    auto var_reg = allocateRegister(var_type == GDType::FLOAT ? Register::FLOAT : Register::GENERAL);
+    nameRegister(var_reg, decl->name);
     variables[decl->name] = var_reg;
+    variable_types[decl->name] = var_type;
     
     if (decl->initializer) {
-        auto init_reg = generateExpression(decl->initializer.get());
+        auto init_reg = convertType(generateExpression(decl->initializer.get()), init_type, var_type);
         emit(Instruction::MOV, var_reg, init_reg);
-        freeRegister(init_reg);
     } else {
         // Initialize to null/zero
         emit(Instruction::MOV, var_reg, 0);
@@ -356,22 +302,25 @@ void CodeGenerator::generateVarDecl(VarDecl* decl) {
 
 void CodeGenerator::generateConstDecl(ConstDecl* decl) {
     auto const_reg = allocateRegister();
-    const_reg->name = decl->name;
+    nameRegister(const_reg, decl->name);
     variables[decl->name] = const_reg;
     
     auto value_reg = generateExpression(decl->value.get());
     emit(Instruction::MOV, const_reg, value_reg);
-    freeRegister(value_reg);
 }
 
 void CodeGenerator::generateFuncDecl(FuncDecl* decl) {
-    setupFunction(decl->name);
+    bool specialized = specialized_functions.count(decl->name) != 0;
+    setupFunction(specialized ? specializedName(decl->name) : decl->name);
+    current_return_type = typeFromName(decl->return_type);
     
     // Set up parameters
     for (size_t i = 0; i < decl->parameters.size(); ++i) {
-        auto param_reg = allocateRegister();
-        param_reg->name = decl->parameters[i].name;
+        GDType param_type = getParameterType(decl, i);
+        auto param_reg = allocateRegister(param_type == GDType::FLOAT ? Register::FLOAT : Register::GENERAL);
+        nameRegister(param_reg, decl->parameters[i].name);
         variables[decl->parameters[i].name] = param_reg;
+        variable_types[decl->parameters[i].name] = param_type;
         current_function->parameters.push_back(param_reg);
     }
     
@@ -380,11 +329,10 @@ void CodeGenerator::generateFuncDecl(FuncDecl* decl) {
     
     // Ensure function returns
     if (current_block->instructions.empty() || 
-        current_block->instructions.back()->opcode != Instruction::RET) {
+        current_block->instructions.back().opcode != Instruction::RET) {
         if (!decl->return_type.empty() && decl->return_type != "void") {
             // Return default value
-            auto return_reg = allocateRegister();
-            emit(Instruction::MOV, return_reg, 0);
+            emit(Instruction::MOV, returnRegister(current_return_type == GDType::FLOAT ? Register::FLOAT : Register::GENERAL), 0);
             emit(Instruction::RET);
         } else {
             emit(Instruction::RET);
@@ -392,18 +340,75 @@ void CodeGenerator::generateFuncDecl(FuncDecl* decl) {
     }
     
     finalizeFunction();
+    
+    if (specialized) {
+        generateEntryStub(decl);
+    }
+}
+
+// Declared type of a parameter, or the one the analyzer inferred from the
+// function's call sites
+GDType CodeGenerator::getParameterType(FuncDecl* decl, size_t index) const {
+    const Parameter& param = decl->parameters[index];
+    if (!param.type.empty() || !semantic_analyzer) {
+        return typeFromName(param.type);
+    }
+    return storageType(semantic_analyzer->getParameterType(decl, index).base_type);
+}
+
+bool CodeGenerator::hasInferredParameters(FuncDecl* decl) const {
+    for (size_t i = 0; i < decl->parameters.size(); ++i) {
+        if (decl->parameters[i].type.empty() && getParameterType(decl, i) != GDType::VARIANT) return true;
+    }
+    return false;
+}
+
+// A top-level function is exported, so callers outside the script pass
+// Variants for its untyped parameters. Under its own name it unboxes them
+// and forwards to the body compiled for the types the script's calls pass.
+void CodeGenerator::generateEntryStub(FuncDecl* decl) {
+    setupFunction(decl->name);
+    
+    std::vector<VReg> args;
+    for (size_t i = 0; i < decl->parameters.size(); ++i) {
+        GDType declared = typeFromName(decl->parameters[i].type);
+        auto param_reg = allocateRegister(declared == GDType::FLOAT ? Register::FLOAT : Register::GENERAL);
+        nameRegister(param_reg, decl->parameters[i].name);
+        current_function->parameters.push_back(param_reg);
+        args.push_back(convertType(param_reg, declared, getParameterType(decl, i)));
+    }
+    
+    Register::Type result_type = typeFromName(decl->return_type) == GDType::FLOAT ?
+        Register::FLOAT : Register::GENERAL;
+    auto result_reg = allocateRegister(result_type);
+    pushArguments(args);
+    emit(Instruction::CALL, result_reg, specializedName(decl->name));
+    emit(Instruction::MOV, returnRegister(result_type), result_reg);
+    emit(Instruction::RET);
+    
+    finalizeFunction();
 }
 
 void CodeGenerator::generateClassDecl(ClassDecl* decl) {
     current_class_name = decl->name;
+    current_class_entry = semantic_analyzer ?
+        semantic_analyzer->getClassHierarchy().findClass(decl->name) : nullptr;
     
-    // First, register all class member variables
+    // First, give static member variables their storage; instance fields
+    // live in the object at the offsets computed by the analyzer
     for (auto& member : decl->members) {
-        if (member->type == ASTNodeType::VAR_DECL) {
-            VarDecl* var_decl = static_cast<VarDecl*>(member.get());
-            auto member_reg = allocateRegister();
-            member_reg->name = var_decl->name;
-            class_members[var_decl->name] = member_reg;
+        if (member->type == ASTNodeType::VAR_DECL && static_cast<VarDecl*>(member.get())->is_static) {
+            declareStaticField(static_cast<VarDecl*>(member.get()));
+        }
+    }
+    if (current_class_entry) {
+        // Inherited static fields are the base class's objects
+        for (const auto& field : current_class_entry->fields) {
+            if (!field.is_static || field.owner_id == current_class_entry->id) continue;
+            const ClassEntry* owner = semantic_analyzer->getClassHierarchy().getClass(field.owner_id);
+            if (owner) {
+                class_members[field.name] = {owner->name + "." + field.name, storageType(field.type.base_type)};
+            }
         }
     }
     
@@ -414,27 +419,31 @@ void CodeGenerator::generateClassDecl(ClassDecl* decl) {
             std::string mangled_name = decl->name + "_" + method->name;
             
             setupFunction(mangled_name);
+            current_return_type = typeFromName(method->return_type);
             
             // Add 'self' parameter for instance methods
             if (!method->is_static) {
                 auto self_reg = allocateRegister();
-                self_reg->name = "self";
+                nameRegister(self_reg, "self");
                 variables["self"] = self_reg;
                 current_function->parameters.push_back(self_reg);
             }
             
             // Add method parameters
-            for (const auto& param : method->parameters) {
-                auto param_reg = allocateRegister();
-                param_reg->name = param.name;
+            for (size_t i = 0; i < method->parameters.size(); ++i) {
+                const auto& param = method->parameters[i];
+                GDType param_type = getParameterType(method, i);
+                auto param_reg = allocateRegister(param_type == GDType::FLOAT ? Register::FLOAT : Register::GENERAL);
+                nameRegister(param_reg, param.name);
                 variables[param.name] = param_reg;
+                variable_types[param.name] = param_type;
                 current_function->parameters.push_back(param_reg);
             }
             
             generateStatement(method->body.get());
             
             if (current_block->instructions.empty() || 
-                current_block->instructions.back()->opcode != Instruction::RET) {
+                current_block->instructions.back().opcode != Instruction::RET) {
                 emit(Instruction::RET);
             }
             
@@ -442,7 +451,99 @@ void CodeGenerator::generateClassDecl(ClassDecl* decl) {
         }
     }
     
+    if (current_class_entry && hasFieldInitializers(*current_class_entry)) {
+        generateFieldInitializer(decl);
+    }
+    
+    // The vtable: one entry per method slot, the distance of its
+    // implementation from the table
+    if (current_class_entry && !current_class_entry->vtable.empty()) {
+        const ClassHierarchy& hierarchy = semantic_analyzer->getClassHierarchy();
+        DataObject vtable(vtableName(current_class_name), DataObject::RODATA, 8);
+        vtable.bytes.assign(current_class_entry->vtable.size() * 8, 0);
+        for (const auto& method : current_class_entry->vtable) {
+            vtable.entries.push_back({static_cast<size_t>(method.slot) * 8,
+                                      hierarchy.getImplementationName(*current_class_entry, method.slot)});
+        }
+        data_objects.push_back(vtable);
+    }
+    
     current_class_name = "";
+    current_class_entry = nullptr;
+    class_members.clear();
+}
+
+bool CodeGenerator::hasFieldInitializers(const ClassEntry& entry) {
+    for (const auto& field : entry.fields) {
+        if (field.owner_id == entry.id && !field.is_static && field.has_initializer) return true;
+    }
+    return false;
+}
+
+// Class.field_init(self) stores the initial values of the fields the class
+// itself declares; .new() runs it for each class from the root down
+void CodeGenerator::generateFieldInitializer(ClassDecl* decl) {
+    setupFunction(fieldInitializerName(current_class_name));
+    current_return_type = GDType::VOID;
+    auto self_reg = allocateRegister();
+    nameRegister(self_reg, "self");
+    variables["self"] = self_reg;
+    current_function->parameters.push_back(self_reg);
+    
+    for (auto& member : decl->members) {
+        if (member->type != ASTNodeType::VAR_DECL) continue;
+        VarDecl* var_decl = static_cast<VarDecl*>(member.get());
+        const FieldSlot* field = current_class_entry->findField(var_decl->name);
+        if (var_decl->is_static || !var_decl->initializer || !field || field->owner_id != current_class_entry->id) {
+            continue;
+        }
+        auto value_reg = generateExpression(var_decl->initializer.get());
+        value_reg = convertType(value_reg, getStaticType(var_decl->initializer.get()),
+                                storageType(field->type.base_type));
+        generateFieldStore(self_reg, field, value_reg);
+    }
+    
+    emit(Instruction::RET);
+    finalizeFunction();
+}
+
+// A static field is one word in .data holding its constant initializer,
+// or in .bss when it has none; other initializers are not run
+void CodeGenerator::declareStaticField(VarDecl* decl) {
+    GDType type = typeFromName(decl->type);
+    if (decl->type.empty()) {
+        type = semantic_analyzer ? storageType(semantic_analyzer->getDeclarationType(decl).base_type) :
+               decl->initializer ? getStaticType(decl->initializer.get()) : GDType::VARIANT;
+    }
+    
+    const ConstantValue* initial = decl->initializer ? &decl->initializer->constant : nullptr;
+    bool numeric = initial && (initial->isNumeric() || initial->kind == ConstantValue::NIL) &&
+                   (isNumericType(type) || initial->kind == ConstantValue::NIL);
+    DataObject object(current_class_name + "." + decl->name, numeric ? DataObject::DATA : DataObject::BSS, 8);
+    int64_t bits = 0;
+    if (numeric && type == GDType::FLOAT) {
+        double value = initial->asFloat();
+        std::memcpy(&bits, &value, sizeof(bits));
+    } else if (numeric) {
+        bits = initial->kind == ConstantValue::FLOAT ? static_cast<int64_t>(initial->float_value) : initial->int_value;
+    }
+    for (int i = 0; i < 8; ++i) object.bytes.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+    data_objects.push_back(object);
+    class_members[decl->name] = {object.name, type};
+}
+
+VReg CodeGenerator::generateStaticLoad(const StaticField& field) {
+    auto address_reg = allocateRegister();
+    emit(Instruction::ADDR, address_reg, field.object);
+    auto result_reg = allocateRegister(field.type == GDType::FLOAT ? Register::FLOAT : Register::GENERAL);
+    emit(Instruction::LOAD, result_reg, address_reg, 0);
+    return result_reg;
+}
+
+void CodeGenerator::generateStaticStore(const StaticField& field, VReg value_reg) {
+    auto address_reg = allocateRegister();
+    emit(Instruction::ADDR, address_reg, field.object);
+    emit(Instruction::STORE, value_reg, address_reg, 0);
 }
 
 void CodeGenerator::generateSignalDecl(SignalDecl* decl) {
@@ -453,8 +554,8 @@ void CodeGenerator::generateSignalDecl(SignalDecl* decl) {
     emit(Instruction::MOV, signal_name_reg, 0); // Load string address
     
     // Call runtime signal registration
+    pushArguments({signal_name_reg});
     emit(Instruction::CALL, "_register_signal");
-    freeRegister(signal_name_reg);
 }
 
 void CodeGenerator::generateEnumDecl(EnumDecl* decl) {
@@ -480,7 +581,6 @@ void CodeGenerator::generateIfStmt(IfStmt* stmt) {
     emit(Instruction::CMP, condition_reg, 0);
     emit(Instruction::JE, else_label);
     
-    freeRegister(condition_reg);
     
     // Generate then branch
     generateStatement(stmt->then_branch.get());
@@ -507,7 +607,6 @@ void CodeGenerator::generateWhileStmt(WhileStmt* stmt) {
     auto condition_reg = generateExpression(stmt->condition.get());
     emit(Instruction::CMP, condition_reg, 0);
     emit(Instruction::JE, end_label);
-    freeRegister(condition_reg);
     
     generateStatement(stmt->body.get());
     emit(Instruction::JMP, loop_label);
@@ -519,67 +618,352 @@ void CodeGenerator::generateWhileStmt(WhileStmt* stmt) {
 }
 
 void CodeGenerator::generateForStmt(ForStmt* stmt) {
+    // range() and plain integers count in a register; everything else goes
+    // through the runtime iterator protocol
+    if (!generateCountedForLoop(stmt) && !generateArrayForLoop(stmt)) {
+        generateIteratorForLoop(stmt);
+    }
+}
+
+bool CodeGenerator::generateCountedForLoop(ForStmt* stmt) {
+    Expression* iterable = stmt->iterable.get();
+    std::vector<Expression*> bounds;
+    if (iterable->type == ASTNodeType::CALL) {
+        CallExpr* call = static_cast<CallExpr*>(iterable);
+        if (call->callee->type != ASTNodeType::IDENTIFIER ||
+            static_cast<IdentifierExpr*>(call->callee.get())->name != "range" ||
+            function_map.count("range") || call->arguments.empty() || call->arguments.size() > 3) {
+            return false;
+        }
+        for (auto& arg : call->arguments) {
+            GDType type = getStaticType(arg.get());
+            if (!isIntegral(type) && type != GDType::FLOAT && type != GDType::VARIANT) return false;
+            bounds.push_back(arg.get());
+        }
+    } else if (isIntegral(getStaticType(iterable)) && getStaticType(iterable) != GDType::BOOL) {
+        bounds.push_back(iterable);     // for i in n counts like range(n)
+    } else {
+        return false;
+    }
+    
+    // A zero step is an error range() reports at run time; a constant one
+    // takes the generic path, and one known only at run time is checked
+    // before the loop
+    Expression* step_expr = bounds.size() == 3 ? bounds[2] : nullptr;
+    bool step_known = !step_expr || (step_expr->constant.kind == ConstantValue::INT &&
+        step_expr->constant.int_value >= std::numeric_limits<int>::min() &&
+        step_expr->constant.int_value <= std::numeric_limits<int>::max());
+    long long step = step_expr && step_known ? step_expr->constant.int_value : 1;
+    if (step == 0) return false;
+    
+    // Bounds are evaluated once, before the first iteration
+    auto bound = [this](Expression* expr) {
+        return convertType(generateExpression(expr), getStaticType(expr), GDType::INT);
+    };
+    VReg start_reg;
+    if (bounds.size() == 1) {
+        start_reg = allocateRegister();
+        emit(Instruction::MOV, start_reg, 0);
+    } else {
+        start_reg = bound(bounds[0]);
+    }
+    VReg end_reg = bound(bounds.size() == 1 ? bounds[0] : bounds[1]);
+    VReg step_reg = step_expr && !step_known ? bound(step_expr) : VReg();
+    
+    auto counter_reg = allocateRegister();
+    auto loop_var_reg = allocateRegister();
+    GDType loop_var_type = semantic_analyzer ?
+        storageType(semantic_analyzer->getDeclarationType(stmt).base_type) : GDType::INT;
+    if (loop_var_type == GDType::FLOAT) {
+        loop_var_reg = allocateRegister(Register::FLOAT);
+    }
+    nameRegister(loop_var_reg, stmt->variable);
+    variables[stmt->variable] = loop_var_reg;
+    variable_types[stmt->variable] = loop_var_type;
+    
+    std::string loop_label = generateLabel("for_loop");
+    std::string next_label = generateLabel("for_next");
+    std::string end_label = generateLabel("for_end");
+    
+    pushBreakLabel(end_label);
+    pushContinueLabel(next_label);
+    
+    if (step_reg) {
+        // range() reports the zero step, and its empty result has no iterations
+        std::string stepped_label = generateLabel("for_step");
+        emit(Instruction::CMP, step_reg, 0);
+        emit(Instruction::JNE, stepped_label);
+        generateRuntimeCall(builtin_functions["range"], {start_reg, end_reg, step_reg});
+        emit(Instruction::JMP, end_label);
+        emitLabel(stepped_label);
+    }
+    
+    emit(Instruction::MOV, counter_reg, start_reg);
+    emitLabel(loop_label);
+    
+    // Counting up stops at the end bound, counting down stops above it
+    if (step_known) {
+        emit(Instruction::CMP, counter_reg, end_reg);
+        emit(step > 0 ? Instruction::JGE : Instruction::JLE, end_label);
+    } else {
+        std::string down_label = generateLabel("for_down");
+        std::string body_label = generateLabel("for_body");
+        emit(Instruction::CMP, step_reg, 0);
+        emit(Instruction::JL, down_label);
+        emit(Instruction::CMP, counter_reg, end_reg);
+        emit(Instruction::JGE, end_label);
+        emit(Instruction::JMP, body_label);
+        emitLabel(down_label);
+        emit(Instruction::CMP, counter_reg, end_reg);
+        emit(Instruction::JLE, end_label);
+        emitLabel(body_label);
+    }
+    
+    // The body may reassign the loop variable without disturbing the count
+    emit(Instruction::MOV, loop_var_reg, convertType(counter_reg, GDType::INT, loop_var_type));
+    
+    generateStatement(stmt->body.get());
+    
+    emitLabel(next_label);
+    if (step_reg) {
+        emit(Instruction::ADD, counter_reg, counter_reg, step_reg);
+    } else {
+        emit(Instruction::ADD, counter_reg, counter_reg, static_cast<int>(step));
+    }
+    emit(Instruction::JMP, loop_label);
+    
+    emitLabel(end_label);
+    
+    popBreakLabel();
+    popContinueLabel();
+    return true;
+}
+
+bool CodeGenerator::generateArrayForLoop(ForStmt* stmt) {
+    if (!semantic_analyzer) return false;
+    TypeInfo iterable_type = semantic_analyzer->getResolvedType(stmt->iterable.get());
+    if (iterable_type.base_type != GDType::ARRAY) return false;
+    
+    // Element stride and how an element becomes a value
+    int stride = VARIANT_SIZE;
+    GDType element_type = GDType::VARIANT;
+    bool narrow = false;
+    if (iterable_type.custom_name == "PackedInt64Array") {
+        stride = 8;
+        element_type = GDType::INT;
+    } else if (iterable_type.custom_name == "PackedInt32Array") {
+        stride = 4;
+        element_type = GDType::INT;
+        narrow = true;
+    } else if (iterable_type.custom_name == "PackedFloat32Array") {
+        stride = 4;
+        element_type = GDType::FLOAT;
+        narrow = true;
+    } else if (!iterable_type.custom_name.empty()) {
+        return false;
+    }
+    
+    auto array_reg = generateExpression(stmt->iterable.get());
+    auto length_reg = allocateRegister();
+    emit(Instruction::LOAD, length_reg, array_reg, ARRAY_SIZE_OFFSET);
+    auto index_reg = allocateRegister();
+    
+    auto loop_var_reg = allocateRegister();
+    GDType loop_var_type = storageType(semantic_analyzer->getDeclarationType(stmt).base_type);
+    if (loop_var_type == GDType::FLOAT) {
+        loop_var_reg = allocateRegister(Register::FLOAT);
+    }
+    nameRegister(loop_var_reg, stmt->variable);
+    variables[stmt->variable] = loop_var_reg;
+    variable_types[stmt->variable] = loop_var_type;
+    
+    std::string loop_label = generateLabel("for_loop");
+    std::string next_label = generateLabel("for_next");
+    std::string end_label = generateLabel("for_end");
+    
+    pushBreakLabel(end_label);
+    pushContinueLabel(next_label);
+    
+    // Tested once before the loop and then at the bottom, so the body runs
+    // on every trip and its loads may be hoisted. The body may resize the
+    // array, so the bottom test reads the length again; loop optimization
+    // hoists that load too when the body cannot write memory.
+    emit(Instruction::MOV, index_reg, 0);
+    emit(Instruction::CMP, index_reg, length_reg);
+    emit(Instruction::JGE, end_label);
+    emitLabel(loop_label);
+    
+    // Storage is reloaded because the body may grow the array; loop
+    // optimization hoists the load when the body cannot write memory, and
+    // the scaled index becomes a running offset
+    auto data_reg = allocateRegister();
+    auto offset_reg = allocateRegister();
+    auto address_reg = allocateRegister();
+    emit(Instruction::LOAD, data_reg, array_reg, ARRAY_DATA_OFFSET);
+    emit(Instruction::MUL, offset_reg, index_reg, stride);
+    emit(Instruction::ADD, address_reg, data_reg, offset_reg);
+    
+    VReg element_reg;
+    if (element_type == GDType::VARIANT) {
+        // A copy, so writes to the array do not show through the loop variable
+        element_reg = generateValueClone(address_reg, VARIANT_SIZE);
+    } else if (element_type == GDType::FLOAT) {
+        element_reg = allocateRegister(Register::FLOAT);
+        emit(Instruction::LOAD, element_reg, address_reg, 0);
+        if (narrow) {
+            // Widen the single-precision low half to a double
+            emit(Instruction::CVTS2D, element_reg, element_reg);
+        }
+    } else if (element_type == GDType::INT) {
+        element_reg = allocateRegister();
+        emit(Instruction::LOAD, element_reg, address_reg, 0);
+        if (narrow) {
+            // Sign-extend the low half of the word
+            emit(Instruction::SHL, element_reg, element_reg, 32);
+            emit(Instruction::SHR, element_reg, element_reg, 32);
+        }
+    }
+    emit(Instruction::MOV, loop_var_reg, convertType(element_reg, element_type, loop_var_type));
+    
+    generateStatement(stmt->body.get());
+    
+    emitLabel(next_label);
+    emit(Instruction::ADD, index_reg, index_reg, 1);
+    emit(Instruction::LOAD, length_reg, array_reg, ARRAY_SIZE_OFFSET);
+    emit(Instruction::CMP, index_reg, length_reg);
+    emit(Instruction::JL, loop_label);
+    
+    emitLabel(end_label);
+    
+    popBreakLabel();
+    popContinueLabel();
+    return true;
+}
+
+void CodeGenerator::generateIteratorForLoop(ForStmt* stmt) {
     // Generate iterator setup
     auto iterable_reg = generateExpression(stmt->iterable.get());
     auto iterator_reg = allocateRegister();
     auto loop_var_reg = allocateRegister();
     
-    loop_var_reg->name = stmt->variable;
+    GDType loop_var_type = semantic_analyzer ?
+        storageType(semantic_analyzer->getDeclarationType(stmt).base_type) : GDType::VARIANT;
+    nameRegister(loop_var_reg, stmt->variable);
     variables[stmt->variable] = loop_var_reg;
+    variable_types[stmt->variable] = loop_var_type;
     
     std::string loop_label = generateLabel("for_loop");
+    std::string next_label = generateLabel("for_next");
     std::string end_label = generateLabel("for_end");
     
     pushBreakLabel(end_label);
-    pushContinueLabel(loop_label);
+    pushContinueLabel(next_label);
     
-    // Initialize iterator
-    emit(Instruction::MOV, iterator_reg, 0);
+    // Initialize iterator from the iterable
+    emit(Instruction::MOV, iterator_reg, iterable_reg);
     
     emitLabel(loop_label);
     
-    // Check if iterator is valid (simplified)
-    emit(Instruction::CALL, "_iterator_valid");
-    auto valid_reg = allocateRegister();
+    // Check if iterator is valid
+    auto valid_reg = generateRuntimeCall("_iterator_valid", {iterator_reg});
     emit(Instruction::CMP, valid_reg, 0);
     emit(Instruction::JE, end_label);
-    freeRegister(valid_reg);
     
-    // Get current value
-    emit(Instruction::CALL, "_iterator_get");
-    emit(Instruction::MOV, loop_var_reg, allocateRegister());
+    // Get current value (iterators yield Variants)
+    auto value_reg = generateRuntimeCall("_iterator_get", {iterator_reg});
+    emit(Instruction::MOV, loop_var_reg, convertType(value_reg, GDType::VARIANT, loop_var_type));
     
     generateStatement(stmt->body.get());
     
-    // Advance iterator
-    emit(Instruction::CALL, "_iterator_next");
+    // Advance iterator; continue lands here too
+    emitLabel(next_label);
+    generateRuntimeCall("_iterator_next", {iterator_reg});
     emit(Instruction::JMP, loop_label);
     
     emitLabel(end_label);
     
-    freeRegister(iterable_reg);
-    freeRegister(iterator_reg);
-    
     popBreakLabel();
     popContinueLabel();
 }
 
 void CodeGenerator::generateReturnStmt(ReturnStmt* stmt) {
+    if (stmt->value && stmt->value->type == ASTNodeType::CALL &&
+        generateSelfTailCall(static_cast<CallExpr*>(stmt->value.get()))) {
+        return;
+    }
+    
     if (stmt->value) {
-        auto return_reg = generateExpression(stmt->value.get());
-        // Move return value to designated return register
-        if (current_function && current_function->return_register) {
-            emit(Instruction::MOV, current_function->return_register, return_reg);
+        // The value takes the declared type, so an untyped function returns
+        // a boxed Variant, and that type picks the return register
+        auto return_reg = convertType(generateExpression(stmt->value.get()), getStaticType(stmt->value.get()),
+                                      current_return_type);
+        if (current_function) {
+            Register::Type type = current_return_type == GDType::FLOAT ? Register::FLOAT : Register::GENERAL;
+            emit(Instruction::MOV, returnRegister(type), return_reg);
         }
-        freeRegister(return_reg);
     }
     
     emit(Instruction::RET);
 }
 
+// 'return f(...)' inside f itself reassigns the parameters and jumps back
+// to the top of the body, so the recursion runs in constant stack space.
+// Calls to other functions in tail position become jumps later, when the
+// calling convention is lowered.
+bool CodeGenerator::generateSelfTailCall(CallExpr* expr) {
+    if (!current_function || expr->callee->type != ASTNodeType::IDENTIFIER) return false;
+    const std::string& name = static_cast<IdentifierExpr*>(expr->callee.get())->name;
+    if (isBuiltinFunction(name) || variables.find(name) != variables.end()) return false;
+    
+    // Methods recurse through their implementation symbol, and only when no
+    // subclass can take the call elsewhere
+    std::string target = name;
+    bool has_self = false;
+    if (current_class_entry) {
+        if (const MethodSlot* method = current_class_entry->findMethod(name)) {
+            const ClassHierarchy& hierarchy = semantic_analyzer->getClassHierarchy();
+            has_self = !method->is_static;
+            if (has_self && hierarchy.isOverridden(current_class_entry->id, method->slot)) return false;
+            target = hierarchy.getImplementationName(*current_class_entry, method->slot);
+        }
+    }
+    const auto& parameters = current_function->parameters;
+    if (target != current_function->name || expr->arguments.size() + (has_self ? 1 : 0) != parameters.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < expr->arguments.size(); ++i) {
+        bool float_argument = getStaticType(expr->arguments[i].get()) == GDType::FLOAT;
+        bool float_parameter = current_function->getRegister(parameters[i + (has_self ? 1 : 0)]).type == Register::FLOAT;
+        if (float_argument != float_parameter) return false;
+    }
+    
+    // Every argument is evaluated before any parameter is overwritten
+    std::vector<VReg> values;
+    for (auto& arg : expr->arguments) {
+        values.push_back(generateExpression(arg.get()));
+    }
+    for (size_t i = 0; i < values.size(); ++i) {
+        emit(Instruction::MOV, parameters[i + (has_self ? 1 : 0)], values[i]);
+    }
+    
+    // The loop head goes in front of the body on first use; the entry block
+    // keeps no predecessors so the incoming parameters are read only once
+    std::string head = current_function->name + "_tailrec";
+    auto& body = current_function->blocks.front()->instructions;
+    bool has_head = !body.empty() && body.front().opcode == Instruction::LABEL &&
+                    current_function->symbolName(body.front().label) == head;
+    if (!has_head) {
+        Instruction label(Instruction::LABEL);
+        label.label = current_function->internSymbol(head);
+        body.insert(body.begin(), label);
+    }
+    emit(Instruction::JMP, head);
+    call_stats.tail_recursion++;
+    return true;
+}
+
 void CodeGenerator::generateExpressionStmt(ExpressionStmt* stmt) {
-    auto result_reg = generateExpression(stmt->expression.get());
-    freeRegister(result_reg);
+    generateExpression(stmt->expression.get());
 }
 
 void CodeGenerator::generateBreakStmt(BreakStmt* stmt) {
@@ -602,8 +986,15 @@ void CodeGenerator::generateContinueStmt(ContinueStmt* stmt) {
     }
 }
 
-std::shared_ptr<Register> CodeGenerator::generateExpression(Expression* expr) {
-    if (!expr) return nullptr;
+VReg CodeGenerator::generateExpression(Expression* expr) {
+    if (!expr) return VReg();
+    
+    // Values the analyzer evaluated at compile time become immediates
+    if (expr->constant.isKnown()) {
+        if (auto constant_reg = generateConstant(expr->constant)) {
+            return constant_reg;
+        }
+    }
     
     switch (expr->type) {
         case ASTNodeType::LITERAL:
@@ -634,25 +1025,100 @@ std::shared_ptr<Register> CodeGenerator::generateExpression(Expression* expr) {
     }
 }
 
-std::shared_ptr<Register> CodeGenerator::generateLiteralExpr(LiteralExpr* expr) {
+VReg CodeGenerator::generateConstant(const ConstantValue& value) {
+    switch (value.kind) {
+        case ConstantValue::INT:
+        case ConstantValue::BOOL:
+            return generateIntConstant(value.int_value);
+        case ConstantValue::FLOAT:
+            return generateFloatConstant(value.float_value);
+        case ConstantValue::NIL: {
+            auto result_reg = allocateRegister();
+            emit(Instruction::MOV, result_reg, 0);
+            return result_reg;
+        }
+        case ConstantValue::STRING:
+            return generateStringConstant(value.string_value);
+        default:
+            return VReg();
+    }
+}
+
+// Floats are doubles. A constant whose bits a sign-extended 32-bit
+// immediate holds, such as 0.0, is a MOV; any other is loaded from .rodata,
+// one object per distinct value.
+VReg CodeGenerator::generateFloatConstant(double value) {
+    int64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    auto result_reg = allocateRegister(Register::FLOAT);
+    if (bits >= INT32_MIN && bits <= INT32_MAX) {
+        emit(Instruction::MOV, result_reg, static_cast<int>(bits));
+        return result_reg;
+    }
+    auto it = float_constants.find(bits);
+    if (it == float_constants.end()) {
+        DataObject object(".double." + std::to_string(float_constants.size()), DataObject::RODATA, 8);
+        for (int i = 0; i < 8; ++i) object.bytes.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+        data_objects.push_back(object);
+        it = float_constants.emplace(bits, object.name).first;
+    }
+    auto address_reg = allocateRegister();
+    emit(Instruction::ADDR, address_reg, it->second);
+    emit(Instruction::LOAD, result_reg, address_reg, 0);
+    return result_reg;
+}
+
+// Immediates are 32-bit. An int that does not fit one is loaded from
+// .rodata, one object per distinct value.
+VReg CodeGenerator::generateIntConstant(int64_t value) {
+    auto result_reg = allocateRegister();
+    if (value >= INT32_MIN && value <= INT32_MAX) {
+        emit(Instruction::MOV, result_reg, static_cast<int>(value));
+        return result_reg;
+    }
+    auto it = int_constants.find(value);
+    if (it == int_constants.end()) {
+        DataObject object(".int64." + std::to_string(int_constants.size()), DataObject::RODATA, 8);
+        for (int i = 0; i < 8; ++i) object.bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        data_objects.push_back(object);
+        it = int_constants.emplace(value, object.name).first;
+    }
+    auto address_reg = allocateRegister();
+    emit(Instruction::ADDR, address_reg, it->second);
+    emit(Instruction::LOAD, result_reg, address_reg, 0);
+    return result_reg;
+}
+
+// A string value is the address of its NUL-terminated bytes; literals live
+// in .rodata, one object per distinct text
+VReg CodeGenerator::generateStringConstant(const std::string& text) {
+    auto it = string_constants.find(text);
+    if (it == string_constants.end()) {
+        DataObject object(".str." + std::to_string(string_constants.size()), DataObject::RODATA, 1);
+        object.bytes.assign(text.begin(), text.end());
+        object.bytes.push_back(0);
+        data_objects.push_back(object);
+        it = string_constants.emplace(text, object.name).first;
+    }
+    auto result_reg = allocateRegister();
+    emit(Instruction::ADDR, result_reg, it->second);
+    return result_reg;
+}
+
+VReg CodeGenerator::generateLiteralExpr(LiteralExpr* expr) {
     auto result_reg = allocateRegister();
     
     switch (expr->literal_type) {
         case TokenType::INTEGER: {
-            int value = std::stoi(expr->value);
-            emit(Instruction::MOV, result_reg, value);
+            result_reg = generateIntConstant(std::stoll(expr->value));
             break;
         }
         case TokenType::FLOAT: {
-            // For simplicity, convert float to int representation
-            float value = std::stof(expr->value);
-            result_reg = allocateRegister(Register::FLOAT);
-            emit(Instruction::MOV, result_reg, static_cast<int>(value * 1000)); // Scale for demo
+            result_reg = generateFloatConstant(std::stod(expr->value));
             break;
         }
         case TokenType::STRING: {
-            // Load string address (simplified)
-            emit(Instruction::MOV, result_reg, 0); // String table address
+            result_reg = generateStringConstant(expr->value);
             break;
         }
         case TokenType::BOOLEAN: {
@@ -673,250 +1139,34 @@ std::shared_ptr<Register> CodeGenerator::generateLiteralExpr(LiteralExpr* expr)
 }
 
 // Machine code generation
-std::vector<uint8_t> CodeGenerator::generateMachineCode() {
-    std::vector<uint8_t> machine_code;
-    
-    // Convert our intermediate representation to machine code
-    for (auto& func : functions) {
-        for (auto& block : func->blocks) {
-            for (auto& instr : block->instructions) {
-                std::vector<uint8_t> instr_bytes = generateInstructionBytes(instr.get());
-                machine_code.insert(machine_code.end(), instr_bytes.begin(), instr_bytes.end());
-            }
-        }
-    }
-    
-    return machine_code;
-}
-
-// Generate machine code bytes for a single instruction
-std::vector<uint8_t> CodeGenerator::generateInstructionBytes(Instruction* instr) {
-    std::vector<uint8_t> bytes;
-    
+AssembledCode CodeGenerator::generateMachineCode() {
     switch (target_platform) {
-        case TargetPlatform::WINDOWS_X64:
-        case TargetPlatform::LINUX_X64:
-        case TargetPlatform::MACOS_X64:
-            bytes = generateX86_64Instruction(instr);
-            break;
         case TargetPlatform::MACOS_ARM64:
-        case TargetPlatform::LINUX_ARM64:
-            bytes = generateARM64Instruction(instr);
-            break;
-        default:
-            // Fallback to simple NOP
-            bytes.push_back(0x90); // x86 NOP
-            break;
-    }
-    
-    return bytes;
-}
-
-// Generate x86_64 machine code for an instruction
-std::vector<uint8_t> CodeGenerator::generateX86_64Instruction(Instruction* instr) {
-    std::vector<uint8_t> bytes;
-    
-    switch (instr->opcode) {
-        case Instruction::MOV:
-            if (instr->has_immediate) {
-                // mov reg, imm32
-                bytes.push_back(0x48); // REX.W prefix for 64-bit
-                bytes.push_back(0xc7);
-                bytes.push_back(0xc0); // ModR/M for RAX
-                // Add immediate value (little endian)
-                uint32_t imm = static_cast<uint32_t>(instr->immediate);
-                bytes.push_back(imm & 0xFF);
-                bytes.push_back((imm >> 8) & 0xFF);
-                bytes.push_back((imm >> 16) & 0xFF);
-                bytes.push_back((imm >> 24) & 0xFF);
-            } else {
-                // mov reg, reg
-                bytes.push_back(0x48); // REX.W prefix
-                bytes.push_back(0x89);
-                bytes.push_back(0xc0); // ModR/M for mov rax, rax
-            }
-            break;
-            
-        case Instruction::ADD:
-            if (instr->has_immediate) {
-                // add reg, imm32
-                bytes.push_back(0x48); // REX.W prefix
-                bytes.push_back(0x81);
-                bytes.push_back(0xc0); // ModR/M for add rax, imm32
-                uint32_t imm = static_cast<uint32_t>(instr->immediate);
-                bytes.push_back(imm & 0xFF);
-                bytes.push_back((imm >> 8) & 0xFF);
-                bytes.push_back((imm >> 16) & 0xFF);
-                bytes.push_back((imm >> 24) & 0xFF);
-            } else {
-                // add reg, reg
-                bytes.push_back(0x48); // REX.W prefix
-                bytes.push_back(0x01);
-                bytes.push_back(0xc0); // ModR/M for add rax, rax
-            }
-            break;
-            
-        case Instruction::SUB:
-            if (instr->has_immediate) {
-                // sub reg, imm32
-                bytes.push_back(0x48); // REX.W prefix
-                bytes.push_back(0x81);
-                bytes.push_back(0xe8); // ModR/M for sub rax, imm32
-                uint32_t imm = static_cast<uint32_t>(instr->immediate);
-                bytes.push_back(imm & 0xFF);
-                bytes.push_back((imm >> 8) & 0xFF);
-                bytes.push_back((imm >> 16) & 0xFF);
-                bytes.push_back((imm >> 24) & 0xFF);
-            } else {
-                // sub reg, reg
-                bytes.push_back(0x48); // REX.W prefix
-                bytes.push_back(0x29);
-                bytes.push_back(0xc0); // ModR/M for sub rax, rax
-            }
-            break;
-            
-        case Instruction::CALL:
-            // call rel32 (placeholder)
-            bytes.push_back(0xe8);
-            bytes.push_back(0x00);
-            bytes.push_back(0x00);
-            bytes.push_back(0x00);
-            bytes.push_back(0x00);
-            break;
-            
-        case Instruction::RET:
-            bytes.push_back(0xc3); // ret
-            break;
-            
-        case Instruction::PUSH:
-            bytes.push_back(0x50); // push rax (simplified)
-            break;
-            
-        case Instruction::POP:
-            bytes.push_back(0x58); // pop rax (simplified)
-            break;
-            
-        case Instruction::NOP:
-            bytes.push_back(0x90); // nop
-            break;
-            
-        default:
-            // Unknown instruction, emit NOP
-            bytes.push_back(0x90);
-            break;
-    }
-    
-    return bytes;
-}
-
-// Generate ARM64 machine code for an instruction
-std::vector<uint8_t> CodeGenerator::generateARM64Instruction(Instruction* instr) {
-    std::vector<uint8_t> bytes;
-    
-    switch (instr->opcode) {
-        case Instruction::MOV:
-            if (instr->has_immediate) {
-                // mov x0, #imm16
-                uint32_t imm = static_cast<uint32_t>(instr->immediate) & 0xFFFF;
-                uint32_t instruction = 0xd2800000 | (imm << 5); // mov x0, #imm16
-                bytes.push_back(instruction & 0xFF);
-                bytes.push_back((instruction >> 8) & 0xFF);
-                bytes.push_back((instruction >> 16) & 0xFF);
-                bytes.push_back((instruction >> 24) & 0xFF);
-            } else {
-                // mov x0, x1
-                bytes.push_back(0xe0); // mov x0, x1
-                bytes.push_back(0x03);
-                bytes.push_back(0x01);
-                bytes.push_back(0xaa);
-            }
-            break;
-            
-        case Instruction::ADD:
-            if (instr->has_immediate) {
-                // add x0, x0, #imm12
-                uint32_t imm = static_cast<uint32_t>(instr->immediate) & 0xFFF;
-                uint32_t instruction = 0x91000000 | (imm << 10); // add x0, x0, #imm12
-                bytes.push_back(instruction & 0xFF);
-                bytes.push_back((instruction >> 8) & 0xFF);
-                bytes.push_back((instruction >> 16) & 0xFF);
-                bytes.push_back((instruction >> 24) & 0xFF);
-            } else {
-                // add x0, x0, x1
-                bytes.push_back(0x00); // add x0, x0, x1
-                bytes.push_back(0x00);
-                bytes.push_back(0x01);
-                bytes.push_back(0x8b);
-            }
-            break;
-            
-        case Instruction::SUB:
-            if (instr->has_immediate) {
-                // sub x0, x0, #imm12
-                uint32_t imm = static_cast<uint32_t>(instr->immediate) & 0xFFF;
-                uint32_t instruction = 0xd1000000 | (imm << 10); // sub x0, x0, #imm12
-                bytes.push_back(instruction & 0xFF);
-                bytes.push_back((instruction >> 8) & 0xFF);
-                bytes.push_back((instruction >> 16) & 0xFF);
-                bytes.push_back((instruction >> 24) & 0xFF);
-            } else {
-                // sub x0, x0, x1
-                bytes.push_back(0x00); // sub x0, x0, x1
-                bytes.push_back(0x00);
-                bytes.push_back(0x01);
-                bytes.push_back(0xcb);
-            }
-            break;
-            
-        case Instruction::CALL:
-            // bl #0 (placeholder)
-            bytes.push_back(0x00);
-            bytes.push_back(0x00);
-            bytes.push_back(0x00);
-            bytes.push_back(0x94);
-            break;
-            
-        case Instruction::RET:
-            bytes.push_back(0xc0); // ret
-            bytes.push_back(0x03);
-            bytes.push_back(0x5f);
-            bytes.push_back(0xd6);
-            break;
-            
-        case Instruction::NOP:
-            bytes.push_back(0x1f); // nop
-            bytes.push_back(0x20);
-            bytes.push_back(0x03);
-            bytes.push_back(0xd5);
-            break;
-            
-        default:
-            // Unknown instruction, emit NOP
-            bytes.push_back(0x1f);
-            bytes.push_back(0x20);
-            bytes.push_back(0x03);
-            bytes.push_back(0xd5);
-            break;
+        case TargetPlatform::LINUX_ARM64: {
+            ARM64Encoder encoder(register_file);
+            return assemble(functions, data_objects, encoder, assembler_stats);
+        }
+        default: {
+            X86Encoder encoder(register_file);
+            return assemble(functions, data_objects, encoder, assembler_stats);
+        }
     }
-    
-    return bytes;
 }
 
-std::shared_ptr<Register> CodeGenerator::generateIdentifierExpr(IdentifierExpr* expr) {
+VReg CodeGenerator::generateIdentifierExpr(IdentifierExpr* expr) {
     // First check local variables
     auto it = variables.find(expr->name);
     if (it != variables.end()) {
-        auto result_reg = allocateRegister();
+        auto result_reg = allocateRegister(registerType(it->second) == Register::FLOAT ? Register::FLOAT : Register::GENERAL);
         emit(Instruction::MOV, result_reg, it->second);
-        return result_reg;
+        // Unbox where inference proved a narrower type at this point than the variable's storage
+        return convertType(result_reg, getVariableType(expr->name), getStaticType(expr));
     }
     
-    // Then check class member variables
-    auto class_it = class_members.find(expr->name);
-    if (class_it != class_members.end()) {
-        auto result_reg = allocateRegister();
-        emit(Instruction::MOV, result_reg, class_it->second);
-        return result_reg;
+    // Then static fields of the enclosing class
+    auto static_it = class_members.find(expr->name);
+    if (static_it != class_members.end()) {
+        return convertType(generateStaticLoad(static_it->second), static_it->second.type, getStaticType(expr));
     }
     
     // Check semantic analyzer's symbol table if available
@@ -928,7 +1178,7 @@ std::shared_ptr<Register> CodeGenerator::generateIdentifierExpr(IdentifierExpr*
             if (symbol) {
                 // Create a register for this variable if not already created
                 auto var_reg = allocateRegister();
-                var_reg->name = expr->name;
+                nameRegister(var_reg, expr->name);
                 variables[expr->name] = var_reg;
                 
                 auto result_reg = allocateRegister();
@@ -946,32 +1196,19 @@ std::shared_ptr<Register> CodeGenerator::generateIdentifierExpr(IdentifierExpr*
             }
         }
         
-        // Check class members if we're in a class context
-        if (!current_class_name.empty()) {
-            auto& classes = semantic_analyzer->getClasses();
-            auto class_it = classes.find(current_class_name);
-            if (class_it != classes.end()) {
-                // Check class member variables
-                auto member_it = class_it->second.members.find(expr->name);
-                if (member_it != class_it->second.members.end()) {
-                    // Create a register for this class member if not already created
-                    auto member_reg = allocateRegister();
-                    member_reg->name = expr->name;
-                    class_members[expr->name] = member_reg;
-                    
-                    auto result_reg = allocateRegister();
-                    emit(Instruction::MOV, result_reg, member_reg);
-                    return result_reg;
-                }
-                
-                // Check class methods
-                auto method_it = class_it->second.methods.find(expr->name);
-                if (method_it != class_it->second.methods.end()) {
-                    // Return function address for method references
-                    auto result_reg = allocateRegister();
-                    emit(Instruction::MOV, result_reg, 0); // Function address placeholder
-                    return result_reg;
-                }
+        // Check class members through the hierarchy index if we're in a class context
+        if (current_class_entry) {
+            const FieldSlot* field = current_class_entry->findField(expr->name);
+            auto self_it = variables.find("self");
+            if (field && !field->is_static && self_it != variables.end()) {
+                return generateFieldLoad(self_it->second, field);
+            }
+            
+            if (current_class_entry->findMethod(expr->name)) {
+                // Return function address for method references
+                auto result_reg = allocateRegister();
+                emit(Instruction::MOV, result_reg, 0); // Function address placeholder
+                return result_reg;
             }
         }
     }
@@ -980,303 +1217,703 @@ std::shared_ptr<Register> CodeGenerator::generateIdentifierExpr(IdentifierExpr*
     return allocateRegister();
 }
 
-std::shared_ptr<Register> CodeGenerator::generateBinaryOpExpr(BinaryOpExpr* expr) {
+VReg CodeGenerator::generateBinaryOpExpr(BinaryOpExpr* expr) {
+    switch (expr->operator_type) {
+        case TokenType::ASSIGN:
+        case TokenType::TYPE_INFER_ASSIGN:
+        case TokenType::PLUS_ASSIGN:
+        case TokenType::MINUS_ASSIGN:
+        case TokenType::MULTIPLY_ASSIGN:
+        case TokenType::DIVIDE_ASSIGN:
+        case TokenType::MODULO_ASSIGN:
+            return generateAssignment(expr);
+        default:
+            break;
+    }
+    
     auto left_reg = generateExpression(expr->left.get());
     auto right_reg = generateExpression(expr->right.get());
-    auto result_reg = allocateRegister();
+    GDType left_type = getStaticType(expr->left.get());
+    GDType right_type = getStaticType(expr->right.get());
     
     switch (expr->operator_type) {
         case TokenType::PLUS:
-            emit(Instruction::ADD, result_reg, left_reg, right_reg);
-            break;
         case TokenType::MINUS:
-            emit(Instruction::SUB, result_reg, left_reg, right_reg);
-            break;
         case TokenType::MULTIPLY:
-            emit(Instruction::MUL, result_reg, left_reg, right_reg);
-            break;
         case TokenType::DIVIDE:
-            emit(Instruction::DIV, result_reg, left_reg, right_reg);
-            break;
         case TokenType::MODULO:
-            emit(Instruction::MOD, result_reg, left_reg, right_reg);
-            break;
+            return generateArithmetic(expr->operator_type, left_reg, left_type, right_reg, right_type);
         case TokenType::EQUAL:
         case TokenType::NOT_EQUAL:
         case TokenType::LESS:
         case TokenType::LESS_EQUAL:
         case TokenType::GREATER:
-        case TokenType::GREATER_EQUAL: {
-            emit(Instruction::CMP, left_reg, right_reg);
-            
-            std::string true_label = generateLabel("cmp_true");
-            std::string end_label = generateLabel("cmp_end");
-            
-            switch (expr->operator_type) {
-                case TokenType::EQUAL: emit(Instruction::JE, true_label); break;
-                case TokenType::NOT_EQUAL: emit(Instruction::JNE, true_label); break;
-                case TokenType::LESS: emit(Instruction::JL, true_label); break;
-                case TokenType::LESS_EQUAL: emit(Instruction::JLE, true_label); break;
-                case TokenType::GREATER: emit(Instruction::JG, true_label); break;
-                case TokenType::GREATER_EQUAL: emit(Instruction::JGE, true_label); break;
+        case TokenType::GREATER_EQUAL:
+            return generateComparison(expr->operator_type, left_reg, left_type, right_reg, right_type);
+        default:
+            break;
+    }
+    
+    auto result_reg = allocateRegister();
+    
+    switch (expr->operator_type) {
+        case TokenType::AND:
+            emit(Instruction::AND, result_reg, left_reg, right_reg);
+            break;
+        case TokenType::OR:
+            emit(Instruction::OR, result_reg, left_reg, right_reg);
+            break;
+        default:
+            addError("Unknown binary operator");
+            emit(Instruction::MOV, result_reg, 0);
+            break;
+    }
+    
+    
+    return result_reg;
+}
+
+GDType CodeGenerator::getStaticType(Expression* expr) const {
+    if (!semantic_analyzer || !expr) return GDType::VARIANT;
+    
+    GDType type = semantic_analyzer->getResolvedType(expr).base_type;
+    return type == GDType::UNKNOWN ? GDType::VARIANT : type;
+}
+
+GDType CodeGenerator::getVariableType(const std::string& name) const {
+    auto it = variable_types.find(name);
+    return it != variable_types.end() ? it->second : GDType::VARIANT;
+}
+
+VReg CodeGenerator::generateArithmetic(TokenType op, VReg left_reg, GDType left_type,
+                                                            VReg right_reg, GDType right_type) {
+    VReg result_reg;
+    
+    if (isIntegral(left_type) && isIntegral(right_type)) {
+        // int op int stays in general purpose registers
+        Instruction::OpCode opcode = Instruction::ADD;
+        switch (op) {
+            case TokenType::MINUS: opcode = Instruction::SUB; break;
+            case TokenType::MULTIPLY: opcode = Instruction::MUL; break;
+            case TokenType::DIVIDE: opcode = Instruction::DIV; break;
+            case TokenType::MODULO: opcode = Instruction::MOD; break;
+            default: break;
+        }
+        result_reg = allocateRegister();
+        emit(opcode, result_reg, left_reg, right_reg);
+    } else if (isNumericType(left_type) && isNumericType(right_type)) {
+        // Mixed int/float promotes the integer side once
+        left_reg = convertType(left_reg, left_type, GDType::FLOAT);
+        right_reg = convertType(right_reg, right_type, GDType::FLOAT);
+        if (op == TokenType::MODULO) {
+            result_reg = generateRuntimeCall("_fmod", {left_reg, right_reg}, Register::FLOAT);
+        } else {
+            Instruction::OpCode opcode = Instruction::FADD;
+            switch (op) {
+                case TokenType::MINUS: opcode = Instruction::FSUB; break;
+                case TokenType::MULTIPLY: opcode = Instruction::FMUL; break;
+                case TokenType::DIVIDE: opcode = Instruction::FDIV; break;
                 default: break;
             }
-            
-            emit(Instruction::MOV, result_reg, 0); // False
-            emit(Instruction::JMP, end_label);
-            emitLabel(true_label);
-            emit(Instruction::MOV, result_reg, 1); // True
-            emitLabel(end_label);
-            break;
+            result_reg = allocateRegister(Register::FLOAT);
+            emit(opcode, result_reg, left_reg, right_reg);
+        }
+    } else if (isVectorType(left_type) && left_type == right_type && op != TokenType::MODULO) {
+        std::string prefix = left_type == GDType::VECTOR2 ? "_vector2_" : "_vector3_";
+        result_reg = generateRuntimeCall(prefix + operatorSuffix(op), {left_reg, right_reg});
+    } else if (isVectorType(left_type) && isNumericType(right_type) &&
+               (op == TokenType::MULTIPLY || op == TokenType::DIVIDE)) {
+        std::string prefix = left_type == GDType::VECTOR2 ? "_vector2_" : "_vector3_";
+        right_reg = convertType(right_reg, right_type, GDType::FLOAT);
+        result_reg = generateRuntimeCall(prefix + (op == TokenType::MULTIPLY ? "scale" : "div_scalar"), {left_reg, right_reg});
+    } else if (isNumericType(left_type) && isVectorType(right_type) && op == TokenType::MULTIPLY) {
+        std::string prefix = right_type == GDType::VECTOR2 ? "_vector2_" : "_vector3_";
+        left_reg = convertType(left_reg, left_type, GDType::FLOAT);
+        result_reg = generateRuntimeCall(prefix + "scale", {right_reg, left_reg});
+    } else if (left_type == GDType::STRING && right_type == GDType::STRING && op == TokenType::PLUS) {
+        result_reg = generateRuntimeCall("_string_concat", {left_reg, right_reg});
+    } else if (left_type == GDType::STRING && op == TokenType::MODULO) {
+        right_reg = convertType(right_reg, right_type, GDType::VARIANT);
+        result_reg = generateRuntimeCall("_string_format", {left_reg, right_reg});
+    } else {
+        // Unknown operand types: box and dispatch through the Variant runtime
+        left_reg = convertType(left_reg, left_type, GDType::VARIANT);
+        right_reg = convertType(right_reg, right_type, GDType::VARIANT);
+        result_reg = generateRuntimeCall(std::string("_variant_") + operatorSuffix(op), {left_reg, right_reg});
+    }
+    
+    return result_reg;
+}
+
+VReg CodeGenerator::generateComparison(TokenType op, VReg left_reg, GDType left_type,
+                                                            VReg right_reg, GDType right_type) {
+    // A float compare with a NaN operand is unordered, which only the
+    // "above" conditions reject, so a < b is tested as b > a
+    bool float_compare = isNumericType(left_type) && isNumericType(right_type) &&
+                         !(isIntegral(left_type) && isIntegral(right_type));
+    if (float_compare && (op == TokenType::LESS || op == TokenType::LESS_EQUAL)) {
+        std::swap(left_reg, right_reg);
+        std::swap(left_type, right_type);
+        op = op == TokenType::LESS ? TokenType::GREATER : TokenType::GREATER_EQUAL;
+    }
+    generateCompare(left_reg, left_type, right_reg, right_type);
+    
+    auto result_reg = allocateRegister();
+    std::string true_label = generateLabel("cmp_true");
+    std::string end_label = generateLabel("cmp_end");
+    
+    switch (op) {
+        case TokenType::EQUAL: emit(Instruction::JE, true_label); break;
+        case TokenType::NOT_EQUAL: emit(Instruction::JNE, true_label); break;
+        case TokenType::LESS: emit(Instruction::JL, true_label); break;
+        case TokenType::LESS_EQUAL: emit(Instruction::JLE, true_label); break;
+        case TokenType::GREATER: emit(Instruction::JG, true_label); break;
+        case TokenType::GREATER_EQUAL: emit(Instruction::JGE, true_label); break;
+        default: break;
+    }
+    
+    emit(Instruction::MOV, result_reg, 0); // False
+    emit(Instruction::JMP, end_label);
+    emitLabel(true_label);
+    emit(Instruction::MOV, result_reg, 1); // True
+    emitLabel(end_label);
+    
+    return result_reg;
+}
+
+// Sets the flags for a branch on the ordering of two values
+void CodeGenerator::generateCompare(VReg left_reg, GDType left_type, VReg right_reg, GDType right_type) {
+    if (isIntegral(left_type) && isIntegral(right_type)) {
+        emit(Instruction::CMP, left_reg, right_reg);
+    } else if (isNumericType(left_type) && isNumericType(right_type)) {
+        left_reg = convertType(left_reg, left_type, GDType::FLOAT);
+        right_reg = convertType(right_reg, right_type, GDType::FLOAT);
+        emit(Instruction::FCMP, left_reg, right_reg);
+    } else {
+        // Runtime comparison returns <0, 0 or >0
+        const char* helper = "_variant_compare";
+        if (left_type == GDType::STRING && right_type == GDType::STRING) {
+            helper = "_string_compare";
+        } else {
+            left_reg = convertType(left_reg, left_type, GDType::VARIANT);
+            right_reg = convertType(right_reg, right_type, GDType::VARIANT);
+        }
+        auto order_reg = generateRuntimeCall(helper, {left_reg, right_reg});
+        emit(Instruction::CMP, order_reg, 0);
+    }
+}
+
+VReg CodeGenerator::generateRuntimeCall(const std::string& name, const std::vector<VReg>& args,
+                                                             Register::Type result_type) {
+    pushArguments(args);
+    auto result_reg = allocateRegister(result_type);
+    emit(Instruction::CALL, result_reg, name);
+    return result_reg;
+}
+
+// Outgoing arguments, last first; calling-convention lowering later moves
+// them into argument registers and releases the stack ones with one add
+void CodeGenerator::pushArguments(const std::vector<VReg>& args) {
+    for (auto it = args.rbegin(); it != args.rend(); ++it) {
+        emit(Instruction::PUSH, *it);
+    }
+}
+
+VReg CodeGenerator::convertType(VReg src, GDType from_type, GDType to_type) {
+    if (from_type == to_type) return src;
+    
+    if (to_type == GDType::FLOAT && isIntegral(from_type)) {
+        auto result_reg = allocateRegister(Register::FLOAT);
+        emit(Instruction::CVTI2F, result_reg, src);
+        return result_reg;
+    }
+    
+    if (isIntegral(to_type) && from_type == GDType::FLOAT) {
+        auto result_reg = allocateRegister();
+        emit(Instruction::CVTF2I, result_reg, src);
+        return result_reg;
+    }
+    
+    if (isIntegral(to_type) && isIntegral(from_type)) {
+        return src;
+    }
+    
+    // Boxing into and unboxing out of Variant goes through the runtime
+    VReg result_reg;
+    if (to_type == GDType::VARIANT) {
+        switch (from_type) {
+            case GDType::INT: result_reg = generateRuntimeCall("_variant_from_int", {src}); break;
+            case GDType::BOOL: result_reg = generateRuntimeCall("_variant_from_bool", {src}); break;
+            case GDType::FLOAT: result_reg = generateRuntimeCall("_variant_from_float", {src}); break;
+            case GDType::STRING: result_reg = generateRuntimeCall("_variant_from_string", {src}); break;
+            default: return src; // Other values are already heap/Variant references
+        }
+    } else if (from_type == GDType::VARIANT) {
+        switch (to_type) {
+            case GDType::INT: result_reg = generateRuntimeCall("_variant_to_int", {src}); break;
+            case GDType::BOOL: result_reg = generateRuntimeCall("_variant_to_bool", {src}); break;
+            case GDType::FLOAT: result_reg = generateRuntimeCall("_variant_to_float", {src}, Register::FLOAT); break;
+            case GDType::STRING: result_reg = generateRuntimeCall("_variant_to_string", {src}); break;
+            default: return src;
+        }
+    } else {
+        return src;
+    }
+    
+    return result_reg;
+}
+
+VReg CodeGenerator::generateAssignment(BinaryOpExpr* expr) {
+    Expression* target = expr->left.get();
+    auto value_reg = generateExpression(expr->right.get());
+    
+    // Compound assignments read the current value first
+    TokenType compound_op = TokenType::ASSIGN;
+    switch (expr->operator_type) {
+        case TokenType::PLUS_ASSIGN: compound_op = TokenType::PLUS; break;
+        case TokenType::MINUS_ASSIGN: compound_op = TokenType::MINUS; break;
+        case TokenType::MULTIPLY_ASSIGN: compound_op = TokenType::MULTIPLY; break;
+        case TokenType::DIVIDE_ASSIGN: compound_op = TokenType::DIVIDE; break;
+        case TokenType::MODULO_ASSIGN: compound_op = TokenType::MODULO; break;
+        default: break;
+    }
+    
+    GDType value_type = getStaticType(expr->right.get());
+    if (compound_op != TokenType::ASSIGN) {
+        // The target's recorded type is the one it holds before the assignment
+        GDType current_type = getStaticType(target);
+        auto current_reg = generateExpression(target);
+        value_reg = generateArithmetic(compound_op, current_reg, current_type, value_reg, value_type);
+        value_type = arithmeticResultType(compound_op, current_type, value_type);
+    }
+    
+    if (target->type == ASTNodeType::IDENTIFIER) {
+        IdentifierExpr* id_expr = static_cast<IdentifierExpr*>(target);
+        auto var_it = variables.find(id_expr->name);
+        if (var_it != variables.end()) {
+            value_reg = convertType(value_reg, value_type, getVariableType(id_expr->name));
+            emit(Instruction::MOV, var_it->second, value_reg);
+            return value_reg;
+        }
+        
+        auto static_it = class_members.find(id_expr->name);
+        if (static_it != class_members.end()) {
+            value_reg = convertType(value_reg, value_type, static_it->second.type);
+            generateStaticStore(static_it->second, value_reg);
+            return value_reg;
         }
-        case TokenType::AND:
-            emit(Instruction::AND, result_reg, left_reg, right_reg);
-            break;
-        case TokenType::OR:
-            emit(Instruction::OR, result_reg, left_reg, right_reg);
-            break;
-        case TokenType::ASSIGN:
-            emit(Instruction::MOV, left_reg, right_reg);
-            emit(Instruction::MOV, result_reg, left_reg);
-            break;
-        case TokenType::PLUS_ASSIGN:
-            emit(Instruction::ADD, left_reg, left_reg, right_reg);
-            emit(Instruction::MOV, result_reg, left_reg);
-            break;
-        case TokenType::MINUS_ASSIGN:
-            emit(Instruction::SUB, left_reg, left_reg, right_reg);
-            emit(Instruction::MOV, result_reg, left_reg);
-            break;
-        case TokenType::MULTIPLY_ASSIGN:
-            emit(Instruction::MUL, left_reg, left_reg, right_reg);
-            emit(Instruction::MOV, result_reg, left_reg);
-            break;
-        case TokenType::DIVIDE_ASSIGN:
-            emit(Instruction::DIV, left_reg, left_reg, right_reg);
-            emit(Instruction::MOV, result_reg, left_reg);
-            break;
-        case TokenType::MODULO_ASSIGN:
-            emit(Instruction::MOD, left_reg, left_reg, right_reg);
-            emit(Instruction::MOV, result_reg, left_reg);
-            break;
-        case TokenType::TYPE_INFER_ASSIGN:
-            // Type inference assignment - same as regular assignment for code generation
-            emit(Instruction::MOV, left_reg, right_reg);
-            emit(Instruction::MOV, result_reg, left_reg);
-            break;
-        default:
-            addError("Unknown binary operator");
-            emit(Instruction::MOV, result_reg, 0);
-            break;
+        
+        // Implicit instance field of the enclosing class
+        auto self_it = variables.find("self");
+        const FieldSlot* field = current_class_entry ? current_class_entry->findField(id_expr->name) : nullptr;
+        if (field && !field->is_static && self_it != variables.end()) {
+            value_reg = convertType(value_reg, value_type, storageType(field->type.base_type));
+            generateFieldStore(self_it->second, field, value_reg);
+            return value_reg;
+        }
+        
+        // Globals known to the analyzer get a register on first write
+        auto var_reg = allocateRegister();
+        nameRegister(var_reg, id_expr->name);
+        variables[id_expr->name] = var_reg;
+        emit(Instruction::MOV, var_reg, value_reg);
+        return value_reg;
+    }
+    
+    if (target->type == ASTNodeType::MEMBER_ACCESS) {
+        MemberAccessExpr* member_expr = static_cast<MemberAccessExpr*>(target);
+        auto object_reg = generateExpression(member_expr->object.get());
+        if (const FieldSlot* field = resolveField(member_expr)) {
+            value_reg = convertType(value_reg, value_type, storageType(field->type.base_type));
+            generateFieldStore(object_reg, field, value_reg);
+        } else {
+            // Unknown class: fall back to a runtime property write by name
+            auto name_reg = generateStringConstant(member_expr->member);
+            value_reg = convertType(value_reg, value_type, GDType::VARIANT);
+            pushArguments({object_reg, name_reg, value_reg});
+            emit(Instruction::CALL, "_object_set");
+        }
+        return value_reg;
+    }
+    
+    if (target->type == ASTNodeType::ARRAY_ACCESS) {
+        ArrayAccessExpr* access = static_cast<ArrayAccessExpr*>(target);
+        auto array_reg = generateExpression(access->array.get());
+        auto index_reg = generateExpression(access->index.get());
+        pushArguments({array_reg, index_reg, value_reg});
+        emit(Instruction::CALL, "_array_set");
+        return value_reg;
+    }
+    
+    addError("Invalid assignment target");
+    return value_reg;
+}
+
+const FieldSlot* CodeGenerator::resolveField(MemberAccessExpr* expr) {
+    if (!semantic_analyzer) return nullptr;
+    
+    TypeInfo object_type = semantic_analyzer->getResolvedType(expr->object.get());
+    if (object_type.base_type != GDType::CUSTOM) return nullptr;
+    
+    const ClassEntry* entry = semantic_analyzer->getClassHierarchy().findClass(object_type.custom_name);
+    const FieldSlot* field = entry ? entry->findField(expr->member) : nullptr;
+    return (field && !field->is_static) ? field : nullptr;
+}
+
+VReg CodeGenerator::generateFieldLoad(VReg object_reg, const FieldSlot* field) {
+    if (field->is_inline) {
+        // Aggregates are used by address, so the value gets storage of its
+        // own; a later store to the field must not change it
+        auto address_reg = allocateRegister();
+        emit(Instruction::ADD, address_reg, object_reg, field->offset);
+        return generateValueClone(address_reg, field->size);
     }
     
-    freeRegister(left_reg);
-    freeRegister(right_reg);
+    if (field->isPackedBool()) {
+        auto word_reg = allocateRegister();
+        emit(Instruction::LOAD, word_reg, object_reg, field->offset);
+        if (field->bit > 0) {
+            emit(Instruction::SHR, word_reg, word_reg, field->bit);
+        }
+        emit(Instruction::AND, word_reg, word_reg, 1);
+        return word_reg;
+    }
     
+    auto result_reg = allocateRegister(field->type.base_type == GDType::FLOAT ? Register::FLOAT : Register::GENERAL);
+    emit(Instruction::LOAD, result_reg, object_reg, field->offset);
     return result_reg;
 }
 
-std::shared_ptr<Register> CodeGenerator::generateUnaryOpExpr(UnaryOpExpr* expr) {
+VReg CodeGenerator::generateValueClone(VReg address_reg, int size) {
+    auto size_reg = allocateRegister();
+    emit(Instruction::MOV, size_reg, size);
+    return generateRuntimeCall("_value_clone", {address_reg, size_reg});
+}
+
+void CodeGenerator::generateFieldStore(VReg object_reg, const FieldSlot* field, VReg value_reg) {
+    if (field->is_inline) {
+        auto address_reg = allocateRegister();
+        auto size_reg = allocateRegister();
+        emit(Instruction::ADD, address_reg, object_reg, field->offset);
+        emit(Instruction::MOV, size_reg, field->size);
+        pushArguments({address_reg, value_reg, size_reg});
+        emit(Instruction::CALL, "_value_copy");
+        return;
+    }
+    
+    if (field->isPackedBool()) {
+        // Read-modify-write of the shared bool word
+        auto word_reg = allocateRegister();
+        auto bit_reg = allocateRegister();
+        emit(Instruction::LOAD, word_reg, object_reg, field->offset);
+        emit(Instruction::AND, word_reg, word_reg, ~(1 << field->bit));
+        emit(Instruction::AND, bit_reg, value_reg, 1);
+        if (field->bit > 0) {
+            emit(Instruction::SHL, bit_reg, bit_reg, field->bit);
+        }
+        emit(Instruction::OR, word_reg, word_reg, bit_reg);
+        emit(Instruction::STORE, word_reg, object_reg, field->offset);
+        return;
+    }
+    
+    emit(Instruction::STORE, value_reg, object_reg, field->offset);
+}
+
+VReg CodeGenerator::generateUnaryOpExpr(UnaryOpExpr* expr) {
     auto operand_reg = generateExpression(expr->operand.get());
     auto result_reg = allocateRegister();
     
     switch (expr->operator_type) {
-        case TokenType::MINUS:
-            emit(Instruction::SUB, result_reg, allocateRegister(), operand_reg);
+        case TokenType::MINUS: {
+            GDType operand_type = getStaticType(expr->operand.get());
+            if (operand_type == GDType::FLOAT) {
+                result_reg = allocateRegister(Register::FLOAT);
+                auto zero_reg = allocateRegister(Register::FLOAT);
+                emit(Instruction::MOV, zero_reg, 0);
+                emit(Instruction::FSUB, result_reg, zero_reg, operand_reg);
+            } else if (isIntegral(operand_type)) {
+                auto zero_reg = allocateRegister();
+                emit(Instruction::MOV, zero_reg, 0);
+                emit(Instruction::SUB, result_reg, zero_reg, operand_reg);
+            } else {
+                result_reg = generateRuntimeCall("_variant_neg", {convertType(operand_reg, operand_type, GDType::VARIANT)});
+                return result_reg;
+            }
             break;
+        }
         case TokenType::PLUS:
             emit(Instruction::MOV, result_reg, operand_reg);
             break;
         case TokenType::NOT:
-        case TokenType::LOGICAL_NOT:
-            emit(Instruction::NOT, result_reg, operand_reg);
-            break;
+        case TokenType::LOGICAL_NOT: {
+            // Logical, not bitwise: true exactly when the operand is zero
+            GDType operand_type = getStaticType(expr->operand.get());
+            if (operand_type == GDType::FLOAT) {
+                return generateComparison(TokenType::EQUAL, operand_reg, GDType::FLOAT,
+                                          generateFloatConstant(0.0), GDType::FLOAT);
+            }
+            if (operand_type == GDType::VARIANT) {
+                operand_reg = convertType(operand_reg, operand_type, GDType::BOOL);
+            }
+            auto zero_reg = allocateRegister();
+            emit(Instruction::MOV, zero_reg, 0);
+            return generateComparison(TokenType::EQUAL, operand_reg, GDType::INT, zero_reg, GDType::INT);
+        }
         default:
             addError("Unknown unary operator");
             emit(Instruction::MOV, result_reg, operand_reg);
             break;
     }
     
-    freeRegister(operand_reg);
     return result_reg;
 }
 
-std::shared_ptr<Register> CodeGenerator::generateCallExpr(CallExpr* expr) {
-    std::vector<std::shared_ptr<Register>> arg_regs;
+VReg CodeGenerator::generateCallExpr(CallExpr* expr) {
+    std::vector<VReg> arg_regs;
     
     // Generate arguments
     for (auto& arg : expr->arguments) {
         arg_regs.push_back(generateExpression(arg.get()));
     }
     
+    if (const ClassEntry* entry = semantic_analyzer ? semantic_analyzer->getConstructedClass(expr) : nullptr) {
+        return generateNewObject(entry, arg_regs);
+    }
+    
     // Check if it's a built-in function
     if (expr->callee->type == ASTNodeType::IDENTIFIER) {
         IdentifierExpr* id_expr = static_cast<IdentifierExpr*>(expr->callee.get());
         if (isBuiltinFunction(id_expr->name)) {
-            auto result = generateBuiltinCall(id_expr->name, arg_regs);
-            for (auto& reg : arg_regs) {
-                freeRegister(reg);
-            }
+            auto result = generateBuiltinCall(id_expr->name, arg_regs,
+                                              getStaticType(expr) == GDType::FLOAT ? Register::FLOAT : Register::GENERAL);
             return result;
         }
+        
+        // Unqualified call to a method of the enclosing class (own or inherited)
+        if (current_class_entry && variables.find(id_expr->name) == variables.end()) {
+            if (const MethodSlot* method = current_class_entry->findMethod(id_expr->name)) {
+                auto self_it = variables.find("self");
+                auto self_reg = self_it != variables.end() ? self_it->second : VReg();
+                auto result = generateMethodCall(current_class_entry, method, self_reg, arg_regs);
+                return result;
+            }
+        }
     }
     
-    // Push arguments onto stack (reverse order for calling convention)
-    for (auto it = arg_regs.rbegin(); it != arg_regs.rend(); ++it) {
-        emit(Instruction::PUSH, *it);
+    // Method call on an object whose class is statically known
+    if (expr->callee->type == ASTNodeType::MEMBER_ACCESS && semantic_analyzer) {
+        MemberAccessExpr* member_expr = static_cast<MemberAccessExpr*>(expr->callee.get());
+        TypeInfo object_type = semantic_analyzer->getResolvedType(member_expr->object.get());
+        const ClassEntry* entry = object_type.base_type == GDType::CUSTOM ?
+            semantic_analyzer->getClassHierarchy().findClass(object_type.custom_name) : nullptr;
+        const MethodSlot* method = entry ? entry->findMethod(member_expr->member) : nullptr;
+        if (method) {
+            auto object_reg = generateExpression(member_expr->object.get());
+            auto result = generateMethodCall(entry, method, object_reg, arg_regs);
+            return result;
+        }
     }
     
-    // Generate function call
+    // Generate function call; the call defines its result register, a float
+    // one when the callee returns in the float return register
+    auto result_reg = allocateRegister(getStaticType(expr) == GDType::FLOAT ? Register::FLOAT : Register::GENERAL);
     if (expr->callee->type == ASTNodeType::IDENTIFIER) {
         IdentifierExpr* id_expr = static_cast<IdentifierExpr*>(expr->callee.get());
-        emit(Instruction::CALL, id_expr->name);
+        bool specialized = specialized_functions.count(id_expr->name) != 0;
+        pushArguments(arg_regs);
+        emit(Instruction::CALL, result_reg, specialized ? specializedName(id_expr->name) : id_expr->name);
     } else {
         // Indirect call
         auto callee_reg = generateExpression(expr->callee.get());
-        emit(Instruction::CALL, callee_reg->name);
-        freeRegister(callee_reg);
+        pushArguments(arg_regs);
+        emit(Instruction::CALL, result_reg, callee_reg);
     }
     
-    // Clean up stack
-    for (size_t i = 0; i < arg_regs.size(); ++i) {
-        emit(Instruction::POP, allocateRegister());
+    return result_reg;
+}
+
+// Name.new(): zeroed storage for the instance with its vtable pointer at
+// offset 0, then _init with the call's arguments when the class has one
+VReg CodeGenerator::generateNewObject(const ClassEntry* entry, const std::vector<VReg>& args) {
+    auto size_reg = allocateRegister();
+    emit(Instruction::MOV, size_reg, entry->instance_size);
+    auto object_reg = generateRuntimeCall("_object_alloc", {size_reg});
+    if (!entry->vtable.empty()) {
+        auto vtable_reg = allocateRegister();
+        emit(Instruction::ADDR, vtable_reg, vtableName(entry->name));
+        emit(Instruction::STORE, vtable_reg, object_reg, 0);
+    }
+    
+    // Base class first, each class's field initializers and then its own
+    // _init. The arguments go to the _init the class resolves to; an
+    // ancestor's _init runs before it when it takes no arguments.
+    const ClassHierarchy& hierarchy = semantic_analyzer->getClassHierarchy();
+    const MethodSlot* init = entry->findMethod("_init");
+    for (int id : entry->display) {
+        const ClassEntry* cls = hierarchy.getClass(id);
+        if (!cls) continue;
+        if (hasFieldInitializers(*cls)) {
+            pushArguments({object_reg});
+            emit(Instruction::CALL, fieldInitializerName(cls->name));
+        }
+        const MethodSlot* own = cls->findMethod("_init");
+        if (!own || own->owner_id != cls->id || own->is_static) continue;
+        bool resolved = init && own->owner_id == init->owner_id;
+        if (!resolved && !own->signature.parameter_types.empty()) continue;
+        
+        std::vector<VReg> call_args = {object_reg};
+        if (resolved) call_args.insert(call_args.end(), args.begin(), args.end());
+        pushArguments(call_args);
+        emit(Instruction::CALL, hierarchy.getImplementationName(*cls, own->slot));
     }
+    return object_reg;
+}
+
+VReg CodeGenerator::generateMethodCall(const ClassEntry* entry, const MethodSlot* method,
+                                                           VReg self_reg,
+                                                           const std::vector<VReg>& args) {
+    const ClassHierarchy& hierarchy = semantic_analyzer->getClassHierarchy();
+    bool has_self = !method->is_static && self_reg;
     
-    // Get return value
-    auto result_reg = allocateRegister();
-    // Return value is typically in a specific register (e.g., rax)
+    // The receiver is the implicit first parameter
+    std::vector<VReg> call_args;
+    if (has_self) {
+        call_args.push_back(self_reg);
+    }
+    call_args.insert(call_args.end(), args.begin(), args.end());
     
-    for (auto& reg : arg_regs) {
-        freeRegister(reg);
+    bool float_result = method->signature.return_type.base_type == GDType::FLOAT;
+    auto result_reg = allocateRegister(float_result ? Register::FLOAT : Register::GENERAL);
+    if (!has_self || !hierarchy.isOverridden(entry->id, method->slot)) {
+        // No subclass overrides this slot: call the implementation directly
+        pushArguments(call_args);
+        emit(Instruction::CALL, result_reg, hierarchy.getImplementationName(*entry, method->slot));
+    } else {
+        // Virtual dispatch: the vtable pointer is stored at offset 0 of every
+        // object, and each entry is its method's distance from the table
+        auto vtable_reg = allocateRegister();
+        auto entry_reg = allocateRegister();
+        auto target_reg = allocateRegister();
+        emit(Instruction::LOAD, vtable_reg, self_reg, 0);
+        emit(Instruction::LOAD, entry_reg, vtable_reg, method->slot * 8);
+        emit(Instruction::ADD, target_reg, vtable_reg, entry_reg);
+        pushArguments(call_args);
+        emit(Instruction::CALL, result_reg, target_reg);
     }
     
     return result_reg;
 }
 
-std::shared_ptr<Register> CodeGenerator::generateMemberAccessExpr(MemberAccessExpr* expr) {
+VReg CodeGenerator::generateMemberAccessExpr(MemberAccessExpr* expr) {
     auto object_reg = generateExpression(expr->object.get());
-    auto result_reg = allocateRegister();
     
-    // Simplified member access - load from offset
-    emit(Instruction::LOAD, result_reg, object_reg);
+    // Statically known class: single load at the field's constant offset
+    if (const FieldSlot* field = resolveField(expr)) {
+        auto result_reg = generateFieldLoad(object_reg, field);
+        return result_reg;
+    }
+    
+    // Otherwise look the property up at runtime by name
+    auto name_reg = generateStringConstant(expr->member);
+    auto result_reg = generateRuntimeCall("_object_get", {object_reg, name_reg});
     
-    freeRegister(object_reg);
     return result_reg;
 }
 
-std::shared_ptr<Register> CodeGenerator::generateArrayAccessExpr(ArrayAccessExpr* expr) {
+VReg CodeGenerator::generateArrayAccessExpr(ArrayAccessExpr* expr) {
     auto array_reg = generateExpression(expr->array.get());
     auto index_reg = generateExpression(expr->index.get());
-    auto result_reg = allocateRegister();
     
     // Call runtime array access function
-    emit(Instruction::PUSH, array_reg);
-    emit(Instruction::PUSH, index_reg);
-    emit(Instruction::CALL, "_array_get");
-    emit(Instruction::POP, allocateRegister());
-    emit(Instruction::POP, allocateRegister());
-    
-    freeRegister(array_reg);
-    freeRegister(index_reg);
+    auto result_reg = generateRuntimeCall("_array_get", {array_reg, index_reg});
     
     return result_reg;
 }
 
-std::shared_ptr<Register> CodeGenerator::generateArrayLiteralExpr(ArrayLiteralExpr* expr) {
+VReg CodeGenerator::generateArrayLiteralExpr(ArrayLiteralExpr* expr) {
     auto result_reg = allocateRegister();
     
     // Call runtime array creation
-    emit(Instruction::CALL, "_array_create");
+    emit(Instruction::CALL, result_reg, "_array_create");
     
     // Add elements
     for (auto& element : expr->elements) {
         auto element_reg = generateExpression(element.get());
-        emit(Instruction::PUSH, result_reg);
-        emit(Instruction::PUSH, element_reg);
+        pushArguments({result_reg, element_reg});
         emit(Instruction::CALL, "_array_append");
-        emit(Instruction::POP, allocateRegister());
-        emit(Instruction::POP, allocateRegister());
-        freeRegister(element_reg);
     }
     
     return result_reg;
 }
 
-std::shared_ptr<Register> CodeGenerator::generateDictLiteralExpr(DictLiteralExpr* expr) {
+VReg CodeGenerator::generateDictLiteralExpr(DictLiteralExpr* expr) {
     auto result_reg = allocateRegister();
     
     // Call runtime dictionary creation
-    emit(Instruction::CALL, "_dict_create");
+    emit(Instruction::CALL, result_reg, "_dict_create");
     
     // Add key-value pairs
     for (auto& pair : expr->pairs) {
         auto key_reg = generateExpression(pair.first.get());
         auto value_reg = generateExpression(pair.second.get());
         
-        emit(Instruction::PUSH, result_reg);
-        emit(Instruction::PUSH, key_reg);
-        emit(Instruction::PUSH, value_reg);
+        pushArguments({result_reg, key_reg, value_reg});
         emit(Instruction::CALL, "_dict_set");
-        emit(Instruction::POP, allocateRegister());
-        emit(Instruction::POP, allocateRegister());
-        emit(Instruction::POP, allocateRegister());
         
-        freeRegister(key_reg);
-        freeRegister(value_reg);
     }
     
     return result_reg;
 }
 
 // Register management
-std::shared_ptr<Register> CodeGenerator::allocateRegister(Register::Type type) {
-    for (auto& reg : available_registers) {
-        if (!reg->is_allocated && reg->type == type) {
-            reg->is_allocated = true;
-            allocated_registers.push_back(reg);
-            return reg;
-        }
-    }
-    
-    // If no physical register available, create virtual register
-    return allocateVirtualRegister(type);
+VReg CodeGenerator::allocateRegister(Register::Type type) {
+    // Every value gets a fresh virtual register; physical registers are
+    // assigned once the whole function is known
+    return current_function ? current_function->newRegister(type) : VReg();
 }
 
-std::shared_ptr<Register> CodeGenerator::allocateVirtualRegister(Register::Type type) {
-    std::string name = "v" + std::to_string(next_register_id++);
-    auto reg = std::make_shared<Register>(next_register_id, Register::VIRTUAL, name);
-    reg->type = type;
-    return reg;
+Register::Type CodeGenerator::registerType(VReg reg) const {
+    return (current_function && reg) ? current_function->getRegister(reg).type : Register::GENERAL;
 }
 
-void CodeGenerator::freeRegister(std::shared_ptr<Register> reg) {
-    if (reg && reg->is_allocated) {
-        reg->is_allocated = false;
-        auto it = std::find(allocated_registers.begin(), allocated_registers.end(), reg);
-        if (it != allocated_registers.end()) {
-            allocated_registers.erase(it);
-        }
+void CodeGenerator::nameRegister(VReg reg, const std::string& name) {
+    if (current_function && reg) {
+        current_function->getRegister(reg).name = name;
+    }
+}
+
+VReg CodeGenerator::returnRegister(Register::Type type) {
+    // Created by the first return with a value; every later return writes
+    // the same register, which RET reads implicitly
+    if (!current_function->return_register) {
+        current_function->return_register = current_function->newRegister(type, "result");
     }
+    return current_function->return_register;
 }
 
 void CodeGenerator::performRegisterAllocation() {
-    // Simplified register allocation - linear scan
+    // Allocate against the ABI of the target; Windows preserves more registers
+    switch (target_platform) {
+        case TargetPlatform::MACOS_ARM64:
+        case TargetPlatform::LINUX_ARM64:
+            register_file = RegisterFile::aarch64();
+            break;
+        case TargetPlatform::WINDOWS_X64:
+            register_file = RegisterFile::x86_64(true);
+            break;
+        default:
+            register_file = RegisterFile::x86_64(false);
+            break;
+    }
+    
     for (auto& func : functions) {
-        for (auto& block : func->blocks) {
-            for (auto& instr : block->instructions) {
-                for (auto& operand : instr->operands) {
-                    if (operand && operand->type == Register::VIRTUAL) {
-                        // Find a physical register
-                        for (auto& phys_reg : available_registers) {
-                            if (!phys_reg->is_allocated && phys_reg->type == operand->type) {
-                                operand->name = phys_reg->name;
-                                operand->id = phys_reg->id;
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
+        lowerCallingConvention(*func, register_file, call_stats);
+        if (allocator_kind == AllocatorKind::GRAPH_COLORING) {
+            GraphColoringAllocator allocator(*func, register_file);
+            allocator.run(allocation_stats);
+        } else {
+            LinearScanAllocator allocator(*func, register_file);
+            allocator.run(allocation_stats);
         }
     }
 }
@@ -1289,66 +1926,86 @@ std::string CodeGenerator::generateLabel(const std::string& prefix) {
 // Instruction helpers
 void CodeGenerator::emit(Instruction::OpCode opcode) {
     if (current_block) {
-        current_block->addInstruction(std::make_unique<Instruction>(opcode));
+        current_block->addInstruction(Instruction(opcode));
+    }
+}
+
+void CodeGenerator::emit(Instruction::OpCode opcode, VReg dest) {
+    if (current_block) {
+        Instruction instr(opcode);
+        instr.addOperand(dest);
+        current_block->addInstruction(instr);
     }
 }
 
-void CodeGenerator::emit(Instruction::OpCode opcode, std::shared_ptr<Register> dest) {
+void CodeGenerator::emit(Instruction::OpCode opcode, VReg dest, VReg src) {
     if (current_block) {
-        auto instr = std::make_unique<Instruction>(opcode);
-        instr->operands.push_back(dest);
-        current_block->addInstruction(std::move(instr));
+        Instruction instr(opcode);
+        instr.addOperand(dest);
+        instr.addOperand(src);
+        current_block->addInstruction(instr);
     }
 }
 
-void CodeGenerator::emit(Instruction::OpCode opcode, std::shared_ptr<Register> dest, std::shared_ptr<Register> src) {
+void CodeGenerator::emit(Instruction::OpCode opcode, VReg dest, VReg src1, VReg src2) {
     if (current_block) {
-        auto instr = std::make_unique<Instruction>(opcode);
-        instr->operands.push_back(dest);
-        instr->operands.push_back(src);
-        current_block->addInstruction(std::move(instr));
+        Instruction instr(opcode);
+        instr.addOperand(dest);
+        instr.addOperand(src1);
+        instr.addOperand(src2);
+        current_block->addInstruction(instr);
     }
 }
 
-void CodeGenerator::emit(Instruction::OpCode opcode, std::shared_ptr<Register> dest, std::shared_ptr<Register> src1, std::shared_ptr<Register> src2) {
+void CodeGenerator::emit(Instruction::OpCode opcode, VReg dest, int immediate) {
     if (current_block) {
-        auto instr = std::make_unique<Instruction>(opcode);
-        instr->operands.push_back(dest);
-        instr->operands.push_back(src1);
-        instr->operands.push_back(src2);
-        current_block->addInstruction(std::move(instr));
+        Instruction instr(opcode);
+        instr.addOperand(dest);
+        instr.setImmediate(immediate);
+        current_block->addInstruction(instr);
     }
 }
 
-void CodeGenerator::emit(Instruction::OpCode opcode, std::shared_ptr<Register> dest, int immediate) {
+void CodeGenerator::emit(Instruction::OpCode opcode, VReg dest, VReg src, int immediate) {
     if (current_block) {
-        auto instr = std::make_unique<Instruction>(opcode);
-        instr->operands.push_back(dest);
-        instr->immediate = immediate;
-        instr->has_immediate = true;
-        current_block->addInstruction(std::move(instr));
+        Instruction instr(opcode);
+        instr.addOperand(dest);
+        instr.addOperand(src);
+        instr.setImmediate(immediate);
+        current_block->addInstruction(instr);
     }
 }
 
 void CodeGenerator::emit(Instruction::OpCode opcode, const std::string& label) {
     if (current_block) {
-        auto instr = std::make_unique<Instruction>(opcode, label);
-        current_block->addInstruction(std::move(instr));
+        Instruction instr(opcode);
+        instr.label = current_function->internSymbol(label);
+        current_block->addInstruction(instr);
     }
 }
 
-void CodeGenerator::emitLabel(const std::string& label) {
+void CodeGenerator::emit(Instruction::OpCode opcode, VReg dest, const std::string& label) {
     if (current_block) {
-        auto instr = std::make_unique<Instruction>(Instruction::LABEL, label);
-        current_block->addInstruction(std::move(instr));
+        Instruction instr(opcode);
+        instr.addOperand(dest);
+        instr.label = current_function->internSymbol(label);
+        current_block->addInstruction(instr);
     }
 }
 
+void CodeGenerator::emitLabel(const std::string& label) {
+    emit(Instruction::LABEL, label);
+}
+
 // Built-in function support
 void CodeGenerator::initializeBuiltinFunctions() {
     builtin_functions["print"] = "_builtin_print";
     builtin_functions["len"] = "_builtin_len";
+    builtin_functions["assert"] = "_builtin_assert_failed";
     builtin_functions["range"] = "_builtin_range";
+    builtin_functions["PackedInt32Array"] = "_packed_int32_array_create";
+    builtin_functions["PackedInt64Array"] = "_packed_int64_array_create";
+    builtin_functions["PackedFloat32Array"] = "_packed_float32_array_create";
     builtin_functions["str"] = "_builtin_str";
     builtin_functions["int"] = "_builtin_int";
     builtin_functions["float"] = "_builtin_float";
@@ -1358,21 +2015,25 @@ bool CodeGenerator::isBuiltinFunction(const std::string& name) {
     return builtin_functions.find(name) != builtin_functions.end();
 }
 
-std::shared_ptr<Register> CodeGenerator::generateBuiltinCall(const std::string& name, const std::vector<std::shared_ptr<Register>>& args) {
-    auto result_reg = allocateRegister();
+VReg CodeGenerator::generateBuiltinCall(const std::string& name, const std::vector<VReg>& args,
+                                       Register::Type result_type) {
+    auto result_reg = allocateRegister(result_type);
     
-    // Push arguments
-    for (auto it = args.rbegin(); it != args.rend(); ++it) {
-        emit(Instruction::PUSH, *it);
+    // assert(condition[, message]) only calls its helper, which does not
+    // return, when the condition is false
+    if (name == "assert") {
+        std::string ok_label = generateLabel("assert_ok");
+        emit(Instruction::CMP, args[0], 0);
+        emit(Instruction::JNE, ok_label);
+        pushArguments(std::vector<VReg>(args.begin() + 1, args.end()));
+        emit(Instruction::CALL, result_reg, builtin_functions[name]);
+        emitLabel(ok_label);
+        return result_reg;
     }
     
     // Call built-in function
-    emit(Instruction::CALL, builtin_functions[name]);
-    
-    // Clean up stack
-    for (size_t i = 0; i < args.size(); ++i) {
-        emit(Instruction::POP, allocateRegister());
-    }
+    pushArguments(args);
+    emit(Instruction::CALL, result_reg, builtin_functions[name]);
     
     return result_reg;
 }
@@ -1393,19 +2054,78 @@ void CodeGenerator::writeAssembly(const std::string& filename) {
         
         for (auto& block : func->blocks) {
             for (auto& instr : block->instructions) {
-                file << "    " << instr->toString() << "\n";
+                for (const auto& line : instr.listing(*func)) {
+                    file << "    " << line << "\n";
+                }
             }
         }
         
         file << "\n";
     }
     
+    // Constants and jump tables, whose entries are distances from the
+    // table, then the program's variables
+    const char* section_names[] = {".rodata", ".data", ".bss"};
+    for (int section = DataObject::RODATA; section <= DataObject::BSS; ++section) {
+        bool tables = false;
+        for (auto& func : functions) tables = tables || !func->jump_tables.empty();
+        bool any = section == DataObject::RODATA && tables;
+        for (const auto& object : data_objects) any = any || object.section == section;
+        if (!any) continue;
+        
+        file << ".section " << section_names[section] << "\n";
+        for (const auto& object : data_objects) {
+            if (object.section != section) continue;
+            file << "    .balign " << object.alignment << "\n";
+            file << object.name << ":\n";
+            if (section == DataObject::BSS) {
+                file << "    .zero " << object.bytes.size() << "\n";
+                continue;
+            }
+            if (!object.entries.empty()) {
+                for (const auto& entry : object.entries) {
+                    file << "    .quad " << entry.function << " - " << object.name << "\n";
+                }
+                continue;
+            }
+            for (size_t i = 0; i < object.bytes.size(); i += 16) {
+                file << "    .byte ";
+                for (size_t j = i; j < object.bytes.size() && j < i + 16; ++j) {
+                    file << (j > i ? ", " : "") << static_cast<int>(object.bytes[j]);
+                }
+                file << "\n";
+            }
+        }
+        if (section != DataObject::RODATA) continue;
+        for (auto& func : functions) {
+            for (auto& table : func->jump_tables) {
+                const std::string& name = func->symbolName(table.symbol);
+                file << "    .balign 4\n";
+                file << name << ":\n";
+                for (uint32_t target : table.targets) {
+                    file << "    .long " << func->symbolName(target) << " - " << name << "\n";
+                }
+            }
+        }
+        file << "\n";
+    }
+    
     file.close();
 }
 
 void CodeGenerator::writeObjectFile(const std::string& filename) {
+    // Linux targets get a relocatable ELF object any linker can consume
+    if (target_platform == TargetPlatform::LINUX_X64 || target_platform == TargetPlatform::LINUX_ARM64) {
+        ElfMachine machine = target_platform == TargetPlatform::LINUX_ARM64 ? ElfMachine::AARCH64 : ElfMachine::X86_64;
+        std::string error;
+        if (!writeElfObject(filename, generateMachineCode(), machine, object_stats, error)) {
+            addError(error);
+        }
+        return;
+    }
+    
     // Simplified object file generation
-    // In a real implementation, this would generate ELF/Mach-O/PE format
+    // In a real implementation, this would generate Mach-O/PE format
     std::ofstream file(filename, std::ios::binary);
     if (!file.is_open()) {
         addError("Cannot open object file: " + filename);
@@ -1436,7 +2156,7 @@ void CodeGenerator::writeObjectFile(const std::string& filename) {
         // Write instructions (simplified)
         for (auto& block : func->blocks) {
             for (auto& instr : block->instructions) {
-                uint32_t opcode = static_cast<uint32_t>(instr->opcode);
+                uint32_t opcode = static_cast<uint32_t>(instr.opcode);
                 file.write(reinterpret_cast<const char*>(&opcode), sizeof(opcode));
             }
         }
@@ -1596,7 +2316,7 @@ void CodeGenerator::generateWindowsExecutable(const std::string& filename) {
     file.seekp(0x400);
     
     // Generate machine code from our intermediate representation
-    std::vector<uint8_t> machine_code = generateMachineCode();
+    std::vector<uint8_t> machine_code = generateMachineCode().code;
     
     // If no code generated, use default "Hello World" program
     if (machine_code.empty()) {
@@ -1736,7 +2456,7 @@ void CodeGenerator::generateMacOSExecutable(const std::string& filename) {
     file.seekp(0xf50);
     
     // Generate machine code from our intermediate representation
-    std::vector<uint8_t> machine_code = generateMachineCode();
+    std::vector<uint8_t> machine_code = generateMachineCode().code;
     
     // If no machine code generated, use default "Hello World" program
     if (machine_code.empty()) {
@@ -1844,7 +2564,7 @@ void CodeGenerator::generateLinuxExecutable(const std::string& filename) {
     file.seekp(0x1000);
     
     // Generate machine code from our intermediate representation
-    std::vector<uint8_t> machine_code = generateMachineCode();
+    std::vector<uint8_t> machine_code = generateMachineCode().code;
     
     // If no machine code generated, use default "Hello World" program
     if (machine_code.empty()) {
@@ -1989,7 +2709,9 @@ void CodeGenerator::generateStartupCode() {
     // Generate program startup code
     emitLabel("_start");
     emit(Instruction::CALL, "main");
-    emit(Instruction::MOV, allocateRegister(), 0); // exit code
+    auto exit_code_reg = allocateRegister();
+    emit(Instruction::MOV, exit_code_reg, 0);
+    pushArguments({exit_code_reg});
     emit(Instruction::CALL, "exit");
 }
 
@@ -2077,16 +2799,16 @@ void CodeGenerator::generateGarbageCollector() {
     // This is a simplified placeholder
 }
 
-void CodeGenerator::generateMemoryAllocation(std::shared_ptr<Register> size_reg) {
+void CodeGenerator::generateMemoryAllocation(VReg size_reg) {
     // Generate memory allocation code
+    pushArguments({size_reg});
     emit(Instruction::CALL, "malloc");
-    (void)size_reg; // Suppress unused parameter warning
 }
 
-void CodeGenerator::generateMemoryDeallocation(std::shared_ptr<Register> ptr_reg) {
+void CodeGenerator::generateMemoryDeallocation(VReg ptr_reg) {
     // Generate memory deallocation code
+    pushArguments({ptr_reg});
     emit(Instruction::CALL, "free");
-    (void)ptr_reg; // Suppress unused parameter warning
 }
 
 // Runtime support
@@ -2122,30 +2844,161 @@ void CodeGenerator::addError(const std::string& message) {
 
 
 // Utility methods
+void CodeGenerator::applyProfile() {
+    for (auto& func : functions) {
+        addProfileLabels(*func);
+        if (!profile.empty()) annotateFunction(*func, profile, profile_stats);
+        if (profile_generate) instrumentFunction(*func, profile_stats);
+    }
+}
+
 void CodeGenerator::optimizeCode() {
+    performInlining();
+    buildSSAForm();
+    performValueNumbering();
+    performLoopOptimization();
     performDeadCodeElimination();
+    leaveSSAForm();
     performConstantFolding();
+    // Folding leaves the constants it propagated without readers
+    performDeadCodeElimination();
+    performBlockLayout();
+    performPeepholeOptimization(PeepholeTarget::ANY);
     performRegisterAllocation();
+    // Allocation turns copies into same-register moves and adds reloads;
+    // the target's own rules only make sense on machine registers
+    performPeepholeOptimization(register_file.architecture == "aarch64" ? PeepholeTarget::AARCH64
+                                                                       : PeepholeTarget::X86_64);
 }
 
 void CodeGenerator::performDeadCodeElimination() {
-    // Remove unused instructions
     for (auto& func : functions) {
-        for (auto& block : func->blocks) {
-            auto& instructions = block->instructions;
-            instructions.erase(
-                std::remove_if(instructions.begin(), instructions.end(),
-                    [](const std::unique_ptr<Instruction>& instr) {
-                        return instr->opcode == Instruction::NOP;
-                    }),
-                instructions.end());
-        }
+        eliminateDeadCode(*func, dce_stats);
+    }
+}
+
+void CodeGenerator::performInlining() {
+    // Runs on the emitted instruction streams; the passes after SSA
+    // construction fold and remove what the copied bodies leave behind
+    inlineFunctions(functions, function_map, inline_options, inline_stats);
+}
+
+void CodeGenerator::buildSSAForm() {
+    // Recover the control flow graph from the emitted labels and branches,
+    // then rename every definition so each register is assigned once
+    for (auto& func : functions) {
+        dce_stats.unreachable_blocks += func->buildCFG();
+        func->computeDominators();
+        convertToSSA(*func, ssa_stats);
+    }
+}
+
+void CodeGenerator::performValueNumbering() {
+    for (auto& func : functions) {
+        eliminateRedundancies(*func, gvn_stats);
+    }
+}
+
+void CodeGenerator::performLoopOptimization() {
+    for (auto& func : functions) {
+        optimizeLoops(*func, loop_stats);
+    }
+}
+
+void CodeGenerator::leaveSSAForm() {
+    for (auto& func : functions) {
+        convertFromSSA(*func, ssa_stats);
+    }
+}
+
+void CodeGenerator::performBlockLayout() {
+    // Out of SSA form, so blocks can move without phi operands to keep in order
+    for (auto& func : functions) {
+        placeBlocks(*func, layout_stats);
+    }
+}
+
+void CodeGenerator::performPeepholeOptimization(PeepholeTarget target) {
+    for (auto& func : functions) {
+        runPeephole(*func, target, peephole_stats);
+    }
+}
+
+static bool foldIntegerOp(Instruction::OpCode opcode, long long a, long long b, long long& result) {
+    switch (opcode) {
+        case Instruction::ADD: result = a + b; break;
+        case Instruction::SUB: result = a - b; break;
+        case Instruction::MUL: result = a * b; break;
+        case Instruction::DIV: if (b == 0) return false; result = a / b; break;
+        case Instruction::MOD: if (b == 0) return false; result = a % b; break;
+        case Instruction::AND: result = a & b; break;
+        case Instruction::OR: result = a | b; break;
+        case Instruction::XOR: result = a ^ b; break;
+        case Instruction::SHL: if (a < 0 || b < 0 || b > 31) return false; result = a << b; break;
+        case Instruction::SHR: if (b < 0 || b > 31) return false; result = a >> b; break;
+        default: return false;
     }
+    return result >= std::numeric_limits<int>::min() && result <= std::numeric_limits<int>::max();
 }
 
 void CodeGenerator::performConstantFolding() {
-    // Fold constant expressions
-    // This is a simplified implementation
+    // Propagate integer immediates through general purpose registers within
+    // straight-line code and fold operations whose inputs are all known.
+    // Labels are join points and calls may clobber registers, so both reset.
+    for (auto& func : functions) {
+        std::vector<int> values(func->registerCount(), 0);
+        std::vector<char> known(func->registerCount(), 0);
+        
+        for (auto& block : func->blocks) {
+            std::fill(known.begin(), known.end(), 0);
+            
+            for (auto& instr : block->instructions) {
+                if (instr.opcode == Instruction::LABEL || instr.opcode == Instruction::CALL) {
+                    std::fill(known.begin(), known.end(), 0);
+                    continue;
+                }
+                if (!instr.definesFirstOperand() || !instr.operands[0]) {
+                    continue;
+                }
+                
+                VReg dest = instr.operands[0];
+                auto valueOf = [&](int index, long long& value) {
+                    if (index >= instr.num_operands || !known[instr.operands[index].id]) return false;
+                    value = values[instr.operands[index].id];
+                    return true;
+                };
+                
+                long long folded = 0;
+                bool is_constant = false;
+                long long a = 0, b = 0;
+                
+                if (instr.opcode == Instruction::MOV) {
+                    if (instr.has_immediate && instr.num_operands == 1) {
+                        folded = instr.immediate;
+                        is_constant = true;
+                    } else if (valueOf(1, a)) {
+                        folded = a;
+                        is_constant = true;
+                    }
+                } else if (instr.num_operands == 3 && valueOf(1, a) && valueOf(2, b)) {
+                    is_constant = foldIntegerOp(instr.opcode, a, b, folded);
+                } else if (instr.num_operands == 2 && instr.has_immediate && valueOf(1, a)) {
+                    is_constant = foldIntegerOp(instr.opcode, a, instr.immediate, folded);
+                }
+                
+                if (is_constant && func->getRegister(dest).type != Register::FLOAT) {
+                    // Rewrite as an immediate load
+                    instr.opcode = Instruction::MOV;
+                    instr.num_operands = 1;
+                    instr.setImmediate(static_cast<int>(folded));
+                    known[dest.id] = 1;
+                    values[dest.id] = static_cast<int>(folded);
+                } else {
+                    known[dest.id] = 0;
+                }
+            }
+        }
+    }
 }
 
 
@@ -2161,15 +3014,10 @@ void CodeGenerator::setupFunction(const std::string& name) {
     
     functions.push_back(std::move(func));
     
-    // Clear variable scope but preserve class members if we're in a class
+    // Locals start over; static fields of a class stay reachable through
+    // class_members
     variables.clear();
-    
-    // If we're inside a class, make class member variables accessible
-    if (!current_class_name.empty()) {
-        for (const auto& member : class_members) {
-            variables[member.first] = member.second;
-        }
-    }
+    variable_types.clear();
 }
 
 void CodeGenerator::finalizeFunction() {
@@ -2181,44 +3029,247 @@ void CodeGenerator::finalizeFunction() {
 
 
 
+// FNV-1a over the pattern bytes; the runtime's _string_hash must agree
+static long long stringPatternHash(const std::string& text) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return static_cast<int32_t>(hash);
+}
+
+// Constant patterns of one kind with pairwise different values, so that at
+// most one of them matches whatever order they are tested in
+static bool distinctConstantPatterns(const std::vector<MatchCase>& cases, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const ConstantValue& a = cases[i].pattern->constant;
+        if (!a.isKnown() || a.kind != cases[0].pattern->constant.kind) return false;
+        for (size_t j = 0; j < i; ++j) {
+            const ConstantValue& b = cases[j].pattern->constant;
+            if (a.int_value == b.int_value && a.float_value == b.float_value && a.string_value == b.string_value) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 void CodeGenerator::generateMatchStmt(MatchStmt* stmt) {
+    GDType subject_type = getStaticType(stmt->expression.get());
     auto expr_reg = generateExpression(stmt->expression.get());
     
     std::string end_label = generateLabel("match_end");
     std::vector<std::string> case_labels;
     
-    // Generate labels for each case
+    // Arms after a wildcard can never run
+    size_t arm_count = stmt->cases.size();
     for (size_t i = 0; i < stmt->cases.size(); ++i) {
+        if (stmt->cases[i].isWildcard()) {
+            arm_count = i + 1;
+            break;
+        }
+    }
+    
+    // Generate labels for each case
+    for (size_t i = 0; i < arm_count; ++i) {
         case_labels.push_back(generateLabel("match_case_" + std::to_string(i)));
     }
     
-    // Generate pattern matching for each case
-    for (size_t i = 0; i < stmt->cases.size(); ++i) {
-        auto& match_case = stmt->cases[i];
+    size_t pattern_count = arm_count;
+    std::string default_label = end_label;
+    if (arm_count > 0 && stmt->cases[arm_count - 1].isWildcard()) {
+        pattern_count = arm_count - 1;
+        default_label = case_labels[pattern_count];
+    }
+    
+    bool int_patterns = isIntegral(subject_type);
+    bool string_patterns = subject_type == GDType::STRING;
+    for (size_t i = 0; i < pattern_count; ++i) {
+        const ConstantValue& value = stmt->cases[i].pattern->constant;
+        bool is_int = value.kind == ConstantValue::INT || value.kind == ConstantValue::BOOL;
+        if (!is_int || value.int_value < INT32_MIN || value.int_value > INT32_MAX) {
+            int_patterns = false;
+        }
+        if (value.kind != ConstantValue::STRING) {
+            string_patterns = false;
+        }
+    }
+    
+    // Arms the profile shows to be hot are tested first. A dispatch still
+    // follows over every arm, so that it takes the same labels as in the
+    // instrumented build and later profile points keep their names. A plain
+    // compare chain may only be reordered when no two patterns can both
+    // match.
+    bool hashed = string_patterns && pattern_count >= 4;
+    std::vector<size_t> hot_arms = hotMatchArms(case_labels, pattern_count);
+    if (!int_patterns && !hashed && !distinctConstantPatterns(stmt->cases, pattern_count)) {
+        hot_arms.clear();
+    }
+    for (size_t k = 0; k < hot_arms.size(); ++k) {
+        if (hot_arms[k] != k) profile_stats.moved_arms++;
+    }
+    
+    if (int_patterns && pattern_count > 0) {
+        // Constant integer patterns: the first arm with a given value wins.
+        // A hot arm never repeats an earlier value, or it could not have run.
+        for (size_t arm : hot_arms) {
+            emit(Instruction::CMP, expr_reg, static_cast<int>(stmt->cases[arm].pattern->constant.int_value));
+            emit(Instruction::JE, case_labels[arm]);
+        }
+        CaseTargets cases;
+        std::set<long long> seen;
+        for (size_t i = 0; i < pattern_count; ++i) {
+            long long value = stmt->cases[i].pattern->constant.int_value;
+            if (seen.insert(value).second) {
+                cases.push_back({value, case_labels[i]});
+            }
+        }
+        std::sort(cases.begin(), cases.end());
+        generateCaseDispatch(expr_reg, cases, 0, cases.size(), default_label);
+    } else if (hashed) {
+        // Dispatch on the hash first, then confirm with one or two string
+        // comparisons in the bucket
+        for (size_t arm : hot_arms) {
+            auto pattern_reg = generateExpression(stmt->cases[arm].pattern.get());
+            generateCompare(expr_reg, subject_type, pattern_reg, GDType::STRING);
+            emit(Instruction::JE, case_labels[arm]);
+        }
+        std::map<long long, std::vector<size_t>> buckets;
+        for (size_t i = 0; i < pattern_count; ++i) {
+            buckets[stringPatternHash(stmt->cases[i].pattern->constant.string_value)].push_back(i);
+        }
         
-        // Generate pattern comparison
-        auto pattern_reg = generateExpression(match_case.pattern.get());
-        emit(Instruction::CMP, expr_reg, pattern_reg);
-        emit(Instruction::JE, case_labels[i]);
+        CaseTargets cases;
+        for (const auto& bucket : buckets) {
+            cases.push_back({bucket.first, generateLabel("match_hash")});
+        }
+        auto hash_reg = generateRuntimeCall("_string_hash", {expr_reg});
+        generateCaseDispatch(hash_reg, cases, 0, cases.size(), default_label);
+        
+        size_t index = 0;
+        for (const auto& bucket : buckets) {
+            emitLabel(cases[index++].second);
+            for (size_t arm : bucket.second) {
+                auto pattern_reg = generateExpression(stmt->cases[arm].pattern.get());
+                generateCompare(expr_reg, subject_type, pattern_reg, GDType::STRING);
+                emit(Instruction::JE, case_labels[arm]);
+            }
+            emit(Instruction::JMP, default_label);
+        }
+    } else {
+        // Generate pattern comparison for each case in order, hot arms first
+        std::vector<size_t> order = hot_arms;
+        for (size_t i = 0; i < pattern_count; ++i) {
+            if (std::find(order.begin(), order.end(), i) == order.end()) order.push_back(i);
+        }
+        for (size_t i : order) {
+            auto& match_case = stmt->cases[i];
+            auto pattern_reg = generateExpression(match_case.pattern.get());
+            generateCompare(expr_reg, subject_type, pattern_reg, getStaticType(match_case.pattern.get()));
+            emit(Instruction::JE, case_labels[i]);
+        }
         
-        freeRegister(pattern_reg);
+        // If no pattern matches, take the wildcard arm or leave
+        emit(Instruction::JMP, default_label);
     }
     
-    // If no pattern matches, jump to end
-    emit(Instruction::JMP, end_label);
-    
     // Generate code for each case body
-    for (size_t i = 0; i < stmt->cases.size(); ++i) {
+    for (size_t i = 0; i < arm_count; ++i) {
         emitLabel(case_labels[i]);
         generateStatement(stmt->cases[i].body.get());
         emit(Instruction::JMP, end_label);
     }
     
     emitLabel(end_label);
-    freeRegister(expr_reg);
 }
 
-std::shared_ptr<Register> CodeGenerator::generateLambdaExpr(LambdaExpr* expr) {
+// Pattern arms taking at least a third of the executions that reach them
+// in the profile, hottest first and at most three; empty without a profile
+std::vector<size_t> CodeGenerator::hotMatchArms(const std::vector<std::string>& case_labels,
+                                                size_t pattern_count) const {
+    std::vector<size_t> hot;
+    const std::string& function = current_function->name;
+    if (profile.empty() || profile.count(function, "") == 0) return hot;
+    
+    std::vector<std::pair<uint64_t, size_t>> arms;
+    uint64_t remaining = 0;
+    for (size_t i = 0; i < case_labels.size(); ++i) {
+        uint64_t count = profile.count(function, case_labels[i]);
+        remaining += count;
+        if (i < pattern_count) arms.push_back({count, i});
+    }
+    std::stable_sort(arms.begin(), arms.end(), [](const std::pair<uint64_t, size_t>& a,
+                                                  const std::pair<uint64_t, size_t>& b) {
+        return a.first > b.first;
+    });
+    for (const auto& arm : arms) {
+        if (hot.size() == 3 || arm.first == 0 || arm.first * 3 < remaining) break;
+        hot.push_back(arm.second);
+        remaining -= arm.first;
+    }
+    return hot;
+}
+
+// Binary decision tree over cases[begin, end), switching to a jump table
+// once a subrange is dense enough
+void CodeGenerator::generateCaseDispatch(VReg subject_reg, const CaseTargets& cases, size_t begin, size_t end,
+                                         const std::string& default_label) {
+    size_t count = end - begin;
+    long long span = cases[end - 1].first - cases[begin].first + 1;
+    if (count >= 4 && span <= 4096 && count * 10 >= static_cast<size_t>(span) * 4) {
+        generateJumpTable(subject_reg, cases, begin, end, default_label);
+        return;
+    }
+    
+    if (count <= 3) {
+        for (size_t i = begin; i < end; ++i) {
+            emit(Instruction::CMP, subject_reg, static_cast<int>(cases[i].first));
+            emit(Instruction::JE, cases[i].second);
+        }
+        emit(Instruction::JMP, default_label);
+        return;
+    }
+    
+    size_t middle = begin + count / 2;
+    std::string upper_label = generateLabel("match_upper");
+    emit(Instruction::CMP, subject_reg, static_cast<int>(cases[middle].first));
+    emit(Instruction::JE, cases[middle].second);
+    emit(Instruction::JG, upper_label);
+    generateCaseDispatch(subject_reg, cases, begin, middle, default_label);
+    emitLabel(upper_label);
+    generateCaseDispatch(subject_reg, cases, middle + 1, end, default_label);
+}
+
+void CodeGenerator::generateJumpTable(VReg subject_reg, const CaseTargets& cases, size_t begin, size_t end,
+                                      const std::string& default_label) {
+    int low = static_cast<int>(cases[begin].first);
+    int high = static_cast<int>(cases[end - 1].first);
+    
+    emit(Instruction::CMP, subject_reg, low);
+    emit(Instruction::JL, default_label);
+    emit(Instruction::CMP, subject_reg, high);
+    emit(Instruction::JG, default_label);
+    
+    auto index_reg = subject_reg;
+    if (low != 0) {
+        index_reg = allocateRegister();
+        emit(Instruction::SUB, index_reg, subject_reg, low);
+    }
+    
+    std::string table_label = generateLabel("match_table");
+    JumpTable table(current_function->internSymbol(table_label));
+    uint32_t default_symbol = current_function->internSymbol(default_label);
+    table.targets.assign(static_cast<size_t>(high - low) + 1, default_symbol);
+    for (size_t i = begin; i < end; ++i) {
+        table.targets[cases[i].first - low] = current_function->internSymbol(cases[i].second);
+    }
+    current_function->jump_tables.push_back(table);
+    
+    emit(Instruction::JMPT, index_reg, table_label);
+}
+
+VReg CodeGenerator::generateLambdaExpr(LambdaExpr* expr) {
     // Generate a unique function name for the lambda
     std::string lambda_name = "_lambda_" + std::to_string(next_label_id++);
     
@@ -2228,27 +3279,30 @@ std::shared_ptr<Register> CodeGenerator::generateLambdaExpr(LambdaExpr* expr) {
     auto saved_variables = variables;
     
     // Create new function for lambda
+    auto saved_return_type = current_return_type;
     setupFunction(lambda_name);
+    current_return_type = GDType::VARIANT;
     
     // Add lambda parameters to variable scope
     for (const auto& param : expr->parameters) {
         auto param_reg = allocateRegister();
         variables[param.name] = param_reg;
+        current_function->parameters.push_back(param_reg);
     }
     
     // Generate lambda body
     auto body_reg = generateExpression(expr->body.get());
     
     // Return the result
-    emit(Instruction::MOV, allocateRegister(), body_reg);
+    emit(Instruction::MOV, returnRegister(registerType(body_reg)), body_reg);
     emit(Instruction::RET);
     
-    freeRegister(body_reg);
     finalizeFunction();
     
     // Restore previous function context
     current_function = saved_function;
     current_block = saved_block;
+    current_return_type = saved_return_type;
     variables = saved_variables;
     
     // Return a register containing the lambda function pointer
@@ -2258,7 +3312,7 @@ std::shared_ptr<Register> CodeGenerator::generateLambdaExpr(LambdaExpr* expr) {
     return result_reg;
 }
 
-std::shared_ptr<Register> CodeGenerator::generateTernaryExpr(TernaryExpr* expr) {
+VReg CodeGenerator::generateTernaryExpr(TernaryExpr* expr) {
     // Generate condition
     auto condition_reg = generateExpression(expr->condition.get());
     
@@ -2269,20 +3323,17 @@ std::shared_ptr<Register> CodeGenerator::generateTernaryExpr(TernaryExpr* expr)
     // Test condition and jump to false branch if zero
     emit(Instruction::CMP, condition_reg, 0);
     emit(Instruction::JE, false_label);
-    freeRegister(condition_reg);
     
     // Generate true expression
     auto true_reg = generateExpression(expr->true_expr.get());
     auto result_reg = allocateRegister();
     emit(Instruction::MOV, result_reg, true_reg);
-    freeRegister(true_reg);
     emit(Instruction::JMP, end_label);
     
     // Generate false expression
     emitLabel(false_label);
     auto false_reg = generateExpression(expr->false_expr.get());
     emit(Instruction::MOV, result_reg, false_reg);
-    freeRegister(false_reg);
     
     // End label
     emitLabel(end_label);
@@ -2,107 +2,28 @@
 
 #include "parser.h"
 #include "semantic_analyzer.h"
+#include "ir.h"
+#include "inliner.h"
+#include "ssa.h"
+#include "gvn.h"
+#include "dce.h"
+#include "loops.h"
+#include "callconv.h"
+#include "regalloc.h"
+#include "layout.h"
+#include "profile.h"
+#include "peephole.h"
+#include "x86_encoder.h"
+#include "arm64_encoder.h"
+#include "assembler.h"
+#include "elf_writer.h"
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <fstream>
 
-// Forward declarations
-class Register;
-class Instruction;
-class BasicBlock;
-class Function;
-
-// Register allocation
-class Register {
-public:
-    enum Type {
-        GENERAL,    // General purpose register
-        FLOAT,      // Floating point register
-        VIRTUAL     // Virtual register (before allocation)
-    };
-    
-    int id;
-    Type type;
-    bool is_allocated;
-    std::string name;
-    
-    Register(int id, Type type, const std::string& name = "")
-        : id(id), type(type), is_allocated(false), name(name) {}
-};
-
-// Instruction representation
-class Instruction {
-public:
-    enum OpCode {
-        // Data movement
-        MOV, LOAD, STORE,
-        
-        // Arithmetic
-        ADD, SUB, MUL, DIV, MOD,
-        FADD, FSUB, FMUL, FDIV,
-        
-        // Logical
-        AND, OR, XOR, NOT,
-        
-        // Comparison
-        CMP, FCMP,
-        
-        // Branching
-        JMP, JE, JNE, JL, JLE, JG, JGE,
-        
-        // Function calls
-        CALL, RET,
-        
-        // Stack operations
-        PUSH, POP,
-        
-        // Special
-        NOP, LABEL
-    };
-    
-    OpCode opcode;
-    std::vector<std::shared_ptr<Register>> operands;
-    std::string label;  // For labels and jumps
-    int immediate;      // For immediate values
-    bool has_immediate;
-    
-    Instruction(OpCode op) : opcode(op), immediate(0), has_immediate(false) {}
-    Instruction(OpCode op, const std::string& lbl) : opcode(op), label(lbl), immediate(0), has_immediate(false) {}
-    
-    std::string toString() const;
-};
-
-// Basic block for control flow
-class BasicBlock {
-public:
-    std::string label;
-    std::vector<std::unique_ptr<Instruction>> instructions;
-    std::vector<BasicBlock*> successors;
-    std::vector<BasicBlock*> predecessors;
-    
-    BasicBlock(const std::string& label) : label(label) {}
-    
-    void addInstruction(std::unique_ptr<Instruction> instr);
-    void addSuccessor(BasicBlock* block);
-};
-
-// Function representation
-class Function {
-public:
-    std::string name;
-    std::vector<std::unique_ptr<BasicBlock>> blocks;
-    std::vector<std::shared_ptr<Register>> parameters;
-    std::shared_ptr<Register> return_register;
-    int stack_size;
-    
-    Function(const std::string& name) : name(name), stack_size(0) {}
-    
-    BasicBlock* createBlock(const std::string& label);
-    BasicBlock* getBlock(const std::string& label);
-};
-
 // Target platform enumeration
 enum class TargetPlatform {
     WINDOWS_X64,
@@ -123,10 +44,23 @@ enum class OutputFormat {
 class CodeGenerator {
 private:
     std::vector<std::unique_ptr<Function>> functions;
-    std::unordered_map<std::string, std::shared_ptr<Register>> variables;
-    std::unordered_map<std::string, std::shared_ptr<Register>> class_members;
+    std::vector<DataObject> data_objects;               // Contents of .rodata, .data and .bss
+    std::unordered_map<std::string, std::string> string_constants;     // Literal text to its data object
+    std::unordered_map<int64_t, std::string> float_constants;           // Bits of a double to its data object
+    std::unordered_map<int64_t, std::string> int_constants;             // Ints wider than an immediate to their data object
+    std::unordered_map<std::string, VReg> variables;
+    std::unordered_map<std::string, GDType> variable_types;    // Storage type of each local's register
+    // Static fields visible in the current class: the data object holding
+    // each and its storage type
+    struct StaticField {
+        std::string object;
+        GDType type;
+    };
+    std::unordered_map<std::string, StaticField> class_members;
     std::unordered_map<std::string, Function*> function_map;
+    std::unordered_set<std::string> specialized_functions;      // Compiled under specializedName behind an entry stub
     std::string current_class_name;
+    const ClassEntry* current_class_entry;
     
     // Target platform and output format
     TargetPlatform target_platform;
@@ -134,16 +68,36 @@ private:
     
     Function* current_function;
     BasicBlock* current_block;
+    GDType current_return_type;     // Declared return type of the function being generated
     
-    int next_register_id;
     int next_label_id;
     int stack_offset;
     
     std::vector<std::string> errors;
     
-    // Register allocation
-    std::vector<std::shared_ptr<Register>> available_registers;
-    std::vector<std::shared_ptr<Register>> allocated_registers;
+    // Optimization statistics
+    InlineStats inline_stats;
+    SSAStats ssa_stats;
+    GVNStats gvn_stats;
+    DCEStats dce_stats;
+    LoopStats loop_stats;
+    CallStats call_stats;
+    AllocationStats allocation_stats;
+    LayoutStats layout_stats;
+    PeepholeStats peephole_stats;
+    AssemblerStats assembler_stats;
+    ProfileStats profile_stats;
+    ObjectStats object_stats;
+    
+    // Machine registers of the target, used by register allocation
+    RegisterFile register_file;
+    AllocatorKind allocator_kind;
+    InlineOptions inline_options;
+    
+    // Profile-guided optimization: counters for an instrumented build, or
+    // counts recorded by one
+    bool profile_generate;
+    ProfileData profile;
     
     // Built-in function declarations
     std::unordered_map<std::string, std::string> builtin_functions;
@@ -183,30 +137,67 @@ public:
     void generateIfStmt(IfStmt* stmt);
     void generateWhileStmt(WhileStmt* stmt);
     void generateForStmt(ForStmt* stmt);
+    bool generateCountedForLoop(ForStmt* stmt);
+    bool generateArrayForLoop(ForStmt* stmt);
+    void generateIteratorForLoop(ForStmt* stmt);
     void generateReturnStmt(ReturnStmt* stmt);
+    bool generateSelfTailCall(CallExpr* expr);
     void generateExpressionStmt(ExpressionStmt* stmt);
     void generateBreakStmt(BreakStmt* stmt);
     void generateContinueStmt(ContinueStmt* stmt);
     void generateMatchStmt(MatchStmt* stmt);
+    std::vector<size_t> hotMatchArms(const std::vector<std::string>& case_labels, size_t pattern_count) const;
+    
+    // Match dispatch over sorted case values, each with its target label
+    typedef std::vector<std::pair<long long, std::string>> CaseTargets;
+    void generateCaseDispatch(VReg subject_reg, const CaseTargets& cases, size_t begin, size_t end,
+                              const std::string& default_label);
+    void generateJumpTable(VReg subject_reg, const CaseTargets& cases, size_t begin, size_t end,
+                           const std::string& default_label);
     
     // Expression generation
-    std::shared_ptr<Register> generateExpression(Expression* expr);
-    std::shared_ptr<Register> generateLiteralExpr(LiteralExpr* expr);
-    std::shared_ptr<Register> generateIdentifierExpr(IdentifierExpr* expr);
-    std::shared_ptr<Register> generateBinaryOpExpr(BinaryOpExpr* expr);
-    std::shared_ptr<Register> generateUnaryOpExpr(UnaryOpExpr* expr);
-    std::shared_ptr<Register> generateCallExpr(CallExpr* expr);
-    std::shared_ptr<Register> generateMemberAccessExpr(MemberAccessExpr* expr);
-    std::shared_ptr<Register> generateArrayAccessExpr(ArrayAccessExpr* expr);
-    std::shared_ptr<Register> generateArrayLiteralExpr(ArrayLiteralExpr* expr);
-    std::shared_ptr<Register> generateDictLiteralExpr(DictLiteralExpr* expr);
-    std::shared_ptr<Register> generateLambdaExpr(LambdaExpr* expr);
-    std::shared_ptr<Register> generateTernaryExpr(TernaryExpr* expr);
+    VReg generateExpression(Expression* expr);
+    VReg generateLiteralExpr(LiteralExpr* expr);
+    VReg generateConstant(const ConstantValue& value);
+    VReg generateStringConstant(const std::string& text);
+    VReg generateFloatConstant(double value);
+    VReg generateIntConstant(int64_t value);
+    VReg generateIdentifierExpr(IdentifierExpr* expr);
+    VReg generateBinaryOpExpr(BinaryOpExpr* expr);
+    VReg generateUnaryOpExpr(UnaryOpExpr* expr);
+    VReg generateCallExpr(CallExpr* expr);
+    VReg generateMemberAccessExpr(MemberAccessExpr* expr);
+    VReg generateArrayAccessExpr(ArrayAccessExpr* expr);
+    VReg generateArrayLiteralExpr(ArrayLiteralExpr* expr);
+    VReg generateDictLiteralExpr(DictLiteralExpr* expr);
+    VReg generateLambdaExpr(LambdaExpr* expr);
+    VReg generateTernaryExpr(TernaryExpr* expr);
+    VReg generateAssignment(BinaryOpExpr* expr);
+    VReg generateFieldLoad(VReg object_reg, const FieldSlot* field);
+    VReg generateValueClone(VReg address_reg, int size);
+    GDType getParameterType(FuncDecl* decl, size_t index) const;
+    bool hasInferredParameters(FuncDecl* decl) const;
+    static std::string specializedName(const std::string& name) { return name + ".typed"; }
+    void generateEntryStub(FuncDecl* decl);
+    void declareStaticField(VarDecl* decl);
+    VReg generateNewObject(const ClassEntry* entry, const std::vector<VReg>& args);
+    static std::string vtableName(const std::string& class_name) { return class_name + ".vtable"; }
+    static std::string fieldInitializerName(const std::string& class_name) { return class_name + ".field_init"; }
+    static bool hasFieldInitializers(const ClassEntry& entry);
+    void generateFieldInitializer(ClassDecl* decl);
+    VReg generateStaticLoad(const StaticField& field);
+    void generateStaticStore(const StaticField& field, VReg value_reg);
+    void generateFieldStore(VReg object_reg, const FieldSlot* field, VReg value_reg);
+    const FieldSlot* resolveField(MemberAccessExpr* expr);
+    VReg generateMethodCall(const ClassEntry* entry, const MethodSlot* method,
+                                                 VReg self_reg,
+                                                 const std::vector<VReg>& args);
     
     // Register management
-    std::shared_ptr<Register> allocateRegister(Register::Type type = Register::GENERAL);
-    std::shared_ptr<Register> allocateVirtualRegister(Register::Type type = Register::GENERAL);
-    void freeRegister(std::shared_ptr<Register> reg);
+    VReg allocateRegister(Register::Type type = Register::GENERAL);
+    Register::Type registerType(VReg reg) const;
+    void nameRegister(VReg reg, const std::string& name);
+    VReg returnRegister(Register::Type type);
     void performRegisterAllocation();
     
     // Label management
@@ -214,20 +205,35 @@ public:
     
     // Instruction helpers
     void emit(Instruction::OpCode opcode);
-    void emit(Instruction::OpCode opcode, std::shared_ptr<Register> dest);
-    void emit(Instruction::OpCode opcode, std::shared_ptr<Register> dest, std::shared_ptr<Register> src);
-    void emit(Instruction::OpCode opcode, std::shared_ptr<Register> dest, std::shared_ptr<Register> src1, std::shared_ptr<Register> src2);
-    void emit(Instruction::OpCode opcode, std::shared_ptr<Register> dest, int immediate);
+    void emit(Instruction::OpCode opcode, VReg dest);
+    void emit(Instruction::OpCode opcode, VReg dest, VReg src);
+    void emit(Instruction::OpCode opcode, VReg dest, VReg src1, VReg src2);
+    void emit(Instruction::OpCode opcode, VReg dest, int immediate);
+    void emit(Instruction::OpCode opcode, VReg dest, VReg src, int immediate);
     void emit(Instruction::OpCode opcode, const std::string& label);
+    void emit(Instruction::OpCode opcode, VReg dest, const std::string& label);
     void emitLabel(const std::string& label);
     
     // Type conversion helpers
-    std::shared_ptr<Register> convertType(std::shared_ptr<Register> src, GDType from_type, GDType to_type);
+    VReg convertType(VReg src, GDType from_type, GDType to_type);
+    GDType getStaticType(Expression* expr) const;
+    GDType getVariableType(const std::string& name) const;
+    
+    // Type-specialized operators
+    VReg generateArithmetic(TokenType op, VReg left_reg, GDType left_type,
+                                                 VReg right_reg, GDType right_type);
+    VReg generateComparison(TokenType op, VReg left_reg, GDType left_type,
+                                                 VReg right_reg, GDType right_type);
+    void generateCompare(VReg left_reg, GDType left_type, VReg right_reg, GDType right_type);
+    VReg generateRuntimeCall(const std::string& name, const std::vector<VReg>& args,
+                                                  Register::Type result_type = Register::GENERAL);
+    void pushArguments(const std::vector<VReg>& args);
     
     // Built-in function support
     void initializeBuiltinFunctions();
     bool isBuiltinFunction(const std::string& name);
-    std::shared_ptr<Register> generateBuiltinCall(const std::string& name, const std::vector<std::shared_ptr<Register>>& args);
+    VReg generateBuiltinCall(const std::string& name, const std::vector<VReg>& args,
+                             Register::Type result_type = Register::GENERAL);
     
     // Assembly output
     void writeAssembly(const std::string& filename);
@@ -258,11 +264,35 @@ public:
     void addError(const std::string& message);
     bool hasErrors() const { return !errors.empty(); }
     const std::vector<std::string>& getErrors() const { return errors; }
+    const InlineStats& getInlineStats() const { return inline_stats; }
+    const SSAStats& getSSAStats() const { return ssa_stats; }
+    const GVNStats& getGVNStats() const { return gvn_stats; }
+    const DCEStats& getDCEStats() const { return dce_stats; }
+    const LoopStats& getLoopStats() const { return loop_stats; }
+    const CallStats& getCallStats() const { return call_stats; }
+    const AllocationStats& getAllocationStats() const { return allocation_stats; }
+    const LayoutStats& getLayoutStats() const { return layout_stats; }
+    const PeepholeStats& getPeepholeStats() const { return peephole_stats; }
+    const AssemblerStats& getAssemblerStats() const { return assembler_stats; }
+    void setAllocatorKind(AllocatorKind kind) { allocator_kind = kind; }
+    void setInlineOptions(const InlineOptions& options) { inline_options = options; }
+    const ProfileStats& getProfileStats() const { return profile_stats; }
+    const ObjectStats& getObjectStats() const { return object_stats; }
+    void setProfileGeneration(bool enabled) { profile_generate = enabled; }
+    void setProfile(const ProfileData& data) { profile = data; }
     
     // Utility methods
+    void applyProfile();
     void optimizeCode();
     void performDeadCodeElimination();
     void performConstantFolding();
+    void performInlining();
+    void buildSSAForm();
+    void performValueNumbering();
+    void performLoopOptimization();
+    void leaveSSAForm();
+    void performBlockLayout();
+    void performPeepholeOptimization(PeepholeTarget target);
     
     // Platform-specific code generation
     std::string getArchitecture() const;
@@ -272,10 +302,7 @@ public:
     void generateDebugInfo(const std::string& source_file);
     
     // Machine code generation
-    std::vector<uint8_t> generateMachineCode();
-    std::vector<uint8_t> generateInstructionBytes(Instruction* instr);
-    std::vector<uint8_t> generateX86_64Instruction(Instruction* instr);
-    std::vector<uint8_t> generateARM64Instruction(Instruction* instr);
+    AssembledCode generateMachineCode();
     
 private:
     // Helper methods
@@ -295,8 +322,8 @@ private:
     
     // Memory management
     void generateGarbageCollector();
-    void generateMemoryAllocation(std::shared_ptr<Register> size_reg);
-    void generateMemoryDeallocation(std::shared_ptr<Register> ptr_reg);
+    void generateMemoryAllocation(VReg size_reg);
+    void generateMemoryDeallocation(VReg ptr_reg);
     
     // Runtime support
     void generateRuntimeSupport();
@@ -0,0 +1,88 @@
+#include "dce.h"
+#include "liveness.h"
+#include <algorithm>
+
+// Instructions that only compute their result and can be dropped when it
+// is dead. Loads are included because every load the code generator emits
+// reads a valid object field or vtable slot.
+static bool isRemovable(const Instruction& instr) {
+    switch (instr.opcode) {
+        case Instruction::MOV: case Instruction::LOAD: case Instruction::ADDR:
+        case Instruction::ADD: case Instruction::SUB: case Instruction::MUL:
+        case Instruction::DIV: case Instruction::MOD:
+        case Instruction::FADD: case Instruction::FSUB: case Instruction::FMUL: case Instruction::FDIV:
+        case Instruction::CVTI2F: case Instruction::CVTF2I: case Instruction::CVTS2D:
+        case Instruction::AND: case Instruction::OR: case Instruction::XOR: case Instruction::NOT:
+        case Instruction::SHL: case Instruction::SHR:
+            return instr.num_operands > 0;
+        default:
+            return false;
+    }
+}
+
+static size_t sweepBlock(Function& func, BasicBlock* block, const Liveness& liveness, DCEStats& stats) {
+    size_t removed = 0;
+    std::vector<bool> live = liveness.liveOut(block);
+    std::vector<VReg> uses;
+    auto& instructions = block->instructions;
+
+    for (size_t i = instructions.size(); i-- > 0;) {
+        Instruction& instr = instructions[i];
+        if (instr.opcode == Instruction::NOP) continue;
+
+        VReg dest = instr.definesFirstOperand() ? instr.operands[0] : VReg();
+        bool dead = dest && !live[dest.id];
+        if (dead && isRemovable(instr)) {
+            instr = Instruction(Instruction::NOP);
+            stats.instructions++;
+            removed++;
+            continue;
+        }
+        if (dead && instr.opcode == Instruction::CALL && instr.num_operands == 1 &&
+            isPureRuntimeHelper(func.symbolName(instr.label))) {
+            // The argument pushes are still ahead of the backward walk
+            int arity = block->callArgumentCount(i);
+            for (int a = -arity; a <= 0; ++a) {
+                instructions[i + a] = Instruction(Instruction::NOP);
+            }
+            stats.calls++;
+            removed++;
+            continue;
+        }
+
+        if (dest) live[dest.id] = false;
+        Liveness::collectUses(func, instr, uses);
+        for (VReg reg : uses) {
+            live[reg.id] = true;
+        }
+    }
+
+    // Whatever is still unmarked at the head is not read in this block or
+    // anywhere after it
+    auto& phis = block->phis;
+    size_t phi_count = phis.size();
+    phis.erase(std::remove_if(phis.begin(), phis.end(),
+        [&live](const Phi& phi) { return !live[phi.dest.id]; }),
+        phis.end());
+    stats.phis += phi_count - phis.size();
+    removed += phi_count - phis.size();
+
+    instructions.erase(std::remove_if(instructions.begin(), instructions.end(),
+        [](const Instruction& instr) { return instr.opcode == Instruction::NOP; }),
+        instructions.end());
+    return removed;
+}
+
+void eliminateDeadCode(Function& func, DCEStats& stats) {
+    stats.unreachable_blocks += func.removeUnreachableBlocks();
+
+    size_t removed;
+    do {
+        Liveness liveness(func);
+        removed = 0;
+        for (auto& block : func.blocks) {
+            removed += sweepBlock(func, block.get(), liveness, stats);
+        }
+        stats.passes++;
+    } while (removed > 0);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "ir.h"
+
+// Counters reported by dead-code elimination
+struct DCEStats {
+    size_t instructions;        // Computations whose result was never read
+    size_t calls;               // Pure runtime helper calls with unused results
+    size_t phis;                // Phi nodes whose result was never read
+    size_t unreachable_blocks;  // Blocks no path from the entry reaches
+    size_t passes;              // Liveness sweeps until nothing more was removed
+
+    DCEStats() : instructions(0), calls(0), phis(0), unreachable_blocks(0), passes(0) {}
+};
+
+// Liveness-based dead-code elimination, valid in and out of SSA form.
+// Locals live in virtual registers, so an assignment to a local that is
+// never read is removed like any other dead definition. Removing one
+// definition can make the values it read dead as well, so sweeps repeat
+// until a fixed point is reached.
+void eliminateDeadCode(Function& func, DCEStats& stats);
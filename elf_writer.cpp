@@ -0,0 +1,330 @@
+#include "elf_writer.h"
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+
+// Sections in the order their headers are written
+enum ElfSection : uint16_t {
+    NULL_SECTION, TEXT, RELA_TEXT, DATA, RODATA, RELA_RODATA, BSS, NOTE_GNU_STACK, SYMTAB, STRTAB, SHSTRTAB,
+    SECTION_COUNT
+};
+
+// Values from the System V ABI and its x86-64 and AArch64 supplements
+static const uint32_t SHT_PROGBITS = 1, SHT_SYMTAB = 2, SHT_STRTAB = 3, SHT_RELA = 4, SHT_NOBITS = 8;
+static const uint64_t SHF_WRITE = 0x1, SHF_ALLOC = 0x2, SHF_EXECINSTR = 0x4, SHF_INFO_LINK = 0x40;
+static const uint8_t STB_LOCAL = 0, STB_GLOBAL = 1;
+static const uint8_t STT_NOTYPE = 0, STT_OBJECT = 1, STT_FUNC = 2, STT_SECTION = 3;
+static const uint32_t R_X86_64_PC32 = 2, R_X86_64_PLT32 = 4, R_X86_64_PC64 = 24;
+static const uint32_t R_AARCH64_PREL64 = 260, R_AARCH64_PREL32 = 261, R_AARCH64_ADR_PREL_PG_HI21 = 275, R_AARCH64_ADD_ABS_LO12_NC = 277,
+                      R_AARCH64_JUMP26 = 282, R_AARCH64_CALL26 = 283;
+
+static void put16(std::vector<uint8_t>& out, uint16_t value) {
+    for (int i = 0; i < 2; ++i) out.push_back((value >> (8 * i)) & 0xff);
+}
+
+static void put32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back((value >> (8 * i)) & 0xff);
+}
+
+static void put64(std::vector<uint8_t>& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) out.push_back((value >> (8 * i)) & 0xff);
+}
+
+static void align(std::vector<uint8_t>& out, size_t alignment) {
+    while (out.size() % alignment != 0) out.push_back(0);
+}
+
+// NUL-terminated names after a leading empty name
+struct StringTable {
+    std::vector<uint8_t> bytes;
+    std::unordered_map<std::string, uint32_t> offsets;
+
+    StringTable() : bytes(1, 0) {}
+
+    uint32_t add(const std::string& name) {
+        auto it = offsets.find(name);
+        if (it != offsets.end()) return it->second;
+        uint32_t offset = static_cast<uint32_t>(bytes.size());
+        bytes.insert(bytes.end(), name.begin(), name.end());
+        bytes.push_back(0);
+        offsets[name] = offset;
+        return offset;
+    }
+};
+
+struct ElfSymbol {
+    uint32_t name;
+    uint8_t info;       // Binding in the high nibble, type in the low one
+    uint16_t section;
+    uint64_t value;
+    uint64_t size;
+};
+
+struct ElfRelocation {
+    uint64_t offset;
+    uint32_t symbol;
+    uint32_t type;
+    int64_t addend;
+};
+
+struct SectionHeader {
+    uint32_t name;
+    uint32_t type;
+    uint64_t flags;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint32_t info;
+    uint64_t alignment;
+    uint64_t entry_size;
+
+    SectionHeader() : name(0), type(0), flags(0), offset(0), size(0), link(0), info(0), alignment(0), entry_size(0) {}
+};
+
+static uint32_t read32(const std::vector<uint8_t>& code, size_t offset) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) value |= static_cast<uint32_t>(code[offset + i]) << (8 * i);
+    return value;
+}
+
+static ElfSection elfSection(Section section) {
+    switch (section) {
+        case Section::TEXT: return TEXT;
+        case Section::RODATA: return RODATA;
+        case Section::DATA: return DATA;
+        case Section::BSS: return BSS;
+    }
+    return TEXT;
+}
+
+// Relocation type of a section reference's field; 0 when there is none
+static uint32_t referenceType(Fixup::Field field, bool arm) {
+    switch (field) {
+        case Fixup::REL32: return arm ? R_AARCH64_PREL32 : R_X86_64_PC32;
+        case Fixup::REL64: return arm ? R_AARCH64_PREL64 : R_X86_64_PC64;
+        case Fixup::PAGE21: return arm ? R_AARCH64_ADR_PREL_PG_HI21 : 0;
+        case Fixup::LO12: return arm ? R_AARCH64_ADD_ABS_LO12_NC : 0;
+        default: return 0;
+    }
+}
+
+static void writeRelocations(std::vector<uint8_t>& out, SectionHeader& header, uint32_t name,
+                             ElfSection target, const std::vector<ElfRelocation>& relocations) {
+    align(out, 8);
+    header.name = name;
+    header.type = SHT_RELA;
+    header.flags = SHF_INFO_LINK;
+    header.offset = out.size();
+    header.size = relocations.size() * 24;
+    header.link = SYMTAB;
+    header.info = target;
+    header.alignment = 8;
+    header.entry_size = 24;
+    for (const auto& relocation : relocations) {
+        put64(out, relocation.offset);
+        put64(out, static_cast<uint64_t>(relocation.symbol) << 32 | relocation.type);
+        put64(out, static_cast<uint64_t>(relocation.addend));
+    }
+}
+
+bool writeElfObject(const std::string& filename, const AssembledCode& code, ElfMachine machine,
+                    ObjectStats& stats, std::string& error) {
+    bool arm = machine == ElfMachine::AARCH64;
+    StringTable strtab;
+
+    // Section symbols come first among the locals; references between
+    // sections are relocated against them
+    std::vector<ElfSymbol> symbols(1, ElfSymbol{0, 0, 0, 0, 0});
+    std::unordered_map<uint16_t, uint32_t> section_symbol;
+    for (uint16_t section : {TEXT, DATA, RODATA, BSS}) {
+        section_symbol[section] = static_cast<uint32_t>(symbols.size());
+        symbols.push_back({0, static_cast<uint8_t>(STB_LOCAL << 4 | STT_SECTION), section, 0, 0});
+    }
+    for (const auto& object : code.objects) {
+        symbols.push_back({strtab.add(object.name), static_cast<uint8_t>(STB_LOCAL << 4 | STT_OBJECT),
+                           elfSection(object.section), object.offset, object.size});
+    }
+    uint32_t first_global = static_cast<uint32_t>(symbols.size());
+
+    std::unordered_map<std::string, uint32_t> symbol_index;
+    for (const auto& func : code.functions) {
+        symbol_index[func.name] = static_cast<uint32_t>(symbols.size());
+        symbols.push_back({strtab.add(func.name), static_cast<uint8_t>(STB_GLOBAL << 4 | STT_FUNC), TEXT,
+                           func.offset, func.size});
+    }
+
+    std::vector<ElfRelocation> relocations;
+    for (const auto& call : code.externals) {
+        auto it = symbol_index.find(call.symbol);
+        if (it == symbol_index.end()) {
+            it = symbol_index.emplace(call.symbol, static_cast<uint32_t>(symbols.size())).first;
+            symbols.push_back({strtab.add(call.symbol), static_cast<uint8_t>(STB_GLOBAL << 4 | STT_NOTYPE), 0, 0, 0});
+        }
+
+        // The field's displacement is measured from base, the relocation's
+        // from the field itself
+        int64_t addend = static_cast<int64_t>(call.offset) - static_cast<int64_t>(call.base);
+        if (call.field == Fixup::REL32 && !arm) {
+            relocations.push_back({call.offset, it->second, R_X86_64_PLT32, addend});
+        } else if (call.field == Fixup::BRANCH26 && arm) {
+            bool link = (read32(code.code, call.offset) >> 26) == 0x25;     // bl rather than b
+            relocations.push_back({call.offset, it->second, link ? R_AARCH64_CALL26 : R_AARCH64_JUMP26, addend});
+        } else {
+            error = "No ELF relocation for the reference to " + call.symbol;
+            return false;
+        }
+    }
+
+    // A reference to the target's section symbol, the target's offset in
+    // the addend, lands on the target as well
+    std::vector<ElfRelocation> rodata_relocations;
+    for (const auto& reference : code.references) {
+        uint32_t type = referenceType(reference.field, arm);
+        std::vector<ElfRelocation>* list = reference.section == Section::TEXT ? &relocations
+                                         : reference.section == Section::RODATA ? &rodata_relocations : nullptr;
+        if (type == 0 || list == nullptr) {
+            error = "No ELF relocation for a reference between sections";
+            return false;
+        }
+        int64_t addend = static_cast<int64_t>(reference.target_offset) + static_cast<int64_t>(reference.offset) -
+                         static_cast<int64_t>(reference.base);
+        list->push_back({reference.offset, section_symbol[elfSection(reference.target)], type, addend});
+    }
+    auto by_offset = [](const ElfRelocation& a, const ElfRelocation& b) { return a.offset < b.offset; };
+    std::sort(relocations.begin(), relocations.end(), by_offset);
+    std::sort(rodata_relocations.begin(), rodata_relocations.end(), by_offset);
+
+    // Contents after the 64-byte file header
+    std::vector<uint8_t> out(64, 0);
+    SectionHeader headers[SECTION_COUNT];
+    StringTable shstrtab;
+
+    align(out, 16);
+    headers[TEXT].name = shstrtab.add(".text");
+    headers[TEXT].type = SHT_PROGBITS;
+    headers[TEXT].flags = SHF_ALLOC | SHF_EXECINSTR;
+    headers[TEXT].offset = out.size();
+    headers[TEXT].size = code.code.size();
+    headers[TEXT].alignment = 16;
+    out.insert(out.end(), code.code.begin(), code.code.end());
+
+    writeRelocations(out, headers[RELA_TEXT], shstrtab.add(".rela.text"), TEXT, relocations);
+
+    align(out, 16);
+    headers[DATA].name = shstrtab.add(".data");
+    headers[DATA].type = SHT_PROGBITS;
+    headers[DATA].flags = SHF_ALLOC | SHF_WRITE;
+    headers[DATA].offset = out.size();
+    headers[DATA].size = code.data.size();
+    headers[DATA].alignment = 16;
+    out.insert(out.end(), code.data.begin(), code.data.end());
+
+    align(out, 16);
+    headers[RODATA].name = shstrtab.add(".rodata");
+    headers[RODATA].type = SHT_PROGBITS;
+    headers[RODATA].flags = SHF_ALLOC;
+    headers[RODATA].offset = out.size();
+    headers[RODATA].size = code.rodata.size();
+    headers[RODATA].alignment = 16;
+    out.insert(out.end(), code.rodata.begin(), code.rodata.end());
+
+    writeRelocations(out, headers[RELA_RODATA], shstrtab.add(".rela.rodata"), RODATA, rodata_relocations);
+
+    headers[BSS].name = shstrtab.add(".bss");
+    headers[BSS].type = SHT_NOBITS;
+    headers[BSS].flags = SHF_ALLOC | SHF_WRITE;
+    headers[BSS].offset = out.size();
+    headers[BSS].size = code.bss_size;
+    headers[BSS].alignment = 16;
+
+    // Marks the stack non-executable for the GNU linker
+    headers[NOTE_GNU_STACK].name = shstrtab.add(".note.GNU-stack");
+    headers[NOTE_GNU_STACK].type = SHT_PROGBITS;
+    headers[NOTE_GNU_STACK].offset = out.size();
+    headers[NOTE_GNU_STACK].alignment = 1;
+
+    align(out, 8);
+    headers[SYMTAB].name = shstrtab.add(".symtab");
+    headers[SYMTAB].type = SHT_SYMTAB;
+    headers[SYMTAB].offset = out.size();
+    headers[SYMTAB].size = symbols.size() * 24;
+    headers[SYMTAB].link = STRTAB;
+    headers[SYMTAB].info = first_global;
+    headers[SYMTAB].alignment = 8;
+    headers[SYMTAB].entry_size = 24;
+    for (const auto& symbol : symbols) {
+        put32(out, symbol.name);
+        out.push_back(symbol.info);
+        out.push_back(0);       // st_other: default visibility
+        put16(out, symbol.section);
+        put64(out, symbol.value);
+        put64(out, symbol.size);
+    }
+
+    headers[STRTAB].name = shstrtab.add(".strtab");
+    headers[STRTAB].type = SHT_STRTAB;
+    headers[STRTAB].offset = out.size();
+    headers[STRTAB].size = strtab.bytes.size();
+    headers[STRTAB].alignment = 1;
+    out.insert(out.end(), strtab.bytes.begin(), strtab.bytes.end());
+
+    headers[SHSTRTAB].name = shstrtab.add(".shstrtab");
+    headers[SHSTRTAB].type = SHT_STRTAB;
+    headers[SHSTRTAB].offset = out.size();
+    headers[SHSTRTAB].size = shstrtab.bytes.size();
+    headers[SHSTRTAB].alignment = 1;
+    out.insert(out.end(), shstrtab.bytes.begin(), shstrtab.bytes.end());
+
+    align(out, 8);
+    uint64_t section_headers = out.size();
+    for (const auto& header : headers) {
+        put32(out, header.name);
+        put32(out, header.type);
+        put64(out, header.flags);
+        put64(out, 0);          // sh_addr: assigned by the linker
+        put64(out, header.offset);
+        put64(out, header.size);
+        put32(out, header.link);
+        put32(out, header.info);
+        put64(out, header.alignment);
+        put64(out, header.entry_size);
+    }
+
+    std::vector<uint8_t> file_header = {
+        0x7f, 'E', 'L', 'F',
+        2,      // ELFCLASS64
+        1,      // ELFDATA2LSB
+        1,      // EV_CURRENT
+        0,      // ELFOSABI_NONE
+        0, 0, 0, 0, 0, 0, 0, 0
+    };
+    put16(file_header, 1);      // ET_REL
+    put16(file_header, static_cast<uint16_t>(machine));
+    put32(file_header, 1);      // EV_CURRENT
+    put64(file_header, 0);      // No entry point
+    put64(file_header, 0);      // No program headers
+    put64(file_header, section_headers);
+    put32(file_header, 0);      // e_flags
+    put16(file_header, 64);     // e_ehsize
+    put16(file_header, 0);      // e_phentsize
+    put16(file_header, 0);      // e_phnum
+    put16(file_header, 64);     // e_shentsize
+    put16(file_header, SECTION_COUNT);
+    put16(file_header, SHSTRTAB);
+    std::copy(file_header.begin(), file_header.end(), out.begin());
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        error = "Cannot open object file: " + filename;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(out.data()), out.size());
+    if (!file) {
+        error = "Cannot write object file: " + filename;
+        return false;
+    }
+
+    stats.symbols = symbols.size() - 1;
+    stats.relocations = relocations.size() + rodata_relocations.size();
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "assembler.h"
+#include <string>
+
+// Machines an ELF object can be written for, as e_machine values
+enum class ElfMachine : uint16_t {
+    X86_64 = 62,
+    AARCH64 = 183
+};
+
+// Counters reported by the object writer
+struct ObjectStats {
+    size_t symbols;         // Symbol table entries, the null symbol excluded
+    size_t relocations;     // RELA entries against .text and .rodata
+
+    ObjectStats() : symbols(0), relocations(0) {}
+};
+
+// Writes the assembled program as an ELF64 relocatable object (ET_REL) that
+// the system linker accepts. .text holds the code, .rodata the constants
+// and jump tables, .data and .bss the program's variables. Every function
+// is a global STT_FUNC symbol, every data object a local STT_OBJECT one.
+// Calls the assembler could not resolve become relocations against
+// undefined symbols (R_X86_64_PLT32, or R_AARCH64_CALL26 and
+// R_AARCH64_JUMP26). References between sections are PC-relative
+// relocations against the target's section symbol (R_X86_64_PC32 and
+// R_X86_64_PC64, or R_AARCH64_PREL32, R_AARCH64_PREL64,
+// R_AARCH64_ADR_PREL_PG_HI21 and R_AARCH64_ADD_ABS_LO12_NC), so neither
+// .text nor .rodata needs a dynamic relocation in a position-independent
+// executable. False with a message
+// when the file cannot be written.
+bool writeElfObject(const std::string& filename, const AssembledCode& code, ElfMachine machine,
+                    ObjectStats& stats, std::string& error);
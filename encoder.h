@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ir.h"
+#include "target.h"
+#include <cstdint>
+#include <vector>
+
+// A displacement an encoder left zero because its target's address is not
+// known yet
+struct Fixup {
+    enum Target {
+        LABEL,      // A label of the same function
+        SYMBOL,     // Another function or a runtime helper
+        TABLE,      // A jump table of the same function
+        DATA        // A DataObject of the program
+    };
+    enum Field {
+        REL8,       // x86-64 signed byte
+        REL32,      // x86-64 signed 32-bit word
+        REL64,      // Signed 64-bit word, only in data
+        BRANCH19,   // AArch64 b.cond, cbz and cbnz: word offset in bits 5-23
+        BRANCH26,   // AArch64 b and bl: word offset in bits 0-25
+        PAGE21,     // AArch64 adrp: 4 KiB page offset split over bits 29-30 and 5-23
+        LO12        // AArch64 add: low 12 bits of the target address in bits 10-21
+    };
+
+    Target target;
+    Field field;
+    size_t offset;      // Position of the field in the code buffer
+    size_t base;        // Position the displacement is measured from
+    uint32_t symbol;    // Function::symbolName id of the target
+
+    Fixup(Target target, Field field, size_t offset, size_t base, uint32_t symbol)
+        : target(target), field(field), offset(offset), base(base), symbol(symbol) {}
+};
+
+// Turns the allocated instructions of one function at a time into machine
+// code, appending to a code buffer
+class MachineEncoder {
+public:
+    virtual ~MachineEncoder() {}
+
+    // Starts a function: emits its prologue and remembers its frame for
+    // the epilogues of RET and TAILCALL
+    virtual void beginFunction(const Function& func, std::vector<uint8_t>& out) = 0;
+
+    // Encodes one instruction. Branches use their short form when
+    // short_branch is set: rel8 on x86-64, a single b.cond, cbz or cbnz on
+    // AArch64. Every displacement is left zero with a fixup recording
+    // where it goes.
+    virtual void encode(const Instruction& instr, bool short_branch, std::vector<uint8_t>& out,
+                        std::vector<Fixup>& fixups) = 0;
+};
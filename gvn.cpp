@@ -0,0 +1,248 @@
+#include "gvn.h"
+#include <algorithm>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+
+// Runtime helpers that read memory but never write it
+static const std::unordered_set<std::string> readonly_helpers = {
+    "_array_get"
+};
+
+static bool isCommutative(Instruction::OpCode opcode) {
+    switch (opcode) {
+        case Instruction::ADD: case Instruction::MUL:
+        case Instruction::AND: case Instruction::OR: case Instruction::XOR:
+        case Instruction::FADD: case Instruction::FMUL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool isPureOperation(Instruction::OpCode opcode) {
+    switch (opcode) {
+        case Instruction::ADDR:
+        case Instruction::ADD: case Instruction::SUB: case Instruction::MUL:
+        case Instruction::DIV: case Instruction::MOD:
+        case Instruction::FADD: case Instruction::FSUB: case Instruction::FMUL: case Instruction::FDIV:
+        case Instruction::CVTI2F: case Instruction::CVTF2I: case Instruction::CVTS2D:
+        case Instruction::AND: case Instruction::OR: case Instruction::XOR: case Instruction::NOT:
+        case Instruction::SHL: case Instruction::SHR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Opcode, result class, operand value numbers, immediate, symbol, memory generation
+typedef std::tuple<int, int, std::vector<uint64_t>, int64_t, uint32_t, uint32_t> ValueKey;
+
+static const int64_t NO_IMMEDIATE = INT64_MIN;
+
+struct NumberingState {
+    Function& func;
+    GVNStats& stats;
+    std::vector<VReg> replacement;          // Leader of each removed definition
+    std::vector<char> is_constant;          // Defined by an immediate MOV
+    std::vector<int32_t> constant_value;
+    std::map<ValueKey, VReg> table;
+    uint32_t generation;
+
+    NumberingState(Function& func, GVNStats& stats)
+        : func(func), stats(stats), replacement(func.registerCount()),
+          is_constant(func.registerCount(), 0), constant_value(func.registerCount(), 0), generation(0) {}
+
+    VReg resolve(VReg reg) const {
+        while (reg && replacement[reg.id]) reg = replacement[reg.id];
+        return reg;
+    }
+
+    // The return register is the one register that stays multiply assigned
+    bool isValue(VReg reg) const {
+        return reg && reg != func.return_register;
+    }
+
+    // Constants number by value so separately materialized immediates match
+    uint64_t valueNumber(VReg reg) const {
+        if (is_constant[reg.id]) {
+            uint64_t type = func.getRegister(reg).type == Register::FLOAT ? 1 : 0;
+            return (1ull << 63) | (type << 32) | static_cast<uint32_t>(constant_value[reg.id]);
+        }
+        return reg.id;
+    }
+
+    int typeOf(VReg reg) const {
+        return reg ? static_cast<int>(func.getRegister(reg).type) : -1;
+    }
+};
+
+static void numberBlock(BasicBlock* block, NumberingState& state, uint32_t memory) {
+    std::vector<ValueKey> inserted;
+    auto lookup = [&](const ValueKey& key, VReg value) -> VReg {
+        auto it = state.table.find(key);
+        if (it != state.table.end()) return it->second;
+        state.table[key] = value;
+        inserted.push_back(key);
+        return VReg();
+    };
+
+    // Values reaching a join may come from paths that wrote memory
+    if (block->predecessors.size() > 1) {
+        memory = ++state.generation;
+    }
+
+    // A phi whose operands all carry the same value is just that value
+    for (auto& phi : block->phis) {
+        VReg common;
+        bool single = true;
+        for (const auto& incoming : phi.incoming) {
+            VReg value = state.resolve(incoming.second);
+            if (value == phi.dest) continue;
+            if (common && value != common) {
+                single = false;
+                break;
+            }
+            common = value;
+        }
+        if (single && common && state.isValue(common)) {
+            state.replacement[phi.dest.id] = common;
+            state.stats.phis++;
+        }
+    }
+    block->phis.erase(std::remove_if(block->phis.begin(), block->phis.end(),
+        [&state](const Phi& phi) { return static_cast<bool>(state.replacement[phi.dest.id]); }),
+        block->phis.end());
+
+    auto& instructions = block->instructions;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        Instruction& instr = instructions[i];
+        for (int j = instr.firstUse(); j < instr.num_operands; ++j) {
+            instr.operands[j] = state.resolve(instr.operands[j]);
+        }
+
+        bool all_values = true;
+        for (int j = 0; j < instr.num_operands; ++j) {
+            if (instr.operands[j] && !state.isValue(instr.operands[j])) all_values = false;
+        }
+        VReg dest = instr.definesFirstOperand() ? instr.operands[0] : VReg();
+
+        if (instr.opcode == Instruction::MOV && dest && all_values) {
+            if (instr.num_operands == 1 && instr.has_immediate) {
+                state.is_constant[dest.id] = 1;
+                state.constant_value[dest.id] = instr.immediate;
+            } else if (instr.num_operands == 2 && !instr.has_immediate &&
+                       state.typeOf(dest) == state.typeOf(instr.operands[1])) {
+                state.replacement[dest.id] = instr.operands[1];
+                instr = Instruction(Instruction::NOP);
+                state.stats.copies++;
+            }
+            continue;
+        }
+
+        if (isPureOperation(instr.opcode) && dest && all_values) {
+            std::vector<uint64_t> operands;
+            for (int j = 1; j < instr.num_operands; ++j) {
+                operands.push_back(state.valueNumber(instr.operands[j]));
+            }
+            if (isCommutative(instr.opcode)) std::sort(operands.begin(), operands.end());
+            ValueKey key(instr.opcode, state.typeOf(dest), operands,
+                         instr.has_immediate ? instr.immediate : NO_IMMEDIATE, instr.label, 0);
+            if (VReg leader = lookup(key, dest)) {
+                state.replacement[dest.id] = leader;
+                instr = Instruction(Instruction::NOP);
+                state.stats.expressions++;
+            }
+            continue;
+        }
+
+        if (instr.opcode == Instruction::LOAD && dest && all_values) {
+            ValueKey key(Instruction::LOAD, state.typeOf(dest), {state.valueNumber(instr.operands[1])},
+                         instr.immediate, 0, memory);
+            if (VReg leader = lookup(key, dest)) {
+                state.replacement[dest.id] = leader;
+                instr = Instruction(Instruction::NOP);
+                state.stats.loads++;
+            }
+            continue;
+        }
+
+        if (instr.opcode == Instruction::STORE) {
+            // Any store may alias any location; afterwards only the stored
+            // value is known
+            memory = ++state.generation;
+            if (all_values) {
+                ValueKey key(Instruction::LOAD, state.typeOf(instr.operands[0]), {state.valueNumber(instr.operands[1])},
+                             instr.immediate, 0, memory);
+                lookup(key, instr.operands[0]);
+            }
+            continue;
+        }
+
+        if (instr.opcode == Instruction::CALL) {
+            const std::string& name = state.func.symbolName(instr.label);
+            bool pure = isPureRuntimeHelper(name);
+            bool readonly = readonly_helpers.count(name) != 0;
+            int arity = (pure || readonly) && dest && instr.num_operands == 1 ? block->callArgumentCount(i) : -1;
+            if (arity < 0) {
+                if (!pure && !readonly) memory = ++state.generation;
+                continue;
+            }
+
+            std::vector<uint64_t> args;
+            bool args_known = all_values;
+            for (int a = arity; a >= 1; --a) {
+                VReg arg = instructions[i - a].operands[0];
+                if (!state.isValue(arg)) args_known = false;
+                else args.push_back(state.valueNumber(arg));
+            }
+            if (!args_known) continue;
+
+            ValueKey key(Instruction::CALL, state.typeOf(dest), args, NO_IMMEDIATE, instr.label,
+                         readonly ? memory : 0);
+            if (VReg leader = lookup(key, dest)) {
+                state.replacement[dest.id] = leader;
+                for (int a = -arity; a <= 0; ++a) {
+                    instructions[i + a] = Instruction(Instruction::NOP);
+                }
+                state.stats.calls++;
+            }
+            continue;
+        }
+    }
+
+    for (BasicBlock* child : block->dominated) {
+        numberBlock(child, state, memory);
+    }
+
+    for (const auto& key : inserted) {
+        state.table.erase(key);
+    }
+}
+
+void eliminateRedundancies(Function& func, GVNStats& stats) {
+    if (func.reverse_postorder.empty()) return;
+
+    NumberingState state(func, stats);
+    numberBlock(func.reverse_postorder.front(), state, 0);
+
+    // Uses reached over back edges are visited before their replacement is
+    // known, so resolve every operand once more and drop the dead husks
+    for (auto& block : func.blocks) {
+        for (auto& phi : block->phis) {
+            for (auto& incoming : phi.incoming) {
+                incoming.second = state.resolve(incoming.second);
+            }
+        }
+        auto& instructions = block->instructions;
+        for (auto& instr : instructions) {
+            for (int j = instr.firstUse(); j < instr.num_operands; ++j) {
+                instr.operands[j] = state.resolve(instr.operands[j]);
+            }
+        }
+        instructions.erase(std::remove_if(instructions.begin(), instructions.end(),
+            [](const Instruction& instr) { return instr.opcode == Instruction::NOP; }),
+            instructions.end());
+    }
+}
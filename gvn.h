@@ -0,0 +1,22 @@
+#pragma once
+
+#include "ir.h"
+
+// Counters reported by value numbering
+struct GVNStats {
+    size_t expressions;     // Redundant arithmetic, logic and conversions removed
+    size_t loads;           // Loads replaced by an earlier load or stored value
+    size_t calls;           // Runtime helper calls replaced by an earlier result
+    size_t copies;          // Copies propagated into their uses
+    size_t phis;            // Phi nodes that merged a single value
+
+    GVNStats() : expressions(0), loads(0), calls(0), copies(0), phis(0) {}
+};
+
+// Dominator-based global value numbering on a function in SSA form.
+// Computations that an equivalent dominating computation already produced
+// are removed and their uses rewritten. Loads and calls to read-only runtime
+// helpers are keyed by a memory generation that every store, unknown call
+// and control-flow join advances, so they are only reused while memory is
+// provably unchanged.
+void eliminateRedundancies(Function& func, GVNStats& stats);
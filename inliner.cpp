@@ -0,0 +1,253 @@
+#include "inliner.h"
+#include <algorithm>
+#include <unordered_set>
+
+// Before the CFG is built a function is a single instruction stream
+static std::vector<Instruction>& flatten(Function& func) {
+    if (func.blocks.empty()) func.createBlock(func.name + "_entry");
+    auto& stream = func.blocks.front()->instructions;
+    for (size_t i = 1; i < func.blocks.size(); ++i) {
+        auto& more = func.blocks[i]->instructions;
+        stream.insert(stream.end(), more.begin(), more.end());
+    }
+    func.blocks.resize(1);
+    return stream;
+}
+
+static size_t codeSize(const Function& func) {
+    size_t size = 0;
+    for (const auto& block : func.blocks) {
+        for (const auto& instr : block->instructions) {
+            if (instr.opcode != Instruction::LABEL && instr.opcode != Instruction::NOP) size++;
+        }
+    }
+    return size;
+}
+
+static bool usesLabel(const Instruction& instr) {
+    return instr.opcode == Instruction::LABEL || instr.isBranch() || instr.opcode == Instruction::JMPT;
+}
+
+struct Inliner {
+    const std::unordered_map<std::string, Function*>& function_map;
+    const InlineOptions& options;
+    InlineStats& stats;
+    std::unordered_map<Function*, size_t> call_sites;
+    std::unordered_set<Function*> recursive;
+    uint64_t hottest;       // Highest block count in the profile, 0 without one
+    int next_copy;
+
+    Inliner(const std::unordered_map<std::string, Function*>& function_map,
+            const InlineOptions& options, InlineStats& stats)
+        : function_map(function_map), options(options), stats(stats), hottest(0), next_copy(0) {}
+
+    Function* directCallee(const Function& caller, const Instruction& instr) const {
+        if (instr.opcode != Instruction::CALL || !instr.label || instr.num_operands > 1) return nullptr;
+        auto it = function_map.find(caller.symbolName(instr.label));
+        return it != function_map.end() ? it->second : nullptr;
+    }
+
+    std::vector<Function*> callees(Function* func) const {
+        std::vector<Function*> result;
+        for (const auto& instr : func->blocks.front()->instructions) {
+            if (Function* callee = directCallee(*func, instr)) result.push_back(callee);
+        }
+        return result;
+    }
+
+    void findRecursive(const std::vector<std::unique_ptr<Function>>& functions) {
+        for (const auto& func : functions) {
+            std::vector<Function*> worklist = callees(func.get());
+            std::unordered_set<Function*> seen;
+            while (!worklist.empty()) {
+                Function* next = worklist.back();
+                worklist.pop_back();
+                if (next == func.get()) {
+                    recursive.insert(next);
+                    stats.recursive++;
+                    break;
+                }
+                if (!seen.insert(next).second) continue;
+                for (Function* callee : callees(next)) worklist.push_back(callee);
+            }
+        }
+    }
+
+    // site is the profiled count of the call site when profiled is set
+    bool shouldInline(Function* caller, Function* callee, const Instruction& call,
+                      const std::vector<VReg>& args, bool profiled, uint64_t site) const {
+        if (callee == caller || recursive.count(callee) || args.size() != callee->parameters.size()) return false;
+
+        size_t size = codeSize(*callee);
+        size_t limit = call_sites.at(callee) == 1 ? options.max_single_call_size : options.max_callee_size;
+        bool hot = profiled && hottest > 0 && site * 100 >= hottest;
+        bool only_hot = hot && size > limit && size <= options.max_hot_callee_size;
+        if ((size > limit && !only_hot) || codeSize(*caller) + size > options.max_caller_size) return false;
+
+        // Values must already sit in the register class the callee expects
+        for (size_t i = 0; i < args.size(); ++i) {
+            if (caller->getRegister(args[i]).type != callee->getRegister(callee->parameters[i]).type) return false;
+        }
+        VReg result = call.num_operands > 0 ? call.operands[0] : VReg();
+        if (result && callee->return_register &&
+            caller->getRegister(result).type != callee->getRegister(callee->return_register).type) {
+            return false;
+        }
+
+        if (profiled && site == 0) {
+            stats.cold++;
+            return false;
+        }
+        if (only_hot) stats.hot++;
+        return true;
+    }
+
+    // Appends a copy of the callee's body that reads its parameters from args
+    // and leaves its return value in result
+    void expand(Function* caller, Function* callee, const std::vector<VReg>& args, VReg result,
+                bool profiled, uint64_t site, std::vector<Instruction>& out) {
+        std::string suffix = "_inl" + std::to_string(next_copy++);
+        std::vector<VReg> reg_map(callee->registerCount());
+        auto mapRegister = [&](VReg reg) {
+            if (!reg) return reg;
+            if (!reg_map[reg.id]) {
+                const Register& info = callee->getRegister(reg);
+                reg_map[reg.id] = caller->newRegister(info.type, info.name);
+            }
+            return reg_map[reg.id];
+        };
+        auto mapLabel = [&](uint32_t symbol) {
+            return caller->internSymbol(callee->symbolName(symbol) + suffix);
+        };
+
+        for (size_t i = 0; i < args.size(); ++i) {
+            Instruction copy(Instruction::MOV);
+            copy.addOperand(mapRegister(callee->parameters[i]));
+            copy.addOperand(args[i]);
+            out.push_back(copy);
+        }
+
+        uint32_t end_label = caller->internSymbol(callee->name + "_return" + suffix);
+        if (profiled) caller->profile_counts[end_label] = site;
+        // Copied labels run as often as the callee's, scaled to this site
+        auto callee_entry = callee->profile_counts.find(0);
+        double scale = profiled && callee_entry != callee->profile_counts.end()
+            ? static_cast<double>(site) / static_cast<double>(callee_entry->second) : -1.0;
+        const auto& body = callee->blocks.front()->instructions;
+        for (size_t i = 0; i < body.size(); ++i) {
+            Instruction instr = body[i];
+            if (instr.opcode == Instruction::NOP) continue;
+            if (instr.opcode == Instruction::RET) {
+                if (i + 1 == body.size()) break;
+                instr = Instruction(Instruction::JMP);
+                instr.label = end_label;
+                out.push_back(instr);
+                continue;
+            }
+
+            for (int j = 0; j < instr.num_operands; ++j) {
+                instr.operands[j] = mapRegister(instr.operands[j]);
+            }
+            if (instr.opcode == Instruction::JMPT) {
+                JumpTable table(mapLabel(instr.label));
+                for (uint32_t target : callee->findJumpTable(instr.label)->targets) {
+                    table.targets.push_back(mapLabel(target));
+                }
+                caller->jump_tables.push_back(table);
+            }
+            if (usesLabel(instr)) {
+                instr.label = mapLabel(instr.label);
+                auto count = callee->profile_counts.find(body[i].label);
+                if (instr.opcode == Instruction::LABEL && scale >= 0.0 && count != callee->profile_counts.end()) {
+                    caller->profile_counts[instr.label] = static_cast<uint64_t>(count->second * scale + 0.5);
+                }
+            } else if (instr.label) {
+                instr.label = caller->internSymbol(callee->symbolName(instr.label));
+            }
+            out.push_back(instr);
+            if (instr.opcode != Instruction::LABEL) stats.instructions++;
+        }
+
+        Instruction end(Instruction::LABEL);
+        end.label = end_label;
+        out.push_back(end);
+        if (result && callee->return_register) {
+            Instruction copy(Instruction::MOV);
+            copy.addOperand(result);
+            copy.addOperand(mapRegister(callee->return_register));
+            out.push_back(copy);
+        }
+    }
+
+    void run(Function* caller) {
+        auto& stream = caller->blocks.front()->instructions;
+        std::vector<Instruction> out;
+        out.reserve(stream.size());
+        // Count of the code being copied: its entry or its last label
+        bool profiled = !caller->profile_counts.empty();
+        uint64_t site = profiled ? caller->profile_counts[0] : 0;
+        for (const auto& instr : stream) {
+            if (profiled && instr.opcode == Instruction::LABEL) {
+                auto count = caller->profile_counts.find(instr.label);
+                if (count != caller->profile_counts.end()) site = count->second;
+            }
+            Function* callee = directCallee(*caller, instr);
+            if (!callee) {
+                out.push_back(instr);
+                continue;
+            }
+
+            // The pushes just emitted are the arguments, last one first
+            size_t arity = 0;
+            while (arity < out.size() && out[out.size() - 1 - arity].opcode == Instruction::PUSH) arity++;
+            std::vector<VReg> args;
+            for (size_t a = 0; a < arity; ++a) {
+                args.push_back(out[out.size() - 1 - a].operands[0]);
+            }
+            if (!shouldInline(caller, callee, instr, args, profiled, site)) {
+                out.push_back(instr);
+                continue;
+            }
+
+            out.resize(out.size() - arity);
+            expand(caller, callee, args, instr.num_operands > 0 ? instr.operands[0] : VReg(), profiled, site, out);
+            call_sites[callee]--;
+            stats.inlined++;
+        }
+        stream = std::move(out);
+    }
+};
+
+void inlineFunctions(std::vector<std::unique_ptr<Function>>& functions,
+                     const std::unordered_map<std::string, Function*>& function_map,
+                     const InlineOptions& options, InlineStats& stats) {
+    Inliner inliner(function_map, options, stats);
+    for (auto& func : functions) {
+        flatten(*func);
+        inliner.call_sites[func.get()];
+        for (const auto& count : func->profile_counts) inliner.hottest = std::max(inliner.hottest, count.second);
+    }
+    for (auto& func : functions) {
+        for (Function* callee : inliner.callees(func.get())) inliner.call_sites[callee]++;
+    }
+    inliner.findRecursive(functions);
+
+    // Postorder over the call graph: callees are finished before their callers
+    std::unordered_set<Function*> visited;
+    for (auto& root : functions) {
+        std::vector<std::pair<Function*, std::vector<Function*>>> stack;
+        if (visited.insert(root.get()).second) stack.push_back({root.get(), inliner.callees(root.get())});
+        while (!stack.empty()) {
+            auto& top = stack.back();
+            if (!top.second.empty()) {
+                Function* callee = top.second.back();
+                top.second.pop_back();
+                if (visited.insert(callee).second) stack.push_back({callee, inliner.callees(callee)});
+                continue;
+            }
+            Function* done = top.first;
+            stack.pop_back();
+            inliner.run(done);
+        }
+    }
+}
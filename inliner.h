@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ir.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Size limits of the inliner, counted in instructions other than labels
+struct InlineOptions {
+    size_t max_callee_size;         // Callees up to this size are inlined at every call site
+    size_t max_single_call_size;    // Callees called from one site only may be this large
+    size_t max_caller_size;         // A caller stops growing past this size
+    size_t max_hot_callee_size;     // Limit at call sites a profile shows to be hot
+
+    InlineOptions() : max_callee_size(30), max_single_call_size(120), max_caller_size(4000), max_hot_callee_size(120) {}
+};
+
+// Counters reported by inlining
+struct InlineStats {
+    size_t inlined;         // Call sites replaced by a copy of the callee
+    size_t instructions;    // Instructions copied into callers
+    size_t recursive;       // Functions never inlined because they can reach themselves
+    size_t hot;             // Sites inlined only because the profile shows them hot
+    size_t cold;            // Sites left alone because the profile shows they never ran
+
+    InlineStats() : inlined(0), instructions(0), recursive(0), hot(0), cold(0) {}
+};
+
+// Inlines direct calls to small non-recursive functions, before the CFG is
+// built. Callers are visited after their callees, so chains of small
+// helpers collapse bottom-up. The callee body is copied with fresh
+// registers and labels, its parameters become copies of the pushed
+// arguments and each return jumps to the continuation. Value numbering,
+// constant folding and dead-code elimination clean up afterwards.
+// In profiled callers a site that never ran is not inlined, one within a
+// hundredth of the program's hottest block gets the hot size limit, and
+// copied labels get the callee's counts scaled to the site.
+void inlineFunctions(std::vector<std::unique_ptr<Function>>& functions,
+                     const std::unordered_map<std::string, Function*>& function_map,
+                     const InlineOptions& options, InlineStats& stats);
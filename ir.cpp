@@ -0,0 +1,477 @@
+#include "ir.h"
+#include "target.h"
+#include <sstream>
+#include <algorithm>
+#include <unordered_set>
+
+// Instruction implementation
+bool Instruction::definesFirstOperand() const {
+    switch (opcode) {
+        case MOV: case LOAD: case ADDR:
+        case ADD: case SUB: case MUL: case DIV: case MOD:
+        case FADD: case FSUB: case FMUL: case FDIV:
+        case CVTI2F: case CVTF2I: case CVTS2D:
+        case AND: case OR: case XOR: case NOT: case SHL: case SHR:
+        case POP:
+        case CALL:      // CALL result, target
+            return num_operands > 0;
+        default:
+            return false;
+    }
+}
+
+std::string Instruction::toString(const Function& func) const {
+    std::stringstream ss;
+    
+    switch (opcode) {
+        case MOV: ss << "mov"; break;
+        case LOAD: ss << "load"; break;
+        case STORE: ss << "store"; break;
+        case ADDR: ss << "addr"; break;
+        case ADD: ss << "add"; break;
+        case SUB: ss << "sub"; break;
+        case MUL: ss << "mul"; break;
+        case DIV: ss << "div"; break;
+        case MOD: ss << "mod"; break;
+        case FADD: ss << "fadd"; break;
+        case FSUB: ss << "fsub"; break;
+        case FMUL: ss << "fmul"; break;
+        case FDIV: ss << "fdiv"; break;
+        case CVTI2F: ss << "cvti2f"; break;
+        case CVTF2I: ss << "cvtf2i"; break;
+        case CVTS2D: ss << "cvts2d"; break;
+        case AND: ss << "and"; break;
+        case OR: ss << "or"; break;
+        case XOR: ss << "xor"; break;
+        case NOT: ss << "not"; break;
+        case SHL: ss << "shl"; break;
+        case SHR: ss << "shr"; break;
+        case CMP: ss << "cmp"; break;
+        case FCMP: ss << "fcmp"; break;
+        case JMP: ss << "jmp"; break;
+        case JE: ss << "je"; break;
+        case JNE: ss << "jne"; break;
+        case JL: ss << "jl"; break;
+        case JLE: ss << "jle"; break;
+        case JG: ss << "jg"; break;
+        case JGE: ss << "jge"; break;
+        case JZ: ss << "jz"; break;
+        case JNZ: ss << "jnz"; break;
+        case JMPT: ss << "jmpt"; break;
+        case CALL: ss << "call"; break;
+        case RET: ss << "ret"; break;
+        case TAILCALL: ss << "tailcall"; break;
+        case PUSH: ss << "push"; break;
+        case POP: ss << "pop"; break;
+        case NOP: ss << "nop"; break;
+        case LABEL: ss << func.symbolName(label) << ":"; return ss.str();
+        default: ss << "unknown"; break;
+    }
+    
+    for (int i = 0; i < num_operands; ++i) {
+        ss << (i > 0 ? ", " : " ");
+        if (operands[i]) {
+            ss << func.registerName(operands[i]);
+        } else {
+            ss << "null";
+        }
+    }
+    
+    // The argument mask of a lowered call is implied by the moves before it
+    if (has_immediate && opcode != CALL && opcode != TAILCALL) {
+        ss << (num_operands > 0 ? ", " : " ") << "#" << immediate;
+    }
+    
+    if (label != 0) {
+        ss << (num_operands > 0 ? ", " : " ") << func.symbolName(label);
+    }
+    
+    return ss.str();
+}
+
+// x86-64 arithmetic overwrites its left operand: d, a, b is "op d, b",
+// after a "mov d, a" unless d already is a. A commutative operation on
+// d, a, d swaps its sources; a subtraction from d negates it first, and a
+// float one parks the right operand on the stack, as the encoder does.
+std::vector<std::string> Instruction::listing(const Function& func) const {
+    bool two_address = false;
+    bool commutative = false;
+    switch (opcode) {
+        case ADD: case MUL: case AND: case OR: case XOR: case FADD: case FMUL:
+            two_address = commutative = true;
+            break;
+        case SUB: case SHL: case SHR: case FSUB: case FDIV: case NOT:
+            two_address = true;
+            break;
+        default:
+            break;
+    }
+    bool x86 = func.register_file && func.register_file->architecture == "x86_64";
+    if (!x86 || !two_address || num_operands < 2 || func.getRegister(operands[0]).physical < 0) {
+        return {toString(func)};
+    }
+    // imul also has a three-operand form for an immediate
+    if (opcode == MUL && num_operands == 2) return {toString(func)};
+
+    std::string dest = func.registerName(operands[0]);
+    std::string left = func.registerName(operands[1]);
+    std::string name = toString(func);
+    name = name.substr(0, name.find(' '));
+    std::string source = num_operands == 3 ? func.registerName(operands[2])
+                       : opcode == NOT ? "" : "#" + std::to_string(has_immediate ? immediate : 0);
+    auto line = [&](const std::string& operand) {
+        return operand.empty() ? name + " " + dest : name + " " + dest + ", " + operand;
+    };
+
+    if (dest == left) return {line(source)};
+    if (source == dest && commutative) return {line(left)};
+    if (source == dest && opcode == SUB) return {"neg " + dest, "add " + dest + ", " + left};
+    if (source == dest && (opcode == FSUB || opcode == FDIV)) {
+        return {"sub rsp, #8", "store " + dest + ", rsp, #0", "mov " + dest + ", " + left,
+                name + " " + dest + ", [rsp]", "add rsp, #8"};
+    }
+    return {"mov " + dest + ", " + left, line(source)};
+}
+
+// BasicBlock implementation
+void BasicBlock::addSuccessor(BasicBlock* block) {
+    if (std::find(successors.begin(), successors.end(), block) != successors.end()) {
+        return;
+    }
+    successors.push_back(block);
+    block->predecessors.push_back(this);
+}
+
+uint32_t BasicBlock::labelSymbol() const {
+    if (!instructions.empty() && instructions.front().opcode == Instruction::LABEL) {
+        return instructions.front().label;
+    }
+    return 0;
+}
+
+size_t BasicBlock::insertionPoint() const {
+    if (!instructions.empty() && instructions.back().isTerminator()) {
+        return instructions.size() - 1;
+    }
+    return instructions.size();
+}
+
+int BasicBlock::callArgumentCount(size_t index) const {
+    int pushes = 0;
+    while (static_cast<size_t>(pushes) < index && instructions[index - pushes - 1].opcode == Instruction::PUSH) {
+        pushes++;
+    }
+    return pushes;
+}
+
+bool isPureRuntimeHelper(const std::string& name) {
+    // Strings and vectors are immutable values; _variant_add is left out
+    // because adding two arrays allocates a fresh array each time
+    static const std::unordered_set<std::string> pure_helpers = {
+        "_variant_sub", "_variant_mul", "_variant_div", "_variant_mod", "_variant_neg", "_variant_compare",
+        "_variant_from_int", "_variant_from_bool", "_variant_from_float", "_variant_from_string",
+        "_variant_to_int", "_variant_to_bool", "_variant_to_float", "_variant_to_string",
+        "_vector2_add", "_vector2_sub", "_vector2_mul", "_vector2_div", "_vector2_scale", "_vector2_div_scalar",
+        "_vector3_add", "_vector3_sub", "_vector3_mul", "_vector3_div", "_vector3_scale", "_vector3_div_scalar",
+        "_string_concat", "_string_format", "_string_compare", "_string_hash", "_fmod"
+    };
+    return pure_helpers.count(name) != 0;
+}
+
+bool isNoReturnRuntimeHelper(const std::string& name) {
+    return name == "_builtin_assert_failed";
+}
+
+// Function implementation
+Function::Function(const std::string& name)
+    : name(name), registers(1), stack_size(0), register_file(nullptr), symbols(1), next_block_id(0) {}
+
+BasicBlock* Function::createBlock(const std::string& label) {
+    auto block = std::make_unique<BasicBlock>(label);
+    BasicBlock* ptr = block.get();
+    blocks.push_back(std::move(block));
+    return ptr;
+}
+
+BasicBlock* Function::getBlock(const std::string& label) {
+    for (auto& block : blocks) {
+        if (block->label == label) {
+            return block.get();
+        }
+    }
+    return nullptr;
+}
+
+VReg Function::newRegister(Register::Type type, const std::string& reg_name) {
+    registers.emplace_back(type, reg_name);
+    return VReg(static_cast<uint32_t>(registers.size() - 1));
+}
+
+std::string Function::registerName(VReg reg) const {
+    const Register& info = registers[reg.id];
+    if (info.physical >= 0 && register_file) {
+        return register_file->get(info.type == Register::FLOAT, info.physical).name;
+    }
+    if (!info.name.empty()) {
+        return info.name;
+    }
+    return "v" + std::to_string(reg.id);
+}
+
+JumpTable* Function::findJumpTable(uint32_t symbol) {
+    for (auto& table : jump_tables) {
+        if (table.symbol == symbol) return &table;
+    }
+    return nullptr;
+}
+
+VReg Function::fixedRegister(Register::Type type, int physical) {
+    VReg& reg = fixed_registers[physical * 2 + (type == Register::FLOAT ? 1 : 0)];
+    if (!reg) {
+        reg = newRegister(type);
+        registers[reg.id].physical = physical;
+    }
+    return reg;
+}
+
+VReg Function::findFixedRegister(Register::Type type, int physical) const {
+    auto it = fixed_registers.find(physical * 2 + (type == Register::FLOAT ? 1 : 0));
+    return it != fixed_registers.end() ? it->second : VReg();
+}
+
+uint32_t Function::internSymbol(const std::string& symbol) {
+    auto it = symbol_ids.find(symbol);
+    if (it != symbol_ids.end()) {
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(symbols.size());
+    symbols.push_back(symbol);
+    symbol_ids[symbol] = id;
+    return id;
+}
+
+std::string Function::newBlockLabel(const std::string& prefix) {
+    return name + "_" + prefix + "_" + std::to_string(next_block_id++);
+}
+
+BasicBlock* Function::insertBlockAfter(BasicBlock* position, const std::string& label) {
+    auto it = std::find_if(blocks.begin(), blocks.end(),
+        [position](const std::unique_ptr<BasicBlock>& block) { return block.get() == position; });
+    auto inserted = blocks.insert(it == blocks.end() ? it : it + 1, std::make_unique<BasicBlock>(label));
+    return inserted->get();
+}
+
+size_t Function::buildCFG() {
+    // Flatten the current layout and split it again into maximal blocks:
+    // a label starts a block, a branch or return ends one
+    std::vector<Instruction> stream;
+    for (auto& block : blocks) {
+        stream.insert(stream.end(), block->instructions.begin(), block->instructions.end());
+    }
+    std::string entry_label = blocks.empty() ? name + "_entry" : blocks.front()->label;
+    blocks.clear();
+    
+    BasicBlock* current = createBlock(entry_label);
+    bool ended = false;
+    for (const auto& instr : stream) {
+        if (instr.opcode == Instruction::LABEL) {
+            current = createBlock(symbolName(instr.label));
+            ended = false;
+        } else if (ended) {
+            current = createBlock(newBlockLabel("bb"));
+            ended = false;
+        }
+        current->addInstruction(instr);
+        ended = instr.isTerminator();
+    }
+    
+    // Wire branch targets and fallthrough edges
+    std::unordered_map<uint32_t, BasicBlock*> label_blocks;
+    for (auto& block : blocks) {
+        if (uint32_t symbol = block->labelSymbol()) {
+            label_blocks[symbol] = block.get();
+        }
+    }
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        BasicBlock* block = blocks[i].get();
+        const Instruction* last = block->instructions.empty() ? nullptr : &block->instructions.back();
+        if (last && last->isBranch()) {
+            auto target = label_blocks.find(last->label);
+            if (target != label_blocks.end()) {
+                block->addSuccessor(target->second);
+            }
+        } else if (last && last->opcode == Instruction::JMPT) {
+            for (uint32_t symbol : findJumpTable(last->label)->targets) {
+                auto target = label_blocks.find(symbol);
+                if (target != label_blocks.end()) {
+                    block->addSuccessor(target->second);
+                }
+            }
+        }
+        bool falls_through = !last || last->fallsThrough();
+        if (falls_through && i + 1 < blocks.size()) {
+            block->addSuccessor(blocks[i + 1].get());
+        }
+    }
+    
+    // Blocks that cannot be reached from the entry never execute; dropping
+    // them keeps predecessor lists exact for SSA construction
+    return removeUnreachableBlocks();
+}
+
+size_t Function::removeUnreachableBlocks() {
+    if (blocks.empty()) return 0;
+    std::vector<BasicBlock*> worklist = {blocks.front().get()};
+    std::unordered_map<BasicBlock*, bool> reachable = {{blocks.front().get(), true}};
+    while (!worklist.empty()) {
+        BasicBlock* block = worklist.back();
+        worklist.pop_back();
+        for (BasicBlock* succ : block->successors) {
+            if (!reachable[succ]) {
+                reachable[succ] = true;
+                worklist.push_back(succ);
+            }
+        }
+    }
+    for (auto& block : blocks) {
+        if (reachable[block.get()]) continue;
+        for (BasicBlock* succ : block->successors) {
+            auto& preds = succ->predecessors;
+            preds.erase(std::remove(preds.begin(), preds.end(), block.get()), preds.end());
+            for (auto& phi : succ->phis) {
+                auto& incoming = phi.incoming;
+                incoming.erase(std::remove_if(incoming.begin(), incoming.end(),
+                    [&block](const std::pair<BasicBlock*, VReg>& edge) { return edge.first == block.get(); }),
+                    incoming.end());
+            }
+        }
+    }
+    size_t count = blocks.size();
+    blocks.erase(std::remove_if(blocks.begin(), blocks.end(),
+        [&reachable](const std::unique_ptr<BasicBlock>& block) { return !reachable[block.get()]; }),
+        blocks.end());
+    return count - blocks.size();
+}
+
+void Function::computeDominators() {
+    // Iterative algorithm of Cooper, Harvey and Kennedy over reverse postorder
+    reverse_postorder.clear();
+    for (auto& block : blocks) {
+        block->idom = nullptr;
+        block->order = -1;
+        block->dominated.clear();
+        block->dominance_frontier.clear();
+    }
+    if (blocks.empty()) return;
+    
+    BasicBlock* entry = blocks.front().get();
+    std::vector<std::pair<BasicBlock*, size_t>> stack = {{entry, 0}};
+    entry->order = 0;
+    while (!stack.empty()) {
+        BasicBlock* block = stack.back().first;
+        size_t& next = stack.back().second;
+        if (next < block->successors.size()) {
+            BasicBlock* succ = block->successors[next++];
+            if (succ->order < 0) {
+                succ->order = 0;
+                stack.push_back({succ, 0});
+            }
+        } else {
+            reverse_postorder.push_back(block);
+            stack.pop_back();
+        }
+    }
+    std::reverse(reverse_postorder.begin(), reverse_postorder.end());
+    for (size_t i = 0; i < reverse_postorder.size(); ++i) {
+        reverse_postorder[i]->order = static_cast<int>(i);
+    }
+    
+    auto intersect = [](BasicBlock* a, BasicBlock* b) {
+        while (a != b) {
+            while (a->order > b->order) a = a->idom;
+            while (b->order > a->order) b = b->idom;
+        }
+        return a;
+    };
+    
+    entry->idom = entry;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < reverse_postorder.size(); ++i) {
+            BasicBlock* block = reverse_postorder[i];
+            BasicBlock* new_idom = nullptr;
+            for (BasicBlock* pred : block->predecessors) {
+                if (!pred->idom) continue;
+                new_idom = new_idom ? intersect(pred, new_idom) : pred;
+            }
+            if (new_idom && block->idom != new_idom) {
+                block->idom = new_idom;
+                changed = true;
+            }
+        }
+    }
+    
+    for (size_t i = 1; i < reverse_postorder.size(); ++i) {
+        BasicBlock* block = reverse_postorder[i];
+        block->idom->dominated.push_back(block);
+    }
+    
+    // Dominance frontiers: walk up from each predecessor of a join point
+    for (BasicBlock* block : reverse_postorder) {
+        if (block->predecessors.size() < 2) continue;
+        for (BasicBlock* pred : block->predecessors) {
+            for (BasicBlock* runner = pred; runner != block->idom; runner = runner->idom) {
+                auto& frontier = runner->dominance_frontier;
+                if (std::find(frontier.begin(), frontier.end(), block) == frontier.end()) {
+                    frontier.push_back(block);
+                }
+            }
+        }
+    }
+}
+
+bool Function::dominates(const BasicBlock* a, const BasicBlock* b) const {
+    // Walk up the dominator tree from b; the entry is its own idom
+    while (true) {
+        if (a == b) return true;
+        if (!b->idom || b->idom == b) return false;
+        b = b->idom;
+    }
+}
+
+BasicBlock* Function::splitEdge(BasicBlock* from, BasicBlock* to) {
+    // A taken branch gets a new block at the end of the layout that jumps on
+    // to the target; a fallthrough edge gets one placed directly after 'from'
+    const Instruction* last = from->instructions.empty() ? nullptr : &from->instructions.back();
+    bool via_table = last && last->opcode == Instruction::JMPT;
+    bool via_branch = via_table || (last && last->isBranch() && last->label == to->labelSymbol());
+    
+    std::string label = newBlockLabel("edge");
+    BasicBlock* edge = via_branch ? createBlock(label) : insertBlockAfter(from, label);
+    Instruction label_instr(Instruction::LABEL);
+    label_instr.label = internSymbol(label);
+    edge->addInstruction(label_instr);
+    if (via_branch) {
+        Instruction jump(Instruction::JMP);
+        jump.label = to->labelSymbol();
+        edge->addInstruction(jump);
+        if (via_table) {
+            auto& targets = findJumpTable(from->instructions.back().label)->targets;
+            std::replace(targets.begin(), targets.end(), to->labelSymbol(), label_instr.label);
+        } else {
+            from->instructions.back().label = label_instr.label;
+        }
+    }
+    
+    std::replace(from->successors.begin(), from->successors.end(), to, edge);
+    std::replace(to->predecessors.begin(), to->predecessors.end(), from, edge);
+    edge->predecessors.push_back(from);
+    edge->successors.push_back(to);
+    for (auto& phi : to->phis) {
+        for (auto& incoming : phi.incoming) {
+            if (incoming.first == from) incoming.first = edge;
+        }
+    }
+    return edge;
+}
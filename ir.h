@@ -0,0 +1,258 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+// Forward declarations
+class Register;
+class Instruction;
+class BasicBlock;
+class Function;
+struct RegisterFile;
+
+// Virtual register number, local to its function (0 means "no register")
+struct VReg {
+    uint32_t id;
+
+    VReg() : id(0) {}
+    explicit VReg(uint32_t n) : id(n) {}
+
+    bool valid() const { return id != 0; }
+    explicit operator bool() const { return id != 0; }
+    bool operator==(const VReg& other) const { return id == other.id; }
+    bool operator!=(const VReg& other) const { return id != other.id; }
+};
+
+namespace std {
+template <> struct hash<VReg> {
+    size_t operator()(const VReg& reg) const { return std::hash<uint32_t>()(reg.id); }
+};
+}
+
+// Per-register information, stored by value in the owning function
+class Register {
+public:
+    enum Type {
+        GENERAL,    // General purpose register
+        FLOAT       // Floating point register
+    };
+
+    Type type;
+    std::string name;   // Source variable name, for listings only
+    int physical;       // Assigned machine register, -1 before allocation
+
+    Register(Type type = GENERAL, const std::string& name = "")
+        : type(type), name(name), physical(-1) {}
+};
+
+// Instruction representation: fixed size, operands stored inline
+class Instruction {
+public:
+    enum OpCode : uint8_t {
+        // Data movement (LOAD dest, base, #offset / STORE src, base, #offset;
+        // ADDR dest, object: address of a DataObject of the program)
+        MOV, LOAD, STORE, ADDR,
+
+        // Arithmetic
+        ADD, SUB, MUL, DIV, MOD,
+        FADD, FSUB, FMUL, FDIV,
+
+        // Conversion (CVTS2D widens the single-precision float in the low
+        // half of a float register to a double)
+        CVTI2F, CVTF2I, CVTS2D,
+
+        // Logical
+        AND, OR, XOR, NOT, SHL, SHR,
+
+        // Comparison
+        CMP, FCMP,
+
+        // Branching (JZ/JNZ reg, label: branch on a register being zero or
+        // not; JMPT index, table: indirect jump through a jump table)
+        JMP, JE, JNE, JL, JLE, JG, JGE, JZ, JNZ, JMPT,
+
+        // Function calls (CALL result, target). Once the calling convention
+        // is lowered, the immediate of a CALL is a mask of the argument
+        // registers it reads: bit i for argument_general[i] of the function's
+        // register file, bit 16 + i for argument_floating[i]. TAILCALL
+        // target leaves the frame and jumps to a function that returns
+        // straight to this function's caller; it carries the same mask.
+        CALL, RET, TAILCALL,
+
+        // Stack operations; the PUSHes directly before a CALL are its
+        // arguments, last argument first
+        PUSH, POP,
+
+        // Special
+        NOP, LABEL
+    };
+
+    static const int MAX_OPERANDS = 3;
+
+    OpCode opcode;
+    uint8_t num_operands;
+    bool has_immediate;
+    VReg operands[MAX_OPERANDS];    // Destination first for defining opcodes
+    int32_t immediate;
+    uint32_t label;                 // Symbol id in the owning function (labels, call targets), 0 if none
+
+    explicit Instruction(OpCode op = NOP)
+        : opcode(op), num_operands(0), has_immediate(false), immediate(0), label(0) {}
+
+    void addOperand(VReg reg) { operands[num_operands++] = reg; }
+    void setImmediate(int32_t value) { immediate = value; has_immediate = true; }
+
+    bool definesFirstOperand() const;
+    int firstUse() const { return definesFirstOperand() ? 1 : 0; }
+    bool isBranch() const { return opcode >= JMP && opcode <= JNZ; }
+    bool isConditionalBranch() const { return opcode > JMP && opcode <= JNZ; }
+    bool isTerminator() const { return isBranch() || opcode == JMPT || opcode == RET || opcode == TAILCALL; }
+    bool fallsThrough() const { return opcode != JMP && opcode != JMPT && opcode != RET && opcode != TAILCALL; }
+    std::string toString(const Function& func) const;
+    // Lines of the assembly listing. Once registers are assigned on x86-64,
+    // arithmetic is listed in the two-operand form the encoder emits.
+    std::vector<std::string> listing(const Function& func) const;
+};
+
+// SSA merge at the head of a block: one incoming value per predecessor
+struct Phi {
+    VReg dest;
+    VReg original;      // Pre-SSA register this phi merges versions of
+    std::vector<std::pair<BasicBlock*, VReg>> incoming;
+
+    Phi(VReg dest, VReg original) : dest(dest), original(original) {}
+};
+
+// Basic block for control flow; instructions are stored contiguously
+class BasicBlock {
+public:
+    std::string label;
+    std::vector<Instruction> instructions;
+    std::vector<BasicBlock*> successors;
+    std::vector<BasicBlock*> predecessors;
+    std::vector<Phi> phis;                  // Empty outside SSA form
+
+    // Dominator tree, filled in by Function::computeDominators
+    BasicBlock* idom;
+    std::vector<BasicBlock*> dominated;
+    std::vector<BasicBlock*> dominance_frontier;
+    int order;                              // Reverse postorder index
+
+    BasicBlock(const std::string& label) : label(label), idom(nullptr), order(-1) {}
+
+    void addInstruction(const Instruction& instr) { instructions.push_back(instr); }
+    void addSuccessor(BasicBlock* block);
+
+    // Symbol of the leading LABEL instruction, 0 for unlabeled blocks
+    uint32_t labelSymbol() const;
+    // Position at which code may be appended without passing the block's branch
+    size_t insertionPoint() const;
+    // Argument count of the CALL at index: the PUSHes directly before it
+    int callArgumentCount(size_t index) const;
+};
+
+// Runtime helpers without side effects whose result depends only on their
+// arguments; calls to them may be merged or removed like arithmetic
+bool isPureRuntimeHelper(const std::string& name);
+
+// Runtime helpers that never return, such as the failure path of assert;
+// code leading to a call to one of them is cold
+bool isNoReturnRuntimeHelper(const std::string& name);
+
+// Targets of a JMPT instruction, indexed by its zero-based operand
+struct JumpTable {
+    uint32_t symbol;                    // Table name, the JMPT label
+    std::vector<uint32_t> targets;      // Label symbols
+
+    JumpTable(uint32_t symbol) : symbol(symbol) {}
+};
+
+// Program data outside the code, named by ADDR instructions
+struct DataObject {
+    enum Section {
+        RODATA,     // Constants: string literals, float constants
+        DATA,       // Initialized variables
+        BSS         // Zero-initialized variables
+    };
+
+    std::string name;
+    Section section;
+    size_t alignment;
+    std::vector<uint8_t> bytes;         // All zero in BSS, where only the size is kept
+
+    // 8-byte fields of a read-only object holding the distance of a
+    // function's entry point from the start of the object, as in a vtable
+    struct FunctionEntry {
+        size_t offset;
+        std::string function;
+    };
+    std::vector<FunctionEntry> entries;
+
+    DataObject(const std::string& name, Section section, size_t alignment)
+        : name(name), section(section), alignment(alignment) {}
+};
+
+// Function representation
+class Function {
+public:
+    std::string name;
+    std::vector<std::unique_ptr<BasicBlock>> blocks;
+    std::vector<Register> registers;    // Indexed by VReg::id, entry 0 unused
+    std::vector<VReg> parameters;
+    VReg return_register;
+    std::vector<JumpTable> jump_tables;
+    int stack_size;                         // Bytes of spill slots below the frame pointer
+
+    // Execution counts from a profile keyed by label symbol, the entry under
+    // symbol 0; empty when the function was not profiled
+    std::unordered_map<uint32_t, uint64_t> profile_counts;
+
+    // Filled in by register allocation
+    const RegisterFile* register_file;
+    std::vector<int> saved_general;         // Callee-saved registers the function must preserve
+    std::vector<int> saved_floating;
+
+    Function(const std::string& name);
+
+    BasicBlock* createBlock(const std::string& label);
+    BasicBlock* getBlock(const std::string& label);
+
+    // Control flow graph. buildCFG splits the emitted instruction stream at
+    // labels and branches, wires the edges and drops unreachable blocks;
+    // both return the number of blocks dropped.
+    std::vector<BasicBlock*> reverse_postorder;
+    size_t buildCFG();
+    size_t removeUnreachableBlocks();
+    void computeDominators();
+    bool dominates(const BasicBlock* a, const BasicBlock* b) const;
+    BasicBlock* splitEdge(BasicBlock* from, BasicBlock* to);
+
+    // Register table
+    VReg newRegister(Register::Type type = Register::GENERAL, const std::string& reg_name = "");
+    Register& getRegister(VReg reg) { return registers[reg.id]; }
+    const Register& getRegister(VReg reg) const { return registers[reg.id]; }
+    size_t registerCount() const { return registers.size(); }
+    std::string registerName(VReg reg) const;
+
+    // Labels and call targets are interned so instructions stay trivially copyable
+    uint32_t internSymbol(const std::string& symbol);
+    const std::string& symbolName(uint32_t id) const { return symbols[id]; }
+    JumpTable* findJumpTable(uint32_t symbol);
+
+    // Registers pinned to one machine register by the calling convention,
+    // shared by every call site and created on first use
+    VReg fixedRegister(Register::Type type, int physical);
+    VReg findFixedRegister(Register::Type type, int physical) const;
+
+private:
+    std::vector<std::string> symbols;   // Entry 0 is the empty symbol
+    std::unordered_map<std::string, uint32_t> symbol_ids;
+    std::unordered_map<int, VReg> fixed_registers;  // Keyed by class and machine register
+    int next_block_id;
+
+    std::string newBlockLabel(const std::string& prefix);
+    BasicBlock* insertBlockAfter(BasicBlock* position, const std::string& label);
+};
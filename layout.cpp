@@ -0,0 +1,311 @@
+#include "layout.h"
+#include "loops.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+// Static estimates in the spirit of Ball and Larus: a loop branch stays in
+// the loop, and a path to a helper that does not return is all but never
+// taken
+static const double LOOP_PROBABILITY = 0.88;
+static const double COLD_PROBABILITY = 0.001;
+static const double LOOP_WEIGHT = 8.0;     // Iterations assumed per loop level
+
+// A CFG edge considered for chaining
+struct LayoutEdge {
+    size_t from;
+    size_t to;
+    double weight;
+    bool fallthrough;   // The original layout already placed 'to' after 'from'
+};
+
+static bool invertBranch(Instruction::OpCode opcode, Instruction::OpCode& inverted) {
+    switch (opcode) {
+        case Instruction::JE: inverted = Instruction::JNE; return true;
+        case Instruction::JNE: inverted = Instruction::JE; return true;
+        case Instruction::JL: inverted = Instruction::JGE; return true;
+        case Instruction::JGE: inverted = Instruction::JL; return true;
+        case Instruction::JLE: inverted = Instruction::JG; return true;
+        case Instruction::JG: inverted = Instruction::JLE; return true;
+        case Instruction::JZ: inverted = Instruction::JNZ; return true;
+        case Instruction::JNZ: inverted = Instruction::JZ; return true;
+        default: return false;
+    }
+}
+
+// After FCMP an unordered result fails every condition, so JL and JGE are
+// not each other's opposite
+static bool branchesOnFloatCompare(const BasicBlock* block) {
+    for (auto it = block->instructions.rbegin(); it != block->instructions.rend(); ++it) {
+        if (it->opcode == Instruction::FCMP) return true;
+        if (it->opcode == Instruction::CMP) return false;
+    }
+    return false;
+}
+
+static bool isCold(const Function& func, const BasicBlock* block) {
+    for (const auto& instr : block->instructions) {
+        if (instr.opcode == Instruction::CALL && instr.label && isNoReturnRuntimeHelper(func.symbolName(instr.label))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Symbol a jump to the block can use, giving it a LABEL when it has none
+static uint32_t jumpLabel(Function& func, BasicBlock* block) {
+    if (uint32_t symbol = block->labelSymbol()) return symbol;
+    Instruction label(Instruction::LABEL);
+    label.label = func.internSymbol(block->label);
+    block->instructions.insert(block->instructions.begin(), label);
+    return label.label;
+}
+
+// Profiled count of each block, or -1 where the profile has none. Blocks
+// the instrumented build did not have, such as preheaders and split edges,
+// take the count of an only predecessor or successor they cannot differ from.
+static std::vector<double> blockCounts(const Function& func, std::unordered_map<BasicBlock*, size_t>& index) {
+    size_t count = func.blocks.size();
+    std::vector<double> counts(count, -1.0);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t symbol = i == 0 ? 0 : func.blocks[i]->labelSymbol();
+        auto it = func.profile_counts.find(symbol);
+        if ((i == 0 || symbol) && it != func.profile_counts.end()) counts[i] = static_cast<double>(it->second);
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < count; ++i) {
+            const BasicBlock* block = func.blocks[i].get();
+            if (counts[i] >= 0.0) continue;
+            if (block->predecessors.size() == 1) {
+                size_t pred = index[block->predecessors[0]];
+                if (counts[pred] >= 0.0 && func.blocks[pred]->successors.size() == 1) {
+                    counts[i] = counts[pred];
+                    changed = true;
+                    continue;
+                }
+            }
+            if (block->successors.size() == 1) {
+                size_t succ = index[block->successors[0]];
+                if (counts[succ] >= 0.0 && func.blocks[succ]->predecessors.size() == 1) {
+                    counts[i] = counts[succ];
+                    changed = true;
+                }
+            }
+        }
+    }
+    return counts;
+}
+
+void placeBlocks(Function& func, LayoutStats& stats) {
+    func.buildCFG();
+    size_t count = func.blocks.size();
+    if (count < 3) return;
+    func.computeDominators();
+    std::vector<Loop> loops = findLoops(func);
+
+    std::unordered_map<BasicBlock*, size_t> index;
+    std::unordered_map<uint32_t, size_t> label_blocks;
+    for (size_t i = 0; i < count; ++i) {
+        index[func.blocks[i].get()] = i;
+        if (uint32_t symbol = func.blocks[i]->labelSymbol()) label_blocks[symbol] = i;
+    }
+
+    // How each block leaves in the original layout
+    const size_t NONE = count;
+    std::vector<size_t> taken(count, NONE), fallthrough(count, NONE);
+    std::vector<bool> cold(count, false);
+    for (size_t i = 0; i < count; ++i) {
+        const BasicBlock* block = func.blocks[i].get();
+        const Instruction* last = block->instructions.empty() ? nullptr : &block->instructions.back();
+        if (last && last->isBranch()) {
+            auto target = label_blocks.find(last->label);
+            if (target != label_blocks.end()) taken[i] = target->second;
+        }
+        if ((!last || last->fallsThrough()) && i + 1 < count) fallthrough[i] = i + 1;
+        cold[i] = isCold(func, block);
+    }
+
+    // A profile replaces the estimates: blocks that never ran are cold and
+    // an edge carries what its ends were measured to run
+    bool profiled = !func.profile_counts.empty();
+    std::vector<double> counts;
+    if (profiled) {
+        counts = blockCounts(func, index);
+        for (size_t i = 1; i < count; ++i) {
+            if (counts[i] == 0.0) cold[i] = true;
+        }
+        // What could not be derived runs as often as its busiest predecessor
+        for (BasicBlock* block : func.reverse_postorder) {
+            size_t i = index[block];
+            if (counts[i] >= 0.0) continue;
+            counts[i] = 0.0;
+            for (BasicBlock* pred : block->predecessors) counts[i] = std::max(counts[i], counts[index[pred]]);
+        }
+        stats.profiled_functions++;
+    }
+
+    // Loop nesting: depth per block, and the innermost loop for exits.
+    // findLoops lists inner loops first.
+    std::vector<int> depth(count, 0);
+    std::vector<const Loop*> innermost(count, nullptr);
+    for (const auto& loop : loops) {
+        for (BasicBlock* block : loop.blocks) {
+            size_t i = index[block];
+            depth[i]++;
+            if (!innermost[i]) innermost[i] = &loop;
+        }
+    }
+    auto isBackEdge = [&](size_t from, size_t to) {
+        for (const auto& loop : loops) {
+            if (loop.header == func.blocks[to].get() && loop.contains(func.blocks[from].get())) return true;
+        }
+        return false;
+    };
+    auto leavesLoop = [&](size_t from, size_t to) {
+        return innermost[from] && !innermost[from]->contains(func.blocks[to].get());
+    };
+
+    // Probability of leaving 'from' towards 'to'
+    auto probability = [&](size_t from, size_t to) {
+        const auto& successors = func.blocks[from]->successors;
+        if (successors.size() != 2) return 1.0 / static_cast<double>(successors.size());
+        size_t other = index[successors[0]] == to ? index[successors[1]] : index[successors[0]];
+        if (cold[to] != cold[other]) return cold[to] ? COLD_PROBABILITY : 1.0 - COLD_PROBABILITY;
+        bool back = isBackEdge(from, to);
+        if (back != isBackEdge(from, other)) return back ? LOOP_PROBABILITY : 1.0 - LOOP_PROBABILITY;
+        bool exits = leavesLoop(from, to);
+        if (exits != leavesLoop(from, other)) return exits ? 1.0 - LOOP_PROBABILITY : LOOP_PROBABILITY;
+        return 0.5;
+    };
+
+    // Measured count of an edge: a target entered only from here ran as
+    // often as the edge, and so did a branch's other side
+    auto profiledWeight = [&](size_t from, size_t to) {
+        const auto& successors = func.blocks[from]->successors;
+        if (successors.size() == 1) return counts[from];
+        if (func.blocks[to]->predecessors.size() == 1) return counts[to];
+        if (successors.size() == 2) {
+            size_t other = index[successors[0]] == to ? index[successors[1]] : index[successors[0]];
+            if (func.blocks[other]->predecessors.size() == 1) return std::max(0.0, counts[from] - counts[other]);
+        }
+        return counts[from] / static_cast<double>(successors.size());
+    };
+
+    std::vector<LayoutEdge> edges;
+    for (size_t i = 0; i < count; ++i) {
+        double frequency = std::pow(LOOP_WEIGHT, depth[i]) * (cold[i] ? COLD_PROBABILITY : 1.0);
+        for (BasicBlock* succ : func.blocks[i]->successors) {
+            size_t to = index[succ];
+            double weight = profiled ? profiledWeight(i, to) : frequency * probability(i, to);
+            edges.push_back({i, to, weight, fallthrough[i] == to});
+        }
+    }
+    // Heaviest first; on a tie the original fallthrough wins, then the original order
+    std::stable_sort(edges.begin(), edges.end(), [](const LayoutEdge& a, const LayoutEdge& b) {
+        if (a.weight != b.weight) return a.weight > b.weight;
+        return a.fallthrough && !b.fallthrough;
+    });
+
+    // Chain blocks along the edges: the tail of one chain may continue with
+    // the head of another. The entry stays a chain head, and hot and cold
+    // blocks never share a chain.
+    std::vector<std::vector<size_t>> chains(count);
+    std::vector<size_t> chain_of(count);
+    for (size_t i = 0; i < count; ++i) {
+        chains[i] = {i};
+        chain_of[i] = i;
+    }
+    for (const auto& edge : edges) {
+        size_t from_chain = chain_of[edge.from];
+        size_t to_chain = chain_of[edge.to];
+        if (from_chain == to_chain || edge.to == 0 || cold[edge.from] != cold[edge.to]) continue;
+        if (chains[from_chain].back() != edge.from || chains[to_chain].front() != edge.to) continue;
+        for (size_t block : chains[to_chain]) {
+            chains[from_chain].push_back(block);
+            chain_of[block] = from_chain;
+        }
+        chains[to_chain].clear();
+    }
+
+    // Place the entry chain, then repeatedly the hot chain most strongly
+    // entered from what is placed; unconnected chains keep their original
+    // order and cold chains go last
+    std::vector<size_t> order;
+    std::vector<bool> placed(count, false);
+    auto place = [&](size_t chain) {
+        for (size_t block : chains[chain]) {
+            order.push_back(block);
+            placed[block] = true;
+        }
+    };
+    place(chain_of[0]);
+    while (order.size() < count) {
+        size_t best = NONE;
+        double best_weight = -1.0;
+        for (const auto& edge : edges) {
+            if (placed[edge.from] && !placed[edge.to] && !cold[edge.to] && edge.weight > best_weight) {
+                best = chain_of[edge.to];
+                best_weight = edge.weight;
+            }
+        }
+        for (size_t i = 0; best == NONE && i < count; ++i) {
+            if (!placed[i] && !cold[i]) best = chain_of[i];
+        }
+        for (size_t i = 0; best == NONE && i < count; ++i) {
+            if (!placed[i]) {
+                best = chain_of[i];
+                stats.cold_blocks += chains[best].size();
+            }
+        }
+        place(best);
+    }
+
+    // Make every block leave towards its successors under the new order
+    for (size_t p = 0; p < count; ++p) {
+        size_t i = order[p];
+        size_t next = p + 1 < count ? order[p + 1] : NONE;
+        auto& code = func.blocks[i]->instructions;
+        Instruction* last = code.empty() ? nullptr : &code.back();
+
+        if (last && last->opcode == Instruction::JMP) {
+            if (taken[i] != NONE && taken[i] == next) {
+                code.pop_back();
+                stats.removed_jumps++;
+            }
+            continue;
+        }
+        if (fallthrough[i] == NONE || fallthrough[i] == next) continue;
+
+        Instruction::OpCode inverted;
+        if (last && last->isConditionalBranch() && taken[i] == next &&
+            !branchesOnFloatCompare(func.blocks[i].get()) && invertBranch(last->opcode, inverted)) {
+            last->opcode = inverted;
+            last->label = jumpLabel(func, func.blocks[fallthrough[i]].get());
+            stats.inverted_branches++;
+            continue;
+        }
+        Instruction jump(Instruction::JMP);
+        jump.label = jumpLabel(func, func.blocks[fallthrough[i]].get());
+        code.push_back(jump);
+        stats.added_jumps++;
+    }
+
+    for (const auto& loop : loops) {
+        size_t header = index[loop.header];
+        for (size_t p = 0; p < count && order[p] != header; ++p) {
+            if (loop.contains(func.blocks[order[p]].get())) {
+                stats.rotated_loops++;
+                break;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<BasicBlock>> reordered;
+    for (size_t i : order) reordered.push_back(std::move(func.blocks[i]));
+    func.blocks = std::move(reordered);
+    func.buildCFG();
+    func.computeDominators();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "ir.h"
+
+// Counters reported by block placement
+struct LayoutStats {
+    size_t rotated_loops;       // Loops whose condition ended up below their body
+    size_t inverted_branches;   // Conditional branches flipped so the likely successor falls through
+    size_t removed_jumps;       // Unconditional jumps to the block placed right after them
+    size_t added_jumps;         // Jumps needed where a fallthrough successor moved away
+    size_t cold_blocks;         // Blocks on a path to a helper that does not return or that never ran, moved to the end
+    size_t profiled_functions;  // Functions laid out from profile counts rather than estimates
+
+    LayoutStats() : rotated_loops(0), inverted_branches(0), removed_jumps(0), added_jumps(0), cold_blocks(0),
+                    profiled_functions(0) {}
+};
+
+// Reorders the blocks of a function out of SSA form so that likely
+// successors fall through. Edges are weighted by static estimates: loop
+// back edges are taken, loop exits are not, and a block that ends in a
+// call to a helper that does not return (an assert failure) is cold.
+// Blocks are chained greedily along the heaviest edges, the chains are
+// placed starting with the entry, and cold chains go last. A while loop
+// comes out rotated, with its condition at the bottom branching back to
+// the body. Branches are then inverted, dropped or added to match the new
+// order, and the CFG is rebuilt. A function with profile counts uses the
+// measured edge counts instead, and its blocks that never ran are cold.
+void placeBlocks(Function& func, LayoutStats& stats);
@@ -0,0 +1,91 @@
+#include "liveness.h"
+#include "target.h"
+
+void Liveness::collectUses(const Function& func, const Instruction& instr, std::vector<VReg>& uses) {
+    uses.clear();
+    for (int i = instr.firstUse(); i < instr.num_operands; ++i) {
+        if (instr.operands[i]) uses.push_back(instr.operands[i]);
+    }
+    if (instr.opcode == Instruction::RET && func.return_register) {
+        uses.push_back(func.return_register);
+    }
+    if ((instr.opcode == Instruction::CALL || instr.opcode == Instruction::TAILCALL) &&
+        instr.has_immediate && func.register_file) {
+        // Argument registers named by the call's mask
+        const RegisterFile& file = *func.register_file;
+        for (size_t i = 0; i < file.argument_general.size(); ++i) {
+            if (instr.immediate & (1 << i)) {
+                uses.push_back(func.findFixedRegister(Register::GENERAL, file.argument_general[i]));
+            }
+        }
+        for (size_t i = 0; i < file.argument_floating.size(); ++i) {
+            if (instr.immediate & (1 << (16 + i))) {
+                uses.push_back(func.findFixedRegister(Register::FLOAT, file.argument_floating[i]));
+            }
+        }
+    }
+}
+
+Liveness::Liveness(const Function& func) {
+    size_t block_count = func.blocks.size();
+    size_t reg_count = func.registerCount();
+    for (size_t i = 0; i < block_count; ++i) {
+        block_index[func.blocks[i].get()] = i;
+    }
+
+    // Upward-exposed uses and definitions of each block
+    std::vector<std::vector<bool>> uses(block_count, std::vector<bool>(reg_count, false));
+    std::vector<std::vector<bool>> defs(block_count, std::vector<bool>(reg_count, false));
+    std::vector<VReg> instr_uses;
+    for (size_t b = 0; b < block_count; ++b) {
+        const BasicBlock* block = func.blocks[b].get();
+        for (const auto& phi : block->phis) {
+            defs[b][phi.dest.id] = true;
+        }
+        for (const auto& instr : block->instructions) {
+            collectUses(func, instr, instr_uses);
+            for (VReg reg : instr_uses) {
+                if (!defs[b][reg.id]) uses[b][reg.id] = true;
+            }
+            if (instr.definesFirstOperand() && instr.operands[0]) {
+                defs[b][instr.operands[0].id] = true;
+            }
+        }
+    }
+
+    live_in.assign(block_count, std::vector<bool>(reg_count, false));
+    live_out.assign(block_count, std::vector<bool>(reg_count, false));
+
+    // Iterate to a fixpoint, visiting blocks back to front so most values
+    // propagate in a single sweep
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = block_count; b-- > 0;) {
+            const BasicBlock* block = func.blocks[b].get();
+            std::vector<bool> out(reg_count, false);
+            for (const BasicBlock* succ : block->successors) {
+                const std::vector<bool>& succ_in = live_in[index(succ)];
+                for (size_t r = 0; r < reg_count; ++r) {
+                    if (succ_in[r]) out[r] = true;
+                }
+                for (const auto& phi : succ->phis) {
+                    for (const auto& incoming : phi.incoming) {
+                        if (incoming.first == block && incoming.second) out[incoming.second.id] = true;
+                    }
+                }
+            }
+
+            std::vector<bool> in = uses[b];
+            for (size_t r = 0; r < reg_count; ++r) {
+                if (out[r] && !defs[b][r]) in[r] = true;
+            }
+
+            if (out != live_out[b] || in != live_in[b]) {
+                live_out[b] = std::move(out);
+                live_in[b] = std::move(in);
+                changed = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "ir.h"
+#include <unordered_map>
+#include <vector>
+
+// Backward dataflow liveness over a function's CFG. Works both in and out of
+// SSA form: phi results are defined at the head of their block and phi
+// operands are used at the end of the matching predecessor.
+class Liveness {
+public:
+    explicit Liveness(const Function& func);
+
+    const std::vector<bool>& liveIn(const BasicBlock* block) const { return live_in[index(block)]; }
+    const std::vector<bool>& liveOut(const BasicBlock* block) const { return live_out[index(block)]; }
+    bool isLiveOut(const BasicBlock* block, VReg reg) const { return live_out[index(block)][reg.id]; }
+
+    // Registers read by an instruction, including the implicit reads of the
+    // return register by RET and of argument registers by a lowered CALL
+    static void collectUses(const Function& func, const Instruction& instr, std::vector<VReg>& uses);
+
+private:
+    std::unordered_map<const BasicBlock*, size_t> block_index;
+    std::vector<std::vector<bool>> live_in;
+    std::vector<std::vector<bool>> live_out;
+
+    size_t index(const BasicBlock* block) const { return block_index.at(block); }
+};
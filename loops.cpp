@@ -0,0 +1,390 @@
+#include "loops.h"
+#include <algorithm>
+#include <unordered_map>
+
+std::vector<Loop> findLoops(const Function& func) {
+    std::vector<Loop> loops;
+    std::unordered_map<BasicBlock*, size_t> loop_of_header;
+
+    // An edge to a block that dominates its source closes a loop
+    for (BasicBlock* block : func.reverse_postorder) {
+        for (BasicBlock* header : block->successors) {
+            if (!func.dominates(header, block)) continue;
+
+            auto it = loop_of_header.find(header);
+            if (it == loop_of_header.end()) {
+                it = loop_of_header.emplace(header, loops.size()).first;
+                loops.emplace_back(header);
+                loops.back().body.insert(header);
+            }
+            Loop& loop = loops[it->second];
+            loop.latches.push_back(block);
+
+            std::vector<BasicBlock*> worklist;
+            if (loop.body.insert(block).second) worklist.push_back(block);
+            while (!worklist.empty()) {
+                BasicBlock* current = worklist.back();
+                worklist.pop_back();
+                for (BasicBlock* pred : current->predecessors) {
+                    if (loop.body.insert(pred).second) worklist.push_back(pred);
+                }
+            }
+        }
+    }
+
+    for (auto& loop : loops) {
+        for (BasicBlock* block : func.reverse_postorder) {
+            if (loop.contains(block)) loop.blocks.push_back(block);
+        }
+    }
+    std::stable_sort(loops.begin(), loops.end(),
+        [](const Loop& a, const Loop& b) { return a.body.size() < b.body.size(); });
+    return loops;
+}
+
+namespace {
+
+// Where each value is defined and which values are known constants. Kept
+// up to date as instructions move and new values are created.
+struct ValueSites {
+    std::vector<BasicBlock*> def_block;     // Null for values live into the function
+    std::vector<char> is_constant;
+    std::vector<int32_t> constant;
+
+    explicit ValueSites(const Function& func)
+        : def_block(func.registerCount(), nullptr), is_constant(func.registerCount(), 0),
+          constant(func.registerCount(), 0) {
+        for (const auto& block : func.blocks) {
+            for (const auto& phi : block->phis) {
+                def_block[phi.dest.id] = block.get();
+            }
+            for (const auto& instr : block->instructions) {
+                if (!instr.definesFirstOperand()) continue;
+                define(instr.operands[0], block.get());
+                if (instr.opcode == Instruction::MOV && instr.num_operands == 1 && instr.has_immediate) {
+                    is_constant[instr.operands[0].id] = 1;
+                    constant[instr.operands[0].id] = instr.immediate;
+                }
+            }
+        }
+    }
+
+    void define(VReg reg, BasicBlock* block) {
+        if (reg.id >= def_block.size()) {
+            def_block.resize(reg.id + 1, nullptr);
+            is_constant.resize(reg.id + 1, 0);
+            constant.resize(reg.id + 1, 0);
+        }
+        def_block[reg.id] = block;
+    }
+};
+
+struct CodeInserter {
+    Function& func;
+    BasicBlock* block;
+    size_t position;
+    ValueSites& sites;
+
+    VReg emit(Instruction::OpCode opcode, VReg a, VReg b) {
+        VReg dest = func.newRegister(Register::GENERAL);
+        Instruction instr(opcode);
+        instr.addOperand(dest);
+        instr.addOperand(a);
+        instr.addOperand(b);
+        insert(instr);
+        return dest;
+    }
+
+    VReg constant(int64_t value) {
+        VReg dest = func.newRegister(Register::GENERAL);
+        Instruction instr(Instruction::MOV);
+        instr.addOperand(dest);
+        instr.setImmediate(static_cast<int32_t>(value));
+        insert(instr);
+        sites.is_constant[dest.id] = 1;
+        sites.constant[dest.id] = instr.immediate;
+        return dest;
+    }
+
+    void insert(const Instruction& instr) {
+        block->instructions.insert(block->instructions.begin() + position++, instr);
+        sites.define(instr.operands[0], block);
+    }
+};
+
+} // namespace
+
+static bool fitsImmediate(int64_t value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+// Pure instructions that may execute even on iterations that would have
+// skipped them. Integer division is left in place since it can trap.
+static bool isHoistable(const Instruction& instr, bool memory_invariant) {
+    if (!instr.definesFirstOperand()) return false;
+    switch (instr.opcode) {
+        case Instruction::MOV: case Instruction::ADDR:
+        case Instruction::ADD: case Instruction::SUB: case Instruction::MUL:
+        case Instruction::FADD: case Instruction::FSUB: case Instruction::FMUL: case Instruction::FDIV:
+        case Instruction::CVTI2F: case Instruction::CVTF2I: case Instruction::CVTS2D:
+        case Instruction::AND: case Instruction::OR: case Instruction::XOR: case Instruction::NOT:
+        case Instruction::SHL: case Instruction::SHR:
+            return true;
+        case Instruction::LOAD:
+            return memory_invariant;
+        default:
+            return false;
+    }
+}
+
+static bool writesMemory(const Function& func, const Loop& loop) {
+    for (BasicBlock* block : loop.blocks) {
+        for (const auto& instr : block->instructions) {
+            if (instr.opcode == Instruction::STORE) return true;
+            if (instr.opcode == Instruction::CALL &&
+                !(instr.label && isPureRuntimeHelper(func.symbolName(instr.label)))) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// A block that dominates every exit runs each time the loop is entered,
+// before the loop can be left, so a load there does not fault where the
+// original program would not. Loops that are never left do not qualify.
+static bool runsOnEntry(const Function& func, const Loop& loop, BasicBlock* block) {
+    bool exits = false;
+    for (BasicBlock* candidate : loop.blocks) {
+        for (BasicBlock* succ : candidate->successors) {
+            if (loop.contains(succ)) continue;
+            if (!func.dominates(block, candidate)) return false;
+            exits = true;
+        }
+    }
+    return exits;
+}
+
+// Gives the loop a block that runs once right before the header. An entry
+// block ending in a conditional branch gets the edge split instead.
+static bool ensurePreheader(Function& func, Loop& loop, std::vector<Loop>& loops, LoopStats& stats) {
+    BasicBlock* entry = nullptr;
+    for (BasicBlock* pred : loop.header->predecessors) {
+        if (loop.contains(pred)) continue;
+        if (entry) return false;
+        entry = pred;
+    }
+    if (!entry) return false;
+
+    bool branches = !entry->instructions.empty() && entry->instructions.back().isConditionalBranch();
+    if (entry->successors.size() == 1) {
+        if (branches) return false;
+        loop.preheader = entry;
+        return true;
+    }
+
+    BasicBlock* preheader = func.splitEdge(entry, loop.header);
+    stats.preheaders++;
+    for (Loop& outer : loops) {
+        if (&outer == &loop || !outer.contains(entry) || !outer.contains(loop.header)) continue;
+        outer.body.insert(preheader);
+        outer.blocks.insert(std::find(outer.blocks.begin(), outer.blocks.end(), loop.header), preheader);
+    }
+    loop.preheader = preheader;
+    return true;
+}
+
+static void hoistInvariants(Function& func, Loop& loop, ValueSites& sites, LoopStats& stats) {
+    bool memory_invariant = !writesMemory(func, loop);
+    auto invariant = [&](VReg reg) {
+        return reg != func.return_register && !loop.contains(sites.def_block[reg.id]);
+    };
+
+    // Hoisting a definition can make its users invariant, so sweep until
+    // nothing moves
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (BasicBlock* block : loop.blocks) {
+            auto& instructions = block->instructions;
+            for (size_t i = 0; i < instructions.size();) {
+                const Instruction& instr = instructions[i];
+                bool movable = isHoistable(instr, memory_invariant) && instr.operands[0] != func.return_register;
+                if (movable && instr.opcode == Instruction::LOAD) {
+                    movable = runsOnEntry(func, loop, block);
+                }
+                for (int j = instr.firstUse(); movable && j < instr.num_operands; ++j) {
+                    movable = invariant(instr.operands[j]);
+                }
+                if (!movable) {
+                    ++i;
+                    continue;
+                }
+
+                CodeInserter{func, loop.preheader, loop.preheader->insertionPoint(), sites}.insert(instr);
+                instructions.erase(instructions.begin() + i);
+                stats.hoisted++;
+                changed = true;
+            }
+        }
+    }
+}
+
+// Recognizes 'next = i + c' or 'next = i - c' for a constant c
+static bool inductionStep(const Instruction& instr, VReg phi, const ValueSites& sites, int64_t& step) {
+    if (instr.opcode != Instruction::ADD && instr.opcode != Instruction::SUB) return false;
+    int64_t sign = instr.opcode == Instruction::SUB ? -1 : 1;
+    if (instr.num_operands == 2 && instr.has_immediate) {
+        if (instr.operands[1] != phi) return false;
+        step = sign * instr.immediate;
+        return true;
+    }
+    if (instr.num_operands != 3) return false;
+    VReg other;
+    if (instr.operands[1] == phi) other = instr.operands[2];
+    else if (instr.operands[2] == phi && instr.opcode == Instruction::ADD) other = instr.operands[1];
+    else return false;
+    if (!sites.is_constant[other.id]) return false;
+    step = sign * sites.constant[other.id];
+    return true;
+}
+
+static bool findDefinition(const Loop& loop, VReg reg, BasicBlock*& block, size_t& index) {
+    for (BasicBlock* candidate : loop.blocks) {
+        for (size_t i = 0; i < candidate->instructions.size(); ++i) {
+            const Instruction& instr = candidate->instructions[i];
+            if (instr.definesFirstOperand() && instr.operands[0] == reg) {
+                block = candidate;
+                index = i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void replaceUses(Function& func, VReg from, VReg to) {
+    for (auto& block : func.blocks) {
+        for (auto& phi : block->phis) {
+            for (auto& incoming : phi.incoming) {
+                if (incoming.second == from) incoming.second = to;
+            }
+        }
+        for (auto& instr : block->instructions) {
+            for (int j = instr.firstUse(); j < instr.num_operands; ++j) {
+                if (instr.operands[j] == from) instr.operands[j] = to;
+            }
+        }
+    }
+}
+
+// A product of a multiplier and the induction variable i
+struct ScaledInduction {
+    VReg product;
+    VReg multiplier;        // Invalid when the multiplier is an immediate
+    int32_t immediate;
+};
+
+static void reduceStrength(Function& func, Loop& loop, ValueSites& sites, LoopStats& stats) {
+    if (loop.latches.size() != 1) return;
+    BasicBlock* latch = loop.latches.front();
+    auto invariant = [&](VReg reg) {
+        return reg != func.return_register && !loop.contains(sites.def_block[reg.id]);
+    };
+
+    size_t phi_count = loop.header->phis.size();
+    for (size_t p = 0; p < phi_count; ++p) {
+        const Phi phi = loop.header->phis[p];
+        if (func.getRegister(phi.dest).type != Register::GENERAL) continue;
+
+        VReg init, next;
+        for (const auto& incoming : phi.incoming) {
+            if (incoming.first == loop.preheader) init = incoming.second;
+            else if (incoming.first == latch) next = incoming.second;
+        }
+        BasicBlock* step_block;
+        size_t step_index;
+        int64_t step;
+        if (!init || !next || !findDefinition(loop, next, step_block, step_index) ||
+            !inductionStep(step_block->instructions[step_index], phi.dest, sites, step)) {
+            continue;
+        }
+
+        std::vector<ScaledInduction> candidates;
+        for (BasicBlock* block : loop.blocks) {
+            for (const auto& instr : block->instructions) {
+                if (instr.opcode != Instruction::MUL || func.getRegister(instr.operands[0]).type != Register::GENERAL) {
+                    continue;
+                }
+                if (instr.num_operands == 2 && instr.has_immediate && instr.operands[1] == phi.dest) {
+                    candidates.push_back({instr.operands[0], VReg(), instr.immediate});
+                } else if (instr.num_operands == 3) {
+                    VReg a = instr.operands[1], b = instr.operands[2];
+                    if (a == phi.dest && b != phi.dest && invariant(b)) candidates.push_back({instr.operands[0], b, 0});
+                    else if (b == phi.dest && a != phi.dest && invariant(a)) candidates.push_back({instr.operands[0], a, 0});
+                }
+            }
+        }
+
+        for (const auto& candidate : candidates) {
+            // Start value and per-iteration increment, computed once before the loop
+            CodeInserter before{func, loop.preheader, loop.preheader->insertionPoint(), sites};
+            bool known = !candidate.multiplier || sites.is_constant[candidate.multiplier.id];
+            int64_t factor = candidate.multiplier ? sites.constant[candidate.multiplier.id] : candidate.immediate;
+            VReg multiplier = candidate.multiplier ? candidate.multiplier : before.constant(factor);
+
+            VReg start;
+            if (known && sites.is_constant[init.id] && fitsImmediate(factor * sites.constant[init.id])) {
+                start = before.constant(factor * sites.constant[init.id]);
+            } else {
+                start = before.emit(Instruction::MUL, init, multiplier);
+            }
+            VReg increment;
+            if (known && fitsImmediate(factor * step)) {
+                increment = before.constant(factor * step);
+            } else {
+                increment = before.emit(Instruction::MUL, before.constant(step), multiplier);
+            }
+
+            // The new variable advances right where i does, so it equals
+            // i * multiplier everywhere i is read
+            VReg scaled = func.newRegister(Register::GENERAL, func.getRegister(candidate.product).name);
+            findDefinition(loop, next, step_block, step_index);
+            VReg advanced = CodeInserter{func, step_block, step_index + 1, sites}
+                .emit(Instruction::ADD, scaled, increment);
+
+            Phi merged(scaled, scaled);
+            for (const auto& incoming : phi.incoming) {
+                merged.incoming.push_back({incoming.first, incoming.first == latch ? advanced : start});
+            }
+            loop.header->phis.push_back(merged);
+            sites.define(scaled, loop.header);
+
+            BasicBlock* product_block;
+            size_t product_index;
+            if (findDefinition(loop, candidate.product, product_block, product_index)) {
+                product_block->instructions.erase(product_block->instructions.begin() + product_index);
+            }
+            replaceUses(func, candidate.product, scaled);
+            stats.reduced++;
+        }
+    }
+}
+
+void optimizeLoops(Function& func, LoopStats& stats) {
+    std::vector<Loop> loops = findLoops(func);
+    if (loops.empty()) return;
+
+    ValueSites sites(func);
+    size_t preheaders = stats.preheaders;
+    for (auto& loop : loops) {
+        stats.loops++;
+        if (!ensurePreheader(func, loop, loops, stats)) continue;
+        hoistInvariants(func, loop, sites, stats);
+        reduceStrength(func, loop, sites, stats);
+    }
+
+    if (stats.preheaders != preheaders) {
+        func.computeDominators();
+    }
+}
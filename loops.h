@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ir.h"
+#include <unordered_set>
+#include <vector>
+
+// Counters reported by loop optimization
+struct LoopStats {
+    size_t loops;           // Natural loops found
+    size_t preheaders;      // Preheader blocks created on the loop entry edge
+    size_t hoisted;         // Invariant instructions moved to a preheader
+    size_t reduced;         // Multiplications by an induction variable turned into additions
+
+    LoopStats() : loops(0), preheaders(0), hoisted(0), reduced(0) {}
+};
+
+// Natural loop: the header and every block that reaches a back edge to it
+// without passing through the header
+struct Loop {
+    BasicBlock* header;
+    BasicBlock* preheader;                  // Sole entry from outside, null until created
+    std::vector<BasicBlock*> latches;       // Sources of the back edges
+    std::vector<BasicBlock*> blocks;        // In reverse postorder
+    std::unordered_set<BasicBlock*> body;
+
+    explicit Loop(BasicBlock* header) : header(header), preheader(nullptr) {}
+    bool contains(BasicBlock* block) const { return body.count(block) != 0; }
+};
+
+// Finds the natural loops of a function whose dominators are computed.
+// Loops sharing a header are merged; inner loops come before outer ones.
+std::vector<Loop> findLoops(const Function& func);
+
+// Loop-invariant code motion and induction-variable strength reduction on
+// a function in SSA form. Pure instructions whose operands are all defined
+// outside a loop move to its preheader; loads move only out of loops that
+// neither store nor call into code that may write memory, and only from
+// blocks that run whenever the loop is entered. A product of a
+// basic induction variable and an invariant becomes a new induction
+// variable advanced by addition on the back edge. Dominators are
+// recomputed when preheaders are inserted.
+void optimizeLoops(Function& func, LoopStats& stats);
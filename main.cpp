@@ -3,16 +3,29 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <cstdlib>
 #include "lexer.h"
 #include "parser.h"
 #include "semantic_analyzer.h"
 #include "code_generator.h"
 
+// Optional compiler behaviour selected on the command line
+struct CompileOptions {
+    bool print_stats;   // Report analysis and optimization statistics
+    AllocatorKind register_allocator;
+    InlineOptions inlining;
+    bool profile_generate;  // Count blocks at run time for a later --profile-use
+    std::string profile_use;    // Counts recorded by an instrumented build
+    
+    CompileOptions() : print_stats(false), register_allocator(AllocatorKind::LINEAR_SCAN), profile_generate(false) {}
+};
+
 class GDScriptCompiler {
 public:
     bool compile(const std::string& source_file, const std::string& output_file, 
                 TargetPlatform platform = TargetPlatform::MACOS_X64, 
-                OutputFormat format = OutputFormat::OBJECT) {
+                OutputFormat format = OutputFormat::OBJECT,
+                const CompileOptions& options = CompileOptions()) {
         try {
             // Read source file
             std::ifstream file(source_file);
@@ -58,9 +71,30 @@ public:
                 return false;
             }
             
+            if (options.print_stats) {
+                const InferenceStats& stats = analyzer.getInferenceStats();
+                std::cout << "Type inference: locals " << stats.declared_locals << " declared, "
+                          << stats.inferred_locals << " inferred, " << stats.variant_locals << " left Variant; "
+                          << "parameters " << stats.declared_parameters << " declared, "
+                          << stats.inferred_parameters << " inferred, " << stats.variant_parameters
+                          << " left Variant" << std::endl;
+            }
+            
             // Code Generation
             std::cout << "[4/4] Code Generation..." << std::endl;
             CodeGenerator generator(platform, format);
+            generator.setAllocatorKind(options.register_allocator);
+            generator.setInlineOptions(options.inlining);
+            generator.setProfileGeneration(options.profile_generate);
+            if (!options.profile_use.empty()) {
+                ProfileData profile;
+                std::string error;
+                if (!readProfile(options.profile_use, profile, error)) {
+                    std::cerr << "Error: " << error << std::endl;
+                    return false;
+                }
+                generator.setProfile(profile);
+            }
             generator.generate(ast.get(), output_file, &analyzer);
             
             if (generator.hasErrors()) {
@@ -68,6 +102,93 @@ public:
                 return false;
             }
             
+            if (options.print_stats) {
+                const ProfileStats& profile = generator.getProfileStats();
+                if (options.profile_generate) {
+                    std::cout << "Profile: " << profile.counters << " counters inserted" << std::endl;
+                }
+                if (!options.profile_use.empty()) {
+                    std::cout << "Profile: " << profile.blocks << " blocks in " << profile.functions
+                              << " functions given counts; " << profile.moved_arms
+                              << " match arms moved ahead" << std::endl;
+                }
+                
+                const InlineStats& inlined = generator.getInlineStats();
+                std::cout << "Inlining: " << inlined.inlined << " call sites inlined, "
+                          << inlined.instructions << " instructions copied; "
+                          << inlined.recursive << " recursive functions left alone";
+                if (!options.profile_use.empty()) {
+                    std::cout << "; " << inlined.hot << " hot sites inlined past the size limit, "
+                              << inlined.cold << " sites that never ran left alone";
+                }
+                std::cout << std::endl;
+                
+                const SSAStats& ssa = generator.getSSAStats();
+                std::cout << "SSA: " << ssa.blocks << " blocks, " << ssa.phis << " phis; "
+                          << ssa.split_edges << " critical edges split and "
+                          << ssa.copies << " copies inserted leaving SSA" << std::endl;
+                
+                const GVNStats& gvn = generator.getGVNStats();
+                std::cout << "Value numbering: " << gvn.expressions << " expressions, " << gvn.loads << " loads, "
+                          << gvn.calls << " helper calls and " << gvn.phis << " phis eliminated; "
+                          << gvn.copies << " copies propagated" << std::endl;
+                
+                const LoopStats& loops = generator.getLoopStats();
+                std::cout << "Loops: " << loops.loops << " found, " << loops.preheaders << " preheaders inserted; "
+                          << loops.hoisted << " invariant instructions hoisted, "
+                          << loops.reduced << " multiplications strength-reduced" << std::endl;
+                
+                const DCEStats& dce = generator.getDCEStats();
+                std::cout << "Dead code: " << dce.instructions << " instructions, " << dce.calls << " helper calls, "
+                          << dce.phis << " phis and " << dce.unreachable_blocks << " unreachable blocks removed in "
+                          << dce.passes << " passes" << std::endl;
+                
+                const LayoutStats& layout = generator.getLayoutStats();
+                std::cout << "Block layout: " << layout.rotated_loops << " loops rotated, "
+                          << layout.inverted_branches << " branches inverted, " << layout.removed_jumps
+                          << " jumps removed, " << layout.added_jumps << " added; "
+                          << layout.cold_blocks << " cold blocks moved to the end; "
+                          << layout.profiled_functions << " functions laid out from the profile" << std::endl;
+                
+                const CallStats& calls = generator.getCallStats();
+                std::cout << "Calls: " << calls.calls << " call sites lowered; " << calls.register_arguments
+                          << " arguments in registers, " << calls.stack_arguments << " on the stack; "
+                          << calls.parameters << " parameters received; " << calls.tail_calls
+                          << " tail calls as jumps, " << calls.tail_recursion << " self tail calls as loops" << std::endl;
+                
+                const AllocationStats& alloc = generator.getAllocationStats();
+                std::cout << "Register allocation ("
+                          << (options.register_allocator == AllocatorKind::GRAPH_COLORING ? "graph coloring" : "linear scan")
+                          << "): " << alloc.values << " values, " << alloc.spilled << " spilled ("
+                          << alloc.reloads << " reloads, " << alloc.spill_stores << " stores), "
+                          << alloc.coalesced_moves << " moves coalesced, "
+                          << alloc.callee_saved << " callee-saved registers used" << std::endl;
+                
+                const PeepholeStats& peephole = generator.getPeepholeStats();
+                const std::vector<PeepholeRule>& rules = peepholeRules();
+                size_t rewrites = 0;
+                std::string hits;
+                for (size_t i = 0; i < rules.size(); ++i) {
+                    if (peephole.hits[i] == 0) continue;
+                    rewrites += peephole.hits[i];
+                    hits += (hits.empty() ? " (" : ", ") + std::string(rules[i].name) + " " + std::to_string(peephole.hits[i]);
+                }
+                std::cout << "Peephole: " << rewrites << " rewrites" << (hits.empty() ? "" : hits + ")") << std::endl;
+                
+                const AssemblerStats& assembler = generator.getAssemblerStats();
+                if (assembler.passes > 0) {
+                    std::cout << "Assembler: " << assembler.short_branches << " short and "
+                              << assembler.long_branches << " long branches after "
+                              << assembler.passes << " layout passes" << std::endl;
+                }
+                
+                const ObjectStats& object = generator.getObjectStats();
+                if (object.symbols > 0) {
+                    std::cout << "ELF object: " << object.symbols << " symbols, "
+                              << object.relocations << " relocations" << std::endl;
+                }
+            }
+            
             std::cout << "Compilation successful! Output: " << output_file << std::endl;
             return true;
             
@@ -100,6 +221,11 @@ void printUsage(const char* program_name) {
     std::cout << "\nOptions:" << std::endl;
     std::cout << "  --platform <target>    Target platform (windows, macos, macos-arm, linux, linux-arm)" << std::endl;
     std::cout << "  --format <format>      Output format (assembly, object, executable)" << std::endl;
+    std::cout << "  --regalloc <kind>      Register allocator (linear, coloring)" << std::endl;
+    std::cout << "  --inline-threshold <n> Inline callees of up to n instructions, 0 to disable" << std::endl;
+    std::cout << "  --profile-generate     Count block executions; the program writes them to gdscript.profile" << std::endl;
+    std::cout << "  --profile-use <file>   Optimize for the counts an instrumented build wrote" << std::endl;
+    std::cout << "  --stats                Print type inference and optimization statistics" << std::endl;
     std::cout << "  --help                 Show this help message" << std::endl;
     std::cout << "\nExamples:" << std::endl;
     std::cout << "  " << program_name << " player.gd player.gdc" << std::endl;
@@ -117,6 +243,7 @@ int main(int argc, char* argv[]) {
     std::string output_file = argv[2];
     TargetPlatform platform = TargetPlatform::MACOS_X64;
     OutputFormat format = OutputFormat::OBJECT;
+    CompileOptions options;
     
     // Parse command line arguments
     for (int i = 3; i < argc; i++) {
@@ -132,6 +259,33 @@ int main(int argc, char* argv[]) {
         else if (arg == "--format" && i + 1 < argc) {
             format = parseOutputFormat(argv[++i]);
         }
+        else if (arg == "--regalloc" && i + 1 < argc) {
+            std::string kind = argv[++i];
+            if (kind == "coloring" || kind == "irc") {
+                options.register_allocator = AllocatorKind::GRAPH_COLORING;
+            } else if (kind == "linear" || kind == "linear-scan") {
+                options.register_allocator = AllocatorKind::LINEAR_SCAN;
+            } else {
+                std::cerr << "Unknown register allocator: " << kind << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--inline-threshold" && i + 1 < argc) {
+            // Single-call callees get four times the budget
+            int threshold = std::atoi(argv[++i]);
+            options.inlining.max_callee_size = threshold > 0 ? threshold : 0;
+            options.inlining.max_single_call_size = options.inlining.max_callee_size * 4;
+            options.inlining.max_hot_callee_size = options.inlining.max_callee_size * 4;
+        }
+        else if (arg == "--profile-generate") {
+            options.profile_generate = true;
+        }
+        else if (arg == "--profile-use" && i + 1 < argc) {
+            options.profile_use = argv[++i];
+        }
+        else if (arg == "--stats") {
+            options.print_stats = true;
+        }
         else {
             std::cerr << "Unknown argument: " << arg << std::endl;
             printUsage(argv[0]);
@@ -140,7 +294,7 @@ int main(int argc, char* argv[]) {
     }
     
     GDScriptCompiler compiler;
-    bool success = compiler.compile(input_file, output_file, platform, format);
+    bool success = compiler.compile(input_file, output_file, platform, format, options);
     
     if (success) {
         std::cout << "Target Platform: " << CodeGenerator(platform, format).getPlatformName() << std::endl;
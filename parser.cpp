@@ -228,7 +228,9 @@ std::unique_ptr<Statement> Parser::statement() {
              consume(TokenType::TYPE_INFER_ASSIGN, "Expected ':=' for type inference");
              auto initializer = expression();
              consume(TokenType::NEWLINE, "Expected newline after type inference assignment");
-             return std::make_unique<VarDecl>(name_token.value, "", std::move(initializer));
+             auto decl = std::make_unique<VarDecl>(name_token.value, "", std::move(initializer));
+             decl->is_inferred = true;
+             return decl;
          } else {
              // Reset and parse as expression statement
              current = saved_current;
@@ -348,13 +350,11 @@ std::unique_ptr<Statement> Parser::returnStatement() {
         value = expression();
     }
     
-    // Skip any newlines that might have been consumed during expression parsing
-    while (match({TokenType::NEWLINE})) {
-        // Just skip newlines
-    }
-    
-    // If we don't have a newline or dedent now, we need a newline
-    if (!check(TokenType::NEWLINE) && !check(TokenType::DEDENT) && !isAtEnd()) {
+    // Consume newline if present, but don't require it if we're at end of
+    // file or about to dedent. Statements may follow, unreachable.
+    if (check(TokenType::NEWLINE)) {
+        advance(); // consume the newline
+    } else if (!check(TokenType::DEDENT) && !isAtEnd()) {
         consume(TokenType::NEWLINE, "Expected newline after return statement");
     }
     
@@ -397,7 +397,9 @@ std::unique_ptr<VarDecl> Parser::varDeclaration() {
     }
     
     std::unique_ptr<Expression> initializer = nullptr;
+    bool is_inferred = false;
     if (match({TokenType::ASSIGN, TokenType::TYPE_INFER_ASSIGN})) {
+        is_inferred = tokens[current - 1].type == TokenType::TYPE_INFER_ASSIGN;
         initializer = expression();
     }
     
@@ -409,7 +411,9 @@ std::unique_ptr<VarDecl> Parser::varDeclaration() {
         consume(TokenType::NEWLINE, "Expected newline after variable declaration");
     }
     
-    return std::make_unique<VarDecl>(name_token.value, type_hint, std::move(initializer));
+    auto decl = std::make_unique<VarDecl>(name_token.value, type_hint, std::move(initializer));
+    decl->is_inferred = is_inferred;
+    return decl;
 }
 
 std::unique_ptr<ConstDecl> Parser::constDeclaration() {
@@ -677,7 +681,17 @@ std::unique_ptr<Expression> Parser::primary() {
         Token token = tokens[current - 1];
         return std::make_unique<IdentifierExpr>(token.value);
     }
-    
+
+    if (match({TokenType::SELF})) {
+        Token token = tokens[current - 1];
+        return std::make_unique<IdentifierExpr>(token.value);
+    }
+
+    // assert(condition[, message]) is a keyword but parses as a call
+    if (match({TokenType::ASSERT})) {
+        return std::make_unique<IdentifierExpr>("assert");
+    }
+
     if (match({TokenType::LEFT_PAREN})) {
         auto expr = expression();
         consume(TokenType::RIGHT_PAREN, "Expected ')' after expression");
@@ -828,7 +842,11 @@ std::vector<std::unique_ptr<Expression>> Parser::arguments() {
 }
 
 std::unique_ptr<EnumDecl> Parser::enumDeclaration() {
-    Token name_token = consume(TokenType::IDENTIFIER, "Expected enum name");
+    // Anonymous enums ('enum { A, B }') export their values directly
+    std::string enum_name;
+    if (check(TokenType::IDENTIFIER)) {
+        enum_name = advance().value;
+    }
     consume(TokenType::LEFT_BRACE, "Expected '{' after enum name");
     
     std::vector<EnumValue> values;
@@ -909,5 +927,5 @@ std::unique_ptr<EnumDecl> Parser::enumDeclaration() {
         consume(TokenType::NEWLINE, "Expected newline after enum declaration");
     }
     
-    return std::make_unique<EnumDecl>(name_token.value, std::move(values));
+    return std::make_unique<EnumDecl>(enum_name, std::move(values));
 }
\ No newline at end of file
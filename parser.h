@@ -64,9 +64,41 @@ public:
     virtual ~ASTNode() = default;
 };
 
+// Compile-time value attached to expressions by the semantic analyzer
+struct ConstantValue {
+    enum Kind { NONE, NIL, BOOL, INT, FLOAT, STRING };
+    
+    Kind kind;
+    long long int_value;        // INT and BOOL payload
+    double float_value;
+    std::string string_value;
+    
+    ConstantValue() : kind(NONE), int_value(0), float_value(0.0) {}
+    
+    static ConstantValue makeInt(long long v) { ConstantValue c; c.kind = INT; c.int_value = v; return c; }
+    static ConstantValue makeBool(bool v) { ConstantValue c; c.kind = BOOL; c.int_value = v ? 1 : 0; return c; }
+    static ConstantValue makeFloat(double v) { ConstantValue c; c.kind = FLOAT; c.float_value = v; return c; }
+    static ConstantValue makeString(const std::string& v) { ConstantValue c; c.kind = STRING; c.string_value = v; return c; }
+    static ConstantValue makeNil() { ConstantValue c; c.kind = NIL; return c; }
+    
+    bool isKnown() const { return kind != NONE; }
+    bool isNumeric() const { return kind == INT || kind == FLOAT || kind == BOOL; }
+    double asFloat() const { return kind == FLOAT ? float_value : static_cast<double>(int_value); }
+    bool isTruthy() const {
+        switch (kind) {
+            case BOOL: case INT: return int_value != 0;
+            case FLOAT: return float_value != 0.0;
+            case STRING: return !string_value.empty();
+            default: return false;
+        }
+    }
+};
+
 // Expression nodes
 class Expression : public ASTNode {
 public:
+    ConstantValue constant;     // Known when the whole subexpression folds at compile time
+    
     Expression(ASTNodeType t, int l = 0, int c = 0) : ASTNode(t, l, c) {}
 };
 
@@ -238,6 +270,12 @@ public:
     
     MatchCase(std::unique_ptr<Expression> pat, std::unique_ptr<Statement> b)
         : pattern(std::move(pat)), body(std::move(b)) {}
+    
+    // '_' matches any value
+    bool isWildcard() const {
+        return pattern && pattern->type == ASTNodeType::IDENTIFIER &&
+               static_cast<const IdentifierExpr*>(pattern.get())->name == "_";
+    }
 };
 
 class MatchStmt : public Statement {
@@ -287,12 +325,13 @@ public:
     std::string type;
     std::unique_ptr<Expression> initializer;
     bool is_static;
+    bool is_inferred;   // Declared with ':=', statically typed from the initializer
     std::vector<std::string> annotations;
     
     VarDecl(const std::string& n, const std::string& t = "", std::unique_ptr<Expression> init = nullptr, 
             bool static_var = false, int l = 0, int c = 0)
         : Declaration(ASTNodeType::VAR_DECL, l, c), name(n), type(t), 
-          initializer(std::move(init)), is_static(static_var) {}
+          initializer(std::move(init)), is_static(static_var), is_inferred(false) {}
 };
 
 class ConstDecl : public Declaration {
@@ -344,9 +383,10 @@ class EnumValue {
 public:
     std::string name;
     std::unique_ptr<Expression> value;
+    long long computed_value;   // Explicit or implicitly incremented value, set by the analyzer
     
     EnumValue(const std::string& n, std::unique_ptr<Expression> val = nullptr)
-        : name(n), value(std::move(val)) {}
+        : name(n), value(std::move(val)), computed_value(0) {}
 };
 
 class EnumDecl : public Declaration {
@@ -0,0 +1,365 @@
+#include "peephole.h"
+#include "liveness.h"
+#include <climits>
+
+static bool sameRegister(const Function& func, VReg a, VReg b) {
+    if (a == b) return true;
+    if (!a || !b) return false;
+    const Register& left = func.getRegister(a);
+    const Register& right = func.getRegister(b);
+    return left.physical >= 0 && left.physical == right.physical && left.type == right.type;
+}
+
+static Instruction move(VReg dest, VReg src) {
+    Instruction instr(Instruction::MOV);
+    instr.addOperand(dest);
+    instr.addOperand(src);
+    return instr;
+}
+
+static void erase(const PeepholeWindow& window, size_t count = 1) {
+    auto& code = window.code();
+    code.erase(code.begin() + window.index, code.begin() + window.index + count);
+}
+
+static bool isCompareWithZero(const Instruction& instr) {
+    return instr.opcode == Instruction::CMP && instr.num_operands == 1 &&
+           instr.has_immediate && instr.immediate == 0;
+}
+
+// Conditional branches read the flags of the compare in their own block, so
+// the flags are dead once the block ends or something sets them again
+static bool flagsDeadAfter(const PeepholeWindow& window) {
+    const auto& code = window.code();
+    for (size_t i = window.index + 1; i < code.size(); ++i) {
+        switch (code[i].opcode) {
+            case Instruction::CMP: case Instruction::FCMP:
+                return true;
+            case Instruction::JE: case Instruction::JNE: case Instruction::JL:
+            case Instruction::JLE: case Instruction::JG: case Instruction::JGE:
+                return false;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+// Whether reg is overwritten before anything reads it again, looking from
+// position start to the end of the block
+static bool deadFrom(const PeepholeWindow& window, size_t start, VReg reg) {
+    const auto& code = window.code();
+    std::vector<VReg> uses;
+    for (size_t i = start; i < code.size(); ++i) {
+        Liveness::collectUses(window.func, code[i], uses);
+        for (VReg use : uses) {
+            if (sameRegister(window.func, use, reg)) return false;
+        }
+        if (code[i].definesFirstOperand() && sameRegister(window.func, code[i].operands[0], reg)) return true;
+    }
+    // Only a block that leaves the function has nothing live out
+    return !code.empty() && (code.back().opcode == Instruction::RET || code.back().opcode == Instruction::TAILCALL);
+}
+
+// MOV t, #k; OP d, s, t becomes OP d, s, #k when the target encodes k in
+// OP and t is dead afterwards. Commutative operations may take the
+// constant from either side; CMP s, t becomes CMP s, #k.
+static bool foldImmediateOperand(const PeepholeWindow& window,
+                                 bool (*encodable)(Instruction::OpCode opcode, int32_t value)) {
+    auto& code = window.code();
+    size_t i = window.index;
+    if (i + 1 >= code.size()) return false;
+    const Instruction& constant = code[i];
+    Instruction& instr = code[i + 1];
+    if (constant.opcode != Instruction::MOV || constant.num_operands != 1 || !constant.has_immediate) return false;
+    if (instr.has_immediate || !encodable(instr.opcode, constant.immediate)) return false;
+
+    VReg reg = constant.operands[0];
+    if (window.func.getRegister(reg).type != Register::GENERAL) return false;
+
+    Instruction folded(instr.opcode);
+    if (instr.opcode == Instruction::CMP) {
+        if (instr.num_operands != 2 || !sameRegister(window.func, instr.operands[1], reg) ||
+            sameRegister(window.func, instr.operands[0], reg)) {
+            return false;
+        }
+        folded.addOperand(instr.operands[0]);
+    } else {
+        if (instr.num_operands != 3) return false;
+        VReg left = instr.operands[1];
+        VReg right = instr.operands[2];
+        bool commutative = instr.opcode == Instruction::ADD || instr.opcode == Instruction::MUL ||
+                           instr.opcode == Instruction::AND || instr.opcode == Instruction::OR ||
+                           instr.opcode == Instruction::XOR;
+        if (commutative && sameRegister(window.func, left, reg)) std::swap(left, right);
+        if (!sameRegister(window.func, right, reg) || sameRegister(window.func, left, reg)) return false;
+        folded.addOperand(instr.operands[0]);
+        folded.addOperand(left);
+    }
+    bool overwritten = instr.definesFirstOperand() && sameRegister(window.func, instr.operands[0], reg);
+    if (!overwritten && !deadFrom(window, i + 2, reg)) return false;
+
+    folded.setImmediate(constant.immediate);
+    instr = folded;
+    erase(window);
+    return true;
+}
+
+// MOV r, r
+static bool redundantMove(const PeepholeWindow& window) {
+    const Instruction& instr = window.code()[window.index];
+    if (instr.opcode != Instruction::MOV || instr.num_operands != 2 || instr.has_immediate) return false;
+    if (!sameRegister(window.func, instr.operands[0], instr.operands[1])) return false;
+    erase(window);
+    return true;
+}
+
+// MOV a, b; MOV b, a: the second copy finds b already holding the value
+static bool moveBack(const PeepholeWindow& window) {
+    auto& code = window.code();
+    if (window.index + 1 >= code.size()) return false;
+    const Instruction& first = code[window.index];
+    const Instruction& second = code[window.index + 1];
+    if (first.opcode != Instruction::MOV || second.opcode != Instruction::MOV) return false;
+    if (first.num_operands != 2 || second.num_operands != 2 || first.has_immediate || second.has_immediate) {
+        return false;
+    }
+    if (!sameRegister(window.func, first.operands[0], second.operands[1]) ||
+        !sameRegister(window.func, first.operands[1], second.operands[0])) {
+        return false;
+    }
+    code.erase(code.begin() + window.index + 1);
+    return true;
+}
+
+// JMP L where L is the next instruction to run anyway
+static bool jumpToNext(const PeepholeWindow& window) {
+    const auto& code = window.code();
+    const Instruction& instr = code[window.index];
+    if (instr.opcode != Instruction::JMP || window.index + 1 != code.size()) return false;
+
+    const auto& blocks = window.func.blocks;
+    for (size_t b = window.block + 1; b < blocks.size(); ++b) {
+        if (blocks[b]->labelSymbol() == instr.label) {
+            erase(window);
+            return true;
+        }
+        // Blocks holding nothing but a label fall through to the next one
+        for (const auto& next : blocks[b]->instructions) {
+            if (next.opcode != Instruction::LABEL) return false;
+        }
+    }
+    return false;
+}
+
+// PUSH x; POP y
+static bool pushPop(const PeepholeWindow& window) {
+    const auto& code = window.code();
+    if (window.index + 1 >= code.size()) return false;
+    const Instruction& push = code[window.index];
+    const Instruction& pop = code[window.index + 1];
+    if (push.opcode != Instruction::PUSH || pop.opcode != Instruction::POP) return false;
+    if (push.num_operands != 1 || pop.num_operands != 1 || push.has_immediate) return false;
+
+    VReg value = push.operands[0];
+    VReg dest = pop.operands[0];
+    if (window.func.getRegister(value).type != window.func.getRegister(dest).type) return false;
+    if (sameRegister(window.func, dest, value)) {
+        erase(window, 2);
+    } else {
+        erase(window);
+        window.code()[window.index] = move(dest, value);
+    }
+    return true;
+}
+
+// ADD/SUB/OR/XOR/SHL/SHR d, s, #0 and MUL/DIV d, s, #1
+static bool identityArithmetic(const PeepholeWindow& window) {
+    Instruction& instr = window.code()[window.index];
+    if (instr.num_operands != 2 || !instr.has_immediate) return false;
+
+    int32_t identity;
+    switch (instr.opcode) {
+        case Instruction::ADD: case Instruction::SUB: case Instruction::OR: case Instruction::XOR:
+        case Instruction::SHL: case Instruction::SHR:
+            identity = 0;
+            break;
+        case Instruction::MUL: case Instruction::DIV:
+            identity = 1;
+            break;
+        default:
+            return false;
+    }
+    if (instr.immediate != identity) return false;
+    instr = move(instr.operands[0], instr.operands[1]);
+    return true;
+}
+
+// STORE v, base, #k; LOAD d, base, #k reads back the value just stored
+static bool storeReload(const PeepholeWindow& window) {
+    auto& code = window.code();
+    if (window.index + 1 >= code.size()) return false;
+    const Instruction& store = code[window.index];
+    Instruction& load = code[window.index + 1];
+    if (store.opcode != Instruction::STORE || load.opcode != Instruction::LOAD) return false;
+    if (store.num_operands != 2 || load.num_operands != 2 || store.immediate != load.immediate) return false;
+    if (!sameRegister(window.func, store.operands[1], load.operands[1])) return false;
+
+    VReg value = store.operands[0];
+    VReg dest = load.operands[0];
+    if (window.func.getRegister(value).type != window.func.getRegister(dest).type) return false;
+    load = move(dest, value);
+    return true;
+}
+
+// x86-64: ADD, SUB, AND, OR and XOR set ZF from their result, so a
+// following CMP r, #0 is redundant when only JE/JNE read it. The encoders
+// finish every such operation with the flag-setting ALU instruction.
+static bool compareZeroAfterArithmetic(const PeepholeWindow& window) {
+    const auto& code = window.code();
+    size_t i = window.index;
+    if (i == 0 || i + 1 >= code.size() || !isCompareWithZero(code[i])) return false;
+
+    const Instruction& previous = code[i - 1];
+    switch (previous.opcode) {
+        case Instruction::ADD: case Instruction::SUB:
+        case Instruction::AND: case Instruction::OR: case Instruction::XOR:
+            break;
+        default:
+            return false;
+    }
+    if (!sameRegister(window.func, previous.operands[0], code[i].operands[0])) return false;
+    if (code[i + 1].opcode != Instruction::JE && code[i + 1].opcode != Instruction::JNE) return false;
+    erase(window);
+    return true;
+}
+
+// x86-64: MOV r, #0 becomes the shorter XOR r, r, r where the flags it
+// clobbers are dead
+static bool zeroIdiom(const PeepholeWindow& window) {
+    Instruction& instr = window.code()[window.index];
+    if (instr.opcode != Instruction::MOV || instr.num_operands != 1 || !instr.has_immediate ||
+        instr.immediate != 0) {
+        return false;
+    }
+    VReg reg = instr.operands[0];
+    if (window.func.getRegister(reg).type != Register::GENERAL || !flagsDeadAfter(window)) return false;
+
+    Instruction zero(Instruction::XOR);
+    zero.addOperand(reg);
+    zero.addOperand(reg);
+    zero.addOperand(reg);
+    instr = zero;
+    return true;
+}
+
+// x86-64 ALU instructions and imul take a sign-extended imm32, shifts an imm8
+static bool x86Immediate(Instruction::OpCode opcode, int32_t value) {
+    switch (opcode) {
+        case Instruction::ADD: case Instruction::SUB: case Instruction::MUL:
+        case Instruction::AND: case Instruction::OR: case Instruction::XOR:
+        case Instruction::CMP:
+            return true;
+        case Instruction::SHL: case Instruction::SHR:
+            return value >= 0 && value < 64;
+        default:
+            return false;
+    }
+}
+
+static bool x86ImmediateOperand(const PeepholeWindow& window) {
+    return foldImmediateOperand(window, x86Immediate);
+}
+
+// AArch64 add, sub and cmp take an unsigned imm12, add and sub flipping
+// for negative values; shifts take the shift amount
+static bool aarch64Immediate(Instruction::OpCode opcode, int32_t value) {
+    switch (opcode) {
+        case Instruction::ADD: case Instruction::SUB:
+            return value >= -4095 && value <= 4095;
+        case Instruction::CMP:
+            return value >= 0 && value <= 4095;
+        case Instruction::SHL: case Instruction::SHR:
+            return value >= 0 && value < 64;
+        default:
+            return false;
+    }
+}
+
+static bool aarch64ImmediateOperand(const PeepholeWindow& window) {
+    return foldImmediateOperand(window, aarch64Immediate);
+}
+
+// AArch64: CMP r, #0; JE/JNE L is a single CBZ/CBNZ
+static bool compareZeroBranch(const PeepholeWindow& window) {
+    auto& code = window.code();
+    size_t i = window.index;
+    if (i + 1 >= code.size() || !isCompareWithZero(code[i])) return false;
+
+    VReg reg = code[i].operands[0];
+    Instruction& branch = code[i + 1];
+    if (window.func.getRegister(reg).type != Register::GENERAL) return false;
+    if (branch.opcode != Instruction::JE && branch.opcode != Instruction::JNE) return false;
+
+    Instruction fused(branch.opcode == Instruction::JE ? Instruction::JZ : Instruction::JNZ);
+    fused.addOperand(reg);
+    fused.label = branch.label;
+    branch = fused;
+    erase(window);
+    return true;
+}
+
+// AArch64: add and sub only encode unsigned 12-bit immediates, so a
+// negative one flips the operation
+static bool negativeImmediate(const PeepholeWindow& window) {
+    Instruction& instr = window.code()[window.index];
+    if (instr.opcode != Instruction::ADD && instr.opcode != Instruction::SUB) return false;
+    if (instr.num_operands != 2 || !instr.has_immediate || instr.immediate >= 0 || instr.immediate == INT_MIN) {
+        return false;
+    }
+    instr.opcode = instr.opcode == Instruction::ADD ? Instruction::SUB : Instruction::ADD;
+    instr.immediate = -instr.immediate;
+    return true;
+}
+
+const std::vector<PeepholeRule>& peepholeRules() {
+    static const std::vector<PeepholeRule> rules = {
+        {"redundant-move", PeepholeTarget::ANY, redundantMove},
+        {"move-back", PeepholeTarget::ANY, moveBack},
+        {"jump-to-next", PeepholeTarget::ANY, jumpToNext},
+        {"push-pop", PeepholeTarget::ANY, pushPop},
+        {"identity-arithmetic", PeepholeTarget::ANY, identityArithmetic},
+        {"store-reload", PeepholeTarget::ANY, storeReload},
+        {"immediate-operand", PeepholeTarget::X86_64, x86ImmediateOperand},
+        {"compare-zero-after-arithmetic", PeepholeTarget::X86_64, compareZeroAfterArithmetic},
+        {"zero-idiom", PeepholeTarget::X86_64, zeroIdiom},
+        {"immediate-operand", PeepholeTarget::AARCH64, aarch64ImmediateOperand},
+        {"compare-zero-branch", PeepholeTarget::AARCH64, compareZeroBranch},
+        {"negative-immediate", PeepholeTarget::AARCH64, negativeImmediate},
+    };
+    return rules;
+}
+
+void runPeephole(Function& func, PeepholeTarget target, PeepholeStats& stats) {
+    const std::vector<PeepholeRule>& rules = peepholeRules();
+    for (size_t b = 0; b < func.blocks.size(); ++b) {
+        auto& code = func.blocks[b]->instructions;
+        size_t i = 0;
+        while (i < code.size()) {
+            bool changed = false;
+            for (size_t r = 0; r < rules.size() && !changed; ++r) {
+                if (rules[r].target != PeepholeTarget::ANY && rules[r].target != target) continue;
+                if (rules[r].apply(PeepholeWindow(func, b, i))) {
+                    stats.hits[r]++;
+                    changed = true;
+                }
+            }
+            // A rewrite can complete a pattern that starts one instruction back
+            if (changed) {
+                i = i > 0 ? i - 1 : 0;
+            } else {
+                i++;
+            }
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ir.h"
+#include <vector>
+
+// Code a peephole rule is valid for
+enum class PeepholeTarget {
+    ANY,        // Target-independent; these also run on the IR before register allocation
+    X86_64,
+    AARCH64
+};
+
+// The instruction a rule is tried at: one position in one block, with the
+// rest of the function in reach for rules that look past the block's end
+struct PeepholeWindow {
+    Function& func;
+    size_t block;
+    size_t index;
+
+    PeepholeWindow(Function& func, size_t block, size_t index) : func(func), block(block), index(index) {}
+
+    std::vector<Instruction>& code() const { return func.blocks[block]->instructions; }
+};
+
+// One rewrite; apply returns true when it changed the code
+struct PeepholeRule {
+    const char* name;
+    PeepholeTarget target;
+    bool (*apply)(const PeepholeWindow& window);
+};
+
+// The rule table, in the order the rules are tried at each instruction
+const std::vector<PeepholeRule>& peepholeRules();
+
+// Counters reported by the peephole optimizer
+struct PeepholeStats {
+    std::vector<size_t> hits;   // Rewrites per rule, indexed like peepholeRules()
+
+    PeepholeStats() : hits(peepholeRules().size(), 0) {}
+};
+
+// Applies the target-independent rules and those written for target to
+// every instruction until none fires. Registers compare equal when they
+// are the same virtual register or share a machine register, so the same
+// table cleans up the IR before allocation and the code after it. Flags
+// are assumed dead across block boundaries, which holds because every
+// conditional branch is emitted right after its compare.
+void runPeephole(Function& func, PeepholeTarget target, PeepholeStats& stats);
@@ -0,0 +1,103 @@
+#include "profile.h"
+#include <fstream>
+#include <sstream>
+
+uint32_t profileKey(const std::string& function, const std::string& label) {
+    uint32_t hash = 2166136261u;
+    std::string text = function + ":" + label;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint64_t ProfileData::count(const std::string& function, const std::string& label) const {
+    auto it = counts.find(profileKey(function, label));
+    return it != counts.end() ? it->second : 0;
+}
+
+bool readProfile(const std::string& path, ProfileData& profile, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "Cannot open profile: " + path;
+        return false;
+    }
+
+    std::string line;
+    size_t number = 0;
+    while (std::getline(file, line)) {
+        number++;
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        uint32_t key;
+        uint64_t count;
+        if (!(fields >> std::hex >> key >> std::dec >> count)) {
+            error = path + ":" + std::to_string(number) + ": expected a hex key and a count";
+            return false;
+        }
+        profile.counts[key] += count;
+    }
+    return true;
+}
+
+void addProfileLabels(Function& func) {
+    std::unordered_map<uint32_t, int> fallthroughs;   // Per branch target
+    for (size_t b = 0; b < func.blocks.size(); ++b) {
+        auto& code = func.blocks[b]->instructions;
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (!code[i].isConditionalBranch()) continue;
+            bool labeled = i + 1 < code.size()
+                ? code[i + 1].opcode == Instruction::LABEL
+                : b + 1 == func.blocks.size() || func.blocks[b + 1]->labelSymbol() != 0;
+            if (labeled) continue;
+
+            uint32_t target = code[i].label;
+            Instruction label(Instruction::LABEL);
+            label.label = func.internSymbol(func.symbolName(target) + "_ft" + std::to_string(fallthroughs[target]++));
+            code.insert(code.begin() + i + 1, label);
+        }
+    }
+}
+
+// MOV key; PUSH key; CALL _profile_count
+static void insertCounter(Function& func, std::vector<Instruction>& code, size_t position, uint32_t key) {
+    VReg key_reg = func.newRegister();
+    Instruction load(Instruction::MOV);
+    load.addOperand(key_reg);
+    load.setImmediate(static_cast<int32_t>(key));
+    Instruction push(Instruction::PUSH);
+    push.addOperand(key_reg);
+    Instruction call(Instruction::CALL);
+    call.addOperand(func.newRegister());
+    call.label = func.internSymbol("_profile_count");
+    code.insert(code.begin() + position, {load, push, call});
+}
+
+void instrumentFunction(Function& func, ProfileStats& stats) {
+    if (func.blocks.empty()) return;
+    insertCounter(func, func.blocks.front()->instructions, 0, profileKey(func.name, ""));
+    stats.counters++;
+    for (auto& block : func.blocks) {
+        auto& code = block->instructions;
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (code[i].opcode != Instruction::LABEL) continue;
+            insertCounter(func, code, i + 1, profileKey(func.name, func.symbolName(code[i].label)));
+            stats.counters++;
+        }
+    }
+}
+
+void annotateFunction(Function& func, const ProfileData& profile, ProfileStats& stats) {
+    uint64_t entry = profile.count(func.name, "");
+    if (entry == 0) return;
+    func.profile_counts[0] = entry;
+    stats.functions++;
+    for (const auto& block : func.blocks) {
+        for (const auto& instr : block->instructions) {
+            if (instr.opcode != Instruction::LABEL) continue;
+            func.profile_counts[instr.label] = profile.count(func.name, func.symbolName(instr.label));
+            stats.blocks++;
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ir.h"
+#include <string>
+#include <unordered_map>
+
+// Block execution counts recorded by an instrumented build. A profile
+// point is a function entry or a label, identified by profileKey. The
+// runtime's _profile_count(key), runtime/profile.c, counts a point, and at
+// exit it writes one "key count" line per point it counted, the key in
+// hex, to the file named by GDSCRIPT_PROFILE (gdscript.profile by
+// default). Points that never ran are absent and read as zero.
+struct ProfileData {
+    std::unordered_map<uint32_t, uint64_t> counts;
+
+    bool empty() const { return counts.empty(); }
+    uint64_t count(const std::string& function, const std::string& label) const;
+};
+
+// Counters reported by instrumentation and profile use
+struct ProfileStats {
+    size_t counters;        // Profile points counted by an instrumented build
+    size_t functions;       // Functions the profile has run, whose blocks got counts
+    size_t blocks;          // Labels given a count
+    size_t moved_arms;      // Match arms tested ahead of their place in the source
+
+    ProfileStats() : counters(0), functions(0), blocks(0), moved_arms(0) {}
+};
+
+// FNV-1a of "function:label"; the entry of a function has an empty label
+uint32_t profileKey(const std::string& function, const std::string& label);
+
+// Reads a profile written by the runtime; false with a message when the
+// file cannot be read or a line is malformed
+bool readProfile(const std::string& path, ProfileData& profile, std::string& error);
+
+// Labels every place a block can start in the emitted stream of a function,
+// so that each block is a profile point. A fallthrough after a conditional
+// branch to L becomes L_ftN, named after the branch rather than its
+// position so that reordered compares keep their counts. Both the
+// instrumented and the optimized build run this on the same stream.
+void addProfileLabels(Function& func);
+
+// Counts the entry and every label of a function with a call to
+// _profile_count. The counters stay through inlining, where copies keep
+// counting for the block they came from.
+void instrumentFunction(Function& func, ProfileStats& stats);
+
+// Copies the counts of a function's labels into Function::profile_counts.
+// Functions the profile never entered get none and keep the static
+// heuristics.
+void annotateFunction(Function& func, const ProfileData& profile, ProfileStats& stats);
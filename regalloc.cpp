@@ -0,0 +1,675 @@
+#include "regalloc.h"
+#include "liveness.h"
+#include <algorithm>
+#include <climits>
+#include <limits>
+#include <unordered_map>
+
+LinearScanAllocator::LinearScanAllocator(Function& func, const RegisterFile& file)
+    : func(func), file(file) {}
+
+void LinearScanAllocator::buildIntervals() {
+    Liveness liveness(func);
+    size_t reg_count = func.registerCount();
+    std::vector<int> start(reg_count, INT_MAX);
+    std::vector<int> end(reg_count, -1);
+    std::vector<int> calls;
+
+    auto extend = [&](size_t id, int position) {
+        start[id] = std::min(start[id], position);
+        end[id] = std::max(end[id], position);
+    };
+
+    // Number instructions in layout order; a register live into or out of
+    // a block covers the whole block boundary
+    // Registers pinned by the calling convention are shared by every call
+    // site, so they get one fixed range per definition rather than a single
+    // interval: from the definition (or the block start) to the last use
+    fixed_ranges[0].assign(file.general.size(), {});
+    fixed_ranges[1].assign(file.floating.size(), {});
+    std::unordered_map<uint32_t, std::pair<int, int>> open_ranges;
+    auto closeRange = [&](uint32_t id, std::pair<int, int> range) {
+        const Register& info = func.getRegister(VReg(id));
+        fixed_ranges[info.type == Register::FLOAT ? 1 : 0][info.physical].push_back(range);
+    };
+
+    int position = 0;
+    std::vector<VReg> uses;
+    for (auto& block : func.blocks) {
+        int block_start = position;
+        open_ranges.clear();
+        for (const auto& instr : block->instructions) {
+            Liveness::collectUses(func, instr, uses);
+            for (VReg reg : uses) {
+                extend(reg.id, position);
+                if (func.getRegister(reg).physical < 0) continue;
+                auto open = open_ranges.emplace(reg.id, std::make_pair(block_start, position)).first;
+                open->second.second = position;
+            }
+            if (instr.definesFirstOperand() && instr.operands[0]) {
+                VReg def = instr.operands[0];
+                extend(def.id, position);
+                if (func.getRegister(def).physical >= 0) {
+                    auto open = open_ranges.find(def.id);
+                    if (open != open_ranges.end()) closeRange(def.id, open->second);
+                    open_ranges[def.id] = std::make_pair(position, position);
+                }
+            }
+            if (instr.opcode == Instruction::CALL) calls.push_back(position);
+            position++;
+        }
+        if (position == block_start) continue;
+
+        const std::vector<bool>& live_in = liveness.liveIn(block.get());
+        const std::vector<bool>& live_out = liveness.liveOut(block.get());
+        for (size_t id = 1; id < reg_count; ++id) {
+            if (live_in[id]) extend(id, block_start);
+            if (live_out[id]) extend(id, position - 1);
+        }
+        for (auto& open : open_ranges) {
+            if (live_out[open.first]) open.second.second = position - 1;
+            closeRange(open.first, open.second);
+        }
+    }
+
+    intervals.clear();
+    for (size_t id = 1; id < reg_count; ++id) {
+        const Register& info = func.getRegister(VReg(static_cast<uint32_t>(id)));
+        if (end[id] < 0 || info.physical >= 0) continue;
+
+        LiveInterval interval(VReg(static_cast<uint32_t>(id)), info.type, start[id], end[id]);
+        auto call = std::upper_bound(calls.begin(), calls.end(), interval.start);
+        interval.crosses_call = call != calls.end() && *call < interval.end;
+        intervals.push_back(interval);
+    }
+    std::sort(intervals.begin(), intervals.end(), [](const LiveInterval& a, const LiveInterval& b) {
+        return a.start < b.start || (a.start == b.start && a.reg.id < b.reg.id);
+    });
+}
+
+bool LinearScanAllocator::canUse(const LiveInterval& interval, int physical) const {
+    // Calls clobber caller-saved registers
+    bool is_float = interval.type == Register::FLOAT;
+    if (interval.crosses_call && !file.get(is_float, physical).callee_saved) return false;
+
+    // An interval may end where a fixed range starts and start where one
+    // ends, since an instruction reads its operands before writing
+    for (const auto& range : fixed_ranges[is_float ? 1 : 0][physical]) {
+        if (range.first < interval.end && interval.start < range.second) return false;
+    }
+    return true;
+}
+
+void LinearScanAllocator::run(AllocationStats& stats) {
+    buildIntervals();
+
+    std::vector<bool> free_general(file.general.size(), true);
+    std::vector<bool> free_floating(file.floating.size(), true);
+    std::vector<LiveInterval*> active;     // Sorted by increasing end point
+
+    for (auto& interval : intervals) {
+        bool is_float = interval.type == Register::FLOAT;
+
+        // Expire intervals that ended before this one starts
+        while (!active.empty() && active.front()->end < interval.start) {
+            LiveInterval* done = active.front();
+            (done->type == Register::FLOAT ? free_floating : free_general)[done->physical] = true;
+            active.erase(active.begin());
+        }
+
+        std::vector<bool>& free = is_float ? free_floating : free_general;
+        const std::vector<int>& candidates = is_float ? file.allocatable_floating : file.allocatable_general;
+        for (int physical : candidates) {
+            if (free[physical] && canUse(interval, physical)) {
+                interval.physical = physical;
+                break;
+            }
+        }
+
+        if (interval.physical < 0) {
+            // Steal the register of the compatible active interval that lives
+            // longest, if it outlives this one
+            LiveInterval* victim = nullptr;
+            for (auto it = active.rbegin(); it != active.rend(); ++it) {
+                if ((*it)->type == interval.type && canUse(interval, (*it)->physical)) {
+                    victim = *it;
+                    break;
+                }
+            }
+            if (!victim || victim->end <= interval.end) {
+                continue;
+            }
+            interval.physical = victim->physical;
+            victim->physical = -1;
+            active.erase(std::find(active.begin(), active.end(), victim));
+        }
+
+        free[interval.physical] = false;
+        auto position = std::upper_bound(active.begin(), active.end(), &interval,
+            [](const LiveInterval* a, const LiveInterval* b) { return a->end < b->end; });
+        active.insert(position, &interval);
+    }
+
+    std::vector<int> spill_slots(func.registerCount(), -1);
+    int next_slot = 0;
+    for (const auto& interval : intervals) {
+        stats.values++;
+        if (interval.physical >= 0) {
+            func.getRegister(interval.reg).physical = interval.physical;
+        } else {
+            spill_slots[interval.reg.id] = next_slot++;
+            stats.spilled++;
+        }
+    }
+
+    func.register_file = &file;
+    recordSavedRegisters(func, file, stats);
+    insertSpillCode(func, file, spill_slots, stats);
+}
+
+void recordSavedRegisters(Function& func, const RegisterFile& file, AllocationStats& stats) {
+    func.saved_general.clear();
+    func.saved_floating.clear();
+    for (size_t id = 1; id < func.registerCount(); ++id) {
+        const Register& info = func.getRegister(VReg(static_cast<uint32_t>(id)));
+        if (info.physical < 0) continue;
+
+        bool is_float = info.type == Register::FLOAT;
+        if (!file.get(is_float, info.physical).callee_saved) continue;
+        if (!is_float && (info.physical == file.frame_pointer || info.physical == file.stack_pointer)) continue;
+
+        std::vector<int>& saved = is_float ? func.saved_floating : func.saved_general;
+        if (std::find(saved.begin(), saved.end(), info.physical) == saved.end()) {
+            saved.push_back(info.physical);
+            stats.callee_saved++;
+        }
+    }
+    std::sort(func.saved_general.begin(), func.saved_general.end());
+    std::sort(func.saved_floating.begin(), func.saved_floating.end());
+}
+
+void insertSpillCode(Function& func, const RegisterFile& file,
+                     const std::vector<int>& spill_slots, AllocationStats& stats) {
+    int slot_count = 0;
+    for (int slot : spill_slots) slot_count = std::max(slot_count, slot + 1);
+    if (slot_count == 0) return;
+
+    // Spill slots sit directly below the saved frame pointer
+    auto slotOffset = [&spill_slots](VReg reg) { return -8 * (spill_slots[reg.id] + 1); };
+    auto precolored = [&func](Register::Type type, int physical) {
+        VReg reg = func.newRegister(type);
+        func.getRegister(reg).physical = physical;
+        return reg;
+    };
+    VReg frame = precolored(Register::GENERAL, file.frame_pointer);
+    VReg scratch[2][2] = {
+        {precolored(Register::GENERAL, file.scratch_general[0]), precolored(Register::GENERAL, file.scratch_general[1])},
+        {precolored(Register::FLOAT, file.scratch_floating[0]), precolored(Register::FLOAT, file.scratch_floating[1])}
+    };
+    auto isSpilled = [&spill_slots](VReg reg) {
+        return reg && reg.id < spill_slots.size() && spill_slots[reg.id] >= 0;
+    };
+
+    for (auto& block : func.blocks) {
+        std::vector<Instruction> rewritten;
+        rewritten.reserve(block->instructions.size());
+
+        for (Instruction instr : block->instructions) {
+            int used[2] = {0, 0};
+            VReg reloaded[2][2];
+            for (int i = instr.firstUse(); i < instr.num_operands; ++i) {
+                VReg reg = instr.operands[i];
+                if (!isSpilled(reg)) continue;
+
+                int cls = func.getRegister(reg).type == Register::FLOAT ? 1 : 0;
+                int k = 0;
+                while (k < used[cls] && reloaded[cls][k] != reg) k++;
+                if (k == used[cls]) {
+                    reloaded[cls][used[cls]++] = reg;
+                    Instruction load(Instruction::LOAD);
+                    load.addOperand(scratch[cls][k]);
+                    load.addOperand(frame);
+                    load.setImmediate(slotOffset(reg));
+                    rewritten.push_back(load);
+                    stats.reloads++;
+                }
+                instr.operands[i] = scratch[cls][k];
+            }
+
+            VReg stored;
+            int stored_cls = 0;
+            if (instr.definesFirstOperand() && isSpilled(instr.operands[0])) {
+                stored = instr.operands[0];
+                stored_cls = func.getRegister(stored).type == Register::FLOAT ? 1 : 0;
+                instr.operands[0] = scratch[stored_cls][0];
+            }
+            rewritten.push_back(instr);
+
+            if (stored) {
+                Instruction store(Instruction::STORE);
+                store.addOperand(scratch[stored_cls][0]);
+                store.addOperand(frame);
+                store.setImmediate(slotOffset(stored));
+                rewritten.push_back(store);
+                stats.spill_stores++;
+            }
+        }
+
+        block->instructions = std::move(rewritten);
+    }
+
+    func.stack_size = (slot_count * 8 + 15) & ~15;
+}
+
+GraphColoringAllocator::GraphColoringAllocator(Function& func, const RegisterFile& file)
+    : func(func), file(file), coloring_float(false), k(0), precolored_count(0) {}
+
+void GraphColoringAllocator::run(AllocationStats& stats) {
+    std::vector<int> spill_slots(func.registerCount(), -1);
+    int next_slot = 0;
+    colorClass(false, spill_slots, next_slot, stats);
+    colorClass(true, spill_slots, next_slot, stats);
+
+    func.register_file = &file;
+    recordSavedRegisters(func, file, stats);
+    insertSpillCode(func, file, spill_slots, stats);
+}
+
+bool GraphColoringAllocator::inClass(VReg reg) const {
+    return reg && reg.id < node_of.size() && node_of[reg.id] >= 0;
+}
+
+bool GraphColoringAllocator::isMove(const Instruction& instr) const {
+    return instr.opcode == Instruction::MOV && instr.num_operands == 2 && !instr.has_immediate &&
+           inClass(instr.operands[0]) && inClass(instr.operands[1]);
+}
+
+void GraphColoringAllocator::colorClass(bool is_float, std::vector<int>& spill_slots, int& next_slot,
+                                        AllocationStats& stats) {
+    coloring_float = is_float;
+    const std::vector<int>& allocatable = is_float ? file.allocatable_floating : file.allocatable_general;
+    k = static_cast<int>(allocatable.size());
+    precolored_count = static_cast<int>(is_float ? file.floating.size() : file.general.size());
+
+    // Spill cost is the number of occurrences; every occurrence of a spilled
+    // register costs a load or a store
+    size_t reg_count = func.registerCount();
+    std::vector<int> occurrences(reg_count, 0);
+    std::vector<VReg> uses;
+    for (auto& block : func.blocks) {
+        for (const auto& instr : block->instructions) {
+            Liveness::collectUses(func, instr, uses);
+            for (VReg reg : uses) occurrences[reg.id]++;
+            if (instr.definesFirstOperand() && instr.operands[0]) occurrences[instr.operands[0].id]++;
+        }
+    }
+
+    node_of.assign(reg_count, -1);
+    node_reg.assign(precolored_count, VReg());
+    for (size_t id = 1; id < reg_count; ++id) {
+        const Register& info = func.getRegister(VReg(static_cast<uint32_t>(id)));
+        if ((info.type == Register::FLOAT) != is_float) continue;
+        if (info.physical >= 0) {
+            // Pinned by the calling convention: the machine register's own node
+            node_of[id] = info.physical;
+            continue;
+        }
+        if (occurrences[id] == 0) continue;
+        node_of[id] = static_cast<int>(node_reg.size());
+        node_reg.push_back(VReg(static_cast<uint32_t>(id)));
+    }
+
+    size_t node_count = node_reg.size();
+    state.assign(node_count, INITIAL);
+    degree.assign(node_count, 0);
+    alias.assign(node_count, -1);
+    color.assign(node_count, -1);
+    spill_cost.assign(node_count, 0);
+    adj_list.assign(node_count, std::vector<int>());
+    move_list.assign(node_count, std::vector<int>());
+    adj_set.clear();
+    moves.clear();
+    simplify_worklist.clear();
+    freeze_worklist.clear();
+    spill_worklist.clear();
+    worklist_moves.clear();
+    select_stack.clear();
+
+    for (int p = 0; p < precolored_count; ++p) {
+        state[p] = PRECOLORED;
+        color[p] = p;
+        degree[p] = std::numeric_limits<int>::max() / 2;
+    }
+    for (size_t n = precolored_count; n < node_count; ++n) {
+        spill_cost[n] = occurrences[node_reg[n].id];
+    }
+
+    build();
+    makeWorklist();
+    while (!simplify_worklist.empty() || !worklist_moves.empty() ||
+           !freeze_worklist.empty() || !spill_worklist.empty()) {
+        if (!simplify_worklist.empty()) simplify();
+        else if (!worklist_moves.empty()) coalesce();
+        else if (!freeze_worklist.empty()) freeze();
+        else selectSpill();
+    }
+    assignColors();
+
+    // Spilled representatives get a slot; coalesced nodes follow their alias
+    std::vector<int> node_slot(node_count, -1);
+    for (size_t n = precolored_count; n < node_count; ++n) {
+        if (state[n] == SPILLED) node_slot[n] = next_slot++;
+    }
+    for (size_t n = precolored_count; n < node_count; ++n) {
+        int representative = getAlias(static_cast<int>(n));
+        VReg reg = node_reg[n];
+        stats.values++;
+        if (state[representative] == SPILLED) {
+            spill_slots[reg.id] = node_slot[representative];
+            stats.spilled++;
+        } else {
+            func.getRegister(reg).physical = color[representative];
+        }
+    }
+
+    // Copies between coalesced registers are now no-ops
+    for (auto& block : func.blocks) {
+        auto& instructions = block->instructions;
+        size_t before = instructions.size();
+        instructions.erase(std::remove_if(instructions.begin(), instructions.end(),
+            [this](const Instruction& instr) {
+                return isMove(instr) &&
+                       getAlias(node_of[instr.operands[0].id]) == getAlias(node_of[instr.operands[1].id]);
+            }), instructions.end());
+        stats.coalesced_moves += before - instructions.size();
+    }
+}
+
+void GraphColoringAllocator::build() {
+    Liveness liveness(func);
+    std::vector<VReg> uses;
+
+    for (auto& block : func.blocks) {
+        std::set<int> live;
+        const std::vector<bool>& live_out = liveness.liveOut(block.get());
+        for (size_t id = 1; id < live_out.size(); ++id) {
+            if (live_out[id] && node_of[id] >= 0) live.insert(node_of[id]);
+        }
+
+        for (auto it = block->instructions.rbegin(); it != block->instructions.rend(); ++it) {
+            const Instruction& instr = *it;
+            Liveness::collectUses(func, instr, uses);
+
+            if (isMove(instr)) {
+                int dest = node_of[instr.operands[0].id];
+                int src = node_of[instr.operands[1].id];
+                live.erase(src);
+                int index = static_cast<int>(moves.size());
+                moves.push_back({dest, src, MOVE_WORKLIST});
+                move_list[dest].push_back(index);
+                move_list[src].push_back(index);
+                worklist_moves.insert(index);
+            }
+
+            int def = -1;
+            if (instr.definesFirstOperand() && inClass(instr.operands[0])) {
+                def = node_of[instr.operands[0].id];
+                live.insert(def);
+                for (int l : live) addEdge(l, def);
+            }
+
+            // Calls clobber every caller-saved register of the class; the
+            // call's own result is written after the clobber
+            if (instr.opcode == Instruction::CALL) {
+                const std::vector<int>& allocatable = coloring_float ? file.allocatable_floating : file.allocatable_general;
+                for (int physical : allocatable) {
+                    if (file.get(coloring_float, physical).callee_saved) continue;
+                    for (int l : live) {
+                        if (l != def) addEdge(l, physical);
+                    }
+                }
+            }
+
+            if (def >= 0) live.erase(def);
+            for (VReg reg : uses) {
+                if (inClass(reg)) live.insert(node_of[reg.id]);
+            }
+        }
+    }
+}
+
+void GraphColoringAllocator::addEdge(int u, int v) {
+    if (u == v || adjacentTo(u, v)) return;
+
+    adj_set.insert(static_cast<uint64_t>(u) << 32 | static_cast<uint32_t>(v));
+    adj_set.insert(static_cast<uint64_t>(v) << 32 | static_cast<uint32_t>(u));
+    if (state[u] != PRECOLORED) {
+        adj_list[u].push_back(v);
+        degree[u]++;
+    }
+    if (state[v] != PRECOLORED) {
+        adj_list[v].push_back(u);
+        degree[v]++;
+    }
+}
+
+bool GraphColoringAllocator::adjacentTo(int u, int v) const {
+    return adj_set.count(static_cast<uint64_t>(u) << 32 | static_cast<uint32_t>(v)) != 0;
+}
+
+std::vector<int> GraphColoringAllocator::adjacent(int n) const {
+    std::vector<int> result;
+    for (int m : adj_list[n]) {
+        if (state[m] != SELECT && state[m] != COALESCED) result.push_back(m);
+    }
+    return result;
+}
+
+std::vector<int> GraphColoringAllocator::nodeMoves(int n) const {
+    std::vector<int> result;
+    for (int m : move_list[n]) {
+        if (moves[m].state == MOVE_ACTIVE || moves[m].state == MOVE_WORKLIST) result.push_back(m);
+    }
+    return result;
+}
+
+void GraphColoringAllocator::makeWorklist() {
+    for (size_t n = precolored_count; n < node_reg.size(); ++n) {
+        int node = static_cast<int>(n);
+        if (degree[node] >= k) {
+            state[node] = SPILL;
+            spill_worklist.insert(node);
+        } else if (moveRelated(node)) {
+            state[node] = FREEZE;
+            freeze_worklist.insert(node);
+        } else {
+            state[node] = SIMPLIFY;
+            simplify_worklist.insert(node);
+        }
+    }
+}
+
+void GraphColoringAllocator::simplify() {
+    int n = *simplify_worklist.begin();
+    simplify_worklist.erase(simplify_worklist.begin());
+    state[n] = SELECT;
+    select_stack.push_back(n);
+    for (int m : adjacent(n)) {
+        decrementDegree(m);
+    }
+}
+
+void GraphColoringAllocator::decrementDegree(int m) {
+    if (state[m] == PRECOLORED) return;
+
+    int d = degree[m]--;
+    if (d == k) {
+        enableMoves(m);
+        for (int n : adjacent(m)) enableMoves(n);
+        spill_worklist.erase(m);
+        if (moveRelated(m)) {
+            state[m] = FREEZE;
+            freeze_worklist.insert(m);
+        } else {
+            state[m] = SIMPLIFY;
+            simplify_worklist.insert(m);
+        }
+    }
+}
+
+void GraphColoringAllocator::enableMoves(int n) {
+    for (int m : nodeMoves(n)) {
+        if (moves[m].state == MOVE_ACTIVE) {
+            moves[m].state = MOVE_WORKLIST;
+            worklist_moves.insert(m);
+        }
+    }
+}
+
+void GraphColoringAllocator::coalesce() {
+    int m = *worklist_moves.begin();
+    worklist_moves.erase(worklist_moves.begin());
+
+    int x = getAlias(moves[m].dest);
+    int y = getAlias(moves[m].src);
+    int u = x, v = y;
+    if (state[y] == PRECOLORED) {
+        u = y;
+        v = x;
+    }
+
+    if (u == v) {
+        moves[m].state = MOVE_COALESCED;
+        addWorklist(u);
+    } else if (state[v] == PRECOLORED || adjacentTo(u, v)) {
+        moves[m].state = MOVE_CONSTRAINED;
+        addWorklist(u);
+        addWorklist(v);
+    } else if (state[u] == PRECOLORED ? [&] {
+                   for (int t : adjacent(v)) {
+                       if (!georgeTest(t, u)) return false;
+                   }
+                   return true;
+               }() : briggsTest(u, v)) {
+        moves[m].state = MOVE_COALESCED;
+        combine(u, v);
+        addWorklist(u);
+    } else {
+        moves[m].state = MOVE_ACTIVE;
+    }
+}
+
+void GraphColoringAllocator::addWorklist(int u) {
+    if (state[u] != PRECOLORED && !moveRelated(u) && degree[u] < k) {
+        freeze_worklist.erase(u);
+        state[u] = SIMPLIFY;
+        simplify_worklist.insert(u);
+    }
+}
+
+bool GraphColoringAllocator::georgeTest(int t, int r) const {
+    return degree[t] < k || state[t] == PRECOLORED || adjacentTo(t, r);
+}
+
+bool GraphColoringAllocator::briggsTest(int u, int v) const {
+    // Conservative: the merged node has fewer than k neighbours of significant degree
+    std::set<int> neighbours;
+    for (int n : adjacent(u)) neighbours.insert(n);
+    for (int n : adjacent(v)) neighbours.insert(n);
+    int significant = 0;
+    for (int n : neighbours) {
+        if (degree[n] >= k) significant++;
+    }
+    return significant < k;
+}
+
+int GraphColoringAllocator::getAlias(int n) const {
+    while (state[n] == COALESCED) n = alias[n];
+    return n;
+}
+
+void GraphColoringAllocator::combine(int u, int v) {
+    if (state[v] == FREEZE) {
+        freeze_worklist.erase(v);
+    } else {
+        spill_worklist.erase(v);
+    }
+    state[v] = COALESCED;
+    alias[v] = u;
+    move_list[u].insert(move_list[u].end(), move_list[v].begin(), move_list[v].end());
+    enableMoves(v);
+    for (int t : adjacent(v)) {
+        addEdge(t, u);
+        decrementDegree(t);
+    }
+    if (degree[u] >= k && state[u] == FREEZE) {
+        freeze_worklist.erase(u);
+        state[u] = SPILL;
+        spill_worklist.insert(u);
+    }
+}
+
+void GraphColoringAllocator::freeze() {
+    int u = *freeze_worklist.begin();
+    freeze_worklist.erase(freeze_worklist.begin());
+    state[u] = SIMPLIFY;
+    simplify_worklist.insert(u);
+    freezeMoves(u);
+}
+
+void GraphColoringAllocator::freezeMoves(int u) {
+    for (int m : nodeMoves(u)) {
+        int x = moves[m].dest;
+        int y = moves[m].src;
+        int v = getAlias(y) == getAlias(u) ? getAlias(x) : getAlias(y);
+
+        worklist_moves.erase(m);
+        moves[m].state = MOVE_FROZEN;
+        if (state[v] == FREEZE && nodeMoves(v).empty() && degree[v] < k) {
+            freeze_worklist.erase(v);
+            state[v] = SIMPLIFY;
+            simplify_worklist.insert(v);
+        }
+    }
+}
+
+void GraphColoringAllocator::selectSpill() {
+    // Cheapest node per unit of degree removed from the graph
+    int chosen = -1;
+    double best = 0;
+    for (int n : spill_worklist) {
+        double priority = static_cast<double>(spill_cost[n]) / degree[n];
+        if (chosen < 0 || priority < best) {
+            chosen = n;
+            best = priority;
+        }
+    }
+    spill_worklist.erase(chosen);
+    state[chosen] = SIMPLIFY;
+    simplify_worklist.insert(chosen);
+    freezeMoves(chosen);
+}
+
+void GraphColoringAllocator::assignColors() {
+    const std::vector<int>& allocatable = coloring_float ? file.allocatable_floating : file.allocatable_general;
+
+    while (!select_stack.empty()) {
+        int n = select_stack.back();
+        select_stack.pop_back();
+
+        std::vector<bool> taken(precolored_count, false);
+        for (int w : adj_list[n]) {
+            int a = getAlias(w);
+            if (state[a] == COLORED || state[a] == PRECOLORED) taken[color[a]] = true;
+        }
+
+        state[n] = SPILLED;
+        for (int physical : allocatable) {
+            if (!taken[physical]) {
+                state[n] = COLORED;
+                color[n] = physical;
+                break;
+            }
+        }
+    }
+}
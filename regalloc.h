@@ -0,0 +1,144 @@
+#pragma once
+
+#include "ir.h"
+#include "target.h"
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+// Register allocation strategy
+enum class AllocatorKind {
+    LINEAR_SCAN,        // Fast, used by default
+    GRAPH_COLORING      // Iterated register coalescing, slower but fewer copies and spills
+};
+
+// Counters reported by register allocation
+struct AllocationStats {
+    size_t values;          // Virtual registers that needed a machine register
+    size_t spilled;         // Virtual registers assigned a stack slot instead
+    size_t reloads;         // Loads inserted before uses of spilled registers
+    size_t spill_stores;    // Stores inserted after definitions of spilled registers
+    size_t callee_saved;    // Callee-saved registers that functions must preserve
+    size_t coalesced_moves; // Copies removed because both sides share a register
+
+    AllocationStats() : values(0), spilled(0), reloads(0), spill_stores(0), callee_saved(0), coalesced_moves(0) {}
+};
+
+// Live range of one virtual register over the linearized instruction order
+struct LiveInterval {
+    VReg reg;
+    Register::Type type;
+    int start;
+    int end;
+    bool crosses_call;      // A call lies strictly inside the range
+    int physical;           // Assigned machine register, -1 if spilled
+
+    LiveInterval(VReg reg, Register::Type type, int start, int end)
+        : reg(reg), type(type), start(start), end(end), crosses_call(false), physical(-1) {}
+};
+
+// Linear-scan allocation (Poletto and Sarkar) on intervals computed from
+// CFG liveness. Values live across a call only receive callee-saved
+// registers, and no value receives a register while the calling convention
+// has pinned another value to it; when a class runs out, the interval
+// ending last is spilled.
+class LinearScanAllocator {
+public:
+    LinearScanAllocator(Function& func, const RegisterFile& file);
+
+    void run(AllocationStats& stats);
+
+private:
+    Function& func;
+    const RegisterFile& file;
+    std::vector<LiveInterval> intervals;
+    std::vector<std::vector<std::pair<int, int>>> fixed_ranges[2];  // Per class and machine register
+
+    void buildIntervals();
+    bool canUse(const LiveInterval& interval, int physical) const;
+};
+
+// Iterated register coalescing (George and Appel) on an interference graph
+// built from CFG liveness. Calls define every caller-saved register, so
+// values live across them are colored with callee-saved registers.
+// Registers pinned by the calling convention are the precolored nodes, so
+// argument and result copies coalesce away where they can. Each
+// register class is colored separately; uncolorable nodes are spilled
+// through the same scratch-register scheme as the linear-scan allocator.
+class GraphColoringAllocator {
+public:
+    GraphColoringAllocator(Function& func, const RegisterFile& file);
+
+    void run(AllocationStats& stats);
+
+private:
+    enum NodeState { PRECOLORED, INITIAL, SIMPLIFY, FREEZE, SPILL, SPILLED, COALESCED, COLORED, SELECT };
+    enum MoveState { MOVE_WORKLIST, MOVE_ACTIVE, MOVE_COALESCED, MOVE_CONSTRAINED, MOVE_FROZEN };
+
+    struct Move {
+        int dest;
+        int src;
+        MoveState state;
+    };
+
+    Function& func;
+    const RegisterFile& file;
+
+    // Graph for the register class being colored. Nodes [0, precolored_count)
+    // stand for machine registers, the rest for virtual registers.
+    bool coloring_float;
+    int k;
+    int precolored_count;
+    std::vector<VReg> node_reg;
+    std::vector<int> node_of;               // Indexed by VReg::id
+    std::vector<NodeState> state;
+    std::vector<int> degree;
+    std::vector<int> alias;
+    std::vector<int> color;
+    std::vector<int> spill_cost;
+    std::vector<std::vector<int>> adj_list;
+    std::unordered_set<uint64_t> adj_set;
+    std::vector<std::vector<int>> move_list;
+    std::vector<Move> moves;
+
+    std::set<int> simplify_worklist;
+    std::set<int> freeze_worklist;
+    std::set<int> spill_worklist;
+    std::set<int> worklist_moves;
+    std::vector<int> select_stack;
+
+    bool isMove(const Instruction& instr) const;
+    bool inClass(VReg reg) const;
+
+    void colorClass(bool is_float, std::vector<int>& spill_slots, int& next_slot, AllocationStats& stats);
+    void build();
+    void addEdge(int u, int v);
+    bool adjacentTo(int u, int v) const;
+    std::vector<int> adjacent(int n) const;
+    std::vector<int> nodeMoves(int n) const;
+    bool moveRelated(int n) const { return !nodeMoves(n).empty(); }
+    void makeWorklist();
+    void simplify();
+    void decrementDegree(int m);
+    void enableMoves(int n);
+    void coalesce();
+    void addWorklist(int u);
+    bool georgeTest(int t, int r) const;
+    bool briggsTest(int u, int v) const;
+    int getAlias(int n) const;
+    void combine(int u, int v);
+    void freeze();
+    void freezeMoves(int u);
+    void selectSpill();
+    void assignColors();
+};
+
+// Rewrites every use of a spilled register as a reload into a scratch
+// register and every definition as a store, then sizes the frame.
+// spill_slots is indexed by VReg::id and holds -1 for registers kept in
+// machine registers.
+void insertSpillCode(Function& func, const RegisterFile& file,
+                     const std::vector<int>& spill_slots, AllocationStats& stats);
+
+// Records which callee-saved registers the allocation touched
+void recordSavedRegisters(Function& func, const RegisterFile& file, AllocationStats& stats);
@@ -0,0 +1,66 @@
+// Profile runtime for programs compiled with --profile-generate. Link it
+// into the instrumented program; at exit it writes the counts that
+// --profile-use reads.
+//
+// ABI: every profile point calls _profile_count(key) with the point's
+// 32-bit key (profileKey in profile.h) in the first integer argument
+// register, sign-extended to 64 bits.
+//
+// File: one "key count" line per point that ran, the key as 8 hex digits
+// and the count in decimal. Lines starting with '#' are comments. The file
+// is GDSCRIPT_PROFILE, or gdscript.profile in the working directory.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+struct counter {
+    unsigned int key;
+    unsigned long long count;   // Zero for a free slot
+};
+
+static struct counter* counters;
+static size_t capacity;         // A power of two
+static size_t used;
+
+static struct counter* slot(struct counter* table, size_t size, unsigned int key) {
+    size_t i = (key * 2654435761u) & (size - 1);
+    while (table[i].count != 0 && table[i].key != key) i = (i + 1) & (size - 1);
+    return &table[i];
+}
+
+static void dump(void) {
+    const char* path = getenv("GDSCRIPT_PROFILE");
+    FILE* file = fopen(path && *path ? path : "gdscript.profile", "w");
+    if (!file) {
+        perror("gdscript profile");
+        return;
+    }
+    fprintf(file, "# key count\n");
+    for (size_t i = 0; i < capacity; ++i) {
+        if (counters[i].count != 0) fprintf(file, "%08x %llu\n", counters[i].key, counters[i].count);
+    }
+    fclose(file);
+}
+
+static void grow(void) {
+    size_t size = capacity ? capacity * 2 : 256;
+    struct counter* table = calloc(size, sizeof(struct counter));
+    if (!table) abort();
+    for (size_t i = 0; i < capacity; ++i) {
+        if (counters[i].count != 0) *slot(table, size, counters[i].key) = counters[i];
+    }
+    if (!counters) atexit(dump);
+    free(counters);
+    counters = table;
+    capacity = size;
+}
+
+void _profile_count(long key) {
+    if (2 * (used + 1) > capacity) grow();
+    struct counter* counter = slot(counters, capacity, (unsigned int)key);
+    if (counter->count == 0) {
+        counter->key = (unsigned int)key;
+        used++;
+    }
+    counter->count++;
+}
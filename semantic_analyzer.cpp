@@ -1,6 +1,19 @@
 #include "semantic_analyzer.h"
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static TypeInfo constantType(const ConstantValue& value) {
+    switch (value.kind) {
+        case ConstantValue::INT: return TypeInfo(GDType::INT);
+        case ConstantValue::FLOAT: return TypeInfo(GDType::FLOAT);
+        case ConstantValue::BOOL: return TypeInfo(GDType::BOOL);
+        case ConstantValue::STRING: return TypeInfo(GDType::STRING);
+        default: return TypeInfo(GDType::VARIANT);
+    }
+}
 
 // TypeInfo implementation
 std::string TypeInfo::toString() const {
@@ -11,7 +24,7 @@ std::string TypeInfo::toString() const {
         case GDType::FLOAT: result = "float"; break;
         case GDType::STRING: result = "String"; break;
         case GDType::BOOL: result = "bool"; break;
-        case GDType::ARRAY: result = "Array"; break;
+        case GDType::ARRAY: result = custom_name.empty() ? "Array" : custom_name; break;
         case GDType::DICTIONARY: result = "Dictionary"; break;
         case GDType::VECTOR2: result = "Vector2"; break;
         case GDType::VECTOR3: result = "Vector3"; break;
@@ -24,8 +37,8 @@ std::string TypeInfo::toString() const {
         default: result = "unknown"; break;
     }
     
-    // Add generic parameters if any
-    if (!generic_params.empty()) {
+    // Add generic parameters if any (packed arrays imply theirs)
+    if (!generic_params.empty() && custom_name.empty()) {
         result += "[";
         for (size_t i = 0; i < generic_params.size(); ++i) {
             if (i > 0) result += ", ";
@@ -60,6 +73,15 @@ bool TypeInfo::isNumeric() const {
     return base_type == GDType::INT || base_type == GDType::FLOAT;
 }
 
+// An instance of a subclass may stand wherever its base class is expected
+bool SemanticAnalyzer::isAssignable(const TypeInfo& target, const TypeInfo& value) const {
+    if (target.isCompatibleWith(value)) return true;
+    if (target.base_type != GDType::CUSTOM || value.base_type != GDType::CUSTOM) return false;
+    const ClassEntry* target_class = class_hierarchy.findClass(target.custom_name);
+    const ClassEntry* value_class = class_hierarchy.findClass(value.custom_name);
+    return target_class && value_class && class_hierarchy.isSubclassOf(value_class->id, target_class->id);
+}
+
 // Scope implementation
 Symbol* Scope::findSymbol(const std::string& name) {
     auto it = symbols.find(name);
@@ -95,10 +117,79 @@ void Scope::defineFunction(const FunctionSignature& function) {
     functions[function.name] = function;
 }
 
+// ClassEntry implementation
+const FieldSlot* ClassEntry::findField(const std::string& field_name) const {
+    auto it = field_index.find(field_name);
+    return it != field_index.end() ? &fields[it->second] : nullptr;
+}
+
+const MethodSlot* ClassEntry::findMethod(const std::string& method_name) const {
+    auto it = method_index.find(method_name);
+    return it != method_index.end() ? &vtable[it->second] : nullptr;
+}
+
+// ClassHierarchy implementation
+ClassEntry* ClassHierarchy::createEntry(const std::string& name) {
+    auto entry = std::make_unique<ClassEntry>();
+    entry->id = static_cast<int>(entries.size());
+    entry->name = name;
+    ids[name] = entry->id;
+    entries.push_back(std::move(entry));
+    return entries.back().get();
+}
+
+ClassEntry* ClassHierarchy::getClass(int id) {
+    if (id < 0 || id >= static_cast<int>(entries.size())) return nullptr;
+    return entries[id].get();
+}
+
+const ClassEntry* ClassHierarchy::getClass(int id) const {
+    if (id < 0 || id >= static_cast<int>(entries.size())) return nullptr;
+    return entries[id].get();
+}
+
+const ClassEntry* ClassHierarchy::findClass(const std::string& name) const {
+    auto it = ids.find(name);
+    return it != ids.end() ? entries[it->second].get() : nullptr;
+}
+
+bool ClassHierarchy::isSubclassOf(int derived_id, int base_id) const {
+    const ClassEntry* derived = getClass(derived_id);
+    const ClassEntry* base = getClass(base_id);
+    if (!derived || !base) return false;
+
+    // Display check: the base must sit at its own depth in the derived chain
+    int base_depth = base->depth();
+    return base_depth <= derived->depth() && derived->display[base_depth] == base_id;
+}
+
+bool ClassHierarchy::isOverridden(int class_id, int slot) const {
+    const ClassEntry* entry = getClass(class_id);
+    if (!entry || slot < 0 || slot >= static_cast<int>(entry->overridden.size())) return false;
+    return entry->overridden[slot];
+}
+
+void ClassHierarchy::markOverridden(const ClassEntry& entry, int slot) {
+    // Every ancestor that already has this slot can no longer be dispatched statically
+    for (int ancestor_id : entry.display) {
+        if (ancestor_id == entry.id) continue;
+        ClassEntry* ancestor = getClass(ancestor_id);
+        if (ancestor && slot < static_cast<int>(ancestor->overridden.size())) {
+            ancestor->overridden[slot] = true;
+        }
+    }
+}
+
+std::string ClassHierarchy::getImplementationName(const ClassEntry& entry, int slot) const {
+    const MethodSlot& method = entry.vtable[slot];
+    const ClassEntry* owner = getClass(method.owner_id);
+    return (owner ? owner->name : entry.name) + "_" + method.name;
+}
+
 // SemanticAnalyzer implementation
 SemanticAnalyzer::SemanticAnalyzer() 
     : global_scope(std::make_unique<Scope>()), current_scope(global_scope.get()),
-      in_loop(false), expected_return_type(GDType::VOID) {
+      inference(nullptr), in_loop(false), expected_return_type(GDType::VOID) {
     initializeBuiltinTypes();
 }
 
@@ -126,6 +217,16 @@ void SemanticAnalyzer::initializeBuiltinTypes() {
     builtin_types["String"] = TypeInfo(GDType::STRING);
     builtin_types["bool"] = TypeInfo(GDType::BOOL);
     builtin_types["Array"] = TypeInfo(GDType::ARRAY);
+    
+    // Packed arrays store raw elements instead of Variants
+    const std::pair<const char*, GDType> packed_arrays[] = {
+        {"PackedInt32Array", GDType::INT}, {"PackedInt64Array", GDType::INT}, {"PackedFloat32Array", GDType::FLOAT}
+    };
+    for (const auto& packed : packed_arrays) {
+        TypeInfo type(GDType::ARRAY, packed.first);
+        type.generic_params.push_back(TypeInfo(packed.second));
+        builtin_types[packed.first] = type;
+    }
     builtin_types["Dictionary"] = TypeInfo(GDType::DICTIONARY);
     builtin_types["Vector2"] = TypeInfo(GDType::VECTOR2);
     builtin_types["Vector3"] = TypeInfo(GDType::VECTOR3);
@@ -139,12 +240,28 @@ void SemanticAnalyzer::initializeBuiltinTypes() {
     std::vector<TypeInfo> print_params = {}; // Empty params for variadic
     global_scope->defineFunction(FunctionSignature("print", print_params, TypeInfo(GDType::VOID), false, true));
     
-    std::vector<TypeInfo> range_params = {TypeInfo(GDType::INT)};
-    global_scope->defineFunction(FunctionSignature("range", range_params, TypeInfo(GDType::ARRAY)));
+    // range(end), range(start, end) and range(start, end, step)
+    std::vector<TypeInfo> range_params = {TypeInfo(GDType::INT), TypeInfo(GDType::INT), TypeInfo(GDType::INT)};
+    FunctionSignature range_signature("range", range_params, TypeInfo(GDType::ARRAY));
+    range_signature.required_parameters = 1;
+    global_scope->defineFunction(range_signature);
+    
+    // assert(condition) and assert(condition, message)
+    std::vector<TypeInfo> assert_params = {TypeInfo(GDType::VARIANT), TypeInfo(GDType::STRING)};
+    FunctionSignature assert_signature("assert", assert_params, TypeInfo(GDType::VOID));
+    assert_signature.required_parameters = 1;
+    global_scope->defineFunction(assert_signature);
     
     std::vector<TypeInfo> len_params = {TypeInfo(GDType::VARIANT)};
     global_scope->defineFunction(FunctionSignature("len", len_params, TypeInfo(GDType::INT)));
     
+    // Packed array constructors, optionally converting an Array
+    for (const char* packed : {"PackedInt32Array", "PackedInt64Array", "PackedFloat32Array"}) {
+        FunctionSignature constructor(packed, {TypeInfo(GDType::ARRAY)}, builtin_types[packed]);
+        constructor.required_parameters = 0;
+        global_scope->defineFunction(constructor);
+    }
+    
     // str() - converts any value to string
     std::vector<TypeInfo> str_params = {TypeInfo(GDType::VARIANT)};
     global_scope->defineFunction(FunctionSignature("str", str_params, TypeInfo(GDType::STRING)));
@@ -193,7 +310,17 @@ void SemanticAnalyzer::analyzeMatchStmt(MatchStmt* stmt) {
     TypeInfo match_type = getExpressionType(stmt->expression.get());
     
     // Analyze each match case
+    bool has_wildcard = false;
     for (auto& match_case : stmt->cases) {
+        if (has_wildcard) {
+            addWarning("Pattern after '_' is unreachable", match_case.pattern->line);
+        }
+        if (match_case.isWildcard()) {
+            has_wildcard = true;
+            analyzeStatement(match_case.body.get());
+            continue;
+        }
+        
         // Analyze the pattern (which is an expression)
         analyzeExpression(match_case.pattern.get());
         TypeInfo pattern_type = getExpressionType(match_case.pattern.get());
@@ -299,6 +426,7 @@ void SemanticAnalyzer::analyzeProgram(Program* program) {
     for (auto& stmt : program->statements) {
         analyzeStatement(stmt.get());
     }
+    inferParameterTypes();
 }
 
 void SemanticAnalyzer::analyzeStatement(Statement* stmt) {
@@ -375,7 +503,7 @@ void SemanticAnalyzer::analyzeVarDecl(VarDecl* decl) {
         analyzeExpression(decl->initializer.get());
         inferred_type = getExpressionType(decl->initializer.get());
         
-        if (!declared_type.isCompatibleWith(inferred_type) && declared_type.base_type != GDType::VARIANT) {
+        if (!isAssignable(declared_type, inferred_type) && declared_type.base_type != GDType::VARIANT) {
             addError("Type mismatch: cannot assign " + inferred_type.toString() + 
                     " to " + declared_type.toString(), decl->line);
         }
@@ -386,8 +514,11 @@ void SemanticAnalyzer::analyzeVarDecl(VarDecl* decl) {
         addError("Variable '" + decl->name + "' already defined", decl->line);
     }
     
-    Symbol symbol(decl->name, declared_type.base_type != GDType::VARIANT ? declared_type : inferred_type, 
-                  false, decl->is_static, decl->line);
+    // Untyped locals are dynamically typed; the inference pass narrows them per program point
+    bool dynamic_local = !current_function.empty() && decl->type.empty() && !decl->is_inferred;
+    TypeInfo symbol_type = declared_type.base_type != GDType::VARIANT || dynamic_local ? declared_type : inferred_type;
+    
+    Symbol symbol(decl->name, symbol_type, false, decl->is_static, decl->line);
     symbol.is_initialized = (decl->initializer != nullptr);
     current_scope->defineSymbol(symbol);
 }
@@ -403,6 +534,7 @@ void SemanticAnalyzer::analyzeConstDecl(ConstDecl* decl) {
     
     Symbol symbol(decl->name, value_type, true, false, decl->line);
     symbol.is_initialized = true;
+    symbol.constant_value = decl->value->constant;
     current_scope->defineSymbol(symbol);
 }
 
@@ -455,6 +587,7 @@ void SemanticAnalyzer::analyzeFuncDecl(FuncDecl* decl) {
     }
     
     analyzeStatement(decl->body.get());
+    inferFunctionTypes(decl, param_types);
     
     current_function = old_function;
     expected_return_type = old_return_type;
@@ -509,6 +642,9 @@ void SemanticAnalyzer::analyzeClassDecl(ClassDecl* decl) {
             
             FunctionSignature signature(func_decl->name, param_types, return_type, func_decl->is_static, func_decl->line);
             current_scope->defineFunction(signature);
+            if (class_info.methods.find(func_decl->name) == class_info.methods.end()) {
+                class_info.method_order.push_back(func_decl->name);
+            }
             class_info.methods[func_decl->name] = signature;
         } else if (member->type == ASTNodeType::SIGNAL_DECL) {
             analyzeStatement(member.get());
@@ -516,18 +652,45 @@ void SemanticAnalyzer::analyzeClassDecl(ClassDecl* decl) {
             class_info.signals.push_back(signal_decl->name);
         } else if (member->type == ASTNodeType::VAR_DECL || member->type == ASTNodeType::CONST_DECL || member->type == ASTNodeType::ENUM_DECL) {
             analyzeStatement(member.get());
-            
+
             if (member->type == ASTNodeType::VAR_DECL) {
                 VarDecl* var_decl = static_cast<VarDecl*>(member.get());
-                TypeInfo member_type = getBuiltinType(var_decl->type);
-                if (member_type.base_type == GDType::UNKNOWN && !var_decl->type.empty()) {
+                // Use the type the declaration resolved to (declared or inferred)
+                Symbol* declared = current_scope->findSymbol(var_decl->name);
+                TypeInfo member_type = declared ? declared->type : TypeInfo(GDType::VARIANT);
+                if (member_type.base_type == GDType::UNKNOWN) {
                     member_type = TypeInfo(GDType::VARIANT);
                 }
+                if (class_info.members.find(var_decl->name) == class_info.members.end()) {
+                    class_info.member_order.push_back(var_decl->name);
+                }
                 class_info.members[var_decl->name] = Symbol(var_decl->name, member_type, false, var_decl->is_static);
+                class_info.members[var_decl->name].is_initialized = var_decl->initializer != nullptr;
             }
         }
     }
-    
+
+    // Register the class and index it before analyzing bodies so that methods
+    // can resolve their own and inherited members through the hierarchy
+    classes[decl->name] = class_info;
+    indexClass(classes[decl->name]);
+
+    if (const ClassEntry* entry = class_hierarchy.findClass(decl->name)) {
+        // Make inherited members and methods visible in the class scope
+        for (const auto& field : entry->fields) {
+            if (field.owner_id != entry->id) {
+                Symbol inherited(field.name, field.type, false, field.is_static);
+                inherited.is_initialized = true;
+                current_scope->defineSymbol(inherited);
+            }
+        }
+        for (const auto& method : entry->vtable) {
+            if (method.owner_id != entry->id) {
+                current_scope->defineFunction(method.signature);
+            }
+        }
+    }
+
     // Second pass: Analyze function bodies
     for (auto& member : decl->members) {
         if (member->type == ASTNodeType::FUNC_DECL) {
@@ -546,6 +709,13 @@ void SemanticAnalyzer::analyzeClassDecl(ClassDecl* decl) {
             current_function = func_decl->name;
             expected_return_type = func_sig->return_type;
             
+            // Instance methods receive an implicit, typed 'self'
+            if (!func_decl->is_static) {
+                Symbol self_symbol("self", TypeInfo(GDType::CUSTOM, decl->name), true, false, func_decl->line);
+                self_symbol.is_initialized = true;
+                current_scope->defineSymbol(self_symbol);
+            }
+            
             // Add parameters to function scope
             for (size_t i = 0; i < func_decl->parameters.size(); ++i) {
                 const auto& param = func_decl->parameters[i];
@@ -555,6 +725,7 @@ void SemanticAnalyzer::analyzeClassDecl(ClassDecl* decl) {
             }
             
             analyzeStatement(func_decl->body.get());
+            inferFunctionTypes(func_decl, func_sig->parameter_types);
             
             current_function = old_function;
             expected_return_type = old_return_type;
@@ -563,12 +734,193 @@ void SemanticAnalyzer::analyzeClassDecl(ClassDecl* decl) {
         }
     }
     
-    classes[decl->name] = class_info;
-    
     current_class = old_class;
     exitScope();
 }
 
+void SemanticAnalyzer::indexClass(const ClassInfo& class_info) {
+    if (class_hierarchy.findClass(class_info.name)) {
+        return; // Redefinition, already reported
+    }
+    
+    ClassEntry* entry = class_hierarchy.createEntry(class_info.name);
+    const ClassEntry* parent = nullptr;
+    
+    if (!class_info.base_class.empty()) {
+        parent = class_hierarchy.findClass(class_info.base_class);
+        if (!parent) {
+            // Engine or otherwise unknown base: the chain cannot be fully resolved
+            entry->unresolved_base = class_info.base_class;
+        }
+    }
+    
+    // Inherit the parent's flattened layout
+    if (parent) {
+        entry->parent_id = parent->id;
+        entry->unresolved_base = parent->unresolved_base;
+        entry->display = parent->display;
+        entry->fields = parent->fields;
+        entry->field_index = parent->field_index;
+        entry->vtable = parent->vtable;
+        entry->method_index = parent->method_index;
+    }
+    entry->display.push_back(entry->id);
+    
+    // Own fields get fresh slots after the inherited prefix
+    for (const auto& member_name : class_info.member_order) {
+        const Symbol& member = class_info.members.at(member_name);
+        if (entry->field_index.count(member_name)) {
+            const ClassEntry* owner = class_hierarchy.getClass(entry->findField(member_name)->owner_id);
+            addError("Member '" + member_name + "' in class '" + class_info.name +
+                     "' already exists in parent class '" + (owner ? owner->name : "") + "'",
+                     class_info.declaration_line);
+            continue;
+        }
+        FieldSlot field(member_name, member.type, static_cast<int>(entry->fields.size()), entry->id, member.is_static);
+        field.has_initializer = member.is_initialized;
+        entry->field_index[member_name] = field.slot;
+        entry->fields.push_back(field);
+    }
+    
+    // Methods either override an inherited slot or append a new one
+    std::vector<int> overridden_slots;
+    for (const auto& method_name : class_info.method_order) {
+        const FunctionSignature& signature = class_info.methods.at(method_name);
+        auto it = entry->method_index.find(method_name);
+        if (it != entry->method_index.end()) {
+            MethodSlot& inherited = entry->vtable[it->second];
+            // Each class's _init runs in turn on .new(), so it takes its own arguments
+            if (method_name != "_init" && !isOverrideCompatible(inherited.signature, signature)) {
+                const ClassEntry* owner = class_hierarchy.getClass(inherited.owner_id);
+                addError("Method '" + method_name + "' in class '" + class_info.name +
+                         "' overrides '" + (owner ? owner->name : "") + "." + method_name +
+                         "' with an incompatible signature", signature.declaration_line);
+            }
+            inherited.signature = signature;
+            inherited.owner_id = entry->id;
+            inherited.is_static = signature.is_static;
+            overridden_slots.push_back(inherited.slot);
+            continue;
+        }
+        MethodSlot method{method_name, signature, static_cast<int>(entry->vtable.size()), entry->id, signature.is_static};
+        entry->method_index[method_name] = method.slot;
+        entry->vtable.push_back(method);
+    }
+    
+    entry->overridden.assign(entry->vtable.size(), false);
+    for (int slot : overridden_slots) {
+        class_hierarchy.markOverridden(*entry, slot);
+    }
+    
+    computeClassLayout(entry, parent);
+}
+
+void SemanticAnalyzer::computeClassLayout(ClassEntry* entry, const ClassEntry* parent) {
+    const int pointer_size = 8;
+    const int bools_per_word = 32; // Keeps every bit mask within a signed 32-bit immediate
+    
+    auto align_to = [](int value, int alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    };
+    
+    // Inherited prefix is kept byte-for-byte so parent methods work on subclasses
+    if (parent) {
+        entry->instance_size = parent->instance_size;
+        entry->instance_alignment = parent->instance_alignment;
+        entry->bool_word_offset = parent->bool_word_offset;
+        entry->bool_bits_used = parent->bool_bits_used;
+    } else {
+        entry->instance_size = pointer_size; // vtable pointer
+        entry->instance_alignment = pointer_size;
+    }
+    
+    // Group own fields by alignment to avoid padding; bools are packed last
+    std::vector<FieldSlot*> aligned8, aligned4, bools;
+    for (auto& field : entry->fields) {
+        if (field.owner_id != entry->id || field.is_static) continue;
+        
+        switch (field.type.base_type) {
+            case GDType::BOOL:
+                field.size = pointer_size;
+                field.alignment = pointer_size;
+                bools.push_back(&field);
+                break;
+            case GDType::VECTOR2:
+                field.size = 8;          // Two packed 32-bit floats, loaded as one word
+                field.alignment = 8;
+                aligned8.push_back(&field);
+                break;
+            case GDType::VECTOR3:
+                field.size = 12;
+                field.alignment = 4;
+                field.is_inline = true;
+                aligned4.push_back(&field);
+                break;
+            case GDType::VARIANT:
+            case GDType::UNKNOWN:
+                field.size = 24;         // Type tag plus 16 bytes of payload
+                field.alignment = 8;
+                field.is_inline = true;
+                aligned8.push_back(&field);
+                break;
+            default:
+                // int and float are 64-bit; references are pointer sized
+                field.size = 8;
+                field.alignment = 8;
+                aligned8.push_back(&field);
+                break;
+        }
+    }
+    
+    int offset = entry->instance_size;
+    for (FieldSlot* field : aligned8) {
+        offset = align_to(offset, field->alignment);
+        field->offset = offset;
+        offset += field->size;
+    }
+    
+    for (FieldSlot* field : bools) {
+        // Reuse free bits in the current word, including one inherited from the parent
+        if (entry->bool_word_offset < 0 || entry->bool_bits_used >= bools_per_word) {
+            offset = align_to(offset, pointer_size);
+            entry->bool_word_offset = offset;
+            entry->bool_bits_used = 0;
+            offset += pointer_size;
+        }
+        field->offset = entry->bool_word_offset;
+        field->bit = entry->bool_bits_used++;
+    }
+    
+    for (FieldSlot* field : aligned4) {
+        offset = align_to(offset, field->alignment);
+        field->offset = offset;
+        offset += field->size;
+    }
+    
+    for (FieldSlot* field : aligned8) {
+        entry->instance_alignment = std::max(entry->instance_alignment, field->alignment);
+    }
+    entry->instance_size = align_to(offset, entry->instance_alignment);
+}
+
+bool SemanticAnalyzer::isOverrideCompatible(const FunctionSignature& base, const FunctionSignature& derived) {
+    if (base.parameter_types.size() != derived.parameter_types.size()) return false;
+    if (base.is_static != derived.is_static) return false;
+    
+    for (size_t i = 0; i < base.parameter_types.size(); ++i) {
+        const TypeInfo& base_param = base.parameter_types[i];
+        const TypeInfo& derived_param = derived.parameter_types[i];
+        if (base_param != derived_param &&
+            base_param.base_type != GDType::VARIANT && derived_param.base_type != GDType::VARIANT) {
+            return false;
+        }
+    }
+    
+    return base.return_type.base_type == GDType::VARIANT ||
+           derived.return_type.base_type == GDType::VARIANT ||
+           base.return_type == derived.return_type;
+}
+
 void SemanticAnalyzer::analyzeSignalDecl(SignalDecl* decl) {
     // Check if signal name conflicts with existing symbols
     if (current_scope->findSymbol(decl->name)) {
@@ -593,22 +945,28 @@ void SemanticAnalyzer::analyzeSignalDecl(SignalDecl* decl) {
 }
 
 void SemanticAnalyzer::analyzeEnumDecl(EnumDecl* decl) {
-    // Check if enum name conflicts with existing symbols
-    if (current_scope->findSymbol(decl->name)) {
-        addError("Enum '" + decl->name + "' conflicts with existing symbol", decl->line);
-        return;
+    if (!decl->name.empty()) {
+        // Check if enum name conflicts with existing symbols
+        if (current_scope->findSymbol(decl->name)) {
+            addError("Enum '" + decl->name + "' conflicts with existing symbol", decl->line);
+            return;
+        }
+        
+        // Register the enum as a custom type
+        TypeInfo enum_type(GDType::CUSTOM, decl->name);
+        Symbol enum_symbol(decl->name, enum_type, true, false, decl->line);
+        enum_symbol.is_initialized = true;
+        current_scope->defineSymbol(enum_symbol);
     }
     
-    // Register the enum as a custom type
-    TypeInfo enum_type(GDType::CUSTOM, decl->name);
-    Symbol enum_symbol(decl->name, enum_type, true, false, decl->line);
-    current_scope->defineSymbol(enum_symbol);
-    
-    // Analyze enum values
-    int auto_value = 0;
-    for (const auto& enum_value : decl->values) {
+    // Analyze enum values; members without a value continue from the previous one.
+    // Members of a named enum live in its own table and are only reached as
+    // Enum.MEMBER; those of an unnamed enum are constants of the scope.
+    long long auto_value = 0;
+    for (auto& enum_value : decl->values) {
         // Check if enum value name conflicts
-        if (current_scope->findSymbol(enum_value.name)) {
+        Symbol* owner = decl->name.empty() ? nullptr : current_scope->findSymbol(decl->name);
+        if (owner ? owner->enum_members.count(enum_value.name) != 0 : current_scope->findSymbol(enum_value.name) != nullptr) {
             addError("Enum value '" + enum_value.name + "' conflicts with existing symbol", decl->line);
             continue;
         }
@@ -617,14 +975,26 @@ void SemanticAnalyzer::analyzeEnumDecl(EnumDecl* decl) {
         if (enum_value.value) {
             analyzeExpression(enum_value.value.get());
             TypeInfo value_type = getExpressionType(enum_value.value.get());
+            const ConstantValue& constant = enum_value.value->constant;
             if (value_type.base_type != GDType::INT) {
                 addError("Enum value '" + enum_value.name + "' must be an integer", decl->line);
+            } else if (constant.kind != ConstantValue::INT) {
+                addError("Enum value '" + enum_value.name + "' must be a constant expression", decl->line);
+            } else {
+                auto_value = constant.int_value;
             }
         }
+        enum_value.computed_value = auto_value;
         
-        // Register the enum value as a constant
-        Symbol value_symbol(enum_value.name, TypeInfo(GDType::INT), true, false, decl->line);
-        current_scope->defineSymbol(value_symbol);
+        if (owner) {
+            owner->enum_members[enum_value.name] = auto_value;
+        } else {
+            // Register the enum value as a constant
+            Symbol value_symbol(enum_value.name, TypeInfo(GDType::INT), true, false, decl->line);
+            value_symbol.is_initialized = true;
+            value_symbol.constant_value = ConstantValue::makeInt(auto_value);
+            current_scope->defineSymbol(value_symbol);
+        }
         
         auto_value++;
     }
@@ -677,6 +1047,7 @@ void SemanticAnalyzer::analyzeForStmt(ForStmt* stmt) {
     
     if (iterable_type.base_type != GDType::ARRAY && 
         iterable_type.base_type != GDType::STRING &&
+        iterable_type.base_type != GDType::INT &&
         iterable_type.base_type != GDType::VARIANT) {
         addError("Cannot iterate over " + iterable_type.toString(), stmt->line);
     }
@@ -715,7 +1086,7 @@ void SemanticAnalyzer::analyzeReturnStmt(ReturnStmt* stmt) {
         return_type = getExpressionType(stmt->value.get());
     }
     
-    if (!expected_return_type.isCompatibleWith(return_type)) {
+    if (!isAssignable(expected_return_type, return_type)) {
         addError("Return type mismatch: expected " + expected_return_type.toString() + 
                 ", got " + return_type.toString(), stmt->line);
     }
@@ -766,6 +1137,681 @@ void SemanticAnalyzer::analyzeExpression(Expression* expr) {
             addError("Unknown expression type", expr->line);
             break;
     }
+    
+    // Record the resolved type and value while the expression's scope is still active
+    expr->constant = evaluateConstant(expr);
+    TypeInfo type = getExpressionType(expr);
+    if (expr->constant.isKnown() && (type.base_type == GDType::UNKNOWN || type.base_type == GDType::VARIANT)) {
+        type = constantType(expr->constant);
+    }
+    expression_types[expr] = type;
+}
+
+TypeInfo SemanticAnalyzer::getResolvedType(const Expression* expr) const {
+    auto it = expression_types.find(expr);
+    return it != expression_types.end() ? it->second : TypeInfo(GDType::UNKNOWN);
+}
+
+TypeInfo SemanticAnalyzer::getDeclarationType(const Statement* decl) const {
+    auto it = declaration_types.find(decl);
+    return it != declaration_types.end() ? it->second : TypeInfo(GDType::UNKNOWN);
+}
+
+TypeInfo SemanticAnalyzer::getParameterType(const FuncDecl* decl, size_t index) const {
+    auto it = function_inference.find(decl);
+    if (it == function_inference.end() || index >= it->second.parameter_types.size()) {
+        return TypeInfo(GDType::UNKNOWN);
+    }
+    return it->second.parameter_types[index];
+}
+
+const ClassEntry* SemanticAnalyzer::getConstructedClass(const CallExpr* call) const {
+    if (call->callee->type != ASTNodeType::MEMBER_ACCESS) return nullptr;
+    const MemberAccessExpr* member = static_cast<const MemberAccessExpr*>(call->callee.get());
+    if (member->member != "new" || member->object->type != ASTNodeType::IDENTIFIER) return nullptr;
+    return class_hierarchy.findClass(static_cast<const IdentifierExpr*>(member->object.get())->name);
+}
+
+// Constant evaluation
+//
+// Runs bottom-up from analyzeExpression, so every child already carries its
+// value. Follows GDScript's runtime semantics: int arithmetic wraps at 64
+// bits and truncates on division, mixing in a float promotes to float.
+
+static long long wrappingArithmetic(long long a, long long b, TokenType op) {
+    unsigned long long ua = static_cast<unsigned long long>(a);
+    unsigned long long ub = static_cast<unsigned long long>(b);
+    switch (op) {
+        case TokenType::PLUS: return static_cast<long long>(ua + ub);
+        case TokenType::MINUS: return static_cast<long long>(ua - ub);
+        default: return static_cast<long long>(ua * ub);
+    }
+}
+
+ConstantValue SemanticAnalyzer::evaluateConstant(Expression* expr) {
+    switch (expr->type) {
+        case ASTNodeType::LITERAL: {
+            LiteralExpr* literal = static_cast<LiteralExpr*>(expr);
+            std::string text = literal->value;
+            try {
+                switch (literal->literal_type) {
+                    case TokenType::INTEGER:
+                        text.erase(std::remove(text.begin(), text.end(), '_'), text.end());
+                        return ConstantValue::makeInt(std::stoll(text, nullptr, 10));
+                    case TokenType::FLOAT:
+                        text.erase(std::remove(text.begin(), text.end(), '_'), text.end());
+                        return ConstantValue::makeFloat(std::stod(text));
+                    case TokenType::STRING: return ConstantValue::makeString(literal->value);
+                    case TokenType::BOOLEAN: return ConstantValue::makeBool(literal->value == "true");
+                    case TokenType::NULL_LITERAL: return ConstantValue::makeNil();
+                    default: break;
+                }
+            } catch (const std::exception&) {
+                addError("Invalid numeric literal '" + literal->value + "'", expr->line);
+            }
+            return ConstantValue();
+        }
+        case ASTNodeType::IDENTIFIER: {
+            Symbol* symbol = current_scope->findSymbol(static_cast<IdentifierExpr*>(expr)->name);
+            return symbol && symbol->is_constant ? symbol->constant_value : ConstantValue();
+        }
+        case ASTNodeType::MEMBER_ACCESS: {
+            // Enum.MEMBER
+            MemberAccessExpr* member = static_cast<MemberAccessExpr*>(expr);
+            if (member->object->type != ASTNodeType::IDENTIFIER) return ConstantValue();
+            Symbol* owner = current_scope->findSymbol(static_cast<IdentifierExpr*>(member->object.get())->name);
+            if (!owner || !owner->is_constant || owner->type.base_type != GDType::CUSTOM) return ConstantValue();
+            auto value = owner->enum_members.find(member->member);
+            return value != owner->enum_members.end() ? ConstantValue::makeInt(value->second) : ConstantValue();
+        }
+        case ASTNodeType::BINARY_OP: {
+            BinaryOpExpr* bin = static_cast<BinaryOpExpr*>(expr);
+            if (!bin->left->constant.isKnown() || !bin->right->constant.isKnown()) return ConstantValue();
+            return evaluateBinaryConstant(bin->left->constant, bin->operator_type, bin->right->constant, expr->line);
+        }
+        case ASTNodeType::UNARY_OP: {
+            UnaryOpExpr* un = static_cast<UnaryOpExpr*>(expr);
+            if (!un->operand->constant.isKnown()) return ConstantValue();
+            return evaluateUnaryConstant(un->operator_type, un->operand->constant);
+        }
+        case ASTNodeType::TERNARY: {
+            TernaryExpr* ternary = static_cast<TernaryExpr*>(expr);
+            if (!ternary->condition->constant.isKnown()) return ConstantValue();
+            return ternary->condition->constant.isTruthy() ? ternary->true_expr->constant
+                                                           : ternary->false_expr->constant;
+        }
+        default:
+            return ConstantValue();
+    }
+}
+
+ConstantValue SemanticAnalyzer::evaluateBinaryConstant(const ConstantValue& left, TokenType op,
+                                                       const ConstantValue& right, int line) {
+    switch (op) {
+        case TokenType::AND:
+        case TokenType::LOGICAL_AND:
+            return ConstantValue::makeBool(left.isTruthy() && right.isTruthy());
+        case TokenType::OR:
+        case TokenType::LOGICAL_OR:
+            return ConstantValue::makeBool(left.isTruthy() || right.isTruthy());
+        default:
+            break;
+    }
+    
+    if (left.kind == ConstantValue::STRING && right.kind == ConstantValue::STRING) {
+        switch (op) {
+            case TokenType::PLUS: return ConstantValue::makeString(left.string_value + right.string_value);
+            case TokenType::EQUAL: return ConstantValue::makeBool(left.string_value == right.string_value);
+            case TokenType::NOT_EQUAL: return ConstantValue::makeBool(left.string_value != right.string_value);
+            case TokenType::LESS: return ConstantValue::makeBool(left.string_value < right.string_value);
+            case TokenType::LESS_EQUAL: return ConstantValue::makeBool(left.string_value <= right.string_value);
+            case TokenType::GREATER: return ConstantValue::makeBool(left.string_value > right.string_value);
+            case TokenType::GREATER_EQUAL: return ConstantValue::makeBool(left.string_value >= right.string_value);
+            default: return ConstantValue();
+        }
+    }
+    
+    if (!left.isNumeric() || !right.isNumeric()) return ConstantValue();
+    
+    if (left.kind != ConstantValue::FLOAT && right.kind != ConstantValue::FLOAT) {
+        long long a = left.int_value;
+        long long b = right.int_value;
+        switch (op) {
+            case TokenType::PLUS:
+            case TokenType::MINUS:
+            case TokenType::MULTIPLY:
+                return ConstantValue::makeInt(wrappingArithmetic(a, b, op));
+            case TokenType::DIVIDE:
+            case TokenType::MODULO:
+                if (b == 0) {
+                    addError("Division by zero in constant expression", line);
+                    return ConstantValue();
+                }
+                if (a == std::numeric_limits<long long>::min() && b == -1) {
+                    return ConstantValue::makeInt(op == TokenType::DIVIDE ? a : 0);
+                }
+                return ConstantValue::makeInt(op == TokenType::DIVIDE ? a / b : a % b);
+            case TokenType::EQUAL: return ConstantValue::makeBool(a == b);
+            case TokenType::NOT_EQUAL: return ConstantValue::makeBool(a != b);
+            case TokenType::LESS: return ConstantValue::makeBool(a < b);
+            case TokenType::LESS_EQUAL: return ConstantValue::makeBool(a <= b);
+            case TokenType::GREATER: return ConstantValue::makeBool(a > b);
+            case TokenType::GREATER_EQUAL: return ConstantValue::makeBool(a >= b);
+            default: return ConstantValue();
+        }
+    }
+    
+    double a = left.asFloat();
+    double b = right.asFloat();
+    switch (op) {
+        case TokenType::PLUS: return ConstantValue::makeFloat(a + b);
+        case TokenType::MINUS: return ConstantValue::makeFloat(a - b);
+        case TokenType::MULTIPLY: return ConstantValue::makeFloat(a * b);
+        case TokenType::DIVIDE: return ConstantValue::makeFloat(a / b);
+        case TokenType::MODULO: return ConstantValue::makeFloat(std::fmod(a, b));
+        case TokenType::EQUAL: return ConstantValue::makeBool(a == b);
+        case TokenType::NOT_EQUAL: return ConstantValue::makeBool(a != b);
+        case TokenType::LESS: return ConstantValue::makeBool(a < b);
+        case TokenType::LESS_EQUAL: return ConstantValue::makeBool(a <= b);
+        case TokenType::GREATER: return ConstantValue::makeBool(a > b);
+        case TokenType::GREATER_EQUAL: return ConstantValue::makeBool(a >= b);
+        default: return ConstantValue();
+    }
+}
+
+ConstantValue SemanticAnalyzer::evaluateUnaryConstant(TokenType op, const ConstantValue& operand) {
+    switch (op) {
+        case TokenType::MINUS:
+            if (operand.kind == ConstantValue::INT) return ConstantValue::makeInt(wrappingArithmetic(0, operand.int_value, TokenType::MINUS));
+            if (operand.kind == ConstantValue::FLOAT) return ConstantValue::makeFloat(-operand.float_value);
+            return ConstantValue();
+        case TokenType::PLUS:
+            return operand.kind == ConstantValue::INT || operand.kind == ConstantValue::FLOAT ? operand : ConstantValue();
+        case TokenType::NOT:
+        case TokenType::LOGICAL_NOT:
+            return ConstantValue::makeBool(!operand.isTruthy());
+        default:
+            return ConstantValue();
+    }
+}
+
+// Type inference pass
+//
+// Runs after a function body has been analyzed. Untyped locals and parameters
+// are tracked through the body with one type per program point; branches
+// join, loops iterate to a fixpoint, and any disagreement widens to Variant.
+// The refined types overwrite expression_types so codegen sees them, and the
+// join over the whole function becomes the variable's storage type.
+
+void FlowState::join(const FlowState& other) {
+    if (!other.reachable) return;
+    if (!reachable) {
+        *this = other;
+        return;
+    }
+    for (auto& entry : types) {
+        auto it = other.types.find(entry.first);
+        entry.second = it != other.types.end() ? SemanticAnalyzer::joinTypes(entry.second, it->second)
+                                               : TypeInfo(GDType::VARIANT);
+    }
+    for (const auto& entry : other.types) {
+        if (types.find(entry.first) == types.end()) {
+            types[entry.first] = TypeInfo(GDType::VARIANT);
+        }
+    }
+}
+
+TypeInfo SemanticAnalyzer::joinTypes(const TypeInfo& a, const TypeInfo& b) {
+    if (a.base_type == GDType::UNKNOWN) return b;
+    if (b.base_type == GDType::UNKNOWN) return a;
+    return a == b ? a : TypeInfo(GDType::VARIANT);
+}
+
+void SemanticAnalyzer::inferFunctionTypes(FuncDecl* decl, const std::vector<TypeInfo>& param_types) {
+    if (current_class.empty()) {
+        script_functions[decl->name] = decl;
+    }
+    inferFunctionBody(decl, param_types);
+}
+
+// One run over the body with the given parameter types. An untyped
+// parameter that enters with its call sites' type keeps it only if every
+// assignment in the body agrees; otherwise it goes back to Variant and the
+// body is inferred again. Replaces what an earlier run recorded.
+void SemanticAnalyzer::inferFunctionBody(FuncDecl* decl, const std::vector<TypeInfo>& param_types) {
+    std::vector<TypeInfo> types = param_types;
+    types.resize(decl->parameters.size(), TypeInfo(GDType::VARIANT));
+    
+    while (true) {
+        InferenceContext context;
+        InferenceContext* old_inference = inference;
+        inference = &context;
+        for (size_t i = 0; i < decl->parameters.size(); ++i) {
+            const Parameter& param = decl->parameters[i];
+            if (param.type.empty()) {
+                // Untyped parameters are tracked like untyped locals
+                context.bindings[param.name] = &param;
+                assignFlowType(&param, types[i]);
+            }
+        }
+        inferStatementTypes(decl->body.get());
+        inference = old_inference;
+        
+        bool widened = false;
+        for (size_t i = 0; i < decl->parameters.size(); ++i) {
+            if (!decl->parameters[i].type.empty() || types[i].base_type == GDType::VARIANT) continue;
+            if (context.summary[&decl->parameters[i]] != types[i]) {
+                types[i] = TypeInfo(GDType::VARIANT);
+                widened = true;
+            }
+        }
+        if (widened) continue;
+        
+        FunctionInference& result = function_inference[decl];
+        result.parameter_types = types;
+        result.calls = context.calls;
+        result.stats = InferenceStats();
+        for (size_t i = 0; i < decl->parameters.size(); ++i) {
+            if (!decl->parameters[i].type.empty()) {
+                result.stats.declared_parameters++;
+            } else if (types[i].base_type != GDType::VARIANT) {
+                result.stats.inferred_parameters++;
+            } else {
+                result.stats.variant_parameters++;
+            }
+        }
+        for (const Statement* declaration : context.declarations) {
+            auto it = context.summary.find(declaration);
+            TypeInfo type = it != context.summary.end() ? it->second : TypeInfo(GDType::VARIANT);
+            if (type.base_type == GDType::UNKNOWN) {
+                type = TypeInfo(GDType::VARIANT);
+            }
+            declaration_types[declaration] = type;
+            if (type.base_type == GDType::VARIANT) {
+                result.stats.variant_locals++;
+            } else {
+                result.stats.inferred_locals++;
+            }
+        }
+        result.stats.declared_locals = static_cast<int>(context.typed_declarations.size());
+        return;
+    }
+}
+
+// Untyped parameters of a script function take the type all its calls
+// pass, when every call is known: the function is never used as a value
+// and each call sits in an inferred function body. Narrowing a parameter
+// can narrow the arguments its function passes on, so this repeats until
+// nothing changes; each parameter is tried once.
+void SemanticAnalyzer::inferParameterTypes() {
+    std::unordered_set<const Parameter*> tried;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& entry : script_functions) {
+            FuncDecl* decl = entry.second;
+            auto sites = call_sites.find(entry.first);
+            auto inferred = function_inference.find(decl);
+            if (escaped_functions.count(entry.first) || sites == call_sites.end() ||
+                inferred == function_inference.end()) {
+                continue;
+            }
+            
+            std::vector<TypeInfo> joined(decl->parameters.size());
+            size_t covered = 0;
+            for (const auto& function : function_inference) {
+                for (const auto& call : function.second.calls) {
+                    if (!sites->second.count(call.first)) continue;
+                    covered++;
+                    for (size_t i = 0; i < joined.size() && i < call.second.size(); ++i) {
+                        joined[i] = joinTypes(joined[i], call.second[i]);
+                    }
+                }
+            }
+            if (covered != sites->second.size()) continue;
+            
+            std::vector<TypeInfo> types = inferred->second.parameter_types;
+            bool narrowed = false;
+            for (size_t i = 0; i < types.size(); ++i) {
+                const Parameter* param = &decl->parameters[i];
+                GDType joined_type = joined[i].base_type;
+                if (!param->type.empty() || tried.count(param) || joined_type == GDType::UNKNOWN ||
+                    joined_type == GDType::VARIANT || joined_type == GDType::VOID) {
+                    continue;
+                }
+                tried.insert(param);
+                types[i] = joined[i];
+                narrowed = true;
+            }
+            if (!narrowed) continue;
+            inferFunctionBody(decl, types);
+            changed = true;
+        }
+    }
+    
+    inference_stats = InferenceStats();
+    for (const auto& function : function_inference) {
+        const InferenceStats& stats = function.second.stats;
+        inference_stats.declared_locals += stats.declared_locals;
+        inference_stats.inferred_locals += stats.inferred_locals;
+        inference_stats.variant_locals += stats.variant_locals;
+        inference_stats.declared_parameters += stats.declared_parameters;
+        inference_stats.inferred_parameters += stats.inferred_parameters;
+        inference_stats.variant_parameters += stats.variant_parameters;
+    }
+}
+
+void SemanticAnalyzer::assignFlowType(const void* variable, const TypeInfo& type) {
+    TypeInfo flow_type = type.base_type == GDType::UNKNOWN || type.base_type == GDType::VOID ?
+                         TypeInfo(GDType::VARIANT) : type;
+    inference->state.types[variable] = flow_type;
+    
+    auto it = inference->summary.find(variable);
+    inference->summary[variable] = it != inference->summary.end() ? joinTypes(it->second, flow_type) : flow_type;
+}
+
+void SemanticAnalyzer::inferStatementTypes(Statement* stmt) {
+    if (!stmt) return;
+    FlowState& state = inference->state;
+    
+    switch (stmt->type) {
+        case ASTNodeType::BLOCK: {
+            BlockStmt* block = static_cast<BlockStmt*>(stmt);
+            // Locals declared in the block go out of scope at its end
+            auto outer = inference->bindings;
+            for (auto& child : block->statements) {
+                inferStatementTypes(child.get());
+            }
+            inference->bindings = outer;
+            break;
+        }
+        case ASTNodeType::VAR_DECL: {
+            VarDecl* var_decl = static_cast<VarDecl*>(stmt);
+            TypeInfo init_type = var_decl->initializer ? inferType(var_decl->initializer.get()) : TypeInfo(GDType::VARIANT);
+            if (var_decl->type.empty() && !var_decl->is_inferred) {
+                inference->bindings[var_decl->name] = var_decl;
+                inference->declarations.insert(var_decl);
+                assignFlowType(var_decl, init_type);
+            } else if (var_decl->is_inferred) {
+                // ':=' fixes the type its initializer infers to, which an
+                // untyped local in the initializer only gets from this pass
+                inference->bindings[var_decl->name] = var_decl;
+                inference->typed_declarations.insert(var_decl);
+                assignFlowType(var_decl, init_type);
+            } else {
+                // Typed locals keep their declared type and hide a same-named untyped one
+                inference->bindings.erase(var_decl->name);
+                inference->typed_declarations.insert(var_decl);
+            }
+            break;
+        }
+        case ASTNodeType::CONST_DECL:
+            inferType(static_cast<ConstDecl*>(stmt)->value.get());
+            break;
+        case ASTNodeType::EXPRESSION_STMT:
+            inferType(static_cast<ExpressionStmt*>(stmt)->expression.get());
+            break;
+        case ASTNodeType::IF_STMT: {
+            IfStmt* if_stmt = static_cast<IfStmt*>(stmt);
+            inferType(if_stmt->condition.get());
+            FlowState entry = state;
+            inferStatementTypes(if_stmt->then_branch.get());
+            FlowState then_state = inference->state;
+            inference->state = entry;
+            inferStatementTypes(if_stmt->else_branch.get());
+            inference->state.join(then_state);
+            break;
+        }
+        case ASTNodeType::WHILE_STMT: {
+            WhileStmt* while_stmt = static_cast<WhileStmt*>(stmt);
+            inferLoopTypes(while_stmt->condition.get(), while_stmt->body.get(), nullptr, TypeInfo());
+            break;
+        }
+        case ASTNodeType::FOR_STMT: {
+            ForStmt* for_stmt = static_cast<ForStmt*>(stmt);
+            TypeInfo iterable_type = inferType(for_stmt->iterable.get());
+            TypeInfo element_type(GDType::VARIANT);
+            if (for_stmt->iterable->type == ASTNodeType::CALL) {
+                CallExpr* call = static_cast<CallExpr*>(for_stmt->iterable.get());
+                if (call->callee->type == ASTNodeType::IDENTIFIER &&
+                    static_cast<IdentifierExpr*>(call->callee.get())->name == "range") {
+                    element_type = TypeInfo(GDType::INT);
+                }
+            } else if (iterable_type.base_type == GDType::ARRAY && !iterable_type.generic_params.empty()) {
+                element_type = iterable_type.generic_params[0];
+            } else if (iterable_type.base_type == GDType::STRING) {
+                element_type = TypeInfo(GDType::STRING);
+            } else if (iterable_type.base_type == GDType::INT) {
+                element_type = TypeInfo(GDType::INT);
+            }
+            
+            auto outer = inference->bindings;
+            inference->bindings[for_stmt->variable] = for_stmt;
+            inference->declarations.insert(for_stmt);
+            inferLoopTypes(nullptr, for_stmt->body.get(), for_stmt, element_type);
+            inference->bindings = outer;
+            break;
+        }
+        case ASTNodeType::MATCH_STMT: {
+            MatchStmt* match_stmt = static_cast<MatchStmt*>(stmt);
+            inferType(match_stmt->expression.get());
+            FlowState entry = state;
+            FlowState result = entry;
+            result.reachable = false;
+            bool exhaustive = false;
+            for (auto& match_case : match_stmt->cases) {
+                inference->state = entry;
+                if (match_case.isWildcard()) {
+                    exhaustive = true;
+                } else {
+                    inferType(match_case.pattern.get());
+                }
+                inferStatementTypes(match_case.body.get());
+                result.join(inference->state);
+            }
+            if (!exhaustive) {
+                result.join(entry);     // No pattern matched
+            }
+            inference->state = result;
+            break;
+        }
+        case ASTNodeType::RETURN_STMT:
+            inferType(static_cast<ReturnStmt*>(stmt)->value.get());
+            state.reachable = false;
+            break;
+        case ASTNodeType::BREAK_STMT:
+            if (inference->break_states) inference->break_states->push_back(state);
+            state.reachable = false;
+            break;
+        case ASTNodeType::CONTINUE_STMT:
+            if (inference->continue_states) inference->continue_states->push_back(state);
+            state.reachable = false;
+            break;
+        default:
+            break;
+    }
+}
+
+void SemanticAnalyzer::inferLoopTypes(Expression* condition, Statement* body, const Statement* loop_var, const TypeInfo& loop_var_type) {
+    std::vector<FlowState>* old_breaks = inference->break_states;
+    std::vector<FlowState>* old_continues = inference->continue_states;
+    std::vector<FlowState> breaks;
+    std::vector<FlowState> continues;
+    inference->break_states = &breaks;
+    inference->continue_states = &continues;
+    
+    // Each variable can only widen (unset -> type -> Variant), so this terminates
+    FlowState head = inference->state;
+    while (true) {
+        breaks.clear();
+        continues.clear();
+        inference->state = head;
+        if (condition) inferType(condition);
+        if (loop_var) assignFlowType(loop_var, loop_var_type);
+        
+        inferStatementTypes(body);
+        
+        FlowState next = head;
+        next.join(inference->state);
+        for (const auto& continued : continues) {
+            next.join(continued);
+        }
+        if (next == head) break;
+        head = next;
+    }
+    
+    inference->state = head;
+    for (const auto& broken : breaks) {
+        inference->state.join(broken);
+    }
+    
+    inference->break_states = old_breaks;
+    inference->continue_states = old_continues;
+}
+
+static TokenType compoundBaseOperator(TokenType op) {
+    switch (op) {
+        case TokenType::PLUS_ASSIGN: return TokenType::PLUS;
+        case TokenType::MINUS_ASSIGN: return TokenType::MINUS;
+        case TokenType::MULTIPLY_ASSIGN: return TokenType::MULTIPLY;
+        case TokenType::DIVIDE_ASSIGN: return TokenType::DIVIDE;
+        case TokenType::MODULO_ASSIGN: return TokenType::MODULO;
+        default: return op;
+    }
+}
+
+TypeInfo SemanticAnalyzer::inferType(Expression* expr) {
+    if (!expr) return TypeInfo(GDType::VOID);
+    
+    TypeInfo type = getResolvedType(expr);
+    
+    switch (expr->type) {
+        case ASTNodeType::IDENTIFIER: {
+            IdentifierExpr* id = static_cast<IdentifierExpr*>(expr);
+            if (inference) {
+                auto binding = inference->bindings.find(id->name);
+                if (binding != inference->bindings.end()) {
+                    auto it = inference->state.types.find(binding->second);
+                    type = it != inference->state.types.end() ? it->second : TypeInfo(GDType::VARIANT);
+                }
+            }
+            break;
+        }
+        case ASTNodeType::BINARY_OP: {
+            BinaryOpExpr* bin = static_cast<BinaryOpExpr*>(expr);
+            TokenType op = bin->operator_type;
+            bool is_assignment = op == TokenType::ASSIGN || op == TokenType::TYPE_INFER_ASSIGN ||
+                                 compoundBaseOperator(op) != op;
+            if (!is_assignment) {
+                TypeInfo left_type = inferType(bin->left.get());
+                TypeInfo right_type = inferType(bin->right.get());
+                TypeInfo result = getBinaryResultType(left_type, op, right_type);
+                if (result.base_type != GDType::UNKNOWN) type = result;
+                break;
+            }
+            
+            TypeInfo value_type = inferType(bin->right.get());
+            // The target records the type it held before the assignment
+            TypeInfo current_type = inferType(bin->left.get());
+            if (bin->left->type == ASTNodeType::IDENTIFIER && inference) {
+                auto binding = inference->bindings.find(static_cast<IdentifierExpr*>(bin->left.get())->name);
+                if (binding != inference->bindings.end()) {
+                    // A ':=' local keeps its type; the value is converted to it
+                    if (!inference->typed_declarations.count(static_cast<const Statement*>(binding->second))) {
+                        TypeInfo new_type = value_type;
+                        if (compoundBaseOperator(op) != op) {
+                            new_type = getBinaryResultType(current_type, compoundBaseOperator(op), value_type);
+                        }
+                        assignFlowType(binding->second, new_type);
+                    }
+                    type = inference->state.types[binding->second];
+                }
+            }
+            break;
+        }
+        case ASTNodeType::UNARY_OP: {
+            UnaryOpExpr* un = static_cast<UnaryOpExpr*>(expr);
+            TypeInfo result = getUnaryResultType(un->operator_type, inferType(un->operand.get()));
+            if (result.base_type != GDType::UNKNOWN) type = result;
+            break;
+        }
+        case ASTNodeType::CALL: {
+            CallExpr* call = static_cast<CallExpr*>(expr);
+            std::vector<TypeInfo> arg_types;
+            for (auto& arg : call->arguments) {
+                arg_types.push_back(inferType(arg.get()));
+            }
+            if (call->callee->type == ASTNodeType::IDENTIFIER && inference) {
+                // Argument types of a direct call of a script function, joined
+                // over the loop iterations; missing arguments take defaults
+                const std::string& name = static_cast<IdentifierExpr*>(call->callee.get())->name;
+                auto function = script_functions.find(name);
+                auto sites = call_sites.find(name);
+                if (function != script_functions.end() && sites != call_sites.end() && sites->second.count(call)) {
+                    std::vector<TypeInfo>& joined = inference->calls[call];
+                    joined.resize(function->second->parameters.size());
+                    for (size_t i = 0; i < joined.size(); ++i) {
+                        joined[i] = joinTypes(joined[i], i < arg_types.size() ? arg_types[i] : TypeInfo(GDType::VARIANT));
+                    }
+                }
+            }
+            if (const ClassEntry* entry = getConstructedClass(call)) {
+                type = TypeInfo(GDType::CUSTOM, entry->name);
+            } else if (call->callee->type == ASTNodeType::MEMBER_ACCESS) {
+                MemberAccessExpr* member = static_cast<MemberAccessExpr*>(call->callee.get());
+                TypeInfo object_type = inferType(member->object.get());
+                if (object_type.base_type == GDType::CUSTOM) {
+                    const ClassEntry* entry = class_hierarchy.findClass(object_type.custom_name);
+                    const MethodSlot* method = entry ? entry->findMethod(member->member) : nullptr;
+                    if (method) type = method->signature.return_type;
+                }
+            }
+            break;
+        }
+        case ASTNodeType::MEMBER_ACCESS: {
+            MemberAccessExpr* member = static_cast<MemberAccessExpr*>(expr);
+            TypeInfo object_type = inferType(member->object.get());
+            if (object_type.base_type == GDType::CUSTOM) {
+                const ClassEntry* entry = class_hierarchy.findClass(object_type.custom_name);
+                const FieldSlot* field = entry ? entry->findField(member->member) : nullptr;
+                if (field) type = field->type;
+            }
+            break;
+        }
+        case ASTNodeType::ARRAY_ACCESS: {
+            ArrayAccessExpr* access = static_cast<ArrayAccessExpr*>(expr);
+            inferType(access->array.get());
+            inferType(access->index.get());
+            break;
+        }
+        case ASTNodeType::ARRAY_LITERAL:
+            for (auto& element : static_cast<ArrayLiteralExpr*>(expr)->elements) {
+                inferType(element.get());
+            }
+            break;
+        case ASTNodeType::DICT_LITERAL:
+            for (auto& pair : static_cast<DictLiteralExpr*>(expr)->pairs) {
+                inferType(pair.first.get());
+                inferType(pair.second.get());
+            }
+            break;
+        case ASTNodeType::TERNARY: {
+            TernaryExpr* ternary = static_cast<TernaryExpr*>(expr);
+            inferType(ternary->condition.get());
+            TypeInfo true_type = inferType(ternary->true_expr.get());
+            TypeInfo false_type = inferType(ternary->false_expr.get());
+            type = joinTypes(true_type, false_type);
+            break;
+        }
+        default:
+            break;
+    }
+    
+    if (expr->constant.isKnown()) {
+        type = constantType(expr->constant);
+    }
+    expression_types[expr] = type;
+    return type;
 }
 
 void SemanticAnalyzer::analyzeLiteralExpr(LiteralExpr* expr) {
@@ -776,7 +1822,10 @@ void SemanticAnalyzer::analyzeIdentifierExpr(IdentifierExpr* expr) {
     Symbol* symbol = current_scope->findSymbol(expr->name);
     FunctionSignature* function = current_scope->findFunction(expr->name);
     
-    if (!symbol && !function) {
+    if (!symbol && function && function == global_scope->findFunction(expr->name)) {
+        escaped_functions.insert(expr->name);
+    }
+    if (!symbol && !function && !class_hierarchy.findClass(expr->name)) {
         addError("Undefined variable '" + expr->name + "'", expr->line);
     } else if (symbol && !symbol->is_initialized) {
         addWarning("Variable '" + expr->name + "' used before initialization", expr->line);
@@ -818,6 +1867,9 @@ void SemanticAnalyzer::analyzeCallExpr(CallExpr* expr) {
     if (expr->callee->type == ASTNodeType::IDENTIFIER) {
         IdentifierExpr* id_expr = static_cast<IdentifierExpr*>(expr->callee.get());
         FunctionSignature* func = current_scope->findFunction(id_expr->name);
+        if (func && func == global_scope->findFunction(id_expr->name)) {
+            call_sites[id_expr->name].insert(expr);
+        }
         
         if (func) {
             // Handle variadic functions (like print)
@@ -827,14 +1879,18 @@ void SemanticAnalyzer::analyzeCallExpr(CallExpr* expr) {
                 // (already done above in the loop)
             } else {
                 // Check argument count and types for non-variadic functions
-                if (expr->arguments.size() != func->parameter_types.size()) {
-                    addError("Function '" + func->name + "' expects " + 
-                            std::to_string(func->parameter_types.size()) + " arguments, got " + 
+                if (expr->arguments.size() < func->required_parameters ||
+                    expr->arguments.size() > func->parameter_types.size()) {
+                    std::string expected = std::to_string(func->parameter_types.size());
+                    if (func->required_parameters != func->parameter_types.size()) {
+                        expected = std::to_string(func->required_parameters) + " to " + expected;
+                    }
+                    addError("Function '" + func->name + "' expects " + expected + " arguments, got " + 
                             std::to_string(expr->arguments.size()), expr->line);
                 } else {
                     for (size_t i = 0; i < expr->arguments.size(); ++i) {
                         TypeInfo arg_type = getExpressionType(expr->arguments[i].get());
-                        if (!func->parameter_types[i].isCompatibleWith(arg_type)) {
+                        if (!isAssignable(func->parameter_types[i], arg_type)) {
                             addError("Argument " + std::to_string(i + 1) + " type mismatch: expected " + 
                                     func->parameter_types[i].toString() + ", got " + arg_type.toString(), expr->line);
                         }
@@ -853,7 +1909,16 @@ void SemanticAnalyzer::analyzeCallExpr(CallExpr* expr) {
 
 void SemanticAnalyzer::analyzeMemberAccessExpr(MemberAccessExpr* expr) {
     analyzeExpression(expr->object.get());
-    // Member access validation would require more detailed type information
+    
+    TypeInfo object_type = getExpressionType(expr->object.get());
+    if (object_type.base_type != GDType::CUSTOM) return;
+    
+    const ClassEntry* entry = class_hierarchy.findClass(object_type.custom_name);
+    if (!entry || !entry->isFullyResolved()) return;
+    
+    if (!entry->findField(expr->member) && !entry->findMethod(expr->member)) {
+        addWarning("Class '" + entry->name + "' has no member '" + expr->member + "'", expr->line);
+    }
 }
 
 void SemanticAnalyzer::analyzeArrayAccessExpr(ArrayAccessExpr* expr) {
@@ -930,11 +1995,37 @@ TypeInfo SemanticAnalyzer::getExpressionType(Expression* expr) {
         }
         case ASTNodeType::CALL: {
             CallExpr* call = static_cast<CallExpr*>(expr);
+            if (const ClassEntry* entry = getConstructedClass(call)) {
+                return TypeInfo(GDType::CUSTOM, entry->name);
+            }
             if (call->callee->type == ASTNodeType::IDENTIFIER) {
                 IdentifierExpr* id = static_cast<IdentifierExpr*>(call->callee.get());
                 FunctionSignature* func = current_scope->findFunction(id->name);
                 return func ? func->return_type : TypeInfo(GDType::UNKNOWN);
             }
+            if (call->callee->type == ASTNodeType::MEMBER_ACCESS) {
+                MemberAccessExpr* member = static_cast<MemberAccessExpr*>(call->callee.get());
+                TypeInfo object_type = getExpressionType(member->object.get());
+                if (object_type.base_type == GDType::CUSTOM) {
+                    const ClassEntry* entry = class_hierarchy.findClass(object_type.custom_name);
+                    const MethodSlot* method = entry ? entry->findMethod(member->member) : nullptr;
+                    if (method) {
+                        return method->signature.return_type;
+                    }
+                }
+            }
+            return TypeInfo(GDType::VARIANT);
+        }
+        case ASTNodeType::MEMBER_ACCESS: {
+            MemberAccessExpr* member = static_cast<MemberAccessExpr*>(expr);
+            TypeInfo object_type = getExpressionType(member->object.get());
+            if (object_type.base_type == GDType::CUSTOM) {
+                const ClassEntry* entry = class_hierarchy.findClass(object_type.custom_name);
+                const FieldSlot* field = entry ? entry->findField(member->member) : nullptr;
+                if (field) {
+                    return field->type;
+                }
+            }
             return TypeInfo(GDType::VARIANT);
         }
         case ASTNodeType::ARRAY_LITERAL:
@@ -1041,8 +2132,14 @@ TypeInfo SemanticAnalyzer::getBinaryResultType(const TypeInfo& left, TokenType o
         return TypeInfo(GDType::VARIANT);
     }
     
+    bool left_vector = left.base_type == GDType::VECTOR2 || left.base_type == GDType::VECTOR3;
+    bool right_vector = right.base_type == GDType::VECTOR2 || right.base_type == GDType::VECTOR3;
+    
     switch (op) {
         case TokenType::PLUS:
+            if (left_vector && left.base_type == right.base_type) {
+                return left;
+            }
             if (left.base_type == GDType::STRING || right.base_type == GDType::STRING) {
                 return TypeInfo(GDType::STRING);
             }
@@ -1055,6 +2152,14 @@ TypeInfo SemanticAnalyzer::getBinaryResultType(const TypeInfo& left, TokenType o
         case TokenType::MINUS:
         case TokenType::MULTIPLY:
         case TokenType::DIVIDE:
+            // Component-wise vector math and scaling by a scalar
+            if (left_vector && (left.base_type == right.base_type ||
+                                (op != TokenType::MINUS && right.isNumeric()))) {
+                return left;
+            }
+            if (right_vector && op == TokenType::MULTIPLY && left.isNumeric()) {
+                return right;
+            }
             if (left.isNumeric() && right.isNumeric()) {
                 return (left.base_type == GDType::FLOAT || right.base_type == GDType::FLOAT) ? 
                        TypeInfo(GDType::FLOAT) : TypeInfo(GDType::INT);
@@ -3,6 +3,7 @@
 
 #include "parser.h"
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <string>
 #include <memory>
@@ -55,6 +56,8 @@ struct Symbol {
     bool is_static;
     bool is_initialized;
     int declaration_line;
+    ConstantValue constant_value;   // Compile-time value of constants and enum members
+    std::unordered_map<std::string, long long> enum_members;    // Values of a named enum's members
     
     Symbol() : is_constant(false), is_static(false), is_initialized(false), declaration_line(0) {}
     
@@ -71,14 +74,15 @@ struct FunctionSignature {
     TypeInfo return_type;
     bool is_static;
     bool is_variadic;  // For functions that accept variable arguments like print
+    size_t required_parameters;  // Trailing parameters past this count are optional
     int declaration_line;
     
-    FunctionSignature() : is_static(false), is_variadic(false), declaration_line(0) {}
+    FunctionSignature() : is_static(false), is_variadic(false), required_parameters(0), declaration_line(0) {}
     
     FunctionSignature(const std::string& n, const std::vector<TypeInfo>& params,
                      const TypeInfo& ret, bool static_func = false, bool variadic = false, int line = 0)
         : name(n), parameter_types(params), return_type(ret), 
-          is_static(static_func), is_variadic(variadic), declaration_line(line) {}
+          is_static(static_func), is_variadic(variadic), required_parameters(params.size()), declaration_line(line) {}
 };
 
 // Class information
@@ -87,6 +91,8 @@ struct ClassInfo {
     std::string base_class;
     std::unordered_map<std::string, Symbol> members;
     std::unordered_map<std::string, FunctionSignature> methods;
+    std::vector<std::string> member_order;  // Declaration order, used for slot assignment
+    std::vector<std::string> method_order;
     std::vector<std::string> signals;
     int declaration_line;
     
@@ -96,6 +102,138 @@ struct ClassInfo {
         : name(n), base_class(base), declaration_line(line) {}
 };
 
+// Flattened field slot (inherited fields come first)
+struct FieldSlot {
+    std::string name;
+    TypeInfo type;
+    int slot;
+    int owner_id;       // Class that declared the field
+    bool is_static;
+    
+    // Object layout, computed by the analyzer (static fields have no offset)
+    int offset;         // Byte offset from the start of the object
+    int size;           // Storage size in bytes (bit-packed bools report their word)
+    int alignment;
+    int bit;            // Bit index inside the word at 'offset' for packed bools, -1 otherwise
+    bool is_inline;     // Aggregate stored inline and accessed by address (Vector3, Variant)
+    bool has_initializer;   // Declared with a value that .new() stores
+    
+    FieldSlot() : slot(-1), owner_id(-1), is_static(false),
+                  offset(-1), size(0), alignment(1), bit(-1), is_inline(false), has_initializer(false) {}
+    FieldSlot(const std::string& n, const TypeInfo& t, int s, int owner, bool static_field)
+        : name(n), type(t), slot(s), owner_id(owner), is_static(static_field),
+          offset(-1), size(0), alignment(1), bit(-1), is_inline(false), has_initializer(false) {}
+    
+    bool isPackedBool() const { return bit >= 0; }
+};
+
+// Flattened vtable-style method slot
+struct MethodSlot {
+    std::string name;
+    FunctionSignature signature;
+    int slot;
+    int owner_id;       // Class providing the implementation used by this class
+    bool is_static;
+};
+
+// Class hierarchy entry, built once per class when it is declared
+struct ClassEntry {
+    int id;
+    std::string name;
+    std::string unresolved_base;    // Engine/unknown base class, empty if fully resolved
+    int parent_id;                  // -1 for root classes
+    std::vector<int> display;       // Ancestor ids from the root down to this class
+    std::vector<FieldSlot> fields;
+    std::vector<MethodSlot> vtable;
+    std::vector<bool> overridden;   // Per vtable slot: overridden by some subclass
+    std::unordered_map<std::string, int> field_index;
+    std::unordered_map<std::string, int> method_index;
+    
+    // Instance layout: vtable pointer at offset 0, inherited prefix, then own fields
+    int instance_size;
+    int instance_alignment;
+    int bool_word_offset;           // Word currently receiving packed bools, -1 if none
+    int bool_bits_used;
+    
+    ClassEntry() : id(-1), parent_id(-1), instance_size(0), instance_alignment(1),
+                   bool_word_offset(-1), bool_bits_used(0) {}
+    
+    const FieldSlot* findField(const std::string& field_name) const;
+    const MethodSlot* findMethod(const std::string& method_name) const;
+    int depth() const { return static_cast<int>(display.size()) - 1; }
+    bool isFullyResolved() const { return unresolved_base.empty(); }
+};
+
+// Class hierarchy index with O(1) subclass tests and member lookups
+class ClassHierarchy {
+private:
+    std::vector<std::unique_ptr<ClassEntry>> entries;
+    std::unordered_map<std::string, int> ids;
+    
+public:
+    ClassEntry* createEntry(const std::string& name);
+    ClassEntry* getClass(int id);
+    const ClassEntry* getClass(int id) const;
+    const ClassEntry* findClass(const std::string& name) const;
+    
+    bool isSubclassOf(int derived_id, int base_id) const;
+    bool isOverridden(int class_id, int slot) const;
+    void markOverridden(const ClassEntry& entry, int slot);
+    std::string getImplementationName(const ClassEntry& entry, int slot) const;
+    size_t size() const { return entries.size(); }
+};
+
+// Variable types at one program point of the inference pass, keyed by the
+// variable's declaration: a local's or loop's Statement, a parameter's
+// Parameter
+struct FlowState {
+    bool reachable;
+    std::unordered_map<const void*, TypeInfo> types;
+    
+    FlowState() : reachable(true) {}
+    
+    void join(const FlowState& other);
+    bool operator==(const FlowState& other) const {
+        return reachable == other.reachable && types == other.types;
+    }
+    bool operator!=(const FlowState& other) const { return !(*this == other); }
+};
+
+// Per-function state of the type inference pass
+struct InferenceContext {
+    FlowState state;
+    std::vector<FlowState>* break_states;
+    std::vector<FlowState>* continue_states;
+    std::unordered_map<std::string, const void*> bindings;     // Untyped locals and parameters in scope
+    std::unordered_map<const void*, TypeInfo> summary;         // Join over all program points
+    std::unordered_set<const Statement*> declarations;         // Untyped locals and loop variables
+    std::unordered_set<const Statement*> typed_declarations;   // Locals with a type in the source
+    std::unordered_map<const CallExpr*, std::vector<TypeInfo>> calls;  // Argument types of script function calls
+    
+    InferenceContext() : break_states(nullptr), continue_states(nullptr) {}
+};
+
+// Inference results reported with --stats. Declared variables have a type
+// in the source; the untyped ones are either inferred or left Variant.
+struct InferenceStats {
+    int declared_locals;
+    int inferred_locals;
+    int variant_locals;
+    int declared_parameters;
+    int inferred_parameters;
+    int variant_parameters;
+    
+    InferenceStats() : declared_locals(0), inferred_locals(0), variant_locals(0),
+                       declared_parameters(0), inferred_parameters(0), variant_parameters(0) {}
+};
+
+// What the inference pass learned about one function
+struct FunctionInference {
+    InferenceStats stats;
+    std::vector<TypeInfo> parameter_types;      // Declared or inferred, Variant otherwise
+    std::unordered_map<const CallExpr*, std::vector<TypeInfo>> calls;
+};
+
 // Scope management
 class Scope {
 public:
@@ -124,6 +262,17 @@ private:
     // Type information
     std::unordered_map<std::string, ClassInfo> classes;
     std::unordered_map<std::string, TypeInfo> builtin_types;
+    ClassHierarchy class_hierarchy;
+    std::unordered_map<const Expression*, TypeInfo> expression_types;
+    std::unordered_map<const Statement*, TypeInfo> declaration_types;
+    InferenceContext* inference;
+    InferenceStats inference_stats;
+    std::unordered_map<const FuncDecl*, FunctionInference> function_inference;
+    
+    // Script functions whose untyped parameters may take their call sites' types
+    std::unordered_map<std::string, FuncDecl*> script_functions;
+    std::unordered_map<std::string, std::unordered_set<const CallExpr*>> call_sites;
+    std::unordered_set<std::string> escaped_functions;      // Used as values, so called from unknown places
     
     // Current context
     std::string current_class;
@@ -143,6 +292,18 @@ private:
     bool isAssignmentCompatible(const TypeInfo& target, const TypeInfo& source);
     bool areTypesCompatible(const TypeInfo& left, const TypeInfo& right, TokenType op);
     
+    void indexClass(const ClassInfo& class_info);
+    void computeClassLayout(ClassEntry* entry, const ClassEntry* parent);
+    bool isOverrideCompatible(const FunctionSignature& base, const FunctionSignature& derived);
+    
+    // Flow-sensitive type inference over a function body
+    void inferFunctionTypes(FuncDecl* decl, const std::vector<TypeInfo>& param_types);
+    void inferFunctionBody(FuncDecl* decl, const std::vector<TypeInfo>& param_types);
+    void inferParameterTypes();
+    void inferStatementTypes(Statement* stmt);
+    void inferLoopTypes(Expression* condition, Statement* body, const Statement* loop_var, const TypeInfo& loop_var_type);
+    void assignFlowType(const void* variable, const TypeInfo& type);
+    
     void enterScope();
     void exitScope();
     
@@ -179,7 +340,13 @@ private:
     void analyzeLambdaExpr(LambdaExpr* expr);
     void analyzeTernaryExpr(TernaryExpr* expr);
     
+    // Constant evaluation (children are already evaluated)
+    ConstantValue evaluateConstant(Expression* expr);
+    ConstantValue evaluateBinaryConstant(const ConstantValue& left, TokenType op, const ConstantValue& right, int line);
+    ConstantValue evaluateUnaryConstant(TokenType op, const ConstantValue& operand);
+    
     // Type checking utilities
+    bool isAssignable(const TypeInfo& target, const TypeInfo& value) const;
     TypeInfo getUnaryResultType(TokenType op, const TypeInfo& operand);
     TypeInfo getBinaryResultType(const TypeInfo& left, TokenType op, const TypeInfo& right);
     
@@ -201,6 +368,15 @@ public:
     
     // Access to symbol information for code generation
     const std::unordered_map<std::string, ClassInfo>& getClasses() const { return classes; }
+    const ClassHierarchy& getClassHierarchy() const { return class_hierarchy; }
+    TypeInfo getResolvedType(const Expression* expr) const;
+    TypeInfo getDeclarationType(const Statement* decl) const;
+    TypeInfo getParameterType(const FuncDecl* decl, size_t index) const;
+    const ClassEntry* getConstructedClass(const CallExpr* call) const;  // Class of a Name.new() call
+    const InferenceStats& getInferenceStats() const { return inference_stats; }
+    
+    // Least upper bound in the inference lattice (unset < concrete type < Variant)
+    static TypeInfo joinTypes(const TypeInfo& a, const TypeInfo& b);
     Scope* getGlobalScope() const { return global_scope.get(); }
 };
 
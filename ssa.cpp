@@ -0,0 +1,207 @@
+#include "ssa.h"
+#include <algorithm>
+#include <unordered_set>
+
+// Renaming state: a stack of live versions for every pre-SSA register
+struct RenameState {
+    Function& func;
+    size_t original_count;
+    VReg excluded;
+    std::vector<std::vector<VReg>> stacks;
+    std::vector<uint32_t> versions;
+
+    RenameState(Function& func, VReg excluded)
+        : func(func), original_count(func.registerCount()), excluded(excluded),
+          stacks(func.registerCount()), versions(func.registerCount(), 0) {}
+
+    bool renames(VReg reg) const {
+        return reg && reg.id < original_count && reg != excluded;
+    }
+
+    // Registers read before any definition keep their own number, which
+    // stands for the value on function entry (parameters, globals)
+    VReg current(VReg reg) const {
+        return stacks[reg.id].empty() ? reg : stacks[reg.id].back();
+    }
+
+    VReg newVersion(VReg original) {
+        Register info = func.getRegister(original);
+        std::string name = info.name.empty() ? "" : info.name + "." + std::to_string(++versions[original.id]);
+        return func.newRegister(info.type, name);
+    }
+};
+
+static void placePhis(Function& func, VReg excluded, SSAStats& stats) {
+    size_t count = func.registerCount();
+    std::vector<std::vector<BasicBlock*>> def_blocks(count);
+    std::vector<char> live_across(count, 0);
+
+    // Only registers read in some block before being written there can
+    // need a merge (semi-pruned SSA)
+    for (BasicBlock* block : func.reverse_postorder) {
+        std::unordered_set<uint32_t> defined;
+        for (const auto& instr : block->instructions) {
+            for (int i = instr.firstUse(); i < instr.num_operands; ++i) {
+                if (instr.operands[i] && !defined.count(instr.operands[i].id)) {
+                    live_across[instr.operands[i].id] = 1;
+                }
+            }
+            if (instr.definesFirstOperand() && instr.operands[0]) {
+                uint32_t id = instr.operands[0].id;
+                defined.insert(id);
+                if (def_blocks[id].empty() || def_blocks[id].back() != block) {
+                    def_blocks[id].push_back(block);
+                }
+            }
+        }
+    }
+
+    std::vector<uint32_t> has_phi(func.reverse_postorder.size(), 0);
+    std::vector<uint32_t> queued(func.reverse_postorder.size(), 0);
+    for (uint32_t id = 1; id < count; ++id) {
+        if (!live_across[id] || def_blocks[id].empty() || VReg(id) == excluded) continue;
+
+        std::vector<BasicBlock*> worklist = def_blocks[id];
+        for (BasicBlock* block : worklist) {
+            queued[block->order] = id;
+        }
+        while (!worklist.empty()) {
+            BasicBlock* block = worklist.back();
+            worklist.pop_back();
+            for (BasicBlock* frontier : block->dominance_frontier) {
+                if (has_phi[frontier->order] == id) continue;
+                has_phi[frontier->order] = id;
+                frontier->phis.emplace_back(VReg(), VReg(id));
+                stats.phis++;
+                if (queued[frontier->order] != id) {
+                    queued[frontier->order] = id;
+                    worklist.push_back(frontier);
+                }
+            }
+        }
+    }
+}
+
+static void renameBlock(BasicBlock* block, RenameState& state) {
+    std::vector<uint32_t> pushed;
+
+    for (auto& phi : block->phis) {
+        phi.dest = state.newVersion(phi.original);
+        state.stacks[phi.original.id].push_back(phi.dest);
+        pushed.push_back(phi.original.id);
+    }
+
+    for (auto& instr : block->instructions) {
+        for (int i = instr.firstUse(); i < instr.num_operands; ++i) {
+            if (state.renames(instr.operands[i])) {
+                instr.operands[i] = state.current(instr.operands[i]);
+            }
+        }
+        if (instr.definesFirstOperand() && state.renames(instr.operands[0])) {
+            VReg original = instr.operands[0];
+            instr.operands[0] = state.newVersion(original);
+            state.stacks[original.id].push_back(instr.operands[0]);
+            pushed.push_back(original.id);
+        }
+    }
+
+    for (BasicBlock* succ : block->successors) {
+        for (auto& phi : succ->phis) {
+            phi.incoming.push_back({block, state.current(phi.original)});
+        }
+    }
+
+    for (BasicBlock* child : block->dominated) {
+        renameBlock(child, state);
+    }
+
+    for (uint32_t id : pushed) {
+        state.stacks[id].pop_back();
+    }
+}
+
+void convertToSSA(Function& func, SSAStats& stats) {
+    if (func.reverse_postorder.empty()) return;
+
+    stats.blocks += func.reverse_postorder.size();
+    placePhis(func, func.return_register, stats);
+
+    RenameState state(func, func.return_register);
+    renameBlock(func.reverse_postorder.front(), state);
+}
+
+// Emits simultaneous copies as a sequence of moves, breaking cycles such as
+// a swap with a temporary register
+static void insertParallelCopy(Function& func, BasicBlock* block,
+                               std::vector<std::pair<VReg, VReg>> copies, SSAStats& stats) {
+    copies.erase(std::remove_if(copies.begin(), copies.end(),
+        [](const std::pair<VReg, VReg>& copy) { return copy.first == copy.second; }),
+        copies.end());
+
+    std::vector<Instruction> moves;
+    auto move = [&moves](VReg dest, VReg src) {
+        Instruction instr(Instruction::MOV);
+        instr.addOperand(dest);
+        instr.addOperand(src);
+        moves.push_back(instr);
+    };
+
+    while (!copies.empty()) {
+        bool progress = false;
+        for (size_t i = 0; i < copies.size(); ++i) {
+            VReg dest = copies[i].first;
+            bool still_read = std::any_of(copies.begin(), copies.end(),
+                [dest](const std::pair<VReg, VReg>& copy) { return copy.second == dest; });
+            if (!still_read) {
+                move(dest, copies[i].second);
+                copies.erase(copies.begin() + i);
+                progress = true;
+                break;
+            }
+        }
+        if (!progress) {
+            VReg dest = copies.front().first;
+            VReg temp = func.newRegister(func.getRegister(dest).type);
+            move(temp, dest);
+            for (auto& copy : copies) {
+                if (copy.second == dest) copy.second = temp;
+            }
+        }
+    }
+
+    block->instructions.insert(block->instructions.begin() + block->insertionPoint(), moves.begin(), moves.end());
+    stats.copies += moves.size();
+}
+
+void convertFromSSA(Function& func, SSAStats& stats) {
+    std::vector<BasicBlock*> joins;
+    for (auto& block : func.blocks) {
+        if (!block->phis.empty()) joins.push_back(block.get());
+    }
+
+    for (BasicBlock* block : joins) {
+        std::vector<BasicBlock*> preds = block->predecessors;
+        for (BasicBlock* pred : preds) {
+            if (pred->successors.size() > 1) {
+                func.splitEdge(pred, block);
+                stats.split_edges++;
+            }
+        }
+    }
+
+    for (BasicBlock* block : joins) {
+        for (BasicBlock* pred : block->predecessors) {
+            std::vector<std::pair<VReg, VReg>> copies;
+            for (const auto& phi : block->phis) {
+                for (const auto& incoming : phi.incoming) {
+                    if (incoming.first == pred) {
+                        copies.push_back({phi.dest, incoming.second});
+                        break;
+                    }
+                }
+            }
+            insertParallelCopy(func, pred, copies, stats);
+        }
+        block->phis.clear();
+    }
+}
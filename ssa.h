@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ir.h"
+#include <vector>
+
+// Counters reported by the SSA passes
+struct SSAStats {
+    size_t blocks;          // Reachable basic blocks after CFG construction
+    size_t phis;            // Phi nodes inserted
+    size_t split_edges;     // Critical edges split while leaving SSA form
+    size_t copies;          // Copies inserted for phi operands
+
+    SSAStats() : blocks(0), phis(0), split_edges(0), copies(0) {}
+};
+
+// Rewrites a function into SSA form: every definition gets a fresh virtual
+// register and phi nodes merge values at join points. The CFG and dominator
+// tree must already be built. The function's return register is left alone.
+void convertToSSA(Function& func, SSAStats& stats);
+
+// Replaces phi nodes by copies at the end of each predecessor, splitting
+// critical edges so the copies only run on the edge they belong to.
+void convertFromSSA(Function& func, SSAStats& stats);
@@ -0,0 +1,96 @@
+#include "target.h"
+
+RegisterFile RegisterFile::x86_64(bool windows_abi) {
+    RegisterFile file;
+    file.architecture = "x86_64";
+
+    // General purpose registers in hardware encoding order
+    static const char* names[16] = {
+        "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+        "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+    };
+    for (int i = 0; i < 16; ++i) {
+        bool callee_saved = i == 3 || i == 4 || i == 5 || i >= 12 ||
+                            (windows_abi && (i == 6 || i == 7));
+        file.general.emplace_back(names[i], i, callee_saved);
+    }
+    for (int i = 0; i < 16; ++i) {
+        // Microsoft x64 preserves xmm6-xmm15; System V preserves none
+        file.floating.emplace_back("xmm" + std::to_string(i), i, windows_abi && i >= 6);
+    }
+
+    file.stack_pointer = 4;
+    file.frame_pointer = 5;
+    file.scratch_general[0] = 10;
+    file.scratch_general[1] = 11;
+    file.scratch_floating[0] = 14;
+    file.scratch_floating[1] = 15;
+
+    // Caller-saved registers first so short-lived values avoid prologue saves
+    file.allocatable_general = {0, 1, 2, 8, 9};
+    if (windows_abi) {
+        file.allocatable_general.insert(file.allocatable_general.end(), {3, 6, 7, 12, 13, 14, 15});
+    } else {
+        file.allocatable_general.insert(file.allocatable_general.end(), {6, 7, 3, 12, 13, 14, 15});
+    }
+    for (int i = 0; i < 14; ++i) {
+        file.allocatable_floating.push_back(i);
+    }
+
+    file.return_general = 0;
+    file.return_floating = 0;
+    if (windows_abi) {
+        // rcx, rdx, r8, r9 or xmm0-xmm3 by position, with 32 bytes of home space
+        file.argument_general = {1, 2, 8, 9};
+        file.argument_floating = {0, 1, 2, 3};
+        file.positional_arguments = true;
+        file.shadow_space = 32;
+    } else {
+        // rdi, rsi, rdx, rcx, r8, r9 and xmm0-xmm7
+        file.argument_general = {7, 6, 2, 1, 8, 9};
+        file.argument_floating = {0, 1, 2, 3, 4, 5, 6, 7};
+    }
+
+    return file;
+}
+
+RegisterFile RegisterFile::aarch64() {
+    RegisterFile file;
+    file.architecture = "aarch64";
+
+    // x0-x30 followed by sp, which shares encoding 31 with xzr
+    for (int i = 0; i < 31; ++i) {
+        bool callee_saved = i >= 19 && i <= 30;
+        file.general.emplace_back(i == 29 ? "fp" : i == 30 ? "lr" : "x" + std::to_string(i), i, callee_saved);
+    }
+    file.general.emplace_back("sp", 31, true);
+    for (int i = 0; i < 32; ++i) {
+        // Floats are doubles in the low halves of v0-v31; the callee
+        // preserves exactly those halves of v8-v15
+        file.floating.emplace_back("d" + std::to_string(i), i, i >= 8 && i <= 15);
+    }
+
+    file.stack_pointer = 31;
+    file.frame_pointer = 29;
+    file.scratch_general[0] = 16;   // IP0/IP1 are free for veneers and scratch use
+    file.scratch_general[1] = 17;
+    file.scratch_floating[0] = 30;
+    file.scratch_floating[1] = 31;
+
+    // x18 is the platform register and is never allocated
+    for (int i = 0; i <= 15; ++i) file.allocatable_general.push_back(i);
+    for (int i = 19; i <= 28; ++i) file.allocatable_general.push_back(i);
+    for (int i = 0; i <= 7; ++i) file.allocatable_floating.push_back(i);
+    for (int i = 16; i <= 29; ++i) file.allocatable_floating.push_back(i);
+    for (int i = 8; i <= 15; ++i) file.allocatable_floating.push_back(i);
+
+    // x0-x7 and v0-v7, results in x0 and v0
+    for (int i = 0; i <= 7; ++i) {
+        file.argument_general.push_back(i);
+        file.argument_floating.push_back(i);
+    }
+    file.return_general = 0;
+    file.return_floating = 0;
+
+    return file;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// One machine register as seen by the register allocator and the encoders
+struct MachineRegister {
+    std::string name;
+    int encoding;           // Hardware register number
+    bool callee_saved;      // Must be preserved across calls by the callee
+
+    MachineRegister(const std::string& name, int encoding, bool callee_saved)
+        : name(name), encoding(encoding), callee_saved(callee_saved) {}
+};
+
+// Register file of a target ABI. Register::physical is an index into
+// 'general' or 'floating' depending on the register's class.
+struct RegisterFile {
+    std::string architecture;
+    std::vector<MachineRegister> general;
+    std::vector<MachineRegister> floating;
+    std::vector<int> allocatable_general;   // In allocation preference order
+    std::vector<int> allocatable_floating;
+    int scratch_general[2];                 // Reserved for spill reloads
+    int scratch_floating[2];
+    int frame_pointer;
+    int stack_pointer;
+
+    // Calling convention
+    std::vector<int> argument_general;      // Integer and pointer arguments, in order
+    std::vector<int> argument_floating;
+    int return_general;
+    int return_floating;
+    bool positional_arguments;              // The n-th argument may only use the n-th register of its class
+    int shadow_space;                       // Bytes the caller reserves between return address and stack arguments
+
+    RegisterFile()
+        : frame_pointer(-1), stack_pointer(-1), return_general(-1), return_floating(-1),
+          positional_arguments(false), shadow_space(0) {
+        scratch_general[0] = scratch_general[1] = -1;
+        scratch_floating[0] = scratch_floating[1] = -1;
+    }
+
+    const MachineRegister& get(bool is_float, int index) const {
+        return is_float ? floating[index] : general[index];
+    }
+
+    static RegisterFile x86_64(bool windows_abi);   // System V or Microsoft x64
+    static RegisterFile aarch64();                  // AAPCS64
+};
@@ -0,0 +1,36 @@
+#!/bin/sh
+# Times examples/array_iteration.gd: compiles it to an x86-64 ELF object
+# with the given options, links it with the harness in
+# tests/bench/array_iteration.c, and runs it. The harness checks the
+# compiled sums against C and prints the best time per element of each.
+#
+# Usage: tests/bench.sh COMPILER [OPTIONS...]
+
+compiler=$1
+shift
+dir=$(dirname "$0")
+out=test_output/bench
+
+if [ "$(uname -s)" != Linux ] || [ "$(uname -m)" != x86_64 ]; then
+    echo "benchmark skipped: it needs an x86-64 Linux host"
+    exit 0
+fi
+for tool in cc objcopy; do
+    if ! command -v $tool > /dev/null 2>&1; then
+        echo "benchmark skipped: $tool is needed"
+        exit 0
+    fi
+done
+
+mkdir -p $out
+if "$compiler" "$dir"/../examples/array_iteration.gd $out/array_iteration --platform linux --format object "$@" \
+        > $out/array_iteration.log 2>&1 &&
+   objcopy --redefine-sym main=gd_main $out/array_iteration.o &&
+   cc -O2 -pie -Wl,-z,text -o $out/array_iteration "$dir"/runtime.c "$dir"/bench/array_iteration.c \
+        $out/array_iteration.o >> $out/array_iteration.log 2>&1; then
+    ./$out/array_iteration
+else
+    echo "benchmark build failed:"
+    sed 's/^/    /' $out/array_iteration.log
+    exit 1
+fi
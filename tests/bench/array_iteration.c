@@ -0,0 +1,104 @@
+// Timing harness for examples/array_iteration.gd. Sums packed arrays of
+// COUNT elements with the compiled loops and with the same loops in C,
+// checks that both agree, and prints the best of RUNS times per element.
+// Array, whose elements are Variants, needs the full runtime and is left
+// out.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define COUNT 1000000
+#define RUNS 20
+
+// Packed array header: reference count, element count, element storage
+// padded to a whole word
+struct packed_array {
+    long refcount;
+    long size;
+    void* data;
+};
+
+long sum_packed(struct packed_array* values);
+long sum_packed32(struct packed_array* values);
+double sum_floats(struct packed_array* values);
+
+// Helpers the rest of the example calls; none of it runs here
+#define UNUSED(name) \
+    void name(void) { fprintf(stderr, #name " called\n"); abort(); }
+UNUSED(_array_create)
+UNUSED(_object_get)
+UNUSED(_packed_int64_array_create)
+UNUSED(_variant_add)
+
+static long c_sum_packed(const long* values, long size) {
+    long total = 0;
+    for (long i = 0; i < size; ++i) total += values[i];
+    return total;
+}
+
+static long c_sum_packed32(const int* values, long size) {
+    long total = 0;
+    for (long i = 0; i < size; ++i) total += values[i];
+    return total;
+}
+
+static double c_sum_floats(const float* values, long size) {
+    double total = 0.0;
+    for (long i = 0; i < size; ++i) total += values[i];
+    return total;
+}
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static volatile double sink;
+
+// Best time of RUNS calls of expr, in nanoseconds per element
+#define TIME(expr, best) \
+    do { \
+        best = 1e30; \
+        for (int run = 0; run < RUNS; ++run) { \
+            double start = seconds(); \
+            sink = (double)(expr); \
+            double elapsed = (seconds() - start) * 1e9 / COUNT; \
+            if (elapsed < best) best = elapsed; \
+        } \
+    } while (0)
+
+static int report(const char* name, double compiled, double reference, int agree) {
+    printf("  %-13s %6.3f ns/element compiled, %6.3f in C%s\n", name, compiled, reference,
+           agree ? "" : "  SUMS DIFFER");
+    return agree;
+}
+
+int main(void) {
+    long* longs = malloc(COUNT * sizeof(long));
+    int* ints = malloc((COUNT + 1) * sizeof(int));
+    float* floats = malloc((COUNT + 1) * sizeof(float));
+    if (!longs || !ints || !floats) return 2;
+    for (long i = 0; i < COUNT; ++i) {
+        longs[i] = i * 3 - COUNT;
+        ints[i] = (int)(i % 2001) - 1000;
+        floats[i] = (float)(i % 7) * 0.25f;
+    }
+    struct packed_array packed = {1, COUNT, longs};
+    struct packed_array packed32 = {1, COUNT, ints};
+    struct packed_array packed_floats = {1, COUNT, floats};
+
+    double compiled, reference;
+    int ok = 1;
+    TIME(sum_packed(&packed), compiled);
+    TIME(c_sum_packed(longs, COUNT), reference);
+    ok &= report("sum_packed", compiled, reference, sum_packed(&packed) == c_sum_packed(longs, COUNT));
+    TIME(sum_packed32(&packed32), compiled);
+    TIME(c_sum_packed32(ints, COUNT), reference);
+    ok &= report("sum_packed32", compiled, reference, sum_packed32(&packed32) == c_sum_packed32(ints, COUNT));
+    TIME(sum_floats(&packed_floats), compiled);
+    TIME(c_sum_floats(floats, COUNT), reference);
+    ok &= report("sum_floats", compiled, reference, sum_floats(&packed_floats) == c_sum_floats(floats, COUNT));
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,368 @@
+// Checks the machine encoders against the LLVM assembler. Each case is a
+// short run of IR instructions over machine registers together with the
+// assembly it must encode to; llvm-mc assembles the expected text, each
+// case in a section of its own, and the bytes have to match exactly.
+// Displacements the encoders leave to a fixup are zero, so the expected
+// text branches to the next instruction on x86-64, to itself on AArch64,
+// and calls and table addresses refer to undefined symbols.
+
+#include "x86_encoder.h"
+#include "arm64_encoder.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+struct Case {
+    std::string expected;               // Assembly, instructions separated by ';'
+    std::vector<Instruction> code;
+    bool short_branch;
+    bool prologue;                      // The case starts with beginFunction's output
+    int stack_size;
+    std::vector<int> saved_general;
+    std::vector<int> saved_floating;
+};
+
+// The cases of one target, sharing a function whose registers are
+// machine registers looked up by name
+class Suite {
+public:
+    Suite(const std::string& triple, const RegisterFile& file) : triple(triple), file(file), func("encoder_test") {
+        func.register_file = &this->file;
+    }
+
+    VReg r(const std::string& name) {
+        for (int is_float = 0; is_float < 2; ++is_float) {
+            const auto& regs = is_float ? file.floating : file.general;
+            for (size_t i = 0; i < regs.size(); ++i) {
+                if (regs[i].name != name) continue;
+                VReg reg = func.newRegister(is_float ? Register::FLOAT : Register::GENERAL, name);
+                func.getRegister(reg).physical = static_cast<int>(i);
+                return reg;
+            }
+        }
+        std::cerr << "unknown register " << name << std::endl;
+        std::exit(2);
+    }
+
+    uint32_t symbol(const std::string& name) { return func.internSymbol(name); }
+
+    Case& check(const std::string& expected, const std::vector<Instruction>& code, bool short_branch = true) {
+        Case c;
+        c.expected = expected;
+        c.code = code;
+        c.short_branch = short_branch;
+        c.prologue = false;
+        c.stack_size = 0;
+        cases.push_back(c);
+        return cases.back();
+    }
+
+    // Number of mismatching cases, or -1 when llvm-mc could not be run
+    int run(MachineEncoder& encoder) {
+        char dir[] = "/tmp/encoder_test.XXXXXX";
+        if (!mkdtemp(dir)) return -1;
+        std::string base = std::string(dir) + "/cases";
+
+        std::ofstream source(base + ".s");
+        if (file.architecture == "x86_64") source << ".intel_syntax noprefix\n";
+        std::string dumps;
+        for (size_t i = 0; i < cases.size(); ++i) {
+            std::string section = ".text.case" + std::to_string(i);
+            source << ".section " << section << ",\"ax\"\n";
+            std::string text = cases[i].expected;
+            for (char& c : text) {
+                if (c == ';') c = '\n';
+            }
+            source << text << "\n";
+            dumps += " --dump-section " + section + "=" + base + std::to_string(i) + ".bin";
+        }
+        source.close();
+
+        std::string command = "llvm-mc -triple=" + triple + " -filetype=obj " + base + ".s -o " + base + ".o && " +
+                              "llvm-objcopy" + dumps + " " + base + ".o " + base + ".stripped";
+        if (std::system(command.c_str()) != 0) return -1;
+
+        int failures = 0;
+        for (size_t i = 0; i < cases.size(); ++i) {
+            const Case& c = cases[i];
+            func.stack_size = c.stack_size;
+            func.saved_general = c.saved_general;
+            func.saved_floating = c.saved_floating;
+
+            std::vector<uint8_t> actual;
+            std::vector<Fixup> fixups;
+            encoder.beginFunction(func, actual);
+            if (!c.prologue) actual.clear();
+            for (const auto& instr : c.code) encoder.encode(instr, c.short_branch, actual, fixups);
+
+            std::ifstream bytes(base + std::to_string(i) + ".bin", std::ios::binary);
+            std::vector<uint8_t> expected((std::istreambuf_iterator<char>(bytes)), std::istreambuf_iterator<char>());
+            if (actual != expected) {
+                std::cerr << file.architecture << ": " << c.expected << "\n    expected" << hex(expected)
+                          << "\n    encoded " << hex(actual) << std::endl;
+                failures++;
+            }
+        }
+        std::system(("rm -rf " + std::string(dir)).c_str());
+        return failures;
+    }
+
+    size_t size() const { return cases.size(); }
+
+private:
+    std::string triple;
+    RegisterFile file;
+    Function func;
+    std::vector<Case> cases;
+
+    static std::string hex(const std::vector<uint8_t>& bytes) {
+        std::ostringstream out;
+        char digits[4];
+        for (uint8_t byte : bytes) {
+            std::snprintf(digits, sizeof(digits), " %02x", byte);
+            out << digits;
+        }
+        return out.str();
+    }
+};
+
+static Instruction op(Instruction::OpCode opcode, std::initializer_list<VReg> operands) {
+    Instruction instr(opcode);
+    for (VReg reg : operands) instr.addOperand(reg);
+    return instr;
+}
+
+static Instruction op(Instruction::OpCode opcode, std::initializer_list<VReg> operands, int32_t immediate) {
+    Instruction instr = op(opcode, operands);
+    instr.setImmediate(immediate);
+    return instr;
+}
+
+static Instruction to(Instruction instr, uint32_t label) {
+    instr.label = label;
+    return instr;
+}
+
+static void x86Cases(Suite& s) {
+    typedef Instruction I;
+    VReg rax = s.r("rax"), rcx = s.r("rcx"), rdx = s.r("rdx"), rsi = s.r("rsi"), rdi = s.r("rdi");
+    VReg rbp = s.r("rbp"), rsp = s.r("rsp"), r8 = s.r("r8"), r9 = s.r("r9"), r11 = s.r("r11");
+    VReg r12 = s.r("r12"), r13 = s.r("r13");
+    VReg xmm0 = s.r("xmm0"), xmm1 = s.r("xmm1"), xmm2 = s.r("xmm2"), xmm3 = s.r("xmm3"), xmm4 = s.r("xmm4");
+    uint32_t label = s.symbol("target"), helper = s.symbol("helper"), table = s.symbol("table");
+
+    s.check("mov eax, 5", {op(I::MOV, {rax}, 5)});
+    s.check("mov r9, -1", {op(I::MOV, {r9}, -1)});
+    s.check("mov rcx, rdx", {op(I::MOV, {rcx, rdx})});
+    s.check("mov r12, rax", {op(I::MOV, {r12, rax})});
+    s.check("mov r10d, 0x3ff00000; movq xmm1, r10", {op(I::MOV, {xmm1}, 0x3ff00000)});
+    s.check("movaps xmm2, xmm3", {op(I::MOV, {xmm2, xmm3})});
+    s.check("movq xmm0, rax", {op(I::MOV, {xmm0, rax})});
+    s.check("movq rax, xmm0", {op(I::MOV, {rax, xmm0})});
+
+    s.check("mov rax, qword ptr [rbp - 8]", {op(I::LOAD, {rax, rbp}, -8)});
+    s.check("mov rcx, qword ptr [rsp + 16]", {op(I::LOAD, {rcx, rsp}, 16)});
+    s.check("mov rdx, qword ptr [r12]", {op(I::LOAD, {rdx, r12}, 0)});
+    s.check("mov rdx, qword ptr [r13]", {op(I::LOAD, {rdx, r13}, 0)});
+    s.check("mov rsi, qword ptr [rdi + 4096]", {op(I::LOAD, {rsi, rdi}, 4096)});
+    s.check("mov qword ptr [rbp - 16], rax", {op(I::STORE, {rax, rbp}, -16)});
+    s.check("movsd xmm1, qword ptr [rbp - 8]", {op(I::LOAD, {xmm1, rbp}, -8)});
+    s.check("movsd qword ptr [rsp], xmm1", {op(I::STORE, {xmm1, rsp}, 0)});
+
+    s.check("add rax, rcx", {op(I::ADD, {rax, rax, rcx})});
+    s.check("add rax, rcx", {op(I::ADD, {rax, rcx, rax})});
+    s.check("neg rax; add rax, rcx", {op(I::SUB, {rax, rcx, rax})});
+    s.check("mov rdx, rcx; sub rdx, rsi", {op(I::SUB, {rdx, rcx, rsi})});
+    s.check("mov rax, rcx; add rax, 8", {op(I::ADD, {rax, rcx}, 8)});
+    s.check("and r8, 4096", {op(I::AND, {r8, r8}, 4096)});
+    s.check("or rax, -2", {op(I::OR, {rax, rax}, -2)});
+    s.check("xor rax, rax", {op(I::XOR, {rax, rax, rax})});
+    s.check("imul rax, rcx, 10", {op(I::MUL, {rax, rcx}, 10)});
+    s.check("imul rax, rcx, 1000", {op(I::MUL, {rax, rcx}, 1000)});
+    s.check("imul rdx, rcx", {op(I::MUL, {rdx, rcx, rdx})});
+    s.check("push rdx; push rax; push rdi; mov rax, rsi; cqo; idiv qword ptr [rsp]; add rsp, 8; "
+            "mov rcx, rax; pop rax; pop rdx", {op(I::DIV, {rcx, rsi, rdi})});
+    s.check("push rax; push 1000; cqo; idiv qword ptr [rsp]; add rsp, 8; pop rax", {op(I::MOD, {rdx, rax}, 1000)});
+    s.check("mov rax, rcx; shl rax, 3", {op(I::SHL, {rax, rcx}, 3)});
+    s.check("sar rdx, cl", {op(I::SHR, {rdx, rdx, rcx})});
+    s.check("push rbx; mov rbx, rax; mov rcx, rdx; shl rbx, cl; mov rcx, rbx; pop rbx", {op(I::SHL, {rcx, rax, rdx})});
+    s.check("mov rdi, rsi; not rdi", {op(I::NOT, {rdi, rsi})});
+
+    s.check("addsd xmm0, xmm1", {op(I::FADD, {xmm0, xmm0, xmm1})});
+    s.check("mulsd xmm1, xmm0", {op(I::FMUL, {xmm1, xmm0, xmm1})});
+    s.check("sub rsp, 8; movsd qword ptr [rsp], xmm0; movaps xmm0, xmm1; subsd xmm0, qword ptr [rsp]; add rsp, 8",
+            {op(I::FSUB, {xmm0, xmm1, xmm0})});
+    s.check("movaps xmm2, xmm3; divsd xmm2, xmm4", {op(I::FDIV, {xmm2, xmm3, xmm4})});
+    s.check("cvtsi2sd xmm0, rax", {op(I::CVTI2F, {xmm0, rax})});
+    s.check("cvttsd2si rax, xmm1", {op(I::CVTF2I, {rax, xmm1})});
+    s.check("cvtss2sd xmm3, xmm2", {op(I::CVTS2D, {xmm3, xmm2})});
+
+    s.check("cmp rax, rcx", {op(I::CMP, {rax, rcx})});
+    s.check("test rax, rax", {op(I::CMP, {rax}, 0)});
+    s.check("cmp r9, 100", {op(I::CMP, {r9}, 100)});
+    s.check("cmp rax, rcx; jl 1f; 1:", {op(I::CMP, {rax, rcx}), to(op(I::JL, {}), label)});
+    s.check("cmp rax, rcx; {disp32} jge 1f; 1:", {op(I::CMP, {rax, rcx}), to(op(I::JGE, {}), label)}, false);
+    s.check("ucomisd xmm0, xmm1; jb 1f; 1:", {op(I::FCMP, {xmm0, xmm1}), to(op(I::JL, {}), label)});
+    s.check("ucomisd xmm0, xmm1; ja 1f; 1:", {op(I::FCMP, {xmm0, xmm1}), to(op(I::JG, {}), label)});
+    s.check("ucomisd xmm0, xmm1; jp 1f; je 1f; 1:", {op(I::FCMP, {xmm0, xmm1}), to(op(I::JE, {}), label)});
+    s.check("ucomisd xmm0, xmm1; jp 1f; {disp32} je 1f; 1:", {op(I::FCMP, {xmm0, xmm1}), to(op(I::JE, {}), label)},
+            false);
+    s.check("ucomisd xmm0, xmm1; jp 1f; 1: jne 2f; 2:", {op(I::FCMP, {xmm0, xmm1}), to(op(I::JNE, {}), label)});
+    s.check("jmp 1f; 1:", {to(op(I::JMP, {}), label)});
+    s.check("{disp32} jmp 1f; 1:", {to(op(I::JMP, {}), label)}, false);
+    s.check("test r8, r8; je 1f; 1:", {to(op(I::JZ, {r8}), label)});
+    s.check("test r8, r8; {disp32} jne 1f; 1:", {to(op(I::JNZ, {r8}), label)}, false);
+    s.check("lea r11, [rip + table]; movsxd r10, dword ptr [r11 + 4*rax]; add r10, r11; jmp r10",
+            {to(op(I::JMPT, {rax}), table)});
+    s.check("lea r10, [rip + table]; movsxd r11, dword ptr [r10 + 4*r11]; add r11, r10; jmp r11",
+            {to(op(I::JMPT, {r11}), table)});
+    s.check("lea rax, [rip + table]", {to(op(I::ADDR, {rax}), table)});
+    s.check("lea r13, [rip + table]", {to(op(I::ADDR, {r13}), table)});
+
+    s.check("call helper", {to(op(I::CALL, {rax}), helper)});
+    s.check("call r8", {op(I::CALL, {rax, r8})});
+    s.check("leave; ret", {op(I::RET, {})});
+    s.check("leave; jmp helper", {to(op(I::TAILCALL, {}), helper)});
+    s.check("push rax; push r12; push 1000", {op(I::PUSH, {rax}), op(I::PUSH, {r12}), op(I::PUSH, {}, 1000)});
+    s.check("sub rsp, 8; movsd qword ptr [rsp], xmm1", {op(I::PUSH, {xmm1})});
+    s.check("pop rcx; movsd xmm2, qword ptr [rsp]; add rsp, 8", {op(I::POP, {rcx}), op(I::POP, {xmm2})});
+    s.check("nop", {op(I::NOP, {})});
+
+    // Frame with spill slots, a saved xmm register and an odd number of
+    // pushes, padded to keep calls aligned
+    Case& frame = s.check("push rbp; mov rbp, rsp; sub rsp, 32; movdqu xmmword ptr [rbp - 32], xmm6; "
+                          "push rbx; push r12; push r13; sub rsp, 8; "
+                          "lea rsp, [rbp - 56]; pop r13; pop r12; pop rbx; movdqu xmm6, xmmword ptr [rbp - 32]; "
+                          "leave; ret", {op(I::RET, {})});
+    frame.prologue = true;
+    frame.stack_size = 16;
+    frame.saved_general = {3, 12, 13};
+    frame.saved_floating = {6};
+}
+
+static void arm64Cases(Suite& s) {
+    typedef Instruction I;
+    VReg x0 = s.r("x0"), x1 = s.r("x1"), x2 = s.r("x2"), x3 = s.r("x3"), x5 = s.r("x5"), x16 = s.r("x16");
+    VReg fp = s.r("fp"), sp = s.r("sp");
+    VReg d0 = s.r("d0"), d1 = s.r("d1"), d2 = s.r("d2");
+    uint32_t label = s.symbol("target"), helper = s.symbol("helper"), table = s.symbol("table");
+
+    s.check("mov x0, #5", {op(I::MOV, {x0}, 5)});
+    s.check("movn x1, #0", {op(I::MOV, {x1}, -1)});
+    s.check("movz x2, #0x2345; movk x2, #0x1, lsl #16", {op(I::MOV, {x2}, 0x12345)});
+    s.check("movn x3, #0x869f; movk x3, #0xfffe, lsl #16", {op(I::MOV, {x3}, -100000)});
+    s.check("mov x0, x1", {op(I::MOV, {x0, x1})});
+    s.check("mov x29, sp", {op(I::MOV, {fp, sp})});
+    s.check("movz x16, #0x3ff0, lsl #16; fmov d0, x16", {op(I::MOV, {d0}, 0x3ff00000)});
+    s.check("fmov d1, d2", {op(I::MOV, {d1, d2})});
+    s.check("fmov d0, x1", {op(I::MOV, {d0, x1})});
+    s.check("fmov x0, d1", {op(I::MOV, {x0, d1})});
+
+    s.check("ldur x0, [x29, #-8]", {op(I::LOAD, {x0, fp}, -8)});
+    s.check("ldr x1, [sp, #16]", {op(I::LOAD, {x1, sp}, 16)});
+    s.check("add x16, x3, #9, lsl #12; add x16, x16, #3136; ldr x2, [x16]", {op(I::LOAD, {x2, x3}, 40000)});
+    s.check("str x0, [sp, #8]", {op(I::STORE, {x0, sp}, 8)});
+    s.check("ldur d0, [x29, #-8]", {op(I::LOAD, {d0, fp}, -8)});
+    s.check("str d1, [sp, #8]", {op(I::STORE, {d1, sp}, 8)});
+
+    s.check("add x0, x1, x2", {op(I::ADD, {x0, x1, x2})});
+    s.check("sub x0, x1, #16", {op(I::SUB, {x0, x1}, 16)});
+    s.check("sub x0, x1, #16", {op(I::ADD, {x0, x1}, -16)});
+    s.check("add x0, x1, #5, lsl #12", {op(I::ADD, {x0, x1}, 0x5000)});
+    s.check("movz x16, #0x100, lsl #16; add x0, x1, x16", {op(I::ADD, {x0, x1}, 0x1000000)});
+    s.check("and x0, x1, #0xff", {op(I::AND, {x0, x1}, 0xff)});
+    s.check("orr x0, x1, x2", {op(I::OR, {x0, x1, x2})});
+    s.check("mov x16, #5; eor x0, x1, x16", {op(I::XOR, {x0, x1}, 5)});
+    s.check("mul x0, x1, x2", {op(I::MUL, {x0, x1, x2})});
+    s.check("mov x16, #3; mul x0, x1, x16", {op(I::MUL, {x0, x1}, 3)});
+    s.check("sdiv x0, x1, x2", {op(I::DIV, {x0, x1, x2})});
+    s.check("sdiv x16, x1, x2; msub x0, x16, x2, x1", {op(I::MOD, {x0, x1, x2})});
+    s.check("mov x17, #7; str x9, [sp, #-16]!; sdiv x9, x16, x17; msub x0, x9, x17, x16; ldr x9, [sp], #16",
+            {op(I::MOD, {x0, x16}, 7)});
+    s.check("mvn x0, x1", {op(I::NOT, {x0, x1})});
+    s.check("lsl x0, x1, #3", {op(I::SHL, {x0, x1}, 3)});
+    s.check("asr x0, x1, #3", {op(I::SHR, {x0, x1}, 3)});
+    s.check("lsl x0, x1, x2", {op(I::SHL, {x0, x1, x2})});
+    s.check("asr x0, x1, x2", {op(I::SHR, {x0, x1, x2})});
+
+    s.check("fadd d0, d1, d2", {op(I::FADD, {d0, d1, d2})});
+    s.check("fsub d0, d1, d2", {op(I::FSUB, {d0, d1, d2})});
+    s.check("fmul d0, d1, d2", {op(I::FMUL, {d0, d1, d2})});
+    s.check("fdiv d0, d1, d2", {op(I::FDIV, {d0, d1, d2})});
+    s.check("scvtf d0, x1", {op(I::CVTI2F, {d0, x1})});
+    s.check("fcvtzs x0, d1", {op(I::CVTF2I, {x0, d1})});
+    s.check("fcvt d2, s1", {op(I::CVTS2D, {d2, d1})});
+
+    s.check("cmp x0, x1", {op(I::CMP, {x0, x1})});
+    s.check("cmp x0, #5", {op(I::CMP, {x0}, 5)});
+    s.check("cmn x0, #5", {op(I::CMP, {x0}, -5)});
+    s.check("cmp x0, #5, lsl #12", {op(I::CMP, {x0}, 0x5000)});
+    s.check("movz x16, #0x86a0; movk x16, #0x1, lsl #16; cmp x0, x16", {op(I::CMP, {x0}, 100000)});
+    s.check("fcmp d0, d1", {op(I::FCMP, {d0, d1})});
+    s.check("cmp x0, x1; 1: b.lt 1b", {op(I::CMP, {x0, x1}), to(op(I::JL, {}), label)});
+    s.check("cmp x0, x1; b.ge 2f; 1: b 1b; 2:", {op(I::CMP, {x0, x1}), to(op(I::JL, {}), label)}, false);
+    s.check("fcmp d0, d1; 1: b.mi 1b", {op(I::FCMP, {d0, d1}), to(op(I::JL, {}), label)});
+    s.check("fcmp d0, d1; 1: b.ls 1b", {op(I::FCMP, {d0, d1}), to(op(I::JLE, {}), label)});
+    s.check("1: b 1b", {to(op(I::JMP, {}), label)});
+    s.check("1: cbz x3, 1b", {to(op(I::JZ, {x3}), label)});
+    s.check("cbz x3, 2f; 1: b 1b; 2:", {to(op(I::JNZ, {x3}), label)}, false);
+    s.check("adrp x16, table; add x16, x16, :lo12:table; ldrsw x17, [x16, x0, lsl #2]; add x16, x16, x17; br x16",
+            {to(op(I::JMPT, {x0}), table)});
+    s.check("adrp x17, table; add x17, x17, :lo12:table; ldrsw x16, [x17, x16, lsl #2]; add x17, x17, x16; br x17",
+            {to(op(I::JMPT, {x16}), table)});
+    s.check("adrp x3, table; add x3, x3, :lo12:table", {to(op(I::ADDR, {x3}), table)});
+
+    s.check("bl helper", {to(op(I::CALL, {x0}), helper)});
+    s.check("blr x5", {op(I::CALL, {x0, x5})});
+    s.check("mov sp, x29; ldp x29, x30, [sp], #16; ret", {op(I::RET, {})});
+    s.check("mov sp, x29; ldp x29, x30, [sp], #16; b helper", {to(op(I::TAILCALL, {}), helper)});
+    s.check("str x0, [sp, #-16]!; mov x16, #1000; str x16, [sp, #-16]!", {op(I::PUSH, {x0}), op(I::PUSH, {}, 1000)});
+    s.check("str d0, [sp, #-16]!", {op(I::PUSH, {d0})});
+    s.check("ldr x1, [sp], #16; ldr d2, [sp], #16", {op(I::POP, {x1}), op(I::POP, {d2})});
+    s.check("nop", {op(I::NOP, {})});
+
+    // Frame with spill slots and callee-saved registers stored from sp up
+    Case& frame = s.check("stp x29, x30, [sp, #-16]!; mov x29, sp; sub sp, sp, #48; "
+                          "str x19, [sp]; str x20, [sp, #8]; str d8, [sp, #16]; "
+                          "sub sp, x29, #48; ldr x19, [sp]; ldr x20, [sp, #8]; ldr d8, [sp, #16]; "
+                          "mov sp, x29; ldp x29, x30, [sp], #16; ret", {op(I::RET, {})});
+    frame.prologue = true;
+    frame.stack_size = 24;
+    frame.saved_general = {19, 20};
+    frame.saved_floating = {8};
+}
+
+int main() {
+    if (std::system("llvm-mc --version > /dev/null 2>&1 && llvm-objcopy --version > /dev/null 2>&1") != 0) {
+        std::cout << "encoder test skipped: llvm-mc and llvm-objcopy are needed" << std::endl;
+        return 0;
+    }
+
+    RegisterFile x86_file = RegisterFile::x86_64(false);
+    Suite x86("x86_64", x86_file);
+    x86Cases(x86);
+    X86Encoder x86_encoder(x86_file);
+    int x86_failures = x86.run(x86_encoder);
+
+    RegisterFile arm_file = RegisterFile::aarch64();
+    Suite arm("aarch64", arm_file);
+    arm64Cases(arm);
+    ARM64Encoder arm_encoder(arm_file);
+    int arm_failures = arm.run(arm_encoder);
+
+    if (x86_failures < 0 || arm_failures < 0) {
+        std::cerr << "encoder test: llvm-mc failed on the expected assembly" << std::endl;
+        return 1;
+    }
+    int failures = x86_failures + arm_failures;
+    size_t total = x86.size() + arm.size();
+    std::cout << "encoder test: " << total - failures << " of " << total << " cases match llvm-mc" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
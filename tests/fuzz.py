@@ -0,0 +1,388 @@
+#!/usr/bin/env python3
+"""Differential fuzzer: generates random GDScript programs over 64-bit
+ints, evaluates them with a reference interpreter in Python, compiles each
+one to an x86-64 ELF object, and links it with a generated C driver that
+checks every function against the reference on a set of inputs.
+
+The programs mix typed and untyped locals, dead stores, code after
+return, if/else, while loops with break, match, calls between functions,
+and arithmetic that wraps and divides by truncation. A failing program is
+kept in test_output/fuzz with its seed for reproduction.
+
+Usage: tests/fuzz.py COMPILER [--count N] [--seed S] [--regalloc linear|coloring]
+"""
+
+import argparse
+import os
+import platform
+import random
+import shutil
+import subprocess
+import sys
+
+MASK = (1 << 64) - 1
+INPUTS = [(0, 0), (1, 2), (-3, 7), (100, -1), (12345, 678), (-(1 << 40), 3), ((1 << 62) + 5, -(1 << 33))]
+
+
+def wrap(value):
+    value &= MASK
+    return value - (1 << 64) if value >= 1 << 63 else value
+
+
+def divide(a, b):
+    quotient = abs(a) // abs(b)
+    return wrap(quotient if (a < 0) == (b < 0) else -quotient)
+
+
+def remainder(a, b):
+    return wrap(a - b * divide(a, b))
+
+
+# A divisor is used as written when it is a literal of at least 2, else it
+# is folded into [2, 14] so it is never 0 and never -1
+def literal_divisor(expr):
+    return expr[0] == 'num' and expr[1] >= 2
+
+
+class Return(Exception):
+    def __init__(self, value):
+        self.value = value
+
+
+class Break(Exception):
+    pass
+
+
+# Expressions: ('num', n), ('var', name), ('bin', op, left, right),
+# ('div', op, left, right) whose divisor is made nonzero,
+# ('call', function, [arguments])
+# Conditions: ('cmp', op, left, right), ('and' | 'or', left, right), ('not', condition)
+# Statements: ('var', name, declaration, value), ('assign', name, op, value),
+# ('if', condition, then, else), ('while', counter, bound, body, break_condition),
+# ('match', value, [(pattern, body)], default), ('return', value)
+
+class Generator:
+    def __init__(self, rng):
+        self.rng = rng
+        self.functions = []     # (name, body) of the functions generated so far
+
+    def number(self):
+        roll = self.rng.random()
+        if roll < 0.1:
+            return self.rng.choice([1 << 40, -(1 << 35), (1 << 62) - 1, 1 << 31])
+        return self.rng.randint(-20, 20)
+
+    def expression(self, scope, depth):
+        roll = self.rng.random()
+        if depth <= 0 or roll < 0.3:
+            if scope and self.rng.random() < 0.7:
+                return ('var', self.rng.choice(scope))
+            return ('num', self.number())
+        if roll < 0.75:
+            op = self.rng.choice(['+', '-', '*'])
+            return ('bin', op, self.expression(scope, depth - 1), self.expression(scope, depth - 1))
+        if roll < 0.9 or not self.functions:
+            op = self.rng.choice(['/', '%'])
+            return ('div', op, self.expression(scope, depth - 1), self.expression(scope, depth - 1))
+        callee = self.rng.choice(self.functions)[0]
+        return ('call', callee, [self.expression(scope, depth - 1) for _ in range(2)])
+
+    def condition(self, scope, depth):
+        roll = self.rng.random()
+        if depth > 0 and roll < 0.15:
+            return (self.rng.choice(['and', 'or']), self.condition(scope, depth - 1), self.condition(scope, depth - 1))
+        if depth > 0 and roll < 0.2:
+            return ('not', self.condition(scope, depth - 1))
+        op = self.rng.choice(['<', '<=', '>', '>=', '==', '!='])
+        return ('cmp', op, self.expression(scope, 1), self.expression(scope, 1))
+
+    def fresh(self, state):
+        state['names'] += 1
+        return 'v%d' % state['names']
+
+    def block(self, scope, depth, state, in_loop=False):
+        scope = list(scope)
+        body = []
+        for _ in range(self.rng.randint(1, 4 if depth > 0 else 3)):
+            roll = self.rng.random()
+            if roll < 0.3 or not scope:
+                name = self.fresh(state)
+                declaration = self.rng.choice(['typed', 'untyped', 'inferred'])
+                body.append(('var', name, declaration, self.expression(scope, 2)))
+                scope.append(name)
+            elif roll < 0.55:
+                # Loop counters are only read, so every loop ends
+                targets = [name for name in scope if name not in state['counters']]
+                op = self.rng.choice(['=', '+=', '-=', '*='])
+                body.append(('assign', self.rng.choice(targets), op, self.expression(scope, 2)))
+            elif roll < 0.68 and depth > 0:
+                otherwise = self.block(scope, depth - 1, state, in_loop) if self.rng.random() < 0.6 else None
+                body.append(('if', self.condition(scope, 1), self.block(scope, depth - 1, state, in_loop), otherwise))
+            elif roll < 0.78 and depth > 0 and state['loops'] < 2:
+                state['loops'] += 1
+                counter = self.fresh(state)
+                state['counters'].add(counter)
+                loop_body = self.block(scope + [counter], depth - 1, state, True)
+                breaker = self.condition(scope + [counter], 0) if self.rng.random() < 0.4 else None
+                body.append(('while', counter, self.rng.randint(0, 6), loop_body, breaker))
+            elif roll < 0.85 and depth > 0:
+                cases = [(value, self.block(scope, depth - 1, state, in_loop))
+                         for value in self.rng.sample(range(-2, 4), self.rng.randint(1, 3))]
+                default = self.block(scope, depth - 1, state, in_loop) if self.rng.random() < 0.5 else None
+                body.append(('match', ('div', '%', self.expression(scope, 1), ('num', 4)), cases, default))
+            elif roll < 0.9 and not in_loop:
+                body.append(('return', self.expression(scope, 2)))
+                if self.rng.random() < 0.5:
+                    # Unreachable: dead code elimination removes it
+                    name = self.fresh(state)
+                    body.append(('var', name, 'typed', self.expression(scope, 1)))
+            else:
+                # A dead store
+                name = self.fresh(state)
+                body.append(('var', name, 'typed', self.expression(scope, 1)))
+                body.append(('assign', name, '=', self.expression(scope, 1)))
+        return body
+
+    def function(self, index):
+        state = {'names': 0, 'loops': 0, 'counters': set()}
+        body = self.block(['a', 'b'], 2, state)
+        scope = ['a', 'b'] + [s[1] for s in body if s[0] == 'var']
+        body.append(('return', self.expression(scope, 2)))
+        name = 'f%d' % index
+        self.functions.append((name, body))
+        return name, body
+
+
+# Reference interpreter
+
+class Interpreter:
+    def __init__(self, functions):
+        self.functions = dict(functions)
+
+    def call(self, name, arguments):
+        env = {'a': arguments[0], 'b': arguments[1]}
+        try:
+            self.run(self.functions[name], env)
+        except Return as result:
+            return result.value
+        raise AssertionError('function without return')
+
+    def expression(self, expr, env):
+        kind = expr[0]
+        if kind == 'num':
+            return expr[1]
+        if kind == 'var':
+            return env[expr[1]]
+        if kind == 'bin':
+            left, right = self.expression(expr[2], env), self.expression(expr[3], env)
+            return wrap({'+': left + right, '-': left - right, '*': left * right}[expr[1]])
+        if kind == 'div':
+            left = self.expression(expr[2], env)
+            right = self.divisor(expr[3], env)
+            return divide(left, right) if expr[1] == '/' else remainder(left, right)
+        if kind == 'call':
+            return self.call(expr[1], [self.expression(arg, env) for arg in expr[2]])
+        raise AssertionError(kind)
+
+    def divisor(self, expr, env):
+        if literal_divisor(expr):
+            return expr[1]
+        return remainder(self.expression(expr, env), 7) + 8
+
+    def condition(self, cond, env):
+        kind = cond[0]
+        if kind == 'and':
+            return self.condition(cond[1], env) and self.condition(cond[2], env)
+        if kind == 'or':
+            return self.condition(cond[1], env) or self.condition(cond[2], env)
+        if kind == 'not':
+            return not self.condition(cond[1], env)
+        left, right = self.expression(cond[2], env), self.expression(cond[3], env)
+        return {'<': left < right, '<=': left <= right, '>': left > right, '>=': left >= right,
+                '==': left == right, '!=': left != right}[cond[1]]
+
+    def run(self, block, env):
+        for stmt in block:
+            kind = stmt[0]
+            if kind == 'var':
+                env[stmt[1]] = self.expression(stmt[3], env)
+            elif kind == 'assign':
+                value = self.expression(stmt[3], env)
+                current = env[stmt[1]]
+                env[stmt[1]] = wrap({'=': value, '+=': current + value, '-=': current - value,
+                                     '*=': current * value}[stmt[2]])
+            elif kind == 'if':
+                if self.condition(stmt[1], env):
+                    self.run(stmt[2], env)
+                elif stmt[3] is not None:
+                    self.run(stmt[3], env)
+            elif kind == 'while':
+                env[stmt[1]] = 0
+                try:
+                    while env[stmt[1]] < stmt[2]:
+                        self.run(stmt[3], env)
+                        if stmt[4] is not None and self.condition(stmt[4], env):
+                            raise Break()
+                        env[stmt[1]] += 1
+                except Break:
+                    pass
+            elif kind == 'match':
+                value = self.expression(stmt[1], env)
+                for pattern, body in stmt[2]:
+                    if value == pattern:
+                        self.run(body, env)
+                        break
+                else:
+                    if stmt[3] is not None:
+                        self.run(stmt[3], env)
+            elif kind == 'return':
+                raise Return(self.expression(stmt[1], env))
+
+
+# GDScript output
+
+def render_expression(expr):
+    kind = expr[0]
+    if kind == 'num':
+        return '(%d)' % expr[1] if expr[1] < 0 else str(expr[1])
+    if kind == 'var':
+        return expr[1]
+    if kind == 'bin':
+        return '(%s %s %s)' % (render_expression(expr[2]), expr[1], render_expression(expr[3]))
+    if kind == 'div':
+        divisor = render_expression(expr[3]) if literal_divisor(expr[3]) else '(%s %% 7 + 8)' % render_expression(expr[3])
+        return '(%s %s %s)' % (render_expression(expr[2]), expr[1], divisor)
+    if kind == 'call':
+        return '%s(%s)' % (expr[1], ', '.join(render_expression(arg) for arg in expr[2]))
+    raise AssertionError(kind)
+
+
+def render_condition(cond):
+    kind = cond[0]
+    if kind in ('and', 'or'):
+        return '(%s %s %s)' % (render_condition(cond[1]), kind, render_condition(cond[2]))
+    if kind == 'not':
+        return '(not %s)' % render_condition(cond[1])
+    return '(%s %s %s)' % (render_expression(cond[2]), cond[1], render_expression(cond[3]))
+
+
+def render_block(block, indent, lines):
+    pad = '    ' * indent
+    for stmt in block:
+        kind = stmt[0]
+        if kind == 'var':
+            annotation = {'typed': ': int =', 'untyped': ' =', 'inferred': ' :='}[stmt[2]]
+            lines.append('%svar %s%s %s' % (pad, stmt[1], annotation, render_expression(stmt[3])))
+        elif kind == 'assign':
+            lines.append('%s%s %s %s' % (pad, stmt[1], stmt[2], render_expression(stmt[3])))
+        elif kind == 'if':
+            lines.append('%sif %s:' % (pad, render_condition(stmt[1])))
+            render_block(stmt[2], indent + 1, lines)
+            if stmt[3] is not None:
+                lines.append('%selse:' % pad)
+                render_block(stmt[3], indent + 1, lines)
+        elif kind == 'while':
+            lines.append('%svar %s: int = 0' % (pad, stmt[1]))
+            lines.append('%swhile %s < %d:' % (pad, stmt[1], stmt[2]))
+            render_block(stmt[3], indent + 1, lines)
+            if stmt[4] is not None:
+                lines.append('%s    if %s:' % (pad, render_condition(stmt[4])))
+                lines.append('%s        break' % pad)
+            lines.append('%s    %s += 1' % (pad, stmt[1]))
+        elif kind == 'match':
+            lines.append('%smatch %s:' % (pad, render_expression(stmt[1])))
+            for pattern, body in stmt[2]:
+                lines.append('%s    %s:' % (pad, '(%d)' % pattern if pattern < 0 else pattern))
+                render_block(body, indent + 2, lines)
+            if stmt[3] is not None:
+                lines.append('%s    _:' % pad)
+                render_block(stmt[3], indent + 2, lines)
+        elif kind == 'return':
+            lines.append('%sreturn %s' % (pad, render_expression(stmt[1])))
+
+
+def render_program(functions, seed):
+    lines = ['# Generated by tests/fuzz.py, seed %d' % seed]
+    for name, body in functions:
+        lines.append('')
+        lines.append('func %s(a: int, b: int) -> int:' % name)
+        render_block(body, 1, lines)
+    return '\n'.join(lines) + '\n'
+
+
+def render_driver(functions, expected):
+    lines = ['#include "runtime.h"', '']
+    for name, _ in functions:
+        lines.append('long %s(long a, long b);' % name)
+    lines += ['', 'int main(void) {']
+    for (name, a, b), value in expected:
+        lines.append('    CHECK_EQ(%s(%dL, %dL), %dL);' % (name, a, b, value))
+    lines += ['    return check_failures != 0;', '}', '']
+    return '\n'.join(lines)
+
+
+def run(command, log):
+    result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    log.write(' '.join(command) + '\n' + result.stdout)
+    return result.returncode == 0
+
+
+def check_program(compiler, options, seed, out):
+    rng = random.Random(seed)
+    generator = Generator(rng)
+    functions = [generator.function(i) for i in range(rng.randint(1, 4))]
+    interpreter = Interpreter(functions)
+    expected = []
+    for name, _ in functions:
+        for a, b in INPUTS:
+            expected.append(((name, a, b), interpreter.call(name, [a, b])))
+
+    tests = os.path.dirname(os.path.abspath(__file__))
+    base = os.path.join(out, 'fuzz_%d' % seed)
+    with open(base + '.gd', 'w') as source:
+        source.write(render_program(functions, seed))
+    with open(base + '.c', 'w') as driver:
+        driver.write(render_driver(functions, expected))
+    with open(base + '.log', 'w') as log:
+        ok = (run([compiler, base + '.gd', base, '--platform', 'linux', '--format', 'object'] + options, log) and
+              run(['objcopy', '--redefine-sym', 'main=gd_main', base + '.o'], log) and
+              run(['cc', '-pie', '-Wl,-z,text', '-I', tests, '-o', base, os.path.join(tests, 'runtime.c'),
+                   base + '.c', base + '.o'], log) and
+              run([base], log))
+    if ok:
+        for suffix in ('.gd', '.c', '.log', '.o', '.s', ''):
+            if os.path.exists(base + suffix):
+                os.remove(base + suffix)
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Differential fuzzer for the GDScript compiler')
+    parser.add_argument('compiler')
+    parser.add_argument('--count', type=int, default=30)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--regalloc', choices=['linear', 'coloring'], default='linear')
+    args = parser.parse_args()
+    options = ['--regalloc', args.regalloc]
+
+    if platform.system() != 'Linux' or platform.machine() != 'x86_64':
+        print('fuzz test skipped: it needs an x86-64 Linux host')
+        return 0
+    for tool in ('cc', 'objcopy'):
+        if shutil.which(tool) is None:
+            print('fuzz test skipped: %s is needed' % tool)
+            return 0
+
+    out = os.path.join('test_output', 'fuzz')
+    os.makedirs(out, exist_ok=True)
+    failed = []
+    for seed in range(args.seed, args.seed + args.count):
+        if not check_program(args.compiler, options, seed, out):
+            failed.append(seed)
+            print('fuzz program %d failed, see %s' % (seed, os.path.join(out, 'fuzz_%d.log' % seed)))
+    print('fuzz test (%s allocator): %d of %d programs passed' % (args.regalloc, args.count - len(failed), args.count))
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
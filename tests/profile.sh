@@ -0,0 +1,54 @@
+#!/bin/sh
+# Profile-guided build of tests/run/profile_guided.gd: compiles it with
+# --profile-generate, links it with runtime/profile.c and runs the driver,
+# which records a profile, then feeds that profile to --profile-use. The
+# driver must pass on both builds, and the second must report that the
+# profile gave its functions counts.
+#
+# Usage: tests/profile.sh COMPILER
+
+compiler=$1
+dir=$(dirname "$0")
+out=test_output/profile
+name=profile_guided
+
+if [ "$(uname -s)" != Linux ] || [ "$(uname -m)" != x86_64 ]; then
+    echo "profile test skipped: it needs an x86-64 Linux host"
+    exit 0
+fi
+for tool in cc objcopy; do
+    if ! command -v $tool > /dev/null 2>&1; then
+        echo "profile test skipped: $tool is needed"
+        exit 0
+    fi
+done
+
+mkdir -p $out
+rm -f $out/$name.profile
+
+# build STAGE OPTIONS...: compiles and links $out/STAGE
+build() {
+    stage=$1
+    shift
+    "$compiler" "$dir"/run/$name.gd $out/$stage --platform linux --format object --stats "$@" > $out/$stage.log 2>&1 &&
+    objcopy --redefine-sym main=gd_main $out/$stage.o &&
+    cc -pie -Wl,-z,text -o $out/$stage "$dir"/runtime.c "$dir"/../runtime/profile.c "$dir"/run/$name.c \
+        $out/$stage.o >> $out/$stage.log 2>&1
+}
+
+fail() {
+    echo "profile test failed: $1"
+    [ -f "$2" ] && sed 's/^/    /' "$2"
+    exit 1
+}
+
+build instrumented --profile-generate || fail "instrumented build" $out/instrumented.log
+GDSCRIPT_PROFILE=$out/$name.profile ./$out/instrumented > $out/run.log 2>&1 || fail "instrumented run" $out/run.log
+grep -q '^[0-9a-f]\{8\} [1-9]' $out/$name.profile || fail "no counts recorded" $out/$name.profile
+
+build optimized --profile-use $out/$name.profile || fail "build with the profile" $out/optimized.log
+grep -q "Profile: [1-9][0-9]* blocks in [1-9][0-9]* functions given counts" $out/optimized.log ||
+    fail "the profile gave no counts" $out/optimized.log
+./$out/optimized > $out/run.log 2>&1 || fail "optimized run" $out/run.log
+
+echo "profile test: passed ($(grep -c '^[0-9a-f]' $out/$name.profile) points recorded)"
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Compiles each tests/run/NAME.gd to an x86-64 ELF object, renames its main
+# to gd_main, links it with tests/runtime.c and tests/run/NAME.c into a
+# position-independent executable that may not have text relocations, and
+# runs it. A driver exits non-zero when a check fails.
+#
+# Usage: tests/run.sh COMPILER
+
+compiler=$1
+dir=$(dirname "$0")
+out=test_output/run
+
+if [ "$(uname -s)" != Linux ] || [ "$(uname -m)" != x86_64 ]; then
+    echo "run tests skipped: they need an x86-64 Linux host"
+    exit 0
+fi
+for tool in cc objcopy; do
+    if ! command -v $tool > /dev/null 2>&1; then
+        echo "run tests skipped: $tool is needed"
+        exit 0
+    fi
+done
+
+mkdir -p $out
+passed=0
+failed=0
+for source in "$dir"/run/*.gd; do
+    name=$(basename "$source" .gd)
+    if "$compiler" "$source" $out/$name --platform linux --format object > $out/$name.log 2>&1 &&
+       objcopy --redefine-sym main=gd_main $out/$name.o &&
+       cc -pie -Wl,-z,text -o $out/$name "$dir"/runtime.c "$dir"/run/$name.c $out/$name.o >> $out/$name.log 2>&1 &&
+       ./$out/$name >> $out/$name.log 2>&1; then
+        passed=$((passed + 1))
+    else
+        echo "run test $name failed:"
+        sed 's/^/    /' $out/$name.log
+        failed=$((failed + 1))
+    fi
+done
+
+echo "run tests: $passed of $((passed + failed)) passed"
+[ $failed -eq 0 ]
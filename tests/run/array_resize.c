@@ -0,0 +1,39 @@
+#include "../runtime.h"
+
+// Packed array header: reference count, element count, element storage
+struct packed_array {
+    long refcount;
+    long size;
+    long* data;
+};
+
+long sum_shrinking(struct packed_array* a);
+long sum_all(struct packed_array* a);
+
+// a.resize(n) looks the method up on a and calls it with n alone, so the
+// lookup remembers the array it was made on
+static struct packed_array* receiver;
+
+static void resize(long size) {
+    receiver->size = size;
+}
+
+void* _object_get(struct packed_array* object, const char* name) {
+    CHECK(strcmp(name, "resize") == 0);
+    receiver = object;
+    return (void*)resize;
+}
+
+int main(void) {
+    long values[4] = {5, 6, 7, 8};
+    struct packed_array a = {1, 4, values};
+    CHECK_EQ(sum_all(&a), 26);
+
+    // Only the first element is left after the first trip
+    CHECK_EQ(sum_shrinking(&a), 5);
+    CHECK_EQ(a.size, 1);
+
+    struct packed_array empty = {1, 0, 0};
+    CHECK_EQ(sum_shrinking(&empty), 0);
+    return check_failures != 0;
+}
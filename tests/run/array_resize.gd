@@ -0,0 +1,16 @@
+# A loop over a packed array reads the length again after each trip, so a
+# body that shrinks the array stops the loop; a body that writes no memory
+# keeps the length in a register
+
+func sum_shrinking(a: PackedInt64Array) -> int:
+    var total = 0
+    for v in a:
+        total += v
+        a.resize(1)
+    return total
+
+func sum_all(a: PackedInt64Array) -> int:
+    var total = 0
+    for v in a:
+        total += v
+    return total
@@ -0,0 +1,32 @@
+#include "../runtime.h"
+#include <setjmp.h>
+#include <string.h>
+
+long checked_divide(long a, long b);
+long sum_positive(long n);
+
+// The failure helper does not return; it jumps back to the check
+static jmp_buf failed;
+static const char* message;
+static int failures;
+
+void _builtin_assert_failed(const char* text) {
+    message = text;
+    failures++;
+    longjmp(failed, 1);
+}
+
+int main(void) {
+    CHECK_EQ(checked_divide(42, 6), 7);
+    CHECK_EQ(checked_divide(-9, 3), -3);
+    CHECK_EQ(sum_positive(100), 5050);
+    CHECK_EQ(failures, 0);
+
+    if (setjmp(failed) == 0) {
+        checked_divide(1, 0);
+        CHECK(0);
+    }
+    CHECK_EQ(failures, 1);
+    CHECK(message && strcmp(message, "division by zero") == 0);
+    return check_failures != 0;
+}
@@ -0,0 +1,15 @@
+# assert only calls its failure helper, which the block layout moves to
+# the end of the function, when the condition is false
+
+func checked_divide(a: int, b: int) -> int:
+    assert(b != 0, "division by zero")
+    return a / b
+
+func sum_positive(n: int) -> int:
+    var total: int = 0
+    var i: int = 1
+    while i <= n:
+        assert(i > 0)
+        total += i
+        i += 1
+    return total
@@ -0,0 +1,33 @@
+#include "../runtime.h"
+
+void* make_counter(void);
+void* make_limited(long n);
+void* make_plain(long n);
+long start_of(void* c);
+long step_of(void* c);
+double scaled(void* c);
+long limit_of(void* l);
+long count_of(void* l);
+long extra_of(void* p);
+
+int main(void) {
+    void* counter = make_counter();
+    CHECK_EQ(start_of(counter), 7);
+    CHECK_EQ(step_of(counter), 8);
+    CHECK(scaled(counter) == 17.5);
+
+    // Counter's initializers and _init run before Limited's
+    void* limited = make_limited(5);
+    CHECK_EQ(start_of(limited), 7);
+    CHECK_EQ(step_of(limited), 8);
+    CHECK_EQ(limit_of(limited), 100);
+    CHECK_EQ(count_of(limited), 40);
+    CHECK(scaled(limited) == 17.5);
+
+    // Plain has no _init, so its arguments go to Limited's
+    void* plain = make_plain(2);
+    CHECK_EQ(extra_of(plain), 3);
+    CHECK_EQ(limit_of(plain), 100);
+    CHECK_EQ(count_of(plain), 16);
+    return check_failures != 0;
+}
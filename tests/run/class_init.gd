@@ -0,0 +1,50 @@
+# .new() runs the field initializers and the _init of every class in the
+# chain, the base class first, so a subclass sees what its base set up
+
+class Counter:
+    var start: int = 7
+    var step: int = 1
+    var scale: float = 2.5
+    var ready: bool = true
+
+    func _init():
+        step = start + 1
+
+class Limited extends Counter:
+    var limit: int = 100
+    var count: int
+
+    func _init(n: int):
+        count = n * step
+
+class Plain extends Limited:
+    var extra: int = 3
+
+func make_counter() -> Counter:
+    return Counter.new()
+
+func make_limited(n: int) -> Limited:
+    return Limited.new(n)
+
+func make_plain(n: int) -> Plain:
+    return Plain.new(n)
+
+func start_of(c: Counter) -> int:
+    return c.start
+
+func step_of(c: Counter) -> int:
+    return c.step
+
+func scaled(c: Counter) -> float:
+    if c.ready:
+        return c.scale * c.start
+    return 0.0
+
+func limit_of(l: Limited) -> int:
+    return l.limit
+
+func count_of(l: Limited) -> int:
+    return l.count
+
+func extra_of(p: Plain) -> int:
+    return p.extra
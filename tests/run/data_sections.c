@@ -0,0 +1,16 @@
+#include "../runtime.h"
+
+long pick(long n);
+const char* greeting(void);
+const char* farewell(void);
+const char* same_literal(void);
+
+int main(void) {
+    for (long n = -2; n <= 6; ++n) {
+        CHECK_EQ(pick(n), n >= 0 && n <= 4 ? 10 * (n + 1) : -1);
+    }
+    CHECK(strcmp(greeting(), "hello") == 0);
+    CHECK(strcmp(farewell(), "bye") == 0);
+    CHECK(same_literal() == greeting());
+    return check_failures != 0;
+}
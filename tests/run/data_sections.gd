@@ -0,0 +1,26 @@
+# Jump tables and string literals live in .rodata and are reached
+# PC-relative, so the program links as a PIE without text relocations
+
+func pick(n: int) -> int:
+    match n:
+        0:
+            return 10
+        1:
+            return 20
+        2:
+            return 30
+        3:
+            return 40
+        4:
+            return 50
+        _:
+            return -1
+
+func greeting() -> String:
+    return "hello"
+
+func farewell() -> String:
+    return "bye"
+
+func same_literal() -> String:
+    return "hello"
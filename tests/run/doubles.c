@@ -0,0 +1,57 @@
+#include "../runtime.h"
+
+#include <math.h>
+
+double third(void);
+double scale(double x, double factor);
+double big(void);
+long truncate(double x);
+double widen(long n);
+long less(double a, double b);
+long less_equal(double a, double b);
+long equal(double a, double b);
+long not_equal(double a, double b);
+long ordered(double a, double b);
+double negate(double x);
+
+// Packed array header: reference count, element count, element storage
+// padded to a whole word
+struct packed_array {
+    long refcount;
+    long size;
+    float* data;
+};
+double sum_floats(struct packed_array* values);
+
+int main(void) {
+    CHECK(third() == 1.0 / 3.0);
+    CHECK(scale(2.5, 4.0) == 2.5 * 4.0 + 0.1);
+    // 2^24 + 1 has no single-precision representation
+    CHECK(big() == 16777217.0);
+    CHECK_EQ(truncate(123456789.75), 123456789);
+    CHECK_EQ(truncate(-2.5), -2);
+    CHECK(widen(3) == 1.5);
+    CHECK_EQ(less(1.0, 1.0 + 1e-12), 1);
+    CHECK_EQ(less(1.0 + 1e-12, 1.0), 0);
+    CHECK_EQ(less_equal(1.0, 1.0), 1);
+    CHECK_EQ(less_equal(2.0, 1.0), 0);
+    CHECK(negate(0.1) == -0.1);
+
+    CHECK_EQ(less(NAN, 1.0), 0);
+    CHECK_EQ(less(1.0, NAN), 0);
+    CHECK_EQ(less_equal(NAN, 1.0), 0);
+    CHECK_EQ(less_equal(NAN, NAN), 0);
+    CHECK_EQ(equal(NAN, NAN), 0);
+    CHECK_EQ(equal(1.5, 1.5), 1);
+    CHECK_EQ(not_equal(NAN, NAN), 1);
+    CHECK_EQ(not_equal(1.5, 1.5), 0);
+    CHECK_EQ(ordered(NAN, 1.0), 0);
+    CHECK_EQ(ordered(1.0, NAN), 0);
+    CHECK_EQ(ordered(1.0, 1.0), 3);
+    CHECK_EQ(ordered(1.0, 2.0), 2);
+
+    float elements[4] = {0.5f, 1.25f, -3.0f, 0.0f};
+    struct packed_array values = {1, 3, elements};
+    CHECK(sum_floats(&values) == -1.25);
+    return check_failures != 0;
+}
@@ -0,0 +1,59 @@
+# Floats are 64-bit doubles: constants that need more than single
+# precision survive arithmetic, conversion and comparison
+
+func third() -> float:
+    return 1.0 / 3.0
+
+func scale(x: float, factor: float) -> float:
+    return x * factor + 0.1
+
+func big() -> float:
+    return 16777217.0
+
+func truncate(x: float) -> int:
+    var n: int = x
+    return n
+
+func widen(n: int) -> float:
+    return n * 0.5
+
+func less(a: float, b: float) -> int:
+    if a < b:
+        return 1
+    return 0
+
+func less_equal(a: float, b: float) -> int:
+    if a <= b:
+        return 1
+    return 0
+
+# Every ordered comparison with a NaN operand is false, and != is true
+func equal(a: float, b: float) -> bool:
+    return a == b
+
+func not_equal(a: float, b: float) -> bool:
+    return a != b
+
+func ordered(a: float, b: float) -> int:
+    var count: int = 0
+    if a < b:
+        count += 1
+    if a <= b:
+        count += 1
+    if a > b:
+        count += 1
+    if a >= b:
+        count += 1
+    if a == b:
+        count += 1
+    return count
+
+func negate(x: float) -> float:
+    return -x
+
+# PackedFloat32Array keeps single-precision elements; each widens to a double
+func sum_floats(values: PackedFloat32Array) -> float:
+    var total = 0.0
+    for value in values:
+        total += value
+    return total
@@ -0,0 +1,38 @@
+#include "../runtime.h"
+#include <string.h>
+
+// An object with two named properties; anything else is a failed check
+struct pair {
+    long x;
+    long y;
+};
+
+static long* property(struct pair* object, const char* name) {
+    if (strcmp(name, "x") == 0) return &object->x;
+    if (strcmp(name, "y") == 0) return &object->y;
+    CHECK(0);
+    return &object->x;
+}
+
+long _object_get(struct pair* object, const char* name) {
+    return *property(object, name);
+}
+
+void _object_set(struct pair* object, const char* name, long value) {
+    *property(object, name) = value;
+}
+
+long get_x(struct pair* object);
+long get_y(struct pair* object);
+void set_pair(struct pair* object, long a, long b);
+
+int main(void) {
+    struct pair object = {3, 4};
+    CHECK_EQ(get_x(&object), 3);
+    CHECK_EQ(get_y(&object), 4);
+    set_pair(&object, 10, 20);
+    CHECK_EQ(object.x, 10);
+    CHECK_EQ(object.y, 20);
+    CHECK_EQ(get_y(&object), 20);
+    return check_failures != 0;
+}
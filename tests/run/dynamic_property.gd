@@ -0,0 +1,14 @@
+# Properties of objects whose class is not known statically are read and
+# written through the runtime, which gets the property's name
+
+func get_x(o) -> int:
+    var x: int = o.x
+    return x
+
+func get_y(o) -> int:
+    var y: int = o.y
+    return y
+
+func set_pair(o, a: int, b: int):
+    o.x = a
+    o.y = b
@@ -0,0 +1,16 @@
+#include "../runtime.h"
+
+void* make_holder(long x);
+long guarded_sum(void* o, long use, long n);
+long repeated_sum(void* o, long n);
+
+int main(void) {
+    void* holder = make_holder(3);
+    CHECK_EQ(guarded_sum(holder, 1, 5), 15);
+    CHECK_EQ(guarded_sum(0, 0, 5), 0);
+
+    // No iterations, so the object is never read
+    CHECK_EQ(repeated_sum(holder, 4), 12);
+    CHECK_EQ(repeated_sum(0, 0), 0);
+    return check_failures != 0;
+}
@@ -0,0 +1,27 @@
+# A field load behind a condition, or in a loop that may not run, stays
+# where it is; hoisting it would dereference a null object
+
+class Holder:
+    var x: int
+
+func make_holder(x: int) -> Holder:
+    var h = Holder.new()
+    h.x = x
+    return h
+
+func guarded_sum(o: Holder, use: bool, n: int) -> int:
+    var s = 0
+    var i = 0
+    while i < n:
+        if use:
+            s += o.x
+        i += 1
+    return s
+
+func repeated_sum(o: Holder, n: int) -> int:
+    var s = 0
+    var i = 0
+    while i < n:
+        s += o.x
+        i += 1
+    return s
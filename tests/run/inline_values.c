@@ -0,0 +1,23 @@
+#include "../runtime.h"
+
+void* make_body(const float* p);
+const float* replace_pos(void* b, const float* q);
+const float* pos_of(void* b);
+
+int main(void) {
+    float p[3] = {1.0f, 2.0f, 3.0f};
+    float q[3] = {4.0f, 5.0f, 6.0f};
+    void* body = make_body(p);
+
+    // The value read before the store keeps the old coordinates
+    const float* old = replace_pos(body, q);
+    CHECK(old[0] == 1.0f && old[1] == 2.0f && old[2] == 3.0f);
+
+    const float* now = pos_of(body);
+    CHECK(now[0] == 4.0f && now[1] == 5.0f && now[2] == 6.0f);
+
+    // Changing the caller's vector does not reach the field
+    q[0] = 9.0f;
+    CHECK(pos_of(body)[0] == 4.0f);
+    return check_failures != 0;
+}
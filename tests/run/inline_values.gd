@@ -0,0 +1,18 @@
+# A Vector3 field lives inside its object; reading it copies the value, so
+# storing to the field afterwards leaves what was read unchanged
+
+class Body:
+    var pos: Vector3
+
+func make_body(p: Vector3) -> Body:
+    var b = Body.new()
+    b.pos = p
+    return b
+
+func replace_pos(b: Body, q: Vector3) -> Vector3:
+    var old = b.pos
+    b.pos = q
+    return old
+
+func pos_of(b: Body) -> Vector3:
+    return b.pos
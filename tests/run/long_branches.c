@@ -0,0 +1,30 @@
+#include "../runtime.h"
+
+long long_if(long x);
+long long_loop(long n);
+
+// The same computations in C; GDScript division truncates like C's
+static long expected_if(long x) {
+    long t = x;
+    if (x > 0) {
+        for (long k = 1; k <= 30; ++k) t = t * 3 + k - (t / 7);
+    } else {
+        t = -t;
+    }
+    return t;
+}
+
+static long expected_loop(long n) {
+    long t = 1;
+    for (long i = 0; i < n; ++i) {
+        for (long k = 1; k <= 40; ++k) t = (t * 5 + k + i) % 1000003;
+    }
+    return t;
+}
+
+int main(void) {
+    for (long x = -2; x <= 3; ++x) CHECK_EQ(long_if(x), expected_if(x));
+    CHECK_EQ(long_loop(0), 1);
+    CHECK_EQ(long_loop(100), expected_loop(100));
+    return check_failures != 0;
+}
@@ -0,0 +1,86 @@
+# Bodies too large for a rel8 displacement, so the assembler relaxes the
+# branches around them to their rel32 form
+
+func long_if(x: int) -> int:
+    var t: int = x
+    if x > 0:
+        t = t * 3 + 1 - (t / 7)
+        t = t * 3 + 2 - (t / 7)
+        t = t * 3 + 3 - (t / 7)
+        t = t * 3 + 4 - (t / 7)
+        t = t * 3 + 5 - (t / 7)
+        t = t * 3 + 6 - (t / 7)
+        t = t * 3 + 7 - (t / 7)
+        t = t * 3 + 8 - (t / 7)
+        t = t * 3 + 9 - (t / 7)
+        t = t * 3 + 10 - (t / 7)
+        t = t * 3 + 11 - (t / 7)
+        t = t * 3 + 12 - (t / 7)
+        t = t * 3 + 13 - (t / 7)
+        t = t * 3 + 14 - (t / 7)
+        t = t * 3 + 15 - (t / 7)
+        t = t * 3 + 16 - (t / 7)
+        t = t * 3 + 17 - (t / 7)
+        t = t * 3 + 18 - (t / 7)
+        t = t * 3 + 19 - (t / 7)
+        t = t * 3 + 20 - (t / 7)
+        t = t * 3 + 21 - (t / 7)
+        t = t * 3 + 22 - (t / 7)
+        t = t * 3 + 23 - (t / 7)
+        t = t * 3 + 24 - (t / 7)
+        t = t * 3 + 25 - (t / 7)
+        t = t * 3 + 26 - (t / 7)
+        t = t * 3 + 27 - (t / 7)
+        t = t * 3 + 28 - (t / 7)
+        t = t * 3 + 29 - (t / 7)
+        t = t * 3 + 30 - (t / 7)
+    else:
+        t = -t
+    return t
+
+func long_loop(n: int) -> int:
+    var t: int = 1
+    var i: int = 0
+    while i < n:
+        t = (t * 5 + 1 + i) % 1000003
+        t = (t * 5 + 2 + i) % 1000003
+        t = (t * 5 + 3 + i) % 1000003
+        t = (t * 5 + 4 + i) % 1000003
+        t = (t * 5 + 5 + i) % 1000003
+        t = (t * 5 + 6 + i) % 1000003
+        t = (t * 5 + 7 + i) % 1000003
+        t = (t * 5 + 8 + i) % 1000003
+        t = (t * 5 + 9 + i) % 1000003
+        t = (t * 5 + 10 + i) % 1000003
+        t = (t * 5 + 11 + i) % 1000003
+        t = (t * 5 + 12 + i) % 1000003
+        t = (t * 5 + 13 + i) % 1000003
+        t = (t * 5 + 14 + i) % 1000003
+        t = (t * 5 + 15 + i) % 1000003
+        t = (t * 5 + 16 + i) % 1000003
+        t = (t * 5 + 17 + i) % 1000003
+        t = (t * 5 + 18 + i) % 1000003
+        t = (t * 5 + 19 + i) % 1000003
+        t = (t * 5 + 20 + i) % 1000003
+        t = (t * 5 + 21 + i) % 1000003
+        t = (t * 5 + 22 + i) % 1000003
+        t = (t * 5 + 23 + i) % 1000003
+        t = (t * 5 + 24 + i) % 1000003
+        t = (t * 5 + 25 + i) % 1000003
+        t = (t * 5 + 26 + i) % 1000003
+        t = (t * 5 + 27 + i) % 1000003
+        t = (t * 5 + 28 + i) % 1000003
+        t = (t * 5 + 29 + i) % 1000003
+        t = (t * 5 + 30 + i) % 1000003
+        t = (t * 5 + 31 + i) % 1000003
+        t = (t * 5 + 32 + i) % 1000003
+        t = (t * 5 + 33 + i) % 1000003
+        t = (t * 5 + 34 + i) % 1000003
+        t = (t * 5 + 35 + i) % 1000003
+        t = (t * 5 + 36 + i) % 1000003
+        t = (t * 5 + 37 + i) % 1000003
+        t = (t * 5 + 38 + i) % 1000003
+        t = (t * 5 + 39 + i) % 1000003
+        t = (t * 5 + 40 + i) % 1000003
+        i += 1
+    return t
@@ -0,0 +1,21 @@
+#include "../runtime.h"
+
+double run_half(void);
+long run_twice(long k);
+long shadow(long flag);
+
+// Called from outside the script, half and twice still take Variants
+long _variant_from_float(double value);
+long _variant_from_int(long value);
+double half(long x);
+long twice(long n);
+
+int main(void) {
+    CHECK(run_half() == 4.0);
+    CHECK_EQ(run_twice(5), 24);
+    CHECK_EQ(shadow(1), 5);
+    CHECK_EQ(shadow(0), 14);
+    CHECK(half(_variant_from_float(3.0)) == 1.5);
+    CHECK_EQ(twice(_variant_from_int(4)), 8);
+    return check_failures != 0;
+}
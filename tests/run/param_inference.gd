@@ -0,0 +1,32 @@
+# Untyped parameters take the type every call site passes, and untyped
+# locals are inferred per declaration. Any of these left Variant would
+# call a Variant arithmetic helper this test does not link with. The
+# exported names keep taking Variants and unbox them for the typed body.
+
+func half(x) -> float:
+    return x * 0.5
+
+func twice(n) -> int:
+    var sum = n + n
+    return sum
+
+func run_half() -> float:
+    return half(3.0) + half(5.0)
+
+func run_twice(k: int) -> int:
+    return twice(k) + twice(7)
+
+func shadow(flag: bool) -> int:
+    var total: int = 0
+    if flag:
+        var v = 2
+        total += v
+    else:
+        var v = 1.5
+        total += 1
+        if v > 1.0:
+            total += 10
+    for i in range(3):
+        var v = i
+        total += v
+    return total
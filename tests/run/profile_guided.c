@@ -0,0 +1,11 @@
+#include "../runtime.h"
+
+long classify(long n);
+long run(long count);
+
+int main(void) {
+    for (long n = 0; n < 16; ++n) CHECK_EQ(classify(n), 10 + n % 8);
+    // classify(0), (100), ... (900) alternate between 10 and 14; 990 calls of classify(7)
+    CHECK_EQ(run(1000), 5 * 10 + 5 * 14 + 990 * 17);
+    return check_failures != 0;
+}
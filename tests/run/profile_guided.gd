@@ -0,0 +1,30 @@
+# Most calls take the last match arm; tests/profile.sh records that with
+# --profile-generate and rebuilds with --profile-use
+
+func classify(n: int) -> int:
+    match n % 8:
+        0:
+            return 10
+        1:
+            return 11
+        2:
+            return 12
+        3:
+            return 13
+        4:
+            return 14
+        5:
+            return 15
+        6:
+            return 16
+        _:
+            return 17
+
+func run(count: int) -> int:
+    var total: int = 0
+    for i in range(count):
+        if i % 100 == 0:
+            total += classify(i)
+        else:
+            total += classify(7)
+    return total
@@ -0,0 +1,24 @@
+#include "../runtime.h"
+
+long count_by(long n, long step);
+
+// Stands in for the runtime's range(), which reports a zero step and
+// returns an empty array
+static int zero_steps;
+
+void* _builtin_range(long start, long end, long step) {
+    (void)start;
+    (void)end;
+    if (step == 0) zero_steps++;
+    return 0;
+}
+
+int main(void) {
+    CHECK_EQ(count_by(10, 3), 4);
+    CHECK_EQ(count_by(10, -1), 0);
+    CHECK_EQ(zero_steps, 0);
+
+    CHECK_EQ(count_by(10, 0), 0);
+    CHECK_EQ(zero_steps, 1);
+    return check_failures != 0;
+}
@@ -0,0 +1,8 @@
+# A range() step known only at run time may be zero, which range() reports
+# as an error; the loop then runs no iterations instead of never ending
+
+func count_by(n: int, step: int) -> int:
+    var count = 0
+    for i in range(0, n, step):
+        count += 1
+    return count
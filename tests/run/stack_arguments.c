@@ -0,0 +1,29 @@
+#include "../runtime.h"
+
+long many_ints(long a, long b, long c, long d, long e, long f, long g, long h, long i);
+double many_floats(double a, double b, double c, double d, double e, double f, double g, double h, double i,
+                   double j);
+double mixed(long a, double x, long b, double y, long c, double z, long d, long e, long f, long g, double w,
+             long h);
+long call_many_ints(long k);
+double call_many_floats(double x);
+double call_mixed(void);
+
+static long expected_ints(long a, long b, long c, long d, long e, long f, long g, long h, long i) {
+    return a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * f + 7 * g + 8 * h + 9 * i;
+}
+
+int main(void) {
+    // Called from C: the compiled callee reads its stack arguments
+    CHECK_EQ(many_ints(1, 2, 3, 4, 5, 6, 7, 8, 9), expected_ints(1, 2, 3, 4, 5, 6, 7, 8, 9));
+    CHECK_EQ(many_ints(0, 0, 0, 0, 0, 0, 0, 0, -1), -9);
+    CHECK(many_floats(1, 1, 1, 1, 1, 1, 1, 1, 1, 1) == 55.0);
+    CHECK(many_floats(0, 0, 0, 0, 0, 0, 0, 0, 0, 0.5) == 5.0);
+    CHECK(mixed(1, 0.5, 2, 0.25, 3, 0.125, 4, 5, 6, 7, 0.0625, 8) == 28 + 5 + 25 + 125 + 625 + 800000);
+
+    // Called from compiled code: the compiled caller pushes them
+    CHECK_EQ(call_many_ints(10), expected_ints(10, 11, 12, 13, 14, 15, 16, 17, 18) + 36 + 9 * 10);
+    CHECK(call_many_floats(2.0) == 2.0 * 45 + 3.0 * 10);
+    CHECK(call_mixed() == 28 + 5 + 25 + 125 + 625 + 800000);
+    return check_failures != 0;
+}
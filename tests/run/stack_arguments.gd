@@ -0,0 +1,20 @@
+# Arguments past the registers of the calling convention go on the stack:
+# the seventh integer and ninth float argument onward on System V
+
+func many_ints(a: int, b: int, c: int, d: int, e: int, f: int, g: int, h: int, i: int) -> int:
+    return a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * f + 7 * g + 8 * h + 9 * i
+
+func many_floats(a: float, b: float, c: float, d: float, e: float, f: float, g: float, h: float, i: float, j: float) -> float:
+    return a + b * 2.0 + c * 3.0 + d * 4.0 + e * 5.0 + f * 6.0 + g * 7.0 + h * 8.0 + i * 9.0 + j * 10.0
+
+func mixed(a: int, x: float, b: int, y: float, c: int, z: float, d: int, e: int, f: int, g: int, w: float, h: int) -> float:
+    return (a + b + c + d + e + f + g) * 1.0 + x * 10.0 + y * 100.0 + z * 1000.0 + w * 10000.0 + h * 100000.0
+
+func call_many_ints(k: int) -> int:
+    return many_ints(k, k + 1, k + 2, k + 3, k + 4, k + 5, k + 6, k + 7, k + 8) + many_ints(1, 1, 1, 1, 1, 1, 1, 1, k)
+
+func call_many_floats(x: float) -> float:
+    return many_floats(x, x, x, x, x, x, x, x, x, x + 1.0)
+
+func call_mixed() -> float:
+    return mixed(1, 0.5, 2, 0.25, 3, 0.125, 4, 5, 6, 7, 0.0625, 8)
@@ -0,0 +1,23 @@
+#include "../runtime.h"
+
+long Counter_bump(void);
+long Counter_read(void);
+long Counter_read_hits(void);
+double Counter_add(double x);
+void Counter_reset(void);
+
+int main(void) {
+    CHECK_EQ(Counter_read(), 5);
+    CHECK_EQ(Counter_read_hits(), 0);
+    CHECK_EQ(Counter_bump(), 6);
+    CHECK_EQ(Counter_bump(), 7);
+    CHECK_EQ(Counter_read(), 7);
+    CHECK_EQ(Counter_read_hits(), 4);
+    CHECK(Counter_add(0.25) == 0.75);
+    CHECK(Counter_add(1.0) == 1.75);
+    Counter_reset();
+    CHECK_EQ(Counter_read(), 0);
+    CHECK_EQ(Counter_bump(), 1);
+    CHECK_EQ(Counter_read_hits(), 2);
+    return check_failures != 0;
+}
@@ -0,0 +1,26 @@
+# Static fields live in .data or .bss, so every method of the class and
+# every call sees the same value
+
+class Counter:
+    static var count: int = 5
+    static var total: float = 0.5
+    static var hits: int
+
+    static func bump() -> int:
+        count += 1
+        hits = hits + 2
+        return count
+
+    static func read() -> int:
+        return count
+
+    static func read_hits() -> int:
+        return hits
+
+    static func add(x: float) -> float:
+        total += x
+        return total
+
+    static func reset():
+        count = 0
+        hits = 0
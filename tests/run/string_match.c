@@ -0,0 +1,30 @@
+#include "../runtime.h"
+
+long two_arms(const char* name);
+long three_arms(const char* name);
+long hashed(const char* command);
+
+int main(void) {
+    // Equal text at a different address, as a string built at runtime would be
+    char buffer[16];
+
+    CHECK_EQ(two_arms("left"), 1);
+    CHECK_EQ(two_arms("right"), 2);
+    CHECK_EQ(two_arms("up"), 0);
+    CHECK_EQ(two_arms(""), 0);
+
+    CHECK_EQ(three_arms("red"), 1);
+    CHECK_EQ(three_arms("green"), 2);
+    strcpy(buffer, "blue");
+    CHECK_EQ(three_arms(buffer), 3);
+    CHECK_EQ(three_arms("bluer"), -1);
+
+    const char* commands[] = {"idle", "walk", "run", "jump", "crouch", "attack"};
+    for (int i = 0; i < 6; ++i) {
+        strcpy(buffer, commands[i]);
+        CHECK_EQ(hashed(buffer), 10 * (i + 1));
+    }
+    CHECK_EQ(hashed("swim"), 0);
+    CHECK_EQ(hashed("Idle"), 0);
+    return check_failures != 0;
+}
@@ -0,0 +1,38 @@
+# match on strings compares against the literals in .rodata: a chain of
+# _string_compare calls for a few arms, a dispatch on _string_hash for more
+
+func two_arms(name: String) -> int:
+    match name:
+        "left":
+            return 1
+        "right":
+            return 2
+    return 0
+
+func three_arms(name: String) -> int:
+    match name:
+        "red":
+            return 1
+        "green":
+            return 2
+        "blue":
+            return 3
+        _:
+            return -1
+
+func hashed(command: String) -> int:
+    match command:
+        "idle":
+            return 10
+        "walk":
+            return 20
+        "run":
+            return 30
+        "jump":
+            return 40
+        "crouch":
+            return 50
+        "attack":
+            return 60
+        _:
+            return 0
@@ -0,0 +1,19 @@
+#include "../runtime.h"
+#include <sys/resource.h>
+
+long fact(long n, long acc);
+long count_down(long n, long steps);
+
+int main(void) {
+    // A frame per level would need hundreds of megabytes; allow one
+    struct rlimit limit = {1 << 20, 1 << 20};
+    CHECK(setrlimit(RLIMIT_STACK, &limit) == 0);
+
+    // Products wrap around at 64 bits, as in the compiled code
+    unsigned long expected = 1;
+    for (unsigned long n = 2; n <= 10000000; ++n) expected *= n;
+    CHECK_EQ(fact(10000000, 1), expected);
+    CHECK_EQ(fact(5, 1), 120);
+    CHECK_EQ(count_down(10000000, 0), 10000000);
+    return check_failures != 0;
+}
@@ -0,0 +1,12 @@
+# Self-recursive calls in tail position become jumps, so recursion ten
+# million deep runs in one frame
+
+func fact(n: int, acc: int) -> int:
+    if n <= 1:
+        return acc
+    return fact(n - 1, acc * n)
+
+func count_down(n: int, steps: int) -> int:
+    if n == 0:
+        return steps
+    return count_down(n - 1, steps + 1)
@@ -0,0 +1,15 @@
+#include "../runtime.h"
+
+long scale(double x);
+long successor(long n);
+double use_scale(void);
+long use_successor(void);
+double _variant_to_float(long value);
+
+int main(void) {
+    CHECK(_variant_to_float(scale(1.25)) == 2.5);
+    CHECK_EQ(successor(1), 2);
+    CHECK(use_scale() == 3.0);
+    CHECK_EQ(use_successor(), 42);
+    return check_failures != 0;
+}
@@ -0,0 +1,14 @@
+# A function without a return type returns a Variant in the integer
+# register, whatever the type of the value, and its callers unbox it
+
+func scale(x: float):
+    return x * 2.0
+
+func successor(n: int):
+    return n + 1
+
+func use_scale() -> float:
+    return scale(1.5)
+
+func use_successor() -> int:
+    return successor(41)
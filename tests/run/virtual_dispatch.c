@@ -0,0 +1,23 @@
+#include "../runtime.h"
+
+void* make_shape(void);
+void* make_square(long size);
+void* make_triangle(void);
+long area_of(void* shape);
+long describe(void* shape);
+
+int main(void) {
+    void* shape = make_shape();
+    void* square = make_square(5);
+    void* triangle = make_triangle();
+
+    CHECK_EQ(area_of(shape), 0);
+    CHECK_EQ(area_of(square), 25);
+    CHECK_EQ(area_of(triangle), 7);
+
+    // describe is not overridden, but calls area through self's vtable
+    CHECK_EQ(describe(shape), 0);
+    CHECK_EQ(describe(square), 254);
+    CHECK_EQ(describe(triangle), 73);
+    return check_failures != 0;
+}
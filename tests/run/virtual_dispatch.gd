@@ -0,0 +1,42 @@
+# .new() stores the class's vtable in the object header, and calls of an
+# overridden method go through it
+
+class Shape:
+    var sides: int
+
+    func area() -> int:
+        return 0
+
+    func describe() -> int:
+        return area() * 10 + sides
+
+class Square extends Shape:
+    var size: int
+
+    func _init(s: int):
+        size = s
+        sides = 4
+
+    func area() -> int:
+        return size * size
+
+class Triangle extends Shape:
+    func area() -> int:
+        return 7
+
+func make_shape() -> Shape:
+    return Shape.new()
+
+func make_square(size: int) -> Shape:
+    return Square.new(size)
+
+func make_triangle() -> Shape:
+    var t = Triangle.new()
+    t.sides = 3
+    return t
+
+func area_of(s: Shape) -> int:
+    return s.area()
+
+func describe(s: Shape) -> int:
+    return s.describe()
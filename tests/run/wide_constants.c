@@ -0,0 +1,15 @@
+#include "../runtime.h"
+
+long literal(void);
+long negative_literal(void);
+long folded(void);
+long scaled(long n);
+
+int main(void) {
+    CHECK_EQ(literal(), 1099511627776L);
+    CHECK_EQ(negative_literal(), -4611686018427387904L);
+    CHECK_EQ(folded(), 3298534883335L);
+    CHECK_EQ(scaled(3), 103079215104L);
+    CHECK_EQ(scaled(-1), -34359738368L);
+    return check_failures != 0;
+}
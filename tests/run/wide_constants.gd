@@ -0,0 +1,16 @@
+# Ints that do not fit a 32-bit immediate, written or folded, are loaded
+# from .rodata
+
+const BIG = 1099511627776
+
+func literal() -> int:
+    return 1099511627776
+
+func negative_literal() -> int:
+    return -4611686018427387904
+
+func folded() -> int:
+    return BIG * 3 + 7
+
+func scaled(n: int) -> int:
+    return n * 34359738368
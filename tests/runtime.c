@@ -0,0 +1,63 @@
+// The runtime helpers compiled programs call, as far as the tests in
+// tests/run need them. Values are 64-bit words; a String is the address of
+// its NUL-terminated bytes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void _builtin_print(long value) {
+    printf("%ld\n", value);
+}
+
+// A Variant here is the plain word of its value
+long _variant_from_int(long value) {
+    return value;
+}
+
+long _variant_to_int(long value) {
+    return value;
+}
+
+long _variant_from_float(double value) {
+    long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double _variant_to_float(long value) {
+    double result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+// Storage for a new instance, zeroed like fresh fields
+void* _object_alloc(long size) {
+    return calloc(1, size);
+}
+
+// Aggregates such as Vector3 and Variant fields are used by address
+void _value_copy(void* destination, const void* source, long size) {
+    memcpy(destination, source, size);
+}
+
+void* _value_clone(const void* source, long size) {
+    void* copy = malloc(size);
+    memcpy(copy, source, size);
+    return copy;
+}
+
+long _string_compare(const char* left, const char* right) {
+    return strcmp(left, right);
+}
+
+// FNV-1a over the bytes, sign-extended from 32 bits like the hashes the
+// compiler computes for string match patterns
+long _string_hash(const char* text) {
+    unsigned int hash = 2166136261u;
+    for (const unsigned char* c = (const unsigned char*)text; *c; ++c) {
+        hash ^= *c;
+        hash *= 16777619u;
+    }
+    return (int)hash;
+}
@@ -0,0 +1,28 @@
+// Shared by the drivers of tests/run. Each program is compiled for
+// x86-64 Linux with its main renamed gd_main, then linked with
+// runtime.c and a driver whose main calls the compiled functions and
+// checks what they return.
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+
+static int check_failures;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            check_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        long long actual_value = (long long)(actual), expected_value = (long long)(expected); \
+        if (actual_value != expected_value) { \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, \
+                    actual_value, expected_value); \
+            check_failures++; \
+        } \
+    } while (0)
@@ -0,0 +1,531 @@
+#include "x86_encoder.h"
+#include <utility>
+
+static const int RAX = 0, RCX = 1, RDX = 2, RSP = 4, RBP = 5;
+
+static bool fitsInByte(int32_t value) {
+    return value >= -128 && value <= 127;
+}
+
+static void emit32(std::vector<uint8_t>& out, int32_t value) {
+    uint32_t bits = static_cast<uint32_t>(value);
+    for (int i = 0; i < 4; ++i) out.push_back((bits >> (8 * i)) & 0xff);
+}
+
+// REX is left out when it would carry no bits
+static void emitRex(std::vector<uint8_t>& out, bool wide, int reg, int base) {
+    uint8_t rex = 0x40 | (wide ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((base & 8) ? 1 : 0);
+    if (rex != 0x40) out.push_back(rex);
+}
+
+// [prefix] [REX] opcode ModRM with both operands in registers
+static void emitRR(std::vector<uint8_t>& out, uint8_t prefix, bool wide, std::initializer_list<uint8_t> opcode,
+                   int reg, int rm) {
+    if (prefix) out.push_back(prefix);
+    emitRex(out, wide, reg, rm);
+    out.insert(out.end(), opcode);
+    out.push_back(0xc0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// [prefix] [REX] opcode ModRM [SIB] [disp8/disp32] addressing [base + disp].
+// rsp and r12 as base need a SIB byte, rbp and r13 a displacement.
+static void emitRM(std::vector<uint8_t>& out, uint8_t prefix, bool wide, std::initializer_list<uint8_t> opcode,
+                   int reg, int base, int32_t disp) {
+    if (prefix) out.push_back(prefix);
+    emitRex(out, wide, reg, base);
+    out.insert(out.end(), opcode);
+    int mod = disp == 0 && (base & 7) != RBP ? 0 : fitsInByte(disp) ? 1 : 2;
+    out.push_back((mod << 6) | ((reg & 7) << 3) | (base & 7));
+    if ((base & 7) == RSP) out.push_back(0x24);
+    if (mod == 1) out.push_back(static_cast<uint8_t>(disp));
+    if (mod == 2) emit32(out, disp);
+}
+
+// lea dest, [rip + target], the displacement left to a fixup
+static void leaRip(std::vector<uint8_t>& out, int dest, Fixup::Target target, uint32_t symbol,
+                   std::vector<Fixup>& fixups) {
+    emitRex(out, true, dest, 0);
+    out.push_back(0x8d);
+    out.push_back(((dest & 7) << 3) | 5);
+    fixups.emplace_back(target, Fixup::REL32, out.size(), out.size() + 4, symbol);
+    emit32(out, 0);
+}
+
+static void movRR(std::vector<uint8_t>& out, int dest, int src) {
+    if (dest != src) emitRR(out, 0, true, {0x89}, src, dest);
+}
+
+static void movImmediate(std::vector<uint8_t>& out, int dest, int32_t value) {
+    if (value >= 0) {
+        // mov r32, imm32 zero-extends into the full register
+        emitRex(out, false, 0, dest);
+        out.push_back(0xb8 + (dest & 7));
+    } else {
+        emitRR(out, 0, true, {0xc7}, 0, dest);
+    }
+    emit32(out, value);
+}
+
+// Group-1 ALU operation with an immediate: /extension selects the operation
+static void aluImmediate(std::vector<uint8_t>& out, int extension, int dest, int32_t value) {
+    if (fitsInByte(value)) {
+        emitRR(out, 0, true, {0x83}, extension, dest);
+        out.push_back(static_cast<uint8_t>(value));
+    } else {
+        emitRR(out, 0, true, {0x81}, extension, dest);
+        emit32(out, value);
+    }
+}
+
+static void push(std::vector<uint8_t>& out, int reg) {
+    emitRex(out, false, 0, reg);
+    out.push_back(0x50 + (reg & 7));
+}
+
+static void pop(std::vector<uint8_t>& out, int reg) {
+    emitRex(out, false, 0, reg);
+    out.push_back(0x58 + (reg & 7));
+}
+
+static void movaps(std::vector<uint8_t>& out, int dest, int src) {
+    if (dest != src) emitRR(out, 0, false, {0x0f, 0x28}, dest, src);
+}
+
+// Group-1 ALU operations: opcode of the "r/m, reg" form and /extension of
+// the immediate forms
+struct AluOperation {
+    uint8_t opcode;
+    int extension;
+    bool commutative;
+};
+
+static bool aluOperation(Instruction::OpCode opcode, AluOperation& op) {
+    switch (opcode) {
+        case Instruction::ADD: op = {0x01, 0, true}; return true;
+        case Instruction::OR:  op = {0x09, 1, true}; return true;
+        case Instruction::AND: op = {0x21, 4, true}; return true;
+        case Instruction::SUB: op = {0x29, 5, false}; return true;
+        case Instruction::XOR: op = {0x31, 6, true}; return true;
+        default: return false;
+    }
+}
+
+// Condition codes of Jcc/SETcc: signed after CMP, unsigned after ucomisd.
+// After ucomisd only ja and jae are false for unordered operands, so float
+// < and <= are generated with their operands swapped.
+static uint8_t conditionCode(Instruction::OpCode opcode, bool float_flags) {
+    switch (opcode) {
+        case Instruction::JE: return 0x4;
+        case Instruction::JNE: return 0x5;
+        case Instruction::JL: return float_flags ? 0x2 : 0xc;
+        case Instruction::JLE: return float_flags ? 0x6 : 0xe;
+        case Instruction::JG: return float_flags ? 0x7 : 0xf;
+        case Instruction::JGE: return float_flags ? 0x3 : 0xd;
+        default: return 0x4;
+    }
+}
+
+X86Encoder::X86Encoder(const RegisterFile& file)
+    : file(file), func(nullptr), frame_bytes(0), float_flags(false) {}
+
+int X86Encoder::encoding(VReg reg) const {
+    const Register& info = func->getRegister(reg);
+    return info.physical >= 0 ? file.get(info.type == Register::FLOAT, info.physical).encoding : 0;
+}
+
+bool X86Encoder::isFloat(VReg reg) const {
+    return func->getRegister(reg).type == Register::FLOAT;
+}
+
+// push rbp; mov rbp, rsp; room for the spill slots and saved xmm
+// registers; pushes of the saved general registers, padded so calls see a
+// 16-byte aligned stack
+void X86Encoder::beginFunction(const Function& function, std::vector<uint8_t>& out) {
+    func = &function;
+    float_flags = false;
+    saved_general.clear();
+    for (int physical : func->saved_general) {
+        if (physical != file.frame_pointer && physical != file.stack_pointer) {
+            saved_general.push_back(file.general[physical].encoding);
+        }
+    }
+    frame_bytes = func->stack_size + 16 * static_cast<int>(func->saved_floating.size());
+
+    push(out, RBP);
+    movRR(out, RBP, RSP);
+    if (frame_bytes > 0) aluImmediate(out, 5, RSP, frame_bytes);
+    for (size_t i = 0; i < func->saved_floating.size(); ++i) {
+        // movdqu [rbp - stack_size - 16 * (i + 1)], xmm
+        int xmm = file.floating[func->saved_floating[i]].encoding;
+        emitRM(out, 0xf3, false, {0x0f, 0x7f}, xmm, RBP, -func->stack_size - 16 * static_cast<int>(i + 1));
+    }
+    for (int reg : saved_general) push(out, reg);
+    if (saved_general.size() % 2 != 0) aluImmediate(out, 5, RSP, 8);
+}
+
+void X86Encoder::epilogue(std::vector<uint8_t>& out) const {
+    // lea rsp, [rbp - frame - pushes] drops the padding whatever the body did
+    int pushed = 8 * static_cast<int>(saved_general.size());
+    if (!saved_general.empty()) emitRM(out, 0, true, {0x8d}, RSP, RBP, -frame_bytes - pushed);
+    for (auto it = saved_general.rbegin(); it != saved_general.rend(); ++it) pop(out, *it);
+    for (size_t i = 0; i < func->saved_floating.size(); ++i) {
+        int xmm = file.floating[func->saved_floating[i]].encoding;
+        emitRM(out, 0xf3, false, {0x0f, 0x6f}, xmm, RBP, -func->stack_size - 16 * static_cast<int>(i + 1));
+    }
+    out.push_back(0xc9);    // leave
+}
+
+// ADD, SUB, AND, OR and XOR d, a, b or d, a, #imm
+void X86Encoder::binary(const Instruction& instr, std::vector<uint8_t>& out) const {
+    AluOperation op = {0, 0, false};
+    aluOperation(instr.opcode, op);
+    int dest = encoding(instr.operands[0]);
+    int left = encoding(instr.operands[1]);
+    if (instr.num_operands == 2) {
+        movRR(out, dest, left);
+        aluImmediate(out, op.extension, dest, instr.has_immediate ? instr.immediate : 0);
+        return;
+    }
+
+    int right = encoding(instr.operands[2]);
+    if (dest == left) {
+        emitRR(out, 0, true, {op.opcode}, right, dest);
+    } else if (dest == right && op.commutative) {
+        emitRR(out, 0, true, {op.opcode}, left, dest);
+    } else if (dest == right) {
+        // d = a - d: neg d; add d, a
+        emitRR(out, 0, true, {0xf7}, 3, dest);
+        emitRR(out, 0, true, {0x01}, left, dest);
+    } else {
+        movRR(out, dest, left);
+        emitRR(out, 0, true, {op.opcode}, right, dest);
+    }
+}
+
+// idiv needs the dividend in rdx:rax. Whatever lives in rax and rdx is
+// saved on the stack, and the divisor is pushed too so that it survives
+// whichever of them it was in.
+void X86Encoder::divide(const Instruction& instr, std::vector<uint8_t>& out) const {
+    int dest = encoding(instr.operands[0]);
+    int left = encoding(instr.operands[1]);
+    int result = instr.opcode == Instruction::DIV ? RAX : RDX;
+
+    if (dest != RDX) push(out, RDX);
+    if (dest != RAX) push(out, RAX);
+    if (instr.num_operands == 3) {
+        push(out, encoding(instr.operands[2]));
+    } else {
+        out.push_back(0x68);    // push imm32
+        emit32(out, instr.has_immediate ? instr.immediate : 1);
+    }
+    movRR(out, RAX, left);
+    out.push_back(0x48);        // cqo
+    out.push_back(0x99);
+    emitRM(out, 0, true, {0xf7}, 7, RSP, 0);    // idiv qword [rsp]
+    aluImmediate(out, 0, RSP, 8);
+    movRR(out, dest, result);
+    if (dest != RAX) pop(out, RAX);
+    if (dest != RDX) pop(out, RDX);
+}
+
+// SHL and SHR (arithmetic) d, a, b or d, a, #imm. A register count must be
+// in cl; the value is shifted in a borrowed register so neither rcx nor
+// the destination is disturbed before the result is ready.
+void X86Encoder::shift(const Instruction& instr, std::vector<uint8_t>& out) const {
+    int extension = instr.opcode == Instruction::SHL ? 4 : 7;
+    int dest = encoding(instr.operands[0]);
+    int left = encoding(instr.operands[1]);
+    if (instr.num_operands == 2) {
+        movRR(out, dest, left);
+        emitRR(out, 0, true, {0xc1}, extension, dest);
+        out.push_back(static_cast<uint8_t>(instr.has_immediate ? instr.immediate & 63 : 0));
+        return;
+    }
+
+    int count = encoding(instr.operands[2]);
+    if (count == RCX && dest != RCX) {
+        movRR(out, dest, left);
+        emitRR(out, 0, true, {0xd3}, extension, dest);
+        return;
+    }
+    int temp = RAX;
+    for (int candidate : {RAX, RDX, 3, 6, 7, 8, 9}) {
+        if (candidate != dest && candidate != left && candidate != count) {
+            temp = candidate;
+            break;
+        }
+    }
+    push(out, temp);
+    if (dest != RCX) push(out, RCX);
+    movRR(out, temp, left);
+    movRR(out, RCX, count);
+    emitRR(out, 0, true, {0xd3}, extension, temp);
+    movRR(out, dest, temp);
+    if (dest != RCX) pop(out, RCX);
+    pop(out, temp);
+}
+
+// FADD, FSUB, FMUL and FDIV d, a, b as addsd, subsd, mulsd and divsd
+void X86Encoder::floatBinary(const Instruction& instr, std::vector<uint8_t>& out) const {
+    uint8_t opcode;
+    bool commutative = false;
+    switch (instr.opcode) {
+        case Instruction::FADD: opcode = 0x58; commutative = true; break;
+        case Instruction::FMUL: opcode = 0x59; commutative = true; break;
+        case Instruction::FSUB: opcode = 0x5c; break;
+        default: opcode = 0x5e; break;
+    }
+    int dest = encoding(instr.operands[0]);
+    int left = encoding(instr.operands[1]);
+    int right = encoding(instr.operands[2]);
+    if (dest == left) {
+        emitRR(out, 0xf2, false, {0x0f, opcode}, dest, right);
+    } else if (dest == right && commutative) {
+        emitRR(out, 0xf2, false, {0x0f, opcode}, dest, left);
+    } else if (dest == right) {
+        // The right operand goes through the stack before dest is overwritten
+        aluImmediate(out, 5, RSP, 8);
+        emitRM(out, 0xf2, false, {0x0f, 0x11}, right, RSP, 0);
+        movaps(out, dest, left);
+        emitRM(out, 0xf2, false, {0x0f, opcode}, dest, RSP, 0);
+        aluImmediate(out, 0, RSP, 8);
+    } else {
+        movaps(out, dest, left);
+        emitRR(out, 0xf2, false, {0x0f, opcode}, dest, right);
+    }
+}
+
+// Jcc or JMP (condition 0xff) in the rel8 or rel32 form
+void X86Encoder::branch(uint8_t condition, bool short_branch, uint32_t label, std::vector<uint8_t>& out,
+                        std::vector<Fixup>& fixups) const {
+    if (short_branch) {
+        out.push_back(condition == 0xff ? 0xeb : 0x70 + condition);
+        fixups.emplace_back(Fixup::LABEL, Fixup::REL8, out.size(), out.size() + 1, label);
+        out.push_back(0);
+    } else {
+        if (condition == 0xff) {
+            out.push_back(0xe9);
+        } else {
+            out.push_back(0x0f);
+            out.push_back(0x80 + condition);
+        }
+        fixups.emplace_back(Fixup::LABEL, Fixup::REL32, out.size(), out.size() + 4, label);
+        emit32(out, 0);
+    }
+}
+
+void X86Encoder::encode(const Instruction& instr, bool short_branch, std::vector<uint8_t>& out,
+                        std::vector<Fixup>& fixups) {
+    const VReg* ops = instr.operands;
+    switch (instr.opcode) {
+        case Instruction::MOV:
+            if (instr.num_operands == 1) {
+                if (!isFloat(ops[0])) {
+                    movImmediate(out, encoding(ops[0]), instr.immediate);
+                } else {
+                    // Float constants are the bits of a double, sign-extended
+                    // from the immediate: through the scratch register, then
+                    // movq xmm, r64
+                    int scratch = file.general[file.scratch_general[0]].encoding;
+                    movImmediate(out, scratch, instr.immediate);
+                    emitRR(out, 0x66, true, {0x0f, 0x6e}, encoding(ops[0]), scratch);
+                }
+            } else if (isFloat(ops[0]) && isFloat(ops[1])) {
+                movaps(out, encoding(ops[0]), encoding(ops[1]));
+            } else if (isFloat(ops[0])) {
+                emitRR(out, 0x66, true, {0x0f, 0x6e}, encoding(ops[0]), encoding(ops[1]));
+            } else if (isFloat(ops[1])) {
+                emitRR(out, 0x66, true, {0x0f, 0x7e}, encoding(ops[1]), encoding(ops[0]));
+            } else {
+                movRR(out, encoding(ops[0]), encoding(ops[1]));
+            }
+            break;
+
+        case Instruction::LOAD:
+            if (isFloat(ops[0])) {
+                emitRM(out, 0xf2, false, {0x0f, 0x10}, encoding(ops[0]), encoding(ops[1]), instr.immediate);
+            } else {
+                emitRM(out, 0, true, {0x8b}, encoding(ops[0]), encoding(ops[1]), instr.immediate);
+            }
+            break;
+
+        case Instruction::STORE:
+            if (isFloat(ops[0])) {
+                emitRM(out, 0xf2, false, {0x0f, 0x11}, encoding(ops[0]), encoding(ops[1]), instr.immediate);
+            } else {
+                emitRM(out, 0, true, {0x89}, encoding(ops[0]), encoding(ops[1]), instr.immediate);
+            }
+            break;
+
+        case Instruction::ADDR:
+            leaRip(out, encoding(ops[0]), Fixup::DATA, instr.label, fixups);
+            break;
+
+        case Instruction::ADD: case Instruction::SUB:
+        case Instruction::AND: case Instruction::OR: case Instruction::XOR:
+            binary(instr, out);
+            float_flags = false;
+            break;
+
+        case Instruction::MUL: {
+            int dest = encoding(ops[0]);
+            int left = encoding(ops[1]);
+            if (instr.num_operands == 2) {
+                // imul r64, r/m64, imm8/imm32
+                int32_t value = instr.has_immediate ? instr.immediate : 1;
+                emitRR(out, 0, true, {static_cast<uint8_t>(fitsInByte(value) ? 0x6b : 0x69)}, dest, left);
+                if (fitsInByte(value)) {
+                    out.push_back(static_cast<uint8_t>(value));
+                } else {
+                    emit32(out, value);
+                }
+            } else {
+                int right = encoding(ops[2]);
+                if (dest == right) std::swap(left, right);
+                movRR(out, dest, left);
+                emitRR(out, 0, true, {0x0f, 0xaf}, dest, right);
+            }
+            break;
+        }
+
+        case Instruction::DIV: case Instruction::MOD:
+            divide(instr, out);
+            break;
+
+        case Instruction::FADD: case Instruction::FSUB: case Instruction::FMUL: case Instruction::FDIV:
+            floatBinary(instr, out);
+            break;
+
+        case Instruction::CVTI2F:
+            // cvtsi2sd xmm, r64
+            emitRR(out, 0xf2, true, {0x0f, 0x2a}, encoding(ops[0]), encoding(ops[1]));
+            break;
+
+        case Instruction::CVTF2I:
+            // cvttsd2si r64, xmm
+            emitRR(out, 0xf2, true, {0x0f, 0x2c}, encoding(ops[0]), encoding(ops[1]));
+            break;
+
+        case Instruction::CVTS2D:
+            // cvtss2sd xmm, xmm
+            emitRR(out, 0xf3, false, {0x0f, 0x5a}, encoding(ops[0]), encoding(ops[1]));
+            break;
+
+        case Instruction::NOT:
+            movRR(out, encoding(ops[0]), encoding(ops[1]));
+            emitRR(out, 0, true, {0xf7}, 2, encoding(ops[0]));
+            break;
+
+        case Instruction::SHL: case Instruction::SHR:
+            shift(instr, out);
+            break;
+
+        case Instruction::CMP:
+            if (instr.num_operands == 2) {
+                emitRR(out, 0, true, {0x39}, encoding(ops[1]), encoding(ops[0]));
+            } else if (!instr.has_immediate || instr.immediate == 0) {
+                emitRR(out, 0, true, {0x85}, encoding(ops[0]), encoding(ops[0]));    // test r, r
+            } else {
+                aluImmediate(out, 7, encoding(ops[0]), instr.immediate);
+            }
+            float_flags = false;
+            break;
+
+        case Instruction::FCMP:
+            // ucomisd sets ZF, PF and CF like an unsigned compare
+            emitRR(out, 0x66, false, {0x0f, 0x2e}, encoding(ops[0]), encoding(ops[1]));
+            float_flags = true;
+            break;
+
+        case Instruction::JMP:
+            branch(0xff, short_branch, instr.label, out, fixups);
+            break;
+
+        case Instruction::JE: case Instruction::JNE: case Instruction::JL:
+        case Instruction::JLE: case Instruction::JG: case Instruction::JGE:
+            // An unordered ucomisd sets ZF as well as PF: equal needs PF
+            // clear, and not-equal also holds when PF is set
+            if (float_flags && instr.opcode == Instruction::JE) {
+                out.push_back(0x7a);                        // jp over the je
+                out.push_back(short_branch ? 2 : 6);
+            } else if (float_flags && instr.opcode == Instruction::JNE) {
+                branch(0xa, short_branch, instr.label, out, fixups);
+            }
+            branch(conditionCode(instr.opcode, float_flags), short_branch, instr.label, out, fixups);
+            break;
+
+        case Instruction::JZ: case Instruction::JNZ:
+            emitRR(out, 0, true, {0x85}, encoding(ops[0]), encoding(ops[0]));
+            float_flags = false;
+            branch(instr.opcode == Instruction::JZ ? 0x4 : 0x5, short_branch, instr.label, out, fixups);
+            break;
+
+        case Instruction::JMPT: {
+            // lea base, [rip + table]; movsxd offset, [base + index * 4];
+            // add offset, base; jmp offset. An index held in a scratch
+            // register is a spill reload that dies here, so it may take
+            // the offset.
+            int index = encoding(ops[0]);
+            int base = index == 11 ? 10 : 11;
+            int offset = base == 11 ? 10 : 11;
+            leaRip(out, base, Fixup::TABLE, instr.label, fixups);
+            out.push_back(0x48 | ((offset & 8) ? 4 : 0) | ((index & 8) ? 2 : 0) | ((base & 8) ? 1 : 0));
+            out.push_back(0x63);
+            out.push_back(((offset & 7) << 3) | 4);
+            out.push_back((2 << 6) | ((index & 7) << 3) | (base & 7));
+            emitRR(out, 0, true, {0x01}, base, offset);
+            emitRR(out, 0, false, {0xff}, 4, offset);
+            break;
+        }
+
+        case Instruction::CALL:
+            if (instr.label) {
+                out.push_back(0xe8);
+                fixups.emplace_back(Fixup::SYMBOL, Fixup::REL32, out.size(), out.size() + 4, instr.label);
+                emit32(out, 0);
+            } else {
+                emitRR(out, 0, false, {0xff}, 2, encoding(ops[instr.num_operands - 1]));
+            }
+            break;
+
+        case Instruction::RET:
+            epilogue(out);
+            out.push_back(0xc3);
+            break;
+
+        case Instruction::TAILCALL:
+            epilogue(out);
+            out.push_back(0xe9);
+            fixups.emplace_back(Fixup::SYMBOL, Fixup::REL32, out.size(), out.size() + 4, instr.label);
+            emit32(out, 0);
+            break;
+
+        case Instruction::PUSH:
+            if (instr.num_operands == 0) {
+                out.push_back(0x68);
+                emit32(out, instr.immediate);
+            } else if (isFloat(ops[0])) {
+                aluImmediate(out, 5, RSP, 8);
+                emitRM(out, 0xf2, false, {0x0f, 0x11}, encoding(ops[0]), RSP, 0);
+            } else {
+                push(out, encoding(ops[0]));
+            }
+            break;
+
+        case Instruction::POP:
+            if (isFloat(ops[0])) {
+                emitRM(out, 0xf2, false, {0x0f, 0x10}, encoding(ops[0]), RSP, 0);
+                aluImmediate(out, 0, RSP, 8);
+            } else {
+                pop(out, encoding(ops[0]));
+            }
+            break;
+
+        case Instruction::NOP:
+            out.push_back(0x90);
+            break;
+
+        case Instruction::LABEL:
+            break;
+    }
+}
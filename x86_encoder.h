@@ -0,0 +1,35 @@
+#pragma once
+
+#include "encoder.h"
+
+// x86-64 encoder for allocated code. Three-address operations become a
+// copy into the destination followed by the two-address instruction,
+// floats use the SSE2 scalar double-precision instructions, and operations
+// tied to fixed registers (division, shifts by a register) borrow those
+// registers by saving them on the stack. Every function gets an rbp frame
+// holding its spill slots and the callee-saved registers it uses.
+class X86Encoder : public MachineEncoder {
+public:
+    explicit X86Encoder(const RegisterFile& file);
+
+    void beginFunction(const Function& func, std::vector<uint8_t>& out) override;
+    void encode(const Instruction& instr, bool short_branch, std::vector<uint8_t>& out,
+                std::vector<Fixup>& fixups) override;
+
+private:
+    const RegisterFile& file;
+    const Function* func;
+    std::vector<int> saved_general;     // Pushed by the prologue, in push order
+    int frame_bytes;                    // Spill slots and saved xmm registers below rbp
+    bool float_flags;                   // The last compare was FCMP, so conditions read CF and ZF
+
+    int encoding(VReg reg) const;
+    bool isFloat(VReg reg) const;
+    void epilogue(std::vector<uint8_t>& out) const;
+    void binary(const Instruction& instr, std::vector<uint8_t>& out) const;
+    void divide(const Instruction& instr, std::vector<uint8_t>& out) const;
+    void shift(const Instruction& instr, std::vector<uint8_t>& out) const;
+    void floatBinary(const Instruction& instr, std::vector<uint8_t>& out) const;
+    void branch(uint8_t condition, bool short_branch, uint32_t label, std::vector<uint8_t>& out,
+                std::vector<Fixup>& fixups) const;
+};